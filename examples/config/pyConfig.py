@@ -11,6 +11,8 @@ Node = "Node"
 
 Sum = 'SUM'
 Avg = 'AVG'
+Min = 'MIN'
+Max = 'MAX'
 
 Float = 'Float'
 Integer = 'Integer'
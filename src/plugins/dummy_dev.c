@@ -1,6 +1,6 @@
-/* 
+/*
  * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
- * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
  * by or on behalf of the U.S. Government. Export of this program may require
  * a license from the United States Government.
  *
@@ -8,94 +8,417 @@
  * information, see the LICENSE file in the top level directory of the
  * distribution.
 */
-#include <sys/timeb.h>
+
+/*
+ * Synthetic device.  The open string is a ':' separated list; tokens
+ * without an '=' (e.g. "node0") only name the device, the others tune it:
+ *
+ *   latency=<us>   cost of each read/readv (default 0)
+ *   jitter=<us>    uniformly distributed extra cost per read (default 0)
+ *   wait=<mode>    "sleep" (default) or "busy" to spin for the cost
+ *   fail=<rate>    fraction of reads that fail, 0.0 - 1.0 (default 0)
+ *   wave=<shape>   "const" (default), "sine", "step" or "walk"
+ *   amp=<value>    waveform amplitude (default 1.0)
+ *   period=<s>     sine/step period or random walk step interval (default 1.0)
+ *   seed=<n>       seed for jitter, failures and the random walk (default 1)
+ *   dt=<s>         advance time by dt per read instead of using the clock
+ *   energy=mono    energy is the integral of power instead of a constant
+ *
+ * e.g. "node0:latency=50:jitter=10:wave=sine:amp=5:energy=mono".  The
+ * waveform is added to the written (or default) value of every attribute
+ * except a monotonic energy counter.
+ *
+ * Reads, the sampling thread's reads and the random walk each draw from a
+ * stream of their own, and the sampling thread never advances a dt clock,
+ * so the values read with a seed do not depend on when samples are taken.
+ */
+
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/time.h>
 
 #include "pwr_dev.h"
 #include "util.h"
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 typedef struct {
     char config[100];
 } dummyDevInfo_t;
 
-#define BUFFER_LEN 10
+typedef enum {
+    DUMMY_WAVE_CONST = 0,
+    DUMMY_WAVE_SINE,
+    DUMMY_WAVE_STEP,
+    DUMMY_WAVE_WALK
+} dummyWave_t;
 
 typedef struct {
-	double values[BUFFER_LEN];
-	PWR_Time timeStamps[BUFFER_LEN];
-} buffer_t;
+    double latency;
+    double jitter;
+    int busy;
+    double failRate;
+    dummyWave_t wave;
+    double amp;
+    double period;
+    double dt;
+    int monotonic;
+    unsigned long long seed;
+} dummyConfig_t;
 
 typedef struct {
-	buffer_t buffers[PWR_NUM_ATTR_NAMES];
+    dummyConfig_t cfg;
+    pthread_mutex_t lock;
+    unsigned long long rng;
+    unsigned long long logRng;
+    unsigned long long walkRng;
+
+	double values[PWR_NUM_ATTR_NAMES];
+
+    PWR_Time start;
+    unsigned long long reads;
+    double now;
+
+    long long walkTick;
+    double walk;
+
+    double energy;
+    double power;
 } dummyFdInfo_t;
 
-static double getTime() {
+static PWR_Time getTime() {
     struct timeval tv;
     gettimeofday(&tv,NULL);
-	double value; 
-    value = tv.tv_sec * 1000000000;
-    value += tv.tv_usec * 1000;
-	return value;
+    return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000;
+}
+
+/* xorshift64*, so runs with the same seed are reproducible */
+static double dummy_rand( unsigned long long* rng )
+{
+    *rng ^= *rng >> 12;
+    *rng ^= *rng << 25;
+    *rng ^= *rng >> 27;
+    return (double)((*rng * 2685821657736338717ULL) >> 11) / (double)(1ULL << 53);
+}
+
+/* a stream of the seed, xorshift must not start at 0 */
+static unsigned long long dummy_stream( unsigned long long seed, unsigned long long mix )
+{
+    return ( seed ^ mix ) ? seed ^ mix : 1;
+}
+
+static void dummy_delay( dummyFdInfo_t* info, unsigned long long* rng )
+{
+    double delay = info->cfg.latency;
+    struct timespec ts, end;
+
+    if ( info->cfg.jitter > 0.0 ) {
+        delay += info->cfg.jitter * dummy_rand( rng );
+    }
+    if ( delay <= 0.0 ) {
+        return;
+    }
+
+    if ( ! info->cfg.busy ) {
+        ts.tv_sec = (time_t)delay;
+        ts.tv_nsec = (long)((delay - ts.tv_sec) * 1000000000.0);
+        while ( nanosleep( &ts, &ts ) );
+        return;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    end.tv_sec += (time_t)delay;
+    end.tv_nsec += (long)((delay - (time_t)delay) * 1000000000.0);
+    if ( end.tv_nsec >= 1000000000 ) {
+        end.tv_sec++;
+        end.tv_nsec -= 1000000000;
+    }
+    do {
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+    } while ( ts.tv_sec < end.tv_sec ||
+            ( ts.tv_sec == end.tv_sec && ts.tv_nsec < end.tv_nsec ) );
 }
-  
+
+static double dummy_wave( dummyFdInfo_t* info, double t )
+{
+    switch ( info->cfg.wave ) {
+    case DUMMY_WAVE_SINE:
+        return info->cfg.amp * sin( 2.0 * M_PI * t / info->cfg.period );
+    case DUMMY_WAVE_STEP:
+        return fmod( t, info->cfg.period ) < info->cfg.period / 2.0 ? 0.0 : info->cfg.amp;
+    case DUMMY_WAVE_WALK:
+        while ( info->walkTick < (long long)( t / info->cfg.period ) ) {
+            info->walk += info->cfg.amp * ( 2.0 * dummy_rand( &info->walkRng ) - 1.0 );
+            info->walkTick++;
+        }
+        return info->walk;
+    default:
+        return 0.0;
+    }
+}
+
+/* advance the device clock and integrate power into the energy counter,
+ * only a counted read steps a dt clock */
+static PWR_Time dummy_update( dummyFdInfo_t* info, int counted )
+{
+    double now, power;
+    PWR_Time ts;
+
+    if ( info->cfg.dt > 0.0 ) {
+        if ( counted ) {
+            ++info->reads;
+        }
+        now = info->reads * info->cfg.dt;
+        ts = info->start + (PWR_Time)( now * 1000000000.0 );
+    } else {
+        ts = getTime();
+        now = (double)( ts - info->start ) / 1000000000.0;
+    }
+
+    if ( now > info->now ) {
+        power = info->values[PWR_ATTR_POWER] + dummy_wave( info, now );
+        info->energy += 0.5 * ( info->power + power ) * ( now - info->now );
+        info->power = power;
+        info->now = now;
+    }
+
+    return ts;
+}
+
+static double dummy_value( dummyFdInfo_t* info, PWR_AttrName type )
+{
+    if ( type == PWR_ATTR_ENERGY && info->cfg.monotonic ) {
+        return info->energy;
+    }
+    return info->values[type] + dummy_wave( info, info->now );
+}
+
+static int dummy_parse( dummyConfig_t* cfg, const char* openstr )
+{
+    char* str = strdup( openstr ? openstr : "" );
+    char* token, *value, *save;
+
+    cfg->busy = 0;
+    cfg->latency = cfg->jitter = cfg->failRate = cfg->dt = 0.0;
+    cfg->wave = DUMMY_WAVE_CONST;
+    cfg->amp = 1.0;
+    cfg->period = 1.0;
+    cfg->monotonic = 0;
+    cfg->seed = 1;
+
+    for ( token = strtok_r( str, ":", &save ); token;
+                        token = strtok_r( NULL, ":", &save ) ) {
+        if ( ( value = strchr( token, '=' ) ) == 0x0 ) {
+            continue;
+        }
+        *value++ = '\0';
+
+        if ( ! strcmp( token, "latency" ) ) {
+            cfg->latency = atof( value ) / 1000000.0;
+        } else if ( ! strcmp( token, "jitter" ) ) {
+            cfg->jitter = atof( value ) / 1000000.0;
+        } else if ( ! strcmp( token, "wait" ) ) {
+            cfg->busy = ! strcmp( value, "busy" );
+        } else if ( ! strcmp( token, "fail" ) ) {
+            cfg->failRate = atof( value );
+        } else if ( ! strcmp( token, "wave" ) ) {
+            if ( ! strcmp( value, "sine" ) ) {
+                cfg->wave = DUMMY_WAVE_SINE;
+            } else if ( ! strcmp( value, "step" ) ) {
+                cfg->wave = DUMMY_WAVE_STEP;
+            } else if ( ! strcmp( value, "walk" ) ) {
+                cfg->wave = DUMMY_WAVE_WALK;
+            } else if ( strcmp( value, "const" ) ) {
+                fprintf( stderr, "Error: unknown dummy waveform `%s`\n", value );
+                free( str );
+                return -1;
+            }
+        } else if ( ! strcmp( token, "amp" ) ) {
+            cfg->amp = atof( value );
+        } else if ( ! strcmp( token, "period" ) ) {
+            cfg->period = atof( value );
+        } else if ( ! strcmp( token, "seed" ) ) {
+            cfg->seed = strtoull( value, NULL, 0 );
+        } else if ( ! strcmp( token, "dt" ) ) {
+            cfg->dt = atof( value );
+        } else if ( ! strcmp( token, "energy" ) ) {
+            cfg->monotonic = ! strcmp( value, "mono" );
+        } else {
+            fprintf( stderr, "Error: unknown dummy option `%s`\n", token );
+            free( str );
+            return -1;
+        }
+    }
+    free( str );
+
+    if ( cfg->period <= 0.0 ) {
+        fprintf( stderr, "Error: dummy period must be positive\n" );
+        return -1;
+    }
+    return 0;
+}
+
 static pwr_fd_t dummy_dev_open( plugin_devops_t* ops, const char *openstr )
 {
-    dummyFdInfo_t *tmp = malloc( 2*sizeof( dummyFdInfo_t ) );
-    tmp->buffers[PWR_ATTR_POWER].values[0] = 10.1234;
-    tmp->buffers[PWR_ATTR_ENERGY].values[0] = 100000000;
+    dummyFdInfo_t *tmp = malloc( sizeof( dummyFdInfo_t ) );
+    bzero( tmp, sizeof( dummyFdInfo_t ) );
+
+    if ( dummy_parse( &tmp->cfg, openstr ) ) {
+        free( tmp );
+        return 0x0;
+    }
+
+    pthread_mutex_init( &tmp->lock, NULL );
+    tmp->rng = dummy_stream( tmp->cfg.seed, 0x9e3779b97f4a7c15ULL );
+    tmp->logRng = dummy_stream( tmp->cfg.seed, 0xbf58476d1ce4e5b9ULL );
+    tmp->walkRng = dummy_stream( tmp->cfg.seed, 0x94d049bb133111ebULL );
+
+    tmp->values[PWR_ATTR_POWER] = 10.1234;
+    tmp->values[PWR_ATTR_ENERGY] = 100000000;
+    tmp->energy = tmp->values[PWR_ATTR_ENERGY];
+    tmp->power = tmp->values[PWR_ATTR_POWER] + dummy_wave( tmp, 0.0 );
+    tmp->start = getTime();
+
     DBGP("`%s` ptr=%p\n",openstr,tmp);
+    pwr_dev_log_open( ops, tmp );
+
     return tmp;
 }
 
 static int dummy_dev_close( pwr_fd_t fd )
 {
     DBGP("\n");
+    pwr_dev_log_close( fd );
+    pthread_mutex_destroy( &((dummyFdInfo_t*) fd)->lock );
     free( fd );
 
     return 0;
 }
 
-static int dummy_dev_read( pwr_fd_t fd, PWR_AttrName type, void* ptr, unsigned int len, PWR_Time* ts )
+static int dummy_read( dummyFdInfo_t* info, unsigned long long* rng, int counted,
+                        PWR_AttrName type, void* ptr, PWR_Time* ts )
 {
+    PWR_Time now;
+
+    pthread_mutex_lock( &info->lock );
+
+    dummy_delay( info, rng );
+    if ( info->cfg.failRate > 0.0 && dummy_rand( rng ) < info->cfg.failRate ) {
+        pthread_mutex_unlock( &info->lock );
+        DBGP("%p type=%s injected failure\n", info, attrNameToString(type));
+        return PWR_RET_FAILURE;
+    }
 
-    *(double*)ptr = ((dummyFdInfo_t*) fd)->buffers[type].values[0];
+    now = dummy_update( info, counted );
+    *(double*)ptr = dummy_value( info, type );
 
-    DBGP("%p type=%s %f\n", fd, attrNameToString(type),*(double*)ptr);
+    pthread_mutex_unlock( &info->lock );
+
+    DBGP("%p type=%s %f\n", info, attrNameToString(type),*(double*)ptr);
 
     if ( ts ) {
-		*ts = getTime();
+		*ts = now;
     }
 
     return PWR_RET_SUCCESS;
 }
 
+static int dummy_dev_read( pwr_fd_t fd, PWR_AttrName type, void* ptr, unsigned int len, PWR_Time* ts )
+{
+    dummyFdInfo_t* info = (dummyFdInfo_t*) fd;
+
+    return dummy_read( info, &info->rng, 1, type, ptr, ts );
+}
+
+/* the sampling thread's read, it leaves the reads' stream and clock alone */
+static int dummy_dev_log_read( pwr_fd_t fd, PWR_AttrName type, void* ptr, unsigned int len, PWR_Time* ts )
+{
+    dummyFdInfo_t* info = (dummyFdInfo_t*) fd;
+
+    return dummy_read( info, &info->logRng, 0, type, ptr, ts );
+}
+
 static int dummy_dev_write( pwr_fd_t fd, PWR_AttrName type, void* ptr, unsigned int len )
 {
+    dummyFdInfo_t* info = (dummyFdInfo_t*) fd;
+
     DBGP("type=%s %f\n",attrNameToString(type), *(double*)ptr);
 
-    ((dummyFdInfo_t*) fd)->buffers[type].values[0] = *(double*)ptr;
+    pthread_mutex_lock( &info->lock );
+    info->values[type] = *(double*)ptr;
+    if ( type == PWR_ATTR_ENERGY ) {
+        info->energy = *(double*)ptr;
+    }
+    pthread_mutex_unlock( &info->lock );
+
     return PWR_RET_SUCCESS;
 }
 
+/* a readv costs one device access; failures hit the whole batch */
 static int dummy_dev_readv( pwr_fd_t fd, unsigned int arraysize, const PWR_AttrName attrs[], void* buf,
                         PWR_Time ts[], int status[] )
 {
-    int i;
+    dummyFdInfo_t* info = (dummyFdInfo_t*) fd;
+    PWR_Time now;
+    int i, failed;
+
+    pthread_mutex_lock( &info->lock );
+
+    dummy_delay( info, &info->rng );
+    failed = info->cfg.failRate > 0.0 && dummy_rand( &info->rng ) < info->cfg.failRate;
+    now = dummy_update( info, 1 );
+
     for ( i = 0; i < arraysize; i++ ) {
 
-        ((double*)buf)[i] = ((dummyFdInfo_t*) fd)->buffers[attrs[i]].values[0];
+        ((double*)buf)[i] = dummy_value( info, attrs[i] );
 
         DBGP("type=%s %f\n",attrNameToString(attrs[i]), ((double*)buf)[i]);
 
-        ts[i] = getTime();
+        ts[i] = now;
 
-        status[i] = PWR_RET_SUCCESS;
+        status[i] = failed ? PWR_RET_FAILURE : PWR_RET_SUCCESS;
     }
-    return PWR_RET_SUCCESS;
+
+    pthread_mutex_unlock( &info->lock );
+
+    return failed ? PWR_RET_FAILURE : PWR_RET_SUCCESS;
+}
+
+/* a readm costs one device access for all descriptors in it */
+static int dummy_dev_readm( pwr_fd_t fds[], unsigned int nfds, const PWR_AttrName attrs[], void* buf,
+                        PWR_Time ts[], int status[] )
+{
+    int i, ret = PWR_RET_SUCCESS;
+
+    for ( i = 0; i < nfds; i++ ) {
+        dummyFdInfo_t* info = (dummyFdInfo_t*) fds[i];
+
+        pthread_mutex_lock( &info->lock );
+
+        if ( i == 0 ) {
+            dummy_delay( info, &info->rng );
+        }
+        if ( info->cfg.failRate > 0.0 && dummy_rand( &info->rng ) < info->cfg.failRate ) {
+            status[i] = ret = PWR_RET_FAILURE;
+        } else {
+            status[i] = PWR_RET_SUCCESS;
+        }
+        ts[i] = dummy_update( info, 1 );
+        ((double*)buf)[i] = dummy_value( info, attrs[i] );
+
+        pthread_mutex_unlock( &info->lock );
+
+        DBGP("%p type=%s %f\n", fds[i], attrNameToString(attrs[i]), ((double*)buf)[i]);
+    }
+
+    return ret;
 }
 
 static int dummy_dev_writev( pwr_fd_t fd, unsigned int arraysize, const PWR_AttrName attrs[], void* buf, int status[] )
@@ -103,11 +426,7 @@ static int dummy_dev_writev( pwr_fd_t fd, unsigned int arraysize, const PWR_Attr
     int i;
     DBGP("num attributes %d\n",arraysize);
     for ( i = 0; i < arraysize; i++ ) {
-        DBGP("type=%s %f\n",attrNameToString(attrs[i]), ((double*)buf)[i]);
-
-        ((dummyFdInfo_t*) fd)->buffers[attrs[i]].values[0] = ((double*)buf)[i];
-
-        status[i] = PWR_RET_SUCCESS;
+        status[i] = dummy_dev_write( fd, attrs[i], (double*)buf + i, sizeof(double) );
     }
     return PWR_RET_SUCCESS;
 }
@@ -126,44 +445,8 @@ static int dummy_dev_clear( pwr_fd_t fd )
     return 0;
 }
 
-static int dummy_dev_log_start( pwr_fd_t fd, PWR_AttrName name )
-{
-    buffer_t* ptr = &((dummyFdInfo_t*) fd)->buffers[name];
-    DBGP("\n");
-	ptr->timeStamps[0] = getTime();
-	return PWR_RET_SUCCESS;
-}
-
-static int dummy_dev_log_stop( pwr_fd_t fd, PWR_AttrName name )
-{
-	return PWR_RET_SUCCESS;
-}
-
-static int dummy_dev_get_samples( pwr_fd_t fd, PWR_AttrName name, 
-			PWR_Time* ts, double period, unsigned int* nSamples, void* buf )
-
-{
-	DBGP("period=%f samples=%d\n",period,*nSamples);
-	struct timeb tp;
-	ftime( &tp);
-	srand((unsigned) tp.millitm );
-	int i;
-
-    struct timeval tv;
-    gettimeofday(&tv,NULL);
-
-    srand(  tv.tv_usec );
-	for ( i = 0; i < *nSamples; i++ ) {
-		((double*)buf)[i] = 100 + (float)rand()/(float)( RAND_MAX/2.0);
-		DBGP("%f\n",((double*)buf)[i]);
-	}	
-	*ts = getTime() - ( (*nSamples * period) * 1000000000);
-	DBGP("ts=%llu\n",*ts);	
-	return PWR_RET_SUCCESS;
-}
-
 static plugin_devops_t devOps = {
-    .open   = dummy_dev_open, 
+    .open   = dummy_dev_open,
     .close  = dummy_dev_close,
     .read   = dummy_dev_read,
     .write  = dummy_dev_write,
@@ -171,9 +454,9 @@ static plugin_devops_t devOps = {
     .writev = dummy_dev_writev,
     .time   = dummy_dev_time,
     .clear  = dummy_dev_clear,
-	.log_start = dummy_dev_log_start,
-	.log_stop = dummy_dev_log_stop,
-	.get_samples = dummy_dev_get_samples,
+	.log_start = pwr_dev_log_start,
+	.log_stop = pwr_dev_log_stop,
+	.get_samples = pwr_dev_get_samples,
 };
 
 static plugin_devops_t* dummy_dev_init( const char *initstr )
@@ -181,22 +464,29 @@ static plugin_devops_t* dummy_dev_init( const char *initstr )
 	plugin_devops_t* ops = malloc(sizeof(*ops));
 	*ops = devOps;
 	ops->private_data = malloc( sizeof( dummyDevInfo_t ) );
+	pwr_dev_log_init( ops, dummy_dev_log_read, PWR_DEV_LOG_PERIOD );
     return ops;
 }
 
 static int dummy_dev_final( plugin_devops_t *ops )
 {
     DBGP("\n");
+	pwr_dev_log_final( ops );
 	free( ops->private_data );
     free( ops );
     return 0;
 }
 
 static plugin_dev_t dev = {
-    .init   = dummy_dev_init, 
+    .init   = dummy_dev_init,
     .final  = dummy_dev_final,
+    .readm  = dummy_dev_readm,
 };
 
 plugin_dev_t* getDev() {
     return &dev;
 }
+
+int getDevVersion() {
+    return PWR_PLUGIN_VERSION;
+}
@@ -117,6 +117,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_apmdev_writev,
     .time         = pwr_apmdev_time,
     .clear        = pwr_apmdev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -333,6 +336,8 @@ plugin_devops_t *pwr_apmdev_init( const char *initstr )
         DBGP( "Info: node[%d].off_core_pwr_watt - %g\n", i, PWR_APMDEV(dev->private_data)->node[i].off_core_pwr_watt );
     }
 
+    pwr_dev_log_init( dev, pwr_apmdev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
@@ -340,6 +345,8 @@ int pwr_apmdev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: PWR APM device close\n" );
 
+    pwr_dev_log_final( dev );
+
     free( dev->private_data );
     free( dev );
 
@@ -351,11 +358,15 @@ pwr_fd_t pwr_apmdev_open( plugin_devops_t *dev, const char *openstr )
     pwr_fd_t *fd = malloc( sizeof(pwr_apmfd_t) );
     PWR_APMFD(fd)->dev = PWR_APMDEV(dev->private_data);
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
 int pwr_apmdev_close( pwr_fd_t fd )
 {
+    pwr_dev_log_close( fd );
+
     PWR_APMFD(fd)->dev = 0x0;
     free( fd );
 
@@ -41,6 +41,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_cpudev_writev,
     .time         = pwr_cpudev_time,
     .clear        = pwr_cpudev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -136,6 +139,8 @@ plugin_devops_t *pwr_cpudev_init( const char *initstr )
     PWR_CPUDEV(dev->private_data)->num_cpus = sysconf(_SC_NPROCESSORS_CONF);
     cpudev_avail_freq(0, PWR_CPUDEV(dev->private_data)->avail_freqlist, &(PWR_CPUDEV(dev->private_data)->num_freq));
 
+    pwr_dev_log_init( dev, pwr_cpudev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
@@ -143,6 +148,8 @@ int pwr_cpudev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: finaling PWR CPU device\n" );
 
+    pwr_dev_log_final( dev );
+
     free( dev->private_data );
     free( dev );
     return 0;
@@ -167,6 +174,8 @@ pwr_fd_t pwr_cpudev_open( plugin_devops_t *dev, const char *openstr )
 
     DBGP( "Info: extracted initialization string (CPU=%u)\n", PWR_CPUFD(fd)->cpu );
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
@@ -174,6 +183,8 @@ int pwr_cpudev_close( pwr_fd_t fd )
 {
     DBGP( "Info: closing PWR CPU descriptor\n" );
 
+    pwr_dev_log_close( fd );
+
     PWR_CPUFD(fd)->dev = 0x0;
     free( fd );
 
@@ -11,12 +11,413 @@
 
 #include "pwr_dev.h"
 
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+/*
+ * Sampling support shared by the plugins.  pwr_dev.c is linked into every
+ * plugin library, so the state below is private to the plugin using it.
+ * Each device instance a plugin creates registers its read callback with
+ * pwr_dev_log_init() and each fd it opens with pwr_dev_log_open(), the
+ * plugin can then use pwr_dev_log_start/pwr_dev_log_stop/pwr_dev_get_samples
+ * as its devops.  Each logged (fd, attr) pair owns a ring of timestamped
+ * samples filled by the sampling thread of its instance, which calls the
+ * plugin's read without holding the instance's lock.
+ */
+
+typedef struct pwr_dev_log_t {
+    pwr_fd_t fd;
+    PWR_AttrName attr;
+    int active;
+
+    unsigned int head;
+    unsigned int count;
+    double values[PWR_DEV_LOG_LEN];
+    PWR_Time timestamps[PWR_DEV_LOG_LEN];
+
+    struct pwr_dev_log_t *next;
+} pwr_dev_log_t;
+
+typedef struct pwr_dev_logger_t {
+    plugin_devops_t *dev;
+    pwr_read_t read;
+    double period;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;
+    int shutdown;
+    int num_active;
+    /* set while the thread reads, logs are not freed until it is done */
+    int sampling;
+
+    pwr_dev_log_t *logs;
+
+    pwr_fd_t *fds;
+    unsigned int num_fds;
+    unsigned int max_fds;
+
+    struct pwr_dev_logger_t *next;
+} pwr_dev_logger_t;
+
+/* the instances, the lock only covers the list and the fds of each */
+static pwr_dev_logger_t *pwr_dev_loggers;
+static pthread_mutex_t pwr_dev_loggers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pwr_dev_logger_t *pwr_dev_logger_of_fd( pwr_fd_t fd )
+{
+    pwr_dev_logger_t *logger;
+    unsigned int i;
+
+    pthread_mutex_lock( &pwr_dev_loggers_lock );
+    for( logger = pwr_dev_loggers; logger; logger = logger->next ) {
+        for( i = 0; i < logger->num_fds; i++ )
+            if( logger->fds[i] == fd )
+                break;
+        if( i < logger->num_fds )
+            break;
+    }
+    pthread_mutex_unlock( &pwr_dev_loggers_lock );
+
+    return logger;
+}
+
+static pwr_dev_log_t *pwr_dev_log_find( pwr_dev_logger_t *logger,
+    pwr_fd_t fd, PWR_AttrName attr )
+{
+    pwr_dev_log_t *log;
+
+    for( log = logger->logs; log; log = log->next )
+        if( log->fd == fd && log->attr == attr )
+            return log;
+
+    return 0x0;
+}
+
+static void pwr_dev_log_store( pwr_dev_log_t *log, double value, PWR_Time timestamp )
+{
+    log->values[log->head] = value;
+    log->timestamps[log->head] = timestamp;
+    log->head = (log->head + 1) % PWR_DEV_LOG_LEN;
+    if( log->count < PWR_DEV_LOG_LEN )
+        log->count++;
+}
+
+/* with the lock held, waits out a sweep of the sampling thread */
+static void pwr_dev_log_wait( pwr_dev_logger_t *logger )
+{
+    while( logger->sampling )
+        pthread_cond_wait( &logger->cond, &logger->lock );
+}
+
+static void pwr_dev_log_advance( struct timespec *deadline, double period )
+{
+    long long nsec = deadline->tv_nsec + (long long)(period * 1000000000.0);
+
+    deadline->tv_sec += nsec / 1000000000;
+    deadline->tv_nsec = nsec % 1000000000;
+}
+
+/*
+ * Each period the active logs are read with the lock dropped.  The logs
+ * stay put while sampling is set, close, stop and final wait for it.
+ */
+static void *pwr_dev_log_thread( void *arg )
+{
+    pwr_dev_logger_t *logger = (pwr_dev_logger_t *)arg;
+    struct timespec deadline;
+    pwr_dev_log_t *log;
+    double value;
+    PWR_Time timestamp;
+    int rc;
+
+    pthread_mutex_lock( &logger->lock );
+    clock_gettime( CLOCK_MONOTONIC, &deadline );
+
+    while( !logger->shutdown ) {
+        if( logger->num_active == 0 ) {
+            pthread_cond_wait( &logger->cond, &logger->lock );
+            clock_gettime( CLOCK_MONOTONIC, &deadline );
+            continue;
+        }
+
+        logger->sampling = 1;
+        for( log = logger->logs; log; log = log->next ) {
+            if( !log->active )
+                continue;
+            pthread_mutex_unlock( &logger->lock );
+            rc = logger->read( log->fd, log->attr, &value, sizeof(double), &timestamp );
+            pthread_mutex_lock( &logger->lock );
+            if( rc < 0 )
+                DBGP( "Info: sampling of attr %u failed\n", log->attr );
+            else
+                pwr_dev_log_store( log, value, timestamp );
+        }
+        logger->sampling = 0;
+        pthread_cond_broadcast( &logger->cond );
+
+        pthread_mutex_unlock( &logger->lock );
+        pwr_dev_log_advance( &deadline, logger->period );
+        while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) == EINTR );
+        pthread_mutex_lock( &logger->lock );
+    }
+
+    pthread_mutex_unlock( &logger->lock );
+    return 0x0;
+}
+
+void pwr_dev_log_init( plugin_devops_t *dev, pwr_read_t read, double period )
+{
+    pwr_dev_logger_t *logger = malloc( sizeof(pwr_dev_logger_t) );
+
+    bzero( logger, sizeof(pwr_dev_logger_t) );
+    logger->dev = dev;
+    logger->read = read;
+    logger->period = period > 0.0 ? period : PWR_DEV_LOG_PERIOD;
+    pthread_mutex_init( &logger->lock, NULL );
+    pthread_cond_init( &logger->cond, NULL );
+
+    pthread_mutex_lock( &pwr_dev_loggers_lock );
+    logger->next = pwr_dev_loggers;
+    pwr_dev_loggers = logger;
+    pthread_mutex_unlock( &pwr_dev_loggers_lock );
+}
+
+void pwr_dev_log_final( plugin_devops_t *dev )
+{
+    pwr_dev_logger_t **prev, *logger;
+    pwr_dev_log_t *log;
+
+    pthread_mutex_lock( &pwr_dev_loggers_lock );
+    for( prev = &pwr_dev_loggers; (logger = *prev); prev = &logger->next )
+        if( logger->dev == dev ) {
+            *prev = logger->next;
+            break;
+        }
+    pthread_mutex_unlock( &pwr_dev_loggers_lock );
+
+    if( logger == 0x0 )
+        return;
+
+    pthread_mutex_lock( &logger->lock );
+    logger->shutdown = 1;
+    pthread_cond_broadcast( &logger->cond );
+    pthread_mutex_unlock( &logger->lock );
+
+    if( logger->started )
+        pthread_join( logger->thread, NULL );
+
+    while( (log = logger->logs) ) {
+        logger->logs = log->next;
+        free( log );
+    }
+
+    pthread_cond_destroy( &logger->cond );
+    pthread_mutex_destroy( &logger->lock );
+    free( logger->fds );
+    free( logger );
+}
+
+void pwr_dev_log_open( plugin_devops_t *dev, pwr_fd_t fd )
+{
+    pwr_dev_logger_t *logger;
+
+    pthread_mutex_lock( &pwr_dev_loggers_lock );
+    for( logger = pwr_dev_loggers; logger; logger = logger->next )
+        if( logger->dev == dev )
+            break;
+    if( logger ) {
+        if( logger->num_fds == logger->max_fds ) {
+            logger->max_fds = logger->max_fds ? 2 * logger->max_fds : 8;
+            logger->fds = realloc( logger->fds, logger->max_fds * sizeof(pwr_fd_t) );
+        }
+        logger->fds[logger->num_fds++] = fd;
+    }
+    pthread_mutex_unlock( &pwr_dev_loggers_lock );
+}
+
+void pwr_dev_log_close( pwr_fd_t fd )
+{
+    pwr_dev_logger_t *logger = pwr_dev_logger_of_fd( fd );
+    pwr_dev_log_t **prev, *log;
+    unsigned int i;
+
+    if( logger == 0x0 )
+        return;
+
+    pthread_mutex_lock( &logger->lock );
+    pwr_dev_log_wait( logger );
+    prev = &logger->logs;
+    while( (log = *prev) ) {
+        if( log->fd == fd ) {
+            if( log->active )
+                logger->num_active--;
+            *prev = log->next;
+            free( log );
+        } else
+            prev = &log->next;
+    }
+    pthread_mutex_unlock( &logger->lock );
+
+    pthread_mutex_lock( &pwr_dev_loggers_lock );
+    for( i = 0; i < logger->num_fds; i++ )
+        if( logger->fds[i] == fd ) {
+            logger->fds[i] = logger->fds[--logger->num_fds];
+            break;
+        }
+    pthread_mutex_unlock( &pwr_dev_loggers_lock );
+}
+
 int pwr_dev_log_start( pwr_fd_t fd, PWR_AttrName name )
 {
+    pwr_dev_logger_t *logger = pwr_dev_logger_of_fd( fd );
+    pwr_dev_log_t *log;
+    double value;
+    PWR_Time timestamp;
+    int rc;
+
+    if( logger == 0x0 || logger->read == 0x0 )
+        return 0;
+
+    /* take the first sample now so the log is never empty once started */
+    rc = logger->read( fd, name, &value, sizeof(double), &timestamp );
+
+    pthread_mutex_lock( &logger->lock );
+
+    if( (log = pwr_dev_log_find( logger, fd, name )) == 0x0 ) {
+        log = malloc( sizeof(pwr_dev_log_t) );
+        bzero( log, sizeof(pwr_dev_log_t) );
+        log->fd = fd;
+        log->attr = name;
+        log->next = logger->logs;
+        logger->logs = log;
+    }
+
+    if( !log->active ) {
+        pwr_dev_log_wait( logger );
+        log->active = 1;
+        log->head = 0;
+        log->count = 0;
+        logger->num_active++;
+    }
+
+    if( rc < 0 )
+        DBGP( "Info: sampling of attr %u failed\n", name );
+    else
+        pwr_dev_log_store( log, value, timestamp );
+
+    if( !logger->started ) {
+        if( pthread_create( &logger->thread, NULL, pwr_dev_log_thread, logger ) ) {
+            fprintf( stderr, "Error: unable to start sampling thread\n" );
+            pthread_mutex_unlock( &logger->lock );
+            return -1;
+        }
+        logger->started = 1;
+    }
+    pthread_cond_broadcast( &logger->cond );
+
+    pthread_mutex_unlock( &logger->lock );
+
+    DBGP( "Info: started log of attr %u period=%f\n", name, logger->period );
+
     return 0;
 }
 
 int pwr_dev_log_stop( pwr_fd_t fd, PWR_AttrName name )
 {
+    pwr_dev_logger_t *logger = pwr_dev_logger_of_fd( fd );
+    pwr_dev_log_t *log;
+
+    if( logger == 0x0 )
+        return 0;
+
+    pthread_mutex_lock( &logger->lock );
+    if( (log = pwr_dev_log_find( logger, fd, name )) && log->active ) {
+        log->active = 0;
+        logger->num_active--;
+    }
+    pthread_mutex_unlock( &logger->lock );
+
+    return 0;
+}
+
+/*
+ * Resample a ring at the requested period, ending with the most recent
+ * sample.  Each output value is the latest sample taken at or before its
+ * slot; slots older than the ring are dropped from the front.
+ */
+int pwr_dev_resample( void *ring, unsigned int count, pwr_dev_sample_t sample,
+    PWR_AttrName name, PWR_Time *timestamp, double period,
+    unsigned int *nSamples, void *buf )
+{
+    PWR_Time step = (PWR_Time)(period * 1000000000.0), last, first, target;
+    unsigned int i, skip = 0, pos;
+
+    if( count == 0 )
+        return -1;
+
+    first = sample( ring, 0, name, 0x0 );
+    last = sample( ring, count - 1, name, 0x0 );
+
+    while( skip < *nSamples && (*nSamples - 1 - skip) * step > last - first )
+        skip++;
+
+    pos = count - 1;
+    for( i = *nSamples; i > skip; i-- ) {
+        target = last - (*nSamples - i) * step;
+        while( pos > 0 && sample( ring, pos, name, 0x0 ) > target )
+            pos--;
+        sample( ring, pos, name, (double *)buf + i - 1 - skip );
+    }
+
+    *nSamples -= skip;
+    *timestamp = *nSamples ? last - (*nSamples - 1) * step : last;
+
+    return 0;
+}
+
+static PWR_Time pwr_dev_log_sample( void *ring, unsigned int i,
+    PWR_AttrName name, double *value )
+{
+    pwr_dev_log_t *log = (pwr_dev_log_t *)ring;
+    unsigned int pos = (log->head + PWR_DEV_LOG_LEN - log->count + i) % PWR_DEV_LOG_LEN;
+
+    if( value )
+        *value = log->values[pos];
+
+    return log->timestamps[pos];
+}
+
+int pwr_dev_get_samples( pwr_fd_t fd, PWR_AttrName name,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf )
+{
+    pwr_dev_logger_t *logger = pwr_dev_logger_of_fd( fd );
+    pwr_dev_log_t *log = 0x0;
+
+    if( logger ) {
+        pthread_mutex_lock( &logger->lock );
+        log = pwr_dev_log_find( logger, fd, name );
+    }
+
+    if( log == 0x0 || log->count == 0 ) {
+        if( logger )
+            pthread_mutex_unlock( &logger->lock );
+        fprintf( stderr, "Error: no samples logged for attr %u\n", name );
+        return -1;
+    }
+
+    pwr_dev_resample( log, log->count, pwr_dev_log_sample, name,
+        timestamp, period, nSamples, buf );
+
+    pthread_mutex_unlock( &logger->lock );
+
+    DBGP( "Info: returning %u samples of attr %u from %llu\n",
+        *nSamples, name, (unsigned long long)*timestamp );
+
     return 0;
 }
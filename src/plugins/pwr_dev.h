@@ -18,12 +18,56 @@
 
 #define DBGP(X, ... ) DBG3( DBG_PLUGGIN, "Plugin", X, ##__VA_ARGS__ )
 
+/*
+ * When plugins are linked into libpwr (configured with USE_STATIC=yes) each
+ * one is built with PWR_STATIC_PLUGIN set to its name.  Its entry points
+ * and its copy of the code below then get names of their own, e.g.
+ * dummy_dev_getDev, which static.cc lists in its plugin table.
+ */
+#ifdef PWR_STATIC_PLUGIN
+#define PWR_STATIC_NAME2(P,N) P##_##N
+#define PWR_STATIC_NAME(P,N) PWR_STATIC_NAME2(P,N)
+
+#define getDev              PWR_STATIC_NAME(PWR_STATIC_PLUGIN,getDev)
+#define getDevVersion       PWR_STATIC_NAME(PWR_STATIC_PLUGIN,getDevVersion)
+#define pwr_dev_log_init    PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_init)
+#define pwr_dev_log_final   PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_final)
+#define pwr_dev_log_open    PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_open)
+#define pwr_dev_log_close   PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_close)
+#define pwr_dev_log_start   PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_start)
+#define pwr_dev_log_stop    PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_log_stop)
+#define pwr_dev_get_samples PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_get_samples)
+#define pwr_dev_resample    PWR_STATIC_NAME(PWR_STATIC_PLUGIN,pwr_dev_resample)
+#endif
+
+#define PWR_DEV_LOG_LEN    4096 /* samples kept per logged attribute */
+#define PWR_DEV_LOG_PERIOD 0.01 /* default sampling period in seconds */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+void pwr_dev_log_init( plugin_devops_t *dev, pwr_read_t read, double period );
+void pwr_dev_log_final( plugin_devops_t *dev );
+void pwr_dev_log_open( plugin_devops_t *dev, pwr_fd_t fd );
+void pwr_dev_log_close( pwr_fd_t fd );
+
 int pwr_dev_log_start( pwr_fd_t fd, PWR_AttrName name );
 int pwr_dev_log_stop( pwr_fd_t fd, PWR_AttrName name );
+int pwr_dev_get_samples( pwr_fd_t fd, PWR_AttrName name,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf );
+
+/*
+ * For plugins keeping their own history.  The accessor returns the
+ * timestamp of sample i of the ring, 0 being the oldest, and stores its
+ * value of attr name when value is not null.
+ */
+typedef PWR_Time (*pwr_dev_sample_t)( void *ring, unsigned int i,
+    PWR_AttrName name, double *value );
+
+int pwr_dev_resample( void *ring, unsigned int count, pwr_dev_sample_t sample,
+    PWR_AttrName name, PWR_Time *timestamp, double period,
+    unsigned int *nSamples, void *buf );
 
 #ifdef __cplusplus
 }
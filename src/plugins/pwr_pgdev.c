@@ -17,15 +17,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #ifndef USE_SYSTIME
 #include <sys/time.h>
 #endif
 
 #include <IntelPowerGadget/EnergyLib.h>
 
+/* the library keeps one sample, a read takes it and pulls from it */
 typedef struct {
     int num_nodes;
     int num_msrs;
+    pthread_mutex_t lock;
 } pwr_pgdev_t;
 #define PWR_PGDEV(X) ((pwr_pgdev_t *)(X))
 
@@ -45,6 +48,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_pgdev_writev,
     .time         = pwr_pgdev_time,
     .clear        = pwr_pgdev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -96,6 +102,9 @@ plugin_devops_t *pwr_pgdev_init( const char *initstr )
     PWR_PGDEV(dev->private_data)->num_msrs = 0;
     GetNumNodes( &(PWR_PGDEV(dev->private_data)->num_nodes) );
     GetNumMsrs( &(PWR_PGDEV(dev->private_data)->num_msrs) );
+    pthread_mutex_init( &(PWR_PGDEV(dev->private_data)->lock), NULL );
+
+    pwr_dev_log_init( dev, pwr_pgdev_read, PWR_DEV_LOG_PERIOD );
 
     return dev;
 }
@@ -104,8 +113,11 @@ int pwr_pgdev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: finalizing PWR PowerGadget device\n" );
 
+    pwr_dev_log_final( dev );
+
     StopLog();
                                                 
+    pthread_mutex_destroy( &(PWR_PGDEV(dev->private_data)->lock) );
     free( dev->private_data );
     free( dev );
 
@@ -125,6 +137,8 @@ pwr_fd_t pwr_pgdev_open( plugin_devops_t *dev, const char *openstr )
         return 0x0;
     }
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
@@ -132,6 +146,8 @@ int pwr_pgdev_close( pwr_fd_t fd )
 {
     DBGP( "Info: closing PWR PowerGadget device\n" );
 
+    pwr_dev_log_close( fd );
+
     PWR_PGFD(fd)->dev = 0x0;
     free( fd );
 
@@ -157,6 +173,7 @@ int pwr_pgdev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int le
     GetSysTime( &systime );
 #endif
 
+    pthread_mutex_lock( &(PWR_PGFD(fd)->dev)->lock );
     switch( attr ) {
         case PWR_ATTR_ENERGY:
             ReadSample();
@@ -198,6 +215,7 @@ int pwr_pgdev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int le
             fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
             break;
     }
+    pthread_mutex_unlock( &(PWR_PGFD(fd)->dev)->lock );
 #ifndef USE_SYSTIME
     *timestamp = tv.tv_sec*1000000000ULL + tv.tv_usec*1000;
 #else
@@ -16,16 +16,47 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
-typedef struct {
+/*
+ * Each device runs one streaming session with the piapi agent: every port
+ * opened on it is put into continuous collection and the callback files
+ * the samples into a ring per port.  read/readv/time/get_samples only look
+ * at those rings, the only wait is for the first sample of a port opened
+ * just before, for up to a couple of streaming periods.
+ */
+
+#define PIAPIDEV_LOG_LEN 1024 /* samples kept per port */
+#define PIAPIDEV_FREQ    10   /* default streaming frequency in Hz */
+
+typedef struct pwr_piport_t {
+    piapi_port_t port;
+    int refs;
+
+    unsigned int head;
+    unsigned int count;
+    piapi_sample_t log[PIAPIDEV_LOG_LEN];
+
+    struct pwr_piport_t *next;
+} pwr_piport_t;
+
+typedef struct pwr_piapidev_t {
     void *cntx;
+    unsigned int freq;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pwr_piport_t *ports;
+
+    struct pwr_piapidev_t *next;
 } pwr_piapidev_t;
 #define PWR_PIAPIDEV(X) ((pwr_piapidev_t *)(X))
 
 typedef struct {
     pwr_piapidev_t *dev;
-    piapi_port_t port;
+    pwr_piport_t *port;
 } pwr_pifd_t;
 #define PWR_PIAPIFD(X) ((pwr_pifd_t *)(X))
 
@@ -38,21 +69,34 @@ static plugin_devops_t devops = {
     .writev       = pwr_piapidev_writev,
     .time         = pwr_piapidev_time,
     .clear        = pwr_piapidev_clear,
-#if 0
-    .stat_get     = pwr_dev_stat_get,
-    .stat_start   = pwr_dev_stat_start,
-    .stat_stop    = pwr_dev_stat_stop,
-    .stat_clear   = pwr_dev_stat_clear,
-#endif
+    .log_start    = pwr_piapidev_log_start,
+    .log_stop     = pwr_piapidev_log_stop,
+    .get_samples  = pwr_piapidev_get_samples,
     .private_data = 0x0
 };
 
-static piapi_sample_t piapidev_counter;
-static int piapidev_reading;
+/*
+ * The callback only gets the sample, which carries the piapi context it
+ * arrived on, so each device is found by its context.
+ */
+static pwr_piapidev_t *piapidev_devs;
+static pthread_mutex_t piapidev_devs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pwr_piport_t *piapidev_port( pwr_piapidev_t *dev, piapi_port_t port )
+{
+    pwr_piport_t *p;
+
+    for( p = dev->ports; p; p = p->next )
+        if( p->port == port )
+            return p;
+
+    return 0x0;
+}
 
 static void piapidev_callback( piapi_sample_t *sample )
 {
-    piapidev_counter = *sample;
+    pwr_piapidev_t *dev;
+    pwr_piport_t *p;
 
     DBGP( "Sample on port %d:\n", sample->port);
     DBGP( "\tsample       - %u of %u\n", sample->number, sample->total );
@@ -75,12 +119,95 @@ static void piapidev_callback( piapi_sample_t *sample )
 
     DBGP( "\ttotal time   - %f\n", sample->time_total );
     DBGP( "\ttotal energy - %f\n", sample->energy );
-	
-    if( sample->total && sample->number == sample->total )
-        piapidev_reading = 0;
+
+    /* a device is unlinked before its context is destroyed */
+    pthread_mutex_lock( &piapidev_devs_lock );
+    for( dev = piapidev_devs; dev; dev = dev->next )
+        if( dev->cntx == sample->cntx )
+            break;
+
+    if( dev ) {
+        pthread_mutex_lock( &dev->lock );
+        if( (p = piapidev_port( dev, sample->port )) ) {
+            p->log[p->head] = *sample;
+            p->head = (p->head + 1) % PIAPIDEV_LOG_LEN;
+            if( p->count < PIAPIDEV_LOG_LEN )
+                p->count++;
+            pthread_cond_broadcast( &dev->cond );
+        }
+        pthread_mutex_unlock( &dev->lock );
+    }
+    pthread_mutex_unlock( &piapidev_devs_lock );
+}
+
+static int piapidev_value( const piapi_sample_t *sample, PWR_AttrName attr, double *value )
+{
+    switch( attr ) {
+        case PWR_ATTR_VOLTAGE:
+            *value = (double)sample->raw.volts;
+            break;
+        case PWR_ATTR_CURRENT:
+            *value = (double)sample->raw.amps;
+            break;
+        case PWR_ATTR_POWER:
+            *value = (double)sample->raw.watts;
+            break;
+        case PWR_ATTR_POWER_LIMIT_MIN:
+            *value = (double)sample->min.watts;
+            break;
+        case PWR_ATTR_POWER_LIMIT_MAX:
+            *value = (double)sample->max.watts;
+            break;
+        case PWR_ATTR_ENERGY:
+            *value = (double)sample->energy;
+            break;
+        default:
+            fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
+            return -1;
+    }
+
+    return 0;
+}
+
+static PWR_Time piapidev_time( const piapi_sample_t *sample )
+{
+    return sample->time_sec*1000000000ULL + sample->time_usec*1000;
+}
+
+/*
+ * Copy out the latest sample of the descriptor's port.  Collection starts
+ * when the port is opened, so the first read waits for its first sample.
+ */
+static int piapidev_latest( pwr_fd_t fd, piapi_sample_t *sample )
+{
+    pwr_piapidev_t *dev = PWR_PIAPIFD(fd)->dev;
+    pwr_piport_t *p = PWR_PIAPIFD(fd)->port;
+    struct timespec deadline;
+    unsigned long long nsec;
+    int count;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    nsec = deadline.tv_nsec + 2 * 1000000000ULL / dev->freq;
+    deadline.tv_sec += 1 + nsec / 1000000000ULL;
+    deadline.tv_nsec = nsec % 1000000000ULL;
+
+    pthread_mutex_lock( &dev->lock );
+    while( p->count == 0 )
+        if( pthread_cond_timedwait( &dev->cond, &dev->lock, &deadline ) == ETIMEDOUT )
+            break;
+    if( (count = p->count) )
+        *sample = p->log[(p->head + PIAPIDEV_LOG_LEN - 1) % PIAPIDEV_LOG_LEN];
+    pthread_mutex_unlock( &dev->lock );
+
+    if( count == 0 ) {
+        fprintf( stderr, "Error: no sample received yet for port %d\n", p->port );
+        return -1;
+    }
+
+    return 0;
 }
 
-static int piapidev_parse( const char *initstr, unsigned int *saddr, unsigned int *sport )
+static int piapidev_parse( const char *initstr, unsigned int *saddr, unsigned int *sport, unsigned int *freq )
 {
     int shift = 24;
     char *token;
@@ -103,45 +230,76 @@ static int piapidev_parse( const char *initstr, unsigned int *saddr, unsigned in
     }
     *sport = atoi(token);
 
-    DBGP( "Info: extracted initialization string (SADDR=%08x, SPORT=%u)\n", *saddr, *sport );
+    /* optional streaming frequency in Hz */
+    *freq = PIAPIDEV_FREQ;
+    if( (token = strtok( NULL, ":" )) != 0x0 && atoi(token) > 0 )
+        *freq = atoi(token);
+
+    DBGP( "Info: extracted initialization string (SADDR=%08x, SPORT=%u, FREQ=%u)\n", *saddr, *sport, *freq );
 
     return 0;
 }
 
+
 plugin_devops_t *pwr_piapidev_init( const char *initstr )
 {
-    unsigned int saddr = 0, sport = 0;
+    unsigned int saddr = 0, sport = 0, freq = 0;
 
     plugin_devops_t *dev = malloc( sizeof(plugin_devops_t) );
     *dev = devops;
 
     dev->private_data = malloc( sizeof(pwr_piapidev_t) );
     bzero( dev->private_data, sizeof(pwr_piapidev_t) );
+    pthread_mutex_init( &PWR_PIAPIDEV(dev->private_data)->lock, NULL );
+    pthread_cond_init( &PWR_PIAPIDEV(dev->private_data)->cond, NULL );
 
     DBGP( "Info: initializing PWR PowerInsight device\n" );
 
-    if( initstr == 0x0 || piapidev_parse(initstr, &saddr, &sport) < 0 ) {
+    if( initstr == 0x0 || piapidev_parse(initstr, &saddr, &sport, &freq) < 0 ) {
         fprintf( stderr, "Error: invalid monitor and control hardware initialization string\n" );
         return 0x0;
     }
+    PWR_PIAPIDEV(dev->private_data)->freq = freq;
 
     if( piapi_init( &(PWR_PIAPIDEV(dev->private_data)->cntx), PIAPI_MODE_PROXY, piapidev_callback, saddr, sport, 0 ) < 0 ) {
         fprintf( stderr, "Error: powerinsight hardware initialization failed\n" );
         return 0x0;
     }
 
+    /* nothing streams before a port is opened, so no sample is missed */
+    pthread_mutex_lock( &piapidev_devs_lock );
+    PWR_PIAPIDEV(dev->private_data)->next = piapidev_devs;
+    piapidev_devs = PWR_PIAPIDEV(dev->private_data);
+    pthread_mutex_unlock( &piapidev_devs_lock );
+
     return dev;
 }
 
 int pwr_piapidev_final( plugin_devops_t *dev )
 {
+    pwr_piapidev_t *pidev = PWR_PIAPIDEV(dev->private_data), **prev;
+    pwr_piport_t *p;
+
     DBGP( "Info: finaling PWR PowerInsight device\n" );
 
-    if( piapi_destroy( &(PWR_PIAPIDEV(dev->private_data)->cntx) ) < 0 ) {
+    pthread_mutex_lock( &piapidev_devs_lock );
+    for( prev = &piapidev_devs; *prev && *prev != pidev; prev = &(*prev)->next );
+    if( *prev )
+        *prev = pidev->next;
+    pthread_mutex_unlock( &piapidev_devs_lock );
+
+    if( piapi_destroy( &(pidev->cntx) ) < 0 ) {
         fprintf( stderr, "Error: powerinsight hardware finalization failed\n" );
         return -1;
     }
 
+    while( (p = pidev->ports) ) {
+        pidev->ports = p->next;
+        free( p );
+    }
+    pthread_cond_destroy( &pidev->cond );
+    pthread_mutex_destroy( &pidev->lock );
+
     free( dev->private_data );
     free( dev );
 
@@ -150,30 +308,69 @@ int pwr_piapidev_final( plugin_devops_t *dev )
 
 pwr_fd_t pwr_piapidev_open( plugin_devops_t *dev, const char *openstr )
 {
+    pwr_piapidev_t *pidev = PWR_PIAPIDEV(dev->private_data);
+    piapi_port_t port;
+    pwr_piport_t *p;
+    int start = 0;
     char *token;
-
-    pwr_fd_t *fd = malloc( sizeof(pwr_pifd_t) );
-    bzero( fd, sizeof(pwr_pifd_t) );
+    pwr_fd_t *fd;
 
     DBGP( "Info: opening PWR PowerInsight descriptor\n" );
 
-    PWR_PIAPIFD(fd)->dev = PWR_PIAPIDEV(dev->private_data);
-
     if( openstr == 0x0 || (token = strtok( (char *)openstr, ":" )) == 0x0 ) {
         fprintf( stderr, "Error: missing sensor port separator in initialization string %s\n", openstr );
         return 0x0;
     }
-    PWR_PIAPIFD(fd)->port = atoi(token);
+    port = atoi(token);
+
+    DBGP( "Info: extracted initialization string (PORT=%u)\n", port );
+
+    pthread_mutex_lock( &pidev->lock );
+    if( (p = piapidev_port( pidev, port )) == 0x0 ) {
+        p = malloc( sizeof(pwr_piport_t) );
+        bzero( p, sizeof(pwr_piport_t) );
+        p->port = port;
+        p->next = pidev->ports;
+        pidev->ports = p;
+        start = 1;
+    }
+    p->refs++;
+    pthread_mutex_unlock( &pidev->lock );
+
+    /* the first descriptor of a port adds it to the device's stream */
+    if( start && piapi_collect( pidev->cntx, port, 0, pidev->freq ) < 0 )
+        fprintf( stderr, "Error: powerinsight collection on port %u failed\n", port );
+
+    fd = malloc( sizeof(pwr_pifd_t) );
+    bzero( fd, sizeof(pwr_pifd_t) );
 
-    DBGP( "Info: extracted initialization string (PORT=%u)\n", PWR_PIAPIFD(fd)->port );
+    PWR_PIAPIFD(fd)->dev = pidev;
+    PWR_PIAPIFD(fd)->port = p;
 
     return fd;
 }
 
 int pwr_piapidev_close( pwr_fd_t fd )
 {
+    pwr_piapidev_t *dev = PWR_PIAPIFD(fd)->dev;
+    pwr_piport_t **prev, *p = PWR_PIAPIFD(fd)->port;
+    int stop = 0;
+
     DBGP( "Info: closing PWR PowerInsight descriptor\n" );
 
+    pthread_mutex_lock( &dev->lock );
+    if( --p->refs == 0 ) {
+        for( prev = &dev->ports; *prev != p; prev = &(*prev)->next );
+        *prev = p->next;
+        stop = 1;
+    }
+    pthread_mutex_unlock( &dev->lock );
+
+    if( stop ) {
+        piapi_halt( dev->cntx, p->port );
+        free( p );
+    }
+
     PWR_PIAPIFD(fd)->dev = 0x0;
     free( fd );
 
@@ -182,45 +379,19 @@ int pwr_piapidev_close( pwr_fd_t fd )
 
 int pwr_piapidev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len, PWR_Time *timestamp )
 {
-    while( piapidev_reading ) sched_yield();
-    piapidev_reading = 1;
-    DBGP( "Info: reading counter for port %d\n", PWR_PIAPIFD(fd)->port );
-    if( piapi_counter( (PWR_PIAPIFD(fd)->dev)->cntx, PWR_PIAPIFD(fd)->port ) < 0 ) {
-        fprintf( stderr, "Error: powerinsight hardware read failed\n" );
-        return -1;
-    }
-    while( piapidev_reading ) sched_yield();
+    piapi_sample_t sample;
 
     if( len != sizeof(double) ) {
         fprintf( stderr, "Error: value field size of %u incorrect, should be %ld\n", len, sizeof(double) );
         return -1;
     }
 
-    switch( attr ) {
-        case PWR_ATTR_VOLTAGE:
-            *((double *)value) = (double)piapidev_counter.raw.volts;
-            break;
-        case PWR_ATTR_CURRENT:
-            *((double *)value) = (double)piapidev_counter.raw.amps;
-            break;
-        case PWR_ATTR_POWER:
-            *((double *)value) = (double)piapidev_counter.raw.watts;
-            break;
-        case PWR_ATTR_POWER_LIMIT_MIN:
-            *((double *)value) = (double)piapidev_counter.min.watts;
-            break;
-        case PWR_ATTR_POWER_LIMIT_MAX:
-            *((double *)value) = (double)piapidev_counter.max.watts;
-            break;
-        case PWR_ATTR_ENERGY:
-            *((double *)value) = (double)piapidev_counter.energy;
-            break;
-        default:
-            fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
-            break;
-    }
-    *timestamp = piapidev_counter.time_sec*1000000000ULL + 
-            piapidev_counter.time_usec*1000;
+    if( piapidev_latest( fd, &sample ) < 0 )
+        return -1;
+
+    if( piapidev_value( &sample, attr, (double *)value ) < 0 )
+        return -1;
+    *timestamp = piapidev_time( &sample );
 
     DBGP( "Info: reading of type %u at time %llu with value %lf\n",
         attr, *(unsigned long long *)timestamp, *(double *)value );
@@ -245,48 +416,22 @@ int pwr_piapidev_write( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned in
 int pwr_piapidev_readv( pwr_fd_t fd, unsigned int arraysize,
     const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
 {
+    piapi_sample_t sample;
     unsigned int i;
 
-    while( piapidev_reading ) sched_yield();
-    piapidev_reading = 1;
-    DBGP( "Info: reading counter for port %d\n", PWR_PIAPIFD(fd)->port );
-    if( piapi_counter( (PWR_PIAPIFD(fd)->dev)->cntx, PWR_PIAPIFD(fd)->port ) < 0 ) {
-        fprintf( stderr, "Error: powerinsight hardware read failed\n" );
-        return -1;
+    /* every attribute comes from the same sample */
+    if( piapidev_latest( fd, &sample ) < 0 ) {
+        for( i = 0; i < arraysize; i++ )
+            status[i] = -1;
+        return 0;
     }
-    while( piapidev_reading ) sched_yield();
 
     for( i = 0; i < arraysize; i++ ) {
-        switch( attrs[i] ) {
-            case PWR_ATTR_VOLTAGE:
-                *((double *)values+i) = (double)piapidev_counter.raw.volts;
-                break;
-            case PWR_ATTR_CURRENT:
-                *((double *)values+i) = (double)piapidev_counter.raw.amps;
-                break;
-            case PWR_ATTR_POWER:
-                *((double *)values+i) = (double)piapidev_counter.raw.watts;
-                break;
-            case PWR_ATTR_POWER_LIMIT_MIN:
-                *((double *)values+i) = (double)piapidev_counter.min.watts;
-                break;
-            case PWR_ATTR_POWER_LIMIT_MAX:
-                *((double *)values+i) = (double)piapidev_counter.max.watts;
-                break;
-            case PWR_ATTR_ENERGY:
-                *((double *)values+i) = (double)piapidev_counter.energy;
-                break;
-            default:
-                fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attrs[i] );
-                break;
-        }
-        timestamp[i] = piapidev_counter.time_sec*1000000000ULL + 
-             piapidev_counter.time_usec*1000;
+        status[i] = piapidev_value( &sample, attrs[i], (double *)values+i );
+        timestamp[i] = piapidev_time( &sample );
 
         DBGP( "Info: reading of type %u at time %llu with value %lf\n",
             attrs[i], *((unsigned long long *)timestamp+i), *((double *)values+i) );
-
-        status[i] = pwr_piapidev_read( fd, attrs[i], (double *)values+i, sizeof(double), timestamp+i );
     }
 
     return 0;
@@ -305,11 +450,15 @@ int pwr_piapidev_writev( pwr_fd_t fd, unsigned int arraysize,
 
 int pwr_piapidev_time( pwr_fd_t fd, PWR_Time *timestamp )
 {
-    double value;
+    piapi_sample_t sample;
 
     DBGP( "Info: getting time from PWR PowerInsight device\n" );
 
-    return pwr_piapidev_read( fd, PWR_ATTR_POWER, &value, sizeof(double), timestamp );
+    if( piapidev_latest( fd, &sample ) < 0 )
+        return -1;
+    *timestamp = piapidev_time( &sample );
+
+    return 0;
 }
 
 int pwr_piapidev_clear( pwr_fd_t fd )
@@ -319,6 +468,62 @@ int pwr_piapidev_clear( pwr_fd_t fd )
     return 0;
 } 
 
+/* ports stream from open on, so there is nothing to start */
+int pwr_piapidev_log_start( pwr_fd_t fd, PWR_AttrName name )
+{
+    piapi_sample_t sample;
+    double value;
+
+    bzero( &sample, sizeof(piapi_sample_t) );
+    return piapidev_value( &sample, name, &value );
+}
+
+int pwr_piapidev_log_stop( pwr_fd_t fd, PWR_AttrName name )
+{
+    return 0;
+}
+
+static PWR_Time piapidev_sample( void *ring, unsigned int i,
+    PWR_AttrName name, double *value )
+{
+    pwr_piport_t *p = (pwr_piport_t *)ring;
+    piapi_sample_t *sample = &p->log[(p->head + PIAPIDEV_LOG_LEN - p->count + i) % PIAPIDEV_LOG_LEN];
+
+    if( value )
+        piapidev_value( sample, name, value );
+
+    return piapidev_time( sample );
+}
+
+/* resample the port's ring the same way pwr_dev_get_samples does */
+int pwr_piapidev_get_samples( pwr_fd_t fd, PWR_AttrName name,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf )
+{
+    pwr_piapidev_t *dev = PWR_PIAPIFD(fd)->dev;
+    pwr_piport_t *p = PWR_PIAPIFD(fd)->port;
+
+    if( pwr_piapidev_log_start( fd, name ) < 0 )
+        return -1;
+
+    pthread_mutex_lock( &dev->lock );
+
+    if( p->count == 0 ) {
+        pthread_mutex_unlock( &dev->lock );
+        fprintf( stderr, "Error: no samples received for port %d\n", p->port );
+        return -1;
+    }
+
+    pwr_dev_resample( p, p->count, piapidev_sample, name,
+        timestamp, period, nSamples, buf );
+
+    pthread_mutex_unlock( &dev->lock );
+
+    DBGP( "Info: returning %u samples of attr %u from %llu\n",
+        *nSamples, name, (unsigned long long)*timestamp );
+
+    return 0;
+}
+
 static plugin_dev_t dev = {
     .init   = pwr_piapidev_init, 
     .final  = pwr_piapidev_final,
@@ -327,4 +532,3 @@ static plugin_dev_t dev = {
 plugin_dev_t* getDev() {
     return &dev;
 }
-
@@ -37,6 +37,11 @@ int pwr_piapidev_writev( pwr_fd_t fd, unsigned int arraysize,
 int pwr_piapidev_time( pwr_fd_t fd, PWR_Time *timestamp );
 int pwr_piapidev_clear( pwr_fd_t fd );
 
+int pwr_piapidev_log_start( pwr_fd_t fd, PWR_AttrName name );
+int pwr_piapidev_log_stop( pwr_fd_t fd, PWR_AttrName name );
+int pwr_piapidev_get_samples( pwr_fd_t fd, PWR_AttrName name,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf );
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_pidev_writev,
     .time         = pwr_pidev_time,
     .clear        = pwr_pidev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -59,11 +62,15 @@ plugin_devops_t *pwr_pidev_init( const char *initstr )
         return 0x0;
     }
 
+    pwr_dev_log_init( dev, pwr_pidev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
 int pwr_pidev_final( plugin_devops_t *dev )
 {
+    pwr_dev_log_final( dev );
+
     if( dev->private_data) free( dev->private_data );
     if( dev ) free( dev );
 
@@ -93,12 +100,16 @@ pwr_fd_t pwr_pidev_open( plugin_devops_t *dev, const char *openstr )
 
     DBGP( "Info: extracted initialization string (PORT=%u)\n", PWR_PIFD(fd)->port );
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
 int pwr_pidev_close( pwr_fd_t fd )
 {
     DBGP( "Info: closing PWR PowerInsight descriptor\n" );
+
+    pwr_dev_log_close( fd );
     free( fd );
 
     return 0;
@@ -46,6 +46,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_pmcdev_writev,
     .time         = pwr_pmcdev_time,
     .clear        = pwr_pmcdev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -115,6 +118,8 @@ plugin_devops_t *pwr_pmcdev_init( const char *initstr )
 
     DBGP( "Info: initializing PWR PMC device\n" );
 
+    pwr_dev_log_init( dev, pwr_pmcdev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
@@ -122,6 +127,8 @@ int pwr_pmcdev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: finalizing PWR PMC device\n" );
 
+    pwr_dev_log_final( dev );
+
     free( dev->private_data );
     free( dev );
     return 0;
@@ -146,6 +153,8 @@ pwr_fd_t pwr_pmcdev_open( plugin_devops_t *dev, const char *openstr )
 
     DBGP( "Info: extracted initialization string (PMC=%u)\n", PWR_PMCFD(fd)->cpu );
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
@@ -153,6 +162,8 @@ int pwr_pmcdev_close( pwr_fd_t fd )
 {
     DBGP( "Info: closing PWR PMC device\n" );
 
+    pwr_dev_log_close( fd );
+
     PWR_PMCFD(fd)->dev = 0x0;
     free( fd );
 
@@ -0,0 +1,614 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+/*
+ * Linux powercap plugin.  Zones are discovered under the powercap class
+ * directory (default /sys/class/powercap, overridden by the init string)
+ * and are opened by directory name (e.g. "intel-rapl:0", "intel-rapl:0:1")
+ * or by the contents of the zone's name file (e.g. "package-0", "dram").
+ * The sysfs files of an open zone are held open and re-read with pread().
+ * Reads of a descriptor are serialized since the sampling thread started
+ * by log_start shares its energy accumulator with the caller.
+ */
+
+#include "pwr_powercapdev.h"
+#include "pwr_dev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#define POWERCAP_ROOT            "/sys/class/powercap"
+#define POWERCAP_PREFIX          "intel-rapl"
+#define POWERCAP_MAX_ZONES       64
+#define POWERCAP_MAX_CONSTRAINTS 4
+#define POWERCAP_POWER_INTERVAL  10000 /* us, the shortest window power is taken over */
+
+typedef struct {
+    char dir[64];
+    char name[64];
+} powercap_zone_t;
+
+typedef struct {
+    char root[256];
+    int num_zones;
+    powercap_zone_t zones[POWERCAP_MAX_ZONES];
+} pwr_powercapdev_t;
+#define PWR_POWERCAPDEV(X) ((pwr_powercapdev_t *)(X))
+
+typedef struct {
+    int limit_fd;
+    int max_fd;
+    int min_fd;
+    char name[32];
+} powercap_constraint_t;
+
+typedef struct {
+    pwr_powercapdev_t *dev;
+    powercap_zone_t *zone;
+
+    int energy_fd;
+    int range_fd;
+    unsigned long long range;
+
+    int num_constraints;
+    int long_term;
+    powercap_constraint_t constraints[POWERCAP_MAX_CONSTRAINTS];
+
+    pthread_mutex_t lock;
+    unsigned long long last_raw;
+    unsigned long long energy;
+    PWR_Time last_time;
+    unsigned long long power_energy;
+    PWR_Time power_time;
+    double power;
+    int have_power;
+} pwr_powercapfd_t;
+#define PWR_POWERCAPFD(X) ((pwr_powercapfd_t *)(X))
+
+static plugin_devops_t devops = {
+    .open         = pwr_powercapdev_open,
+    .close        = pwr_powercapdev_close,
+    .read         = pwr_powercapdev_read,
+    .write        = pwr_powercapdev_write,
+    .readv        = pwr_powercapdev_readv,
+    .writev       = pwr_powercapdev_writev,
+    .time         = pwr_powercapdev_time,
+    .clear        = pwr_powercapdev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
+    .private_data = 0x0
+};
+
+static PWR_Time powercapdev_now( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec*1000000000ULL + tv.tv_usec*1000;
+}
+
+static int powercapdev_open_file( pwr_powercapfd_t *fd, const char *file, int flags )
+{
+    char path[512] = "";
+
+    sprintf( path, "%s/%s/%s", fd->dev->root, fd->zone->dir, file );
+    return open( path, flags );
+}
+
+static int powercapdev_read_str( int fd, char *str, size_t len )
+{
+    ssize_t count;
+
+    if( (count = pread( fd, str, len-1, 0 )) <= 0 )
+        return -1;
+
+    str[count] = '\0';
+    while( count > 0 && (str[count-1] == '\n' || str[count-1] == ' ') )
+        str[--count] = '\0';
+
+    return 0;
+}
+
+static int powercapdev_read_ull( int fd, unsigned long long *val )
+{
+    char strval[32] = "";
+
+    if( fd < 0 || powercapdev_read_str( fd, strval, sizeof(strval) ) < 0 )
+        return -1;
+
+    *val = strtoull( strval, NULL, 10 );
+    return 0;
+}
+
+static int powercapdev_write_ull( int fd, unsigned long long val )
+{
+    char strval[32] = "";
+
+    if( fd < 0 )
+        return -1;
+
+    sprintf( strval, "%llu", val );
+    if( pwrite( fd, strval, strlen(strval), 0 ) < 0 )
+        return -1;
+
+    return 0;
+}
+
+static int powercapdev_read_file( const char *root, const char *dir, const char *file, char *str, size_t len )
+{
+    char path[512] = "";
+    int fd, retval;
+
+    sprintf( path, "%s/%s/%s", root, dir, file );
+    if( (fd = open( path, O_RDONLY )) < 0 )
+        return -1;
+
+    retval = powercapdev_read_str( fd, str, len );
+    close( fd );
+
+    return retval;
+}
+
+/*
+ * Fold the current energy counter into the accumulated energy, accounting
+ * for the counter wrapping at max_energy_range_uj.  Power is the energy
+ * over the window since it was last taken and is only taken again once
+ * that window is POWERCAP_POWER_INTERVAL long, reads closer together than
+ * the counter's update rate would see no change or a single step of it.
+ */
+static int powercapdev_update( pwr_powercapfd_t *fd, PWR_Time *timestamp )
+{
+    unsigned long long raw, delta;
+    PWR_Time now;
+
+    if( powercapdev_read_ull( fd->energy_fd, &raw ) < 0 ) {
+        fprintf( stderr, "Error: unable to read energy of powercap zone %s\n", fd->zone->dir );
+        return -1;
+    }
+    now = powercapdev_now();
+
+    if( raw >= fd->last_raw )
+        delta = raw - fd->last_raw;
+    else
+        delta = fd->range - fd->last_raw + raw;
+
+    fd->energy += delta;
+    fd->last_raw = raw;
+    fd->last_time = now;
+
+    if( now >= fd->power_time + POWERCAP_POWER_INTERVAL * 1000ULL ) {
+        fd->power = (double)(fd->energy - fd->power_energy) /
+                    ((double)(now - fd->power_time) / 1000.0);
+        fd->power_energy = fd->energy;
+        fd->power_time = now;
+        fd->have_power = 1;
+    }
+
+    if( timestamp )
+        *timestamp = now;
+
+    return 0;
+}
+
+/*
+ * How long a power read has to wait for the first window, opened with the
+ * descriptor, to be long enough.
+ */
+static useconds_t powercapdev_power_wait( pwr_powercapfd_t *fd )
+{
+    PWR_Time now = powercapdev_now();
+    PWR_Time end = fd->power_time + POWERCAP_POWER_INTERVAL * 1000ULL;
+
+    if( fd->have_power || now >= end )
+        return 0;
+
+    return (end - now) / 1000 + 1;
+}
+
+static int powercapdev_value( pwr_powercapfd_t *fd, PWR_AttrName attr, double *value )
+{
+    powercap_constraint_t *constraint = fd->constraints + fd->long_term;
+    unsigned long long uw;
+
+    switch( attr ) {
+        case PWR_ATTR_ENERGY:
+            *value = (double)fd->energy / 1000000.0;
+            break;
+        case PWR_ATTR_POWER:
+            *value = fd->power;
+            break;
+        case PWR_ATTR_POWER_LIMIT_MAX:
+            if( fd->num_constraints == 0 || powercapdev_read_ull( constraint->limit_fd, &uw ) < 0 ) {
+                fprintf( stderr, "Error: unable to read power limit of powercap zone %s\n", fd->zone->dir );
+                return -1;
+            }
+            *value = (double)uw / 1000000.0;
+            break;
+        case PWR_ATTR_POWER_LIMIT_MIN:
+            if( fd->num_constraints == 0 || powercapdev_read_ull( constraint->min_fd, &uw ) < 0 ) {
+                fprintf( stderr, "Error: unable to read minimum power of powercap zone %s\n", fd->zone->dir );
+                return -1;
+            }
+            *value = (double)uw / 1000000.0;
+            break;
+        default:
+            fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
+            return -1;
+    }
+
+    return 0;
+}
+
+static int powercapdev_zone_cmp( const void *a, const void *b )
+{
+    return strcmp( ((const powercap_zone_t *)a)->dir, ((const powercap_zone_t *)b)->dir );
+}
+
+static void powercapdev_discover( pwr_powercapdev_t *dev )
+{
+    struct dirent *entry;
+    DIR *dir;
+
+    if( (dir = opendir( dev->root )) == 0x0 ) {
+        fprintf( stderr, "Error: unable to open powercap root %s\n", dev->root );
+        return;
+    }
+
+    while( (entry = readdir( dir )) != 0x0 && dev->num_zones < POWERCAP_MAX_ZONES ) {
+        powercap_zone_t *zone = dev->zones + dev->num_zones;
+
+        if( strncmp( entry->d_name, POWERCAP_PREFIX, strlen(POWERCAP_PREFIX) ) ||
+            strlen( entry->d_name ) >= sizeof(zone->dir) )
+            continue;
+
+        strcpy( zone->dir, entry->d_name );
+        if( powercapdev_read_file( dev->root, zone->dir, "name", zone->name, sizeof(zone->name) ) < 0 )
+            continue;
+
+        DBGP( "Info: found powercap zone %s (%s)\n", zone->dir, zone->name );
+        dev->num_zones++;
+    }
+
+    closedir( dir );
+
+    /* name lookups resolve duplicates (e.g. "core") to the lowest zone */
+    qsort( dev->zones, dev->num_zones, sizeof(powercap_zone_t), powercapdev_zone_cmp );
+}
+
+plugin_devops_t *pwr_powercapdev_init( const char *initstr )
+{
+    plugin_devops_t *dev = malloc( sizeof(plugin_devops_t) );
+    *dev = devops;
+
+    dev->private_data = malloc( sizeof(pwr_powercapdev_t) );
+    bzero( dev->private_data, sizeof(pwr_powercapdev_t) );
+
+    DBGP( "Info: initializing PWR powercap device\n" );
+
+    if( initstr == 0x0 || strlen( initstr ) == 0 || strlen( initstr ) >= sizeof(PWR_POWERCAPDEV(dev->private_data)->root) )
+        strcpy( PWR_POWERCAPDEV(dev->private_data)->root, POWERCAP_ROOT );
+    else
+        strcpy( PWR_POWERCAPDEV(dev->private_data)->root, initstr );
+
+    powercapdev_discover( PWR_POWERCAPDEV(dev->private_data) );
+    pwr_dev_log_init( dev, pwr_powercapdev_read, PWR_DEV_LOG_PERIOD );
+
+    DBGP( "Info: extracted initialization string (ROOT=%s, ZONES=%d)\n",
+        PWR_POWERCAPDEV(dev->private_data)->root, PWR_POWERCAPDEV(dev->private_data)->num_zones );
+
+    return dev;
+}
+
+int pwr_powercapdev_final( plugin_devops_t *dev )
+{
+    DBGP( "Info: finaling PWR powercap device\n" );
+
+    pwr_dev_log_final( dev );
+
+    free( dev->private_data );
+    free( dev );
+    return 0;
+}
+
+pwr_fd_t pwr_powercapdev_open( plugin_devops_t *dev, const char *openstr )
+{
+    pwr_powercapdev_t *capdev = PWR_POWERCAPDEV(dev->private_data);
+    pwr_powercapfd_t *fd;
+    char file[64] = "";
+    int i;
+
+    DBGP( "Info: opening PWR powercap descriptor\n" );
+
+    if( openstr == 0x0 ) {
+        fprintf( stderr, "Error: missing powercap zone in open string\n" );
+        return 0x0;
+    }
+
+    fd = malloc( sizeof(pwr_powercapfd_t) );
+    bzero( fd, sizeof(pwr_powercapfd_t) );
+    fd->dev = capdev;
+    fd->energy_fd = fd->range_fd = -1;
+    pthread_mutex_init( &fd->lock, NULL );
+
+    for( i = 0; i < capdev->num_zones && fd->zone == 0x0; i++ )
+        if( !strcmp( capdev->zones[i].dir, openstr ) )
+            fd->zone = capdev->zones + i;
+    for( i = 0; i < capdev->num_zones && fd->zone == 0x0; i++ )
+        if( !strcmp( capdev->zones[i].name, openstr ) )
+            fd->zone = capdev->zones + i;
+
+    if( fd->zone == 0x0 ) {
+        fprintf( stderr, "Error: powercap zone %s not found under %s\n", openstr, capdev->root );
+        free( fd );
+        return 0x0;
+    }
+
+    fd->energy_fd = powercapdev_open_file( fd, "energy_uj", O_RDONLY );
+    fd->range_fd = powercapdev_open_file( fd, "max_energy_range_uj", O_RDONLY );
+    if( fd->energy_fd < 0 || powercapdev_read_ull( fd->range_fd, &fd->range ) < 0 ) {
+        fprintf( stderr, "Error: unable to open energy counter of powercap zone %s\n", fd->zone->dir );
+        pwr_powercapdev_close( fd );
+        return 0x0;
+    }
+
+    for( i = 0; i < POWERCAP_MAX_CONSTRAINTS; i++ ) {
+        powercap_constraint_t *constraint = fd->constraints + i;
+
+        sprintf( file, "constraint_%d_power_limit_uw", i );
+        if( (constraint->limit_fd = powercapdev_open_file( fd, file, O_RDWR )) < 0 &&
+            (constraint->limit_fd = powercapdev_open_file( fd, file, O_RDONLY )) < 0 )
+            break;
+
+        sprintf( file, "constraint_%d_max_power_uw", i );
+        constraint->max_fd = powercapdev_open_file( fd, file, O_RDONLY );
+        sprintf( file, "constraint_%d_min_power_uw", i );
+        constraint->min_fd = powercapdev_open_file( fd, file, O_RDONLY );
+
+        sprintf( file, "constraint_%d_name", i );
+        powercapdev_read_file( capdev->root, fd->zone->dir, file, constraint->name, sizeof(constraint->name) );
+        if( !strcmp( constraint->name, "long_term" ) )
+            fd->long_term = i;
+
+        fd->num_constraints++;
+    }
+
+    if( powercapdev_read_ull( fd->energy_fd, &fd->last_raw ) < 0 ) {
+        fprintf( stderr, "Error: unable to read energy of powercap zone %s\n", fd->zone->dir );
+        pwr_powercapdev_close( fd );
+        return 0x0;
+    }
+    fd->energy = fd->power_energy = fd->last_raw;
+    fd->last_time = fd->power_time = powercapdev_now();
+
+    DBGP( "Info: extracted open string (ZONE=%s, NAME=%s, RANGE=%llu, CONSTRAINTS=%d)\n",
+        fd->zone->dir, fd->zone->name, fd->range, fd->num_constraints );
+
+    pwr_dev_log_open( dev, fd );
+
+    return fd;
+}
+
+int pwr_powercapdev_close( pwr_fd_t fd )
+{
+    int i;
+
+    DBGP( "Info: closing PWR powercap descriptor\n" );
+
+    pwr_dev_log_close( fd );
+
+    if( PWR_POWERCAPFD(fd)->energy_fd >= 0 )
+        close( PWR_POWERCAPFD(fd)->energy_fd );
+    if( PWR_POWERCAPFD(fd)->range_fd >= 0 )
+        close( PWR_POWERCAPFD(fd)->range_fd );
+
+    for( i = 0; i < PWR_POWERCAPFD(fd)->num_constraints; i++ ) {
+        powercap_constraint_t *constraint = PWR_POWERCAPFD(fd)->constraints + i;
+
+        close( constraint->limit_fd );
+        if( constraint->max_fd >= 0 )
+            close( constraint->max_fd );
+        if( constraint->min_fd >= 0 )
+            close( constraint->min_fd );
+    }
+
+    pthread_mutex_destroy( &PWR_POWERCAPFD(fd)->lock );
+    PWR_POWERCAPFD(fd)->dev = 0x0;
+    free( fd );
+
+    return 0;
+}
+
+int pwr_powercapdev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len, PWR_Time *timestamp )
+{
+    PWR_Time ts;
+
+    if( len != sizeof(double) ) {
+        fprintf( stderr, "Error: value field size of %u incorrect, should be %ld\n", len, sizeof(double) );
+        return -1;
+    }
+
+    pthread_mutex_lock( &PWR_POWERCAPFD(fd)->lock );
+
+    if( attr == PWR_ATTR_POWER )
+        usleep( powercapdev_power_wait( PWR_POWERCAPFD(fd) ) );
+
+    if( powercapdev_update( PWR_POWERCAPFD(fd), &ts ) < 0 ||
+        powercapdev_value( PWR_POWERCAPFD(fd), attr, (double *)value ) < 0 ) {
+        pthread_mutex_unlock( &PWR_POWERCAPFD(fd)->lock );
+        return -1;
+    }
+
+    pthread_mutex_unlock( &PWR_POWERCAPFD(fd)->lock );
+
+    if( timestamp )
+        *timestamp = ts;
+
+    DBGP( "Info: reading of type %u at time %llu with value %lf\n",
+                attr, (unsigned long long)ts, *(double *)value );
+
+    return 0;
+}
+
+int pwr_powercapdev_write( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len )
+{
+    powercap_constraint_t *constraint;
+    unsigned long long uw, max;
+
+    if( len != sizeof(double) ) {
+        fprintf( stderr, "Error: value field size of %u incorrect, should be %ld\n", len, sizeof(double) );
+        return -1;
+    }
+
+    if( attr != PWR_ATTR_POWER_LIMIT_MAX ) {
+        fprintf( stderr, "Warning: unknown PWR writing attr (%u) requested\n", attr );
+        return -1;
+    }
+
+    if( PWR_POWERCAPFD(fd)->num_constraints == 0 ) {
+        fprintf( stderr, "Error: powercap zone %s has no power limit\n", PWR_POWERCAPFD(fd)->zone->dir );
+        return -1;
+    }
+
+    constraint = PWR_POWERCAPFD(fd)->constraints + PWR_POWERCAPFD(fd)->long_term;
+    uw = (unsigned long long)(*(double *)value * 1000000.0);
+    if( powercapdev_read_ull( constraint->max_fd, &max ) == 0 && max && uw > max ) {
+        fprintf( stderr, "Error: power limit %lf exceeds maximum of powercap zone %s\n",
+            *(double *)value, PWR_POWERCAPFD(fd)->zone->dir );
+        return -1;
+    }
+
+    if( powercapdev_write_ull( constraint->limit_fd, uw ) < 0 ) {
+        fprintf( stderr, "Error: unable to write power limit of powercap zone %s\n", PWR_POWERCAPFD(fd)->zone->dir );
+        return -1;
+    }
+
+    DBGP( "Info: writing of type %u with value %lf\n", attr, *(double *)value );
+
+    return 0;
+}
+
+/*
+ * All attributes in a readv are served from a single read of the zone's
+ * energy counter and share its timestamp.
+ */
+int pwr_powercapdev_readv( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
+{
+    PWR_Time ts;
+    unsigned int i;
+
+    pthread_mutex_lock( &PWR_POWERCAPFD(fd)->lock );
+
+    for( i = 0; i < arraysize; i++ )
+        if( attrs[i] == PWR_ATTR_POWER ) {
+            usleep( powercapdev_power_wait( PWR_POWERCAPFD(fd) ) );
+            break;
+        }
+
+    if( powercapdev_update( PWR_POWERCAPFD(fd), &ts ) < 0 ) {
+        pthread_mutex_unlock( &PWR_POWERCAPFD(fd)->lock );
+        for( i = 0; i < arraysize; i++ )
+            status[i] = -1;
+        return -1;
+    }
+
+    for( i = 0; i < arraysize; i++ ) {
+        status[i] = powercapdev_value( PWR_POWERCAPFD(fd), attrs[i], (double *)values+i );
+        timestamp[i] = ts;
+    }
+
+    pthread_mutex_unlock( &PWR_POWERCAPFD(fd)->lock );
+
+    return 0;
+}
+
+/*
+ * Zones whose first POWER window is still short wait it out together
+ * rather than one after the other.
+ */
+int pwr_powercapdev_readm( pwr_fd_t fds[], unsigned int nfds,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
+{
+    unsigned int i;
+    useconds_t wait = 0, zone_wait;
+    int ret = 0;
+
+    for( i = 0; i < nfds; i++ )
+        if( attrs[i] == PWR_ATTR_POWER ) {
+            pthread_mutex_lock( &PWR_POWERCAPFD(fds[i])->lock );
+            zone_wait = powercapdev_power_wait( PWR_POWERCAPFD(fds[i]) );
+            pthread_mutex_unlock( &PWR_POWERCAPFD(fds[i])->lock );
+            if( zone_wait > wait )
+                wait = zone_wait;
+        }
+
+    usleep( wait );
+
+    for( i = 0; i < nfds; i++ ) {
+        pthread_mutex_lock( &PWR_POWERCAPFD(fds[i])->lock );
+        if( powercapdev_update( PWR_POWERCAPFD(fds[i]), &timestamp[i] ) < 0 )
+            status[i] = -1;
+        else
+            status[i] = powercapdev_value( PWR_POWERCAPFD(fds[i]), attrs[i], (double *)values+i );
+        pthread_mutex_unlock( &PWR_POWERCAPFD(fds[i])->lock );
+
+        if( status[i] < 0 )
+            ret = -1;
+    }
+
+    return ret;
+}
+
+int pwr_powercapdev_writev( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, int status[] )
+{
+    unsigned int i;
+
+    for( i = 0; i < arraysize; i++ )
+        status[i] = pwr_powercapdev_write( fd, attrs[i], (double *)values+i, sizeof(double) );
+
+    return 0;
+}
+
+int pwr_powercapdev_time( pwr_fd_t fd, PWR_Time *timestamp )
+{
+    double value;
+
+    DBGP( "Info: reading time from powercap device\n" );
+
+    return pwr_powercapdev_read( fd, PWR_ATTR_ENERGY, &value, sizeof(double), timestamp );
+}
+
+int pwr_powercapdev_clear( pwr_fd_t fd )
+{
+    return 0;
+}
+
+static plugin_dev_t dev = {
+    .init   = pwr_powercapdev_init,
+    .final  = pwr_powercapdev_final,
+    .readm  = pwr_powercapdev_readm,
+};
+
+plugin_dev_t* getDev() {
+    return &dev;
+}
+
+int getDevVersion() {
+    return PWR_PLUGIN_VERSION;
+}
@@ -151,6 +151,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_rapldev_writev,
     .time         = pwr_rapldev_time,
     .clear        = pwr_rapldev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -430,6 +433,8 @@ plugin_devops_t *pwr_rapldev_init( const char *initstr )
     DBGP( "Info: limit.enabled2 - %u\n", PWR_RAPLDEV(dev->private_data)->limit.enabled2 );
     DBGP( "Info: limit.clamped2 - %u\n", PWR_RAPLDEV(dev->private_data)->limit.clamped2 );
 
+    pwr_dev_log_init( dev, pwr_rapldev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
@@ -437,6 +442,8 @@ int pwr_rapldev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: PWR RAPL device close\n" );
 
+    pwr_dev_log_final( dev );
+
     close( PWR_RAPLDEV(dev->private_data)->fd );
     free( dev->private_data );
     free( dev );
@@ -454,11 +461,15 @@ pwr_fd_t pwr_rapldev_open( plugin_devops_t *dev, const char *openstr )
         return 0x0;
     }
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
 int pwr_rapldev_close( pwr_fd_t fd )
 {
+    pwr_dev_log_close( fd );
+
     PWR_RAPLFD(fd)->dev = 0x0;
     free( fd );
 
@@ -0,0 +1,607 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+/*
+ * Trace replay plugin.  The init string names a trace file followed by
+ * optional ':' separated settings:
+ *
+ *   <file>[:scale=<x>][:offset=<s>][:loop]
+ *
+ * scale speeds up (or slows down) playback, offset starts playback that
+ * many trace seconds in and loop wraps around at the end of the trace.
+ * Playback starts when the plugin is initialized.  The open string names
+ * a device in the trace.
+ *
+ * A trace is a table of rows, each a timestamp in seconds followed by one
+ * value per column; columns are named "<device>.<ATTR>" using the
+ * configuration attribute names (e.g. "node0.POWER", "node0.ENERGY").
+ * Two encodings are accepted:
+ *
+ *   CSV     a header line "time,node0.POWER,..." followed by one line per
+ *           row, parsed once into memory at init.
+ *   binary  a pwr_trace_hdr_t, ncols fixed size column names, then nrows
+ *           rows of 1+ncols doubles, used in place from the mapping.
+ *
+ * Rows must be sorted by time.  Reads return the value of the last row at
+ * or before the playback position.
+ */
+
+#include "pwr_tracedev.h"
+#include "pwr_dev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define TRACE_MAGIC    "PWRTRACE"
+#define TRACE_VERSION  1
+#define TRACE_NAME_LEN 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t ncols;
+    uint64_t nrows;
+} pwr_trace_hdr_t;
+
+typedef struct {
+    void *map;
+    size_t map_len;
+    double *rows;       /* nrows x (1+ncols), in the mapping or malloc'ed */
+    int parsed;         /* names and rows were parsed from CSV */
+    unsigned int ncols;
+    unsigned long long nrows;
+    char (*names)[TRACE_NAME_LEN];
+
+    double scale;
+    double offset;
+    int loop;
+    PWR_Time start;
+} pwr_tracedev_t;
+#define PWR_TRACEDEV(X) ((pwr_tracedev_t *)(X))
+
+typedef struct {
+    pwr_tracedev_t *dev;
+    int cols[PWR_NUM_ATTR_NAMES];
+} pwr_tracefd_t;
+#define PWR_TRACEFD(X) ((pwr_tracefd_t *)(X))
+
+static plugin_devops_t devops = {
+    .open         = pwr_tracedev_open,
+    .close        = pwr_tracedev_close,
+    .read         = pwr_tracedev_read,
+    .write        = pwr_tracedev_write,
+    .readv        = pwr_tracedev_readv,
+    .writev       = pwr_tracedev_writev,
+    .time         = pwr_tracedev_time,
+    .clear        = pwr_tracedev_clear,
+    .log_start    = pwr_tracedev_log_start,
+    .log_stop     = pwr_tracedev_log_stop,
+    .get_samples  = pwr_tracedev_get_samples,
+    .private_data = 0x0
+};
+
+static struct {
+    const char *name;
+    PWR_AttrName attr;
+} tracedev_attrs[] = {
+    { "PSTATE",          PWR_ATTR_PSTATE },
+    { "CSTATE",          PWR_ATTR_CSTATE },
+    { "CSTATE_LIMIT",    PWR_ATTR_CSTATE_LIMIT },
+    { "SSTATE",          PWR_ATTR_SSTATE },
+    { "CURRENT",         PWR_ATTR_CURRENT },
+    { "VOLTAGE",         PWR_ATTR_VOLTAGE },
+    { "POWER",           PWR_ATTR_POWER },
+    { "MIN_POWER",       PWR_ATTR_POWER_LIMIT_MIN },
+    { "MAX_POWER",       PWR_ATTR_POWER_LIMIT_MAX },
+    { "FREQ",            PWR_ATTR_FREQ },
+    { "FREQ_MIN",        PWR_ATTR_FREQ_LIMIT_MIN },
+    { "FREQ_MAX",        PWR_ATTR_FREQ_LIMIT_MAX },
+    { "ENERGY",          PWR_ATTR_ENERGY },
+    { "TEMP",            PWR_ATTR_TEMP },
+    { "OS_ID",           PWR_ATTR_OS_ID },
+    { "THROTTLED_TIME",  PWR_ATTR_THROTTLED_TIME },
+    { "THROTTLED_COUNT", PWR_ATTR_THROTTLED_COUNT },
+};
+
+static PWR_Time tracedev_now( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec*1000000000ULL + tv.tv_usec*1000;
+}
+
+#define TRACE_ROW(D,R) ((D)->rows + (size_t)(R) * ((D)->ncols + 1))
+
+static double tracedev_first( pwr_tracedev_t *dev )
+{
+    return TRACE_ROW(dev, 0)[0];
+}
+
+static double tracedev_last( pwr_tracedev_t *dev )
+{
+    return TRACE_ROW(dev, dev->nrows - 1)[0];
+}
+
+/* map a wall clock time to a position in trace time */
+static double tracedev_position( pwr_tracedev_t *dev, PWR_Time when )
+{
+    double pos = tracedev_first( dev ) + dev->offset +
+                 (double)(long long)(when - dev->start) / 1000000000.0 * dev->scale;
+    double len = tracedev_last( dev ) - tracedev_first( dev );
+
+    if( dev->loop && len > 0.0 && pos > tracedev_last( dev ) )
+        pos = tracedev_first( dev ) + fmod( pos - tracedev_first( dev ), len );
+
+    return pos;
+}
+
+/* index of the last row at or before pos, or the first row */
+static unsigned long long tracedev_search( pwr_tracedev_t *dev, double pos )
+{
+    unsigned long long lo = 0, hi = dev->nrows;
+
+    while( hi - lo > 1 ) {
+        unsigned long long mid = lo + (hi - lo) / 2;
+
+        if( TRACE_ROW(dev, mid)[0] <= pos )
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static int tracedev_column( pwr_tracedev_t *dev, const char *device, PWR_AttrName attr )
+{
+    char name[TRACE_NAME_LEN] = "";
+    unsigned int i;
+
+    for( i = 0; i < sizeof(tracedev_attrs)/sizeof(tracedev_attrs[0]); i++ )
+        if( tracedev_attrs[i].attr == attr )
+            break;
+    if( i == sizeof(tracedev_attrs)/sizeof(tracedev_attrs[0]) )
+        return -1;
+
+    snprintf( name, sizeof(name), "%s.%s", device, tracedev_attrs[i].name );
+    for( i = 0; i < dev->ncols; i++ )
+        if( !strncmp( dev->names[i], name, TRACE_NAME_LEN ) )
+            return i;
+
+    return -1;
+}
+
+static int tracedev_load_binary( pwr_tracedev_t *dev )
+{
+    pwr_trace_hdr_t *hdr = (pwr_trace_hdr_t *)dev->map;
+    size_t names_len;
+
+    if( dev->map_len < sizeof(pwr_trace_hdr_t) || hdr->version != TRACE_VERSION ) {
+        fprintf( stderr, "Error: unsupported binary trace version\n" );
+        return -1;
+    }
+
+    dev->ncols = hdr->ncols;
+    dev->nrows = hdr->nrows;
+
+    /* sizes come from the file, a corrupt header must not wrap them */
+    names_len = (size_t)dev->ncols * TRACE_NAME_LEN;
+    if( dev->map_len - sizeof(pwr_trace_hdr_t) < names_len ||
+        dev->nrows > (dev->map_len - sizeof(pwr_trace_hdr_t) - names_len) /
+                     (((size_t)dev->ncols + 1) * sizeof(double)) ) {
+        fprintf( stderr, "Error: binary trace is truncated\n" );
+        return -1;
+    }
+
+    dev->names = (char (*)[TRACE_NAME_LEN])((char *)dev->map + sizeof(pwr_trace_hdr_t));
+    dev->rows = (double *)((char *)dev->map + sizeof(pwr_trace_hdr_t) + names_len);
+
+    return 0;
+}
+
+static int tracedev_parse_row( const char *pos, const char *eol, int terminated,
+    double *values, unsigned int ncols )
+{
+    char *line = 0x0, *next;
+    unsigned int col;
+    int retval = 0;
+
+    /* strtod needs a terminator, which a final line without '\n' lacks */
+    if( !terminated ) {
+        line = strndup( pos, eol - pos );
+        eol = line + (eol - pos);
+        pos = line;
+    }
+
+    for( col = 0; col <= ncols; col++ ) {
+        values[col] = strtod( pos, &next );
+        if( next == pos || next > eol ) {
+            retval = -1;
+            break;
+        }
+        pos = next + 1;
+    }
+
+    free( line );
+    return retval;
+}
+
+static int tracedev_load_csv( pwr_tracedev_t *dev )
+{
+    const char *pos = (const char *)dev->map, *end = pos + dev->map_len, *eol;
+    unsigned long long lines = 0, row = 0;
+    unsigned int col;
+    const char *next;
+
+    /* header: time,<device>.<ATTR>,... */
+    if( (eol = memchr( pos, '\n', end - pos )) == 0x0 )
+        eol = end;
+    for( next = pos; next < eol; next++ )
+        if( *next == ',' )
+            dev->ncols++;
+    if( dev->ncols == 0 ) {
+        fprintf( stderr, "Error: CSV trace header has no value columns\n" );
+        return -1;
+    }
+
+    dev->names = malloc( dev->ncols * TRACE_NAME_LEN );
+    bzero( dev->names, dev->ncols * TRACE_NAME_LEN );
+    dev->parsed = 1;
+    pos = (const char *)memchr( pos, ',', eol - pos ) + 1;
+    for( col = 0; col < dev->ncols; col++ ) {
+        const char *sep = memchr( pos, ',', eol - pos );
+        size_t len = (sep ? sep : eol) - pos;
+
+        while( len && (pos[len-1] == '\r' || pos[len-1] == ' ') )
+            len--;
+        if( len >= TRACE_NAME_LEN )
+            len = TRACE_NAME_LEN - 1;
+        memcpy( dev->names[col], pos, len );
+        pos = sep ? sep + 1 : eol;
+    }
+
+    for( pos = eol; pos < end; pos++ )
+        if( *pos == '\n' )
+            lines++;
+    dev->rows = malloc( (lines + 1) * (dev->ncols + 1) * sizeof(double) );
+
+    for( pos = eol < end ? eol + 1 : end; pos < end; pos = eol + 1 ) {
+        double *values = TRACE_ROW(dev, row);
+
+        if( (eol = memchr( pos, '\n', end - pos )) == 0x0 )
+            eol = end;
+        if( eol == pos || (eol == pos + 1 && *pos == '\r') || *pos == '#' )
+            continue;
+
+        if( tracedev_parse_row( pos, eol, eol < end, values, dev->ncols ) < 0 ) {
+            fprintf( stderr, "Error: CSV trace row %llu has too few columns\n", row + 1 );
+            return -1;
+        }
+        row++;
+    }
+    dev->nrows = row;
+
+    return 0;
+}
+
+plugin_devops_t *pwr_tracedev_init( const char *initstr )
+{
+    plugin_devops_t *dev = malloc( sizeof(plugin_devops_t) );
+    pwr_tracedev_t *trace;
+    char *token, *value;
+    struct stat st;
+    int fd;
+
+    *dev = devops;
+    dev->private_data = trace = malloc( sizeof(pwr_tracedev_t) );
+    bzero( trace, sizeof(pwr_tracedev_t) );
+    trace->scale = 1.0;
+
+    DBGP( "Info: initializing PWR trace device\n" );
+
+    if( initstr == 0x0 || (token = strtok( (char *)initstr, ":" )) == 0x0 ) {
+        fprintf( stderr, "Error: missing trace file in initialization string\n" );
+        free( trace );
+        free( dev );
+        return 0x0;
+    }
+
+    if( (fd = open( token, O_RDONLY )) < 0 || fstat( fd, &st ) < 0 || st.st_size == 0 ||
+        (trace->map = mmap( 0x0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED ) {
+        fprintf( stderr, "Error: unable to map trace file %s\n", token );
+        if( fd >= 0 )
+            close( fd );
+        free( trace );
+        free( dev );
+        return 0x0;
+    }
+    close( fd );
+    trace->map_len = st.st_size;
+
+    if( ( trace->map_len >= strlen(TRACE_MAGIC) &&
+          !memcmp( trace->map, TRACE_MAGIC, strlen(TRACE_MAGIC) ) ?
+          tracedev_load_binary( trace ) : tracedev_load_csv( trace ) ) < 0 ||
+        trace->nrows == 0 ) {
+        fprintf( stderr, "Error: unable to load trace file %s\n", token );
+        pwr_tracedev_final( dev );
+        return 0x0;
+    }
+
+    while( (token = strtok( NULL, ":" )) != 0x0 ) {
+        if( (value = strchr( token, '=' )) != 0x0 )
+            *value++ = '\0';
+
+        if( !strcmp( token, "scale" ) && value )
+            trace->scale = atof( value );
+        else if( !strcmp( token, "offset" ) && value )
+            trace->offset = atof( value );
+        else if( !strcmp( token, "loop" ) )
+            trace->loop = 1;
+        else
+            fprintf( stderr, "Warning: unknown trace option %s\n", token );
+    }
+
+    trace->start = tracedev_now();
+
+    DBGP( "Info: extracted initialization string (COLS=%u, ROWS=%llu, SCALE=%lf, OFFSET=%lf, LOOP=%d)\n",
+        trace->ncols, trace->nrows, trace->scale, trace->offset, trace->loop );
+
+    return dev;
+}
+
+int pwr_tracedev_final( plugin_devops_t *dev )
+{
+    pwr_tracedev_t *trace = PWR_TRACEDEV(dev->private_data);
+
+    DBGP( "Info: finaling PWR trace device\n" );
+
+    if( trace->parsed ) {
+        free( trace->rows );
+        free( trace->names );
+    }
+    munmap( trace->map, trace->map_len );
+    free( trace );
+    free( dev );
+    return 0;
+}
+
+pwr_fd_t pwr_tracedev_open( plugin_devops_t *dev, const char *openstr )
+{
+    pwr_tracefd_t *fd;
+    int attr, found = 0;
+
+    DBGP( "Info: opening PWR trace descriptor\n" );
+
+    if( openstr == 0x0 || strlen( openstr ) == 0 ) {
+        fprintf( stderr, "Error: missing trace device in open string\n" );
+        return 0x0;
+    }
+
+    fd = malloc( sizeof(pwr_tracefd_t) );
+    fd->dev = PWR_TRACEDEV(dev->private_data);
+    for( attr = 0; attr < PWR_NUM_ATTR_NAMES; attr++ )
+        if( (fd->cols[attr] = tracedev_column( fd->dev, openstr, attr )) >= 0 )
+            found++;
+
+    if( !found ) {
+        fprintf( stderr, "Error: trace has no columns for device %s\n", openstr );
+        free( fd );
+        return 0x0;
+    }
+
+    DBGP( "Info: extracted open string (DEVICE=%s, COLUMNS=%d)\n", openstr, found );
+
+    return fd;
+}
+
+int pwr_tracedev_close( pwr_fd_t fd )
+{
+    DBGP( "Info: closing PWR trace descriptor\n" );
+
+    PWR_TRACEFD(fd)->dev = 0x0;
+    free( fd );
+
+    return 0;
+}
+
+int pwr_tracedev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len, PWR_Time *timestamp )
+{
+    int status;
+
+    if( len != sizeof(double) ) {
+        fprintf( stderr, "Error: value field size of %u incorrect, should be %ld\n", len, sizeof(double) );
+        return -1;
+    }
+
+    pwr_tracedev_readv( fd, 1, &attr, value, timestamp, &status );
+
+    return status;
+}
+
+int pwr_tracedev_write( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len )
+{
+    fprintf( stderr, "Error: trace device attr (%u) is read only\n", attr );
+    return -1;
+}
+
+/* all attributes of a readv come from the same trace row */
+int pwr_tracedev_readv( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
+{
+    pwr_tracedev_t *dev = PWR_TRACEFD(fd)->dev;
+    PWR_Time now = tracedev_now();
+    double *row = TRACE_ROW(dev, tracedev_search( dev, tracedev_position( dev, now ) ));
+    unsigned int i;
+
+    for( i = 0; i < arraysize; i++ ) {
+        int col = attrs[i] >= 0 && attrs[i] < PWR_NUM_ATTR_NAMES ? PWR_TRACEFD(fd)->cols[attrs[i]] : -1;
+
+        if( col < 0 ) {
+            fprintf( stderr, "Warning: trace has no column for attr (%u)\n", attrs[i] );
+            status[i] = -1;
+            continue;
+        }
+
+        ((double *)values)[i] = row[col + 1];
+        timestamp[i] = now;
+        status[i] = 0;
+
+        DBGP( "Info: reading of type %u at trace time %lf with value %lf\n",
+            attrs[i], row[0], ((double *)values)[i] );
+    }
+
+    return 0;
+}
+
+/* descriptors opened on the same trace share one row search */
+int pwr_tracedev_readm( pwr_fd_t fds[], unsigned int nfds,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
+{
+    pwr_tracedev_t *dev = 0x0;
+    PWR_Time now = tracedev_now();
+    double *row = 0x0;
+    unsigned int i;
+    int ret = 0;
+
+    for( i = 0; i < nfds; i++ ) {
+        int col = attrs[i] >= 0 && attrs[i] < PWR_NUM_ATTR_NAMES ? PWR_TRACEFD(fds[i])->cols[attrs[i]] : -1;
+
+        if( col < 0 ) {
+            fprintf( stderr, "Warning: trace has no column for attr (%u)\n", attrs[i] );
+            status[i] = ret = -1;
+            continue;
+        }
+
+        if( PWR_TRACEFD(fds[i])->dev != dev ) {
+            dev = PWR_TRACEFD(fds[i])->dev;
+            row = TRACE_ROW(dev, tracedev_search( dev, tracedev_position( dev, now ) ));
+        }
+
+        ((double *)values)[i] = row[col + 1];
+        timestamp[i] = now;
+        status[i] = 0;
+    }
+
+    return ret;
+}
+
+/* reads never touch a device, so they complete before returning */
+int pwr_tracedev_read_async( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[],
+    pwr_read_cb_t cb, void *ctx )
+{
+    unsigned int i;
+    int ret = 0;
+
+    pwr_tracedev_readv( fd, arraysize, attrs, values, timestamp, status );
+    for( i = 0; i < arraysize; i++ )
+        if( status[i] )
+            ret = status[i];
+
+    cb( ctx, ret );
+
+    return 0;
+}
+
+int pwr_tracedev_writev( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, int status[] )
+{
+    unsigned int i;
+
+    for( i = 0; i < arraysize; i++ )
+        status[i] = pwr_tracedev_write( fd, attrs[i], (double *)values+i, sizeof(double) );
+
+    return 0;
+}
+
+int pwr_tracedev_time( pwr_fd_t fd, PWR_Time *timestamp )
+{
+    *timestamp = tracedev_now();
+
+    return 0;
+}
+
+int pwr_tracedev_clear( pwr_fd_t fd )
+{
+    return 0;
+}
+
+/* the whole trace is always available, so logging needs no state */
+int pwr_tracedev_log_start( pwr_fd_t fd, PWR_AttrName attr )
+{
+    return 0;
+}
+
+int pwr_tracedev_log_stop( pwr_fd_t fd, PWR_AttrName attr )
+{
+    return 0;
+}
+
+/*
+ * Samples are read straight from the trace at period intervals ending at
+ * the current playback position; samples that would fall before the first
+ * row of the trace are dropped.
+ */
+int pwr_tracedev_get_samples( pwr_fd_t fd, PWR_AttrName attr,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf )
+{
+    pwr_tracedev_t *dev = PWR_TRACEFD(fd)->dev;
+    PWR_Time step = (PWR_Time)(period * 1000000000.0), now = tracedev_now();
+    int col = attr >= 0 && attr < PWR_NUM_ATTR_NAMES ? PWR_TRACEFD(fd)->cols[attr] : -1;
+    unsigned int i, skip = 0;
+
+    if( col < 0 ) {
+        fprintf( stderr, "Warning: trace has no column for attr (%u)\n", attr );
+        return -1;
+    }
+
+    while( skip < *nSamples &&
+           tracedev_position( dev, now - (*nSamples - 1 - skip) * step ) < tracedev_first( dev ) )
+        skip++;
+
+    *nSamples -= skip;
+    *timestamp = now - (*nSamples ? *nSamples - 1 : 0) * step;
+
+    for( i = 0; i < *nSamples; i++ ) {
+        double pos = tracedev_position( dev, *timestamp + i * step );
+
+        ((double *)buf)[i] = TRACE_ROW(dev, tracedev_search( dev, pos ))[col + 1];
+    }
+
+    DBGP( "Info: returning %u samples of attr %u from %llu\n",
+        *nSamples, attr, (unsigned long long)*timestamp );
+
+    return 0;
+}
+
+static plugin_dev_t dev = {
+    .init   = pwr_tracedev_init,
+    .final  = pwr_tracedev_final,
+    .readm  = pwr_tracedev_readm,
+    .read_async = pwr_tracedev_read_async,
+};
+
+plugin_dev_t* getDev() {
+    return &dev;
+}
+
+int getDevVersion() {
+    return PWR_PLUGIN_VERSION;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+#ifndef PWR_TRACEDEV_H 
+#define PWR_TRACEDEV_H 
+
+#include "pwrdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+plugin_devops_t *pwr_tracedev_init( const char *initstr );
+int pwr_tracedev_final( plugin_devops_t *dev );
+
+pwr_fd_t pwr_tracedev_open( plugin_devops_t *dev, const char *openstr );
+int pwr_tracedev_close( pwr_fd_t fd );
+
+int pwr_tracedev_read( pwr_fd_t fd, PWR_AttrName attr,
+    void *value, unsigned int len, PWR_Time *timestamp );
+int pwr_tracedev_write( pwr_fd_t fd, PWR_AttrName attr,
+    void *value, unsigned int len );
+
+int pwr_tracedev_readv(pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] );
+int pwr_tracedev_readm(pwr_fd_t fds[], unsigned int nfds,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] );
+int pwr_tracedev_read_async(pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[],
+    pwr_read_cb_t cb, void *ctx );
+int pwr_tracedev_writev(pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName attrs[], void *values, int status[] );
+
+int pwr_tracedev_time( pwr_fd_t fd, PWR_Time *timestamp );
+int pwr_tracedev_clear( pwr_fd_t fd );
+
+int pwr_tracedev_log_start( pwr_fd_t fd, PWR_AttrName attr );
+int pwr_tracedev_log_stop( pwr_fd_t fd, PWR_AttrName attr );
+int pwr_tracedev_get_samples( pwr_fd_t fd, PWR_AttrName attr,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,11 +17,53 @@
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
 #include <termios.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/time.h>
 
+/*
+ * The meter is put into external logging mode when the device is
+ * initialized and then streams one "#d,...;" record per interval.  A reader
+ * thread parses the records into the latest-value slot and a history ring,
+ * so read/readv/time/get_samples never touch the serial line.  A read
+ * fails once the thread has lost the meter or the latest record is older
+ * than a couple of logging intervals.
+ */
+
+#define WUDEV_LOG_LEN  4096 /* records kept in the history ring */
+#define WUDEV_INTERVAL 1    /* default logging interval in seconds */
+#define WUDEV_POLL_MS  100  /* reader thread shutdown check */
+#define WUDEV_REC_LEN  256
+#define WUDEV_STALE(I) (2 * (I) + 1) /* seconds without a record */
+
+typedef struct {
+    double power;
+    double voltage;
+    double current;
+    double energy;
+    PWR_Time timestamp;
+} wudev_rec_t;
+
 typedef struct {
     int fd;
+    int interval;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;
+    int shutdown;
+    int error;
+
+    int valid;
+    wudev_rec_t latest;
+
+    unsigned int head;
+    unsigned int count;
+    wudev_rec_t log[WUDEV_LOG_LEN];
 } pwr_wudev_t;
 #define PWR_WUDEV(X) ((pwr_wudev_t *)(X))
 
@@ -39,16 +81,13 @@ static plugin_devops_t devops = {
     .writev       = pwr_wudev_writev,
     .time         = pwr_wudev_time,
     .clear        = pwr_wudev_clear,
-#if 0
-    .stat_get     = pwr_dev_stat_get,
-    .stat_start   = pwr_dev_stat_start,
-    .stat_stop    = pwr_dev_stat_stop,
-    .stat_clear   = pwr_dev_stat_clear,
-#endif
+    .log_start    = pwr_wudev_log_start,
+    .log_stop     = pwr_wudev_log_stop,
+    .get_samples  = pwr_wudev_get_samples,
     .private_data = 0x0
 };
 
-static int wudev_parse( const char *initstr, char *port, int *baud )
+static int wudev_parse( const char *initstr, char *port, int *baud, int *interval )
 {
     char *token;
 
@@ -66,7 +105,12 @@ static int wudev_parse( const char *initstr, char *port, int *baud )
     }
     *baud = atoi(token);
 
-    DBGP( "Info: extracted initialization string (PORT=%s, BAUD=%d)\n", port, *baud);
+    /* optional logging interval in seconds */
+    *interval = WUDEV_INTERVAL;
+    if( (token = strtok( NULL, ":" )) != 0x0 && atoi(token) > 0 )
+        *interval = atoi(token);
+
+    DBGP( "Info: extracted initialization string (PORT=%s, BAUD=%d, INTERVAL=%d)\n", port, *baud, *interval);
 
     return 0;
 }
@@ -80,8 +124,10 @@ static int wudev_open( const char *port, int baud )
     if( (fd=open( port, O_RDWR | O_NOCTTY | O_NDELAY)) == -1 )
         return -1;
 
-    if( tcgetattr( fd, &opts ) < 0 )
+    if( tcgetattr( fd, &opts ) < 0 ) {
+        close( fd );
         return -1;
+    }
 
     switch( baud ) {
         case 4800:
@@ -104,6 +150,7 @@ static int wudev_open( const char *port, int baud )
             break;
         default:
             fprintf( stderr, "Error: unsupported baud rate of %d\n", baud );
+            close( fd );
             return -1;
     }
 
@@ -125,8 +172,10 @@ static int wudev_open( const char *port, int baud )
     opts.c_cc[VMIN] = 0;
     opts.c_cc[VTIME] = 20;
 
-    if( tcsetattr( fd, TCSANOW, &opts) < 0 )
+    if( tcsetattr( fd, TCSANOW, &opts) < 0 ) {
+        close( fd );
         return -1;
+    }
 
     return fd;
 }
@@ -141,73 +190,239 @@ static int wudev_write( int fd, const char *str )
     return 0;
 }
 
-static int wudev_read( int fd, char *buf, char term )
+
+static int wudev_record( const char *buf, wudev_rec_t *rec )
 {
-    char c;
-    int i = 0, n;
+    char tmp[WUDEV_REC_LEN], *token, *save;
+    long long field[8];
+    int i;
 
-    do {
-        n = read( fd, &c, 1 );
+    /* only data records are logged, command replies are dropped */
+    if( strncmp( buf, "#d,", 3 ) != 0 )
+        return -1;
 
-        if( n == -1 )
+    strcpy( tmp, buf );
+    for( i = 1; i < 8; i++ ) {
+        if( (token = strtok_r( i > 1 ? NULL : tmp, ",;", &save )) == 0x0 )
             return -1;
+        field[i] = atoll(token);
+    }
+
+    rec->power = field[4] / 10.0;
+    rec->voltage = field[5] / 10.0;
+    rec->current = field[6] / 1000.0;
+    rec->energy = field[7] / 10.0 * 3600;
 
-        if( n == 0 ) {
-            usleep(5 * 1000);
-            continue;
+    return 0;
+}
+
+static void wudev_store( pwr_wudev_t *dev, const char *buf )
+{
+    struct timeval tv;
+    wudev_rec_t rec;
+
+    if( wudev_record( buf, &rec ) < 0 ) {
+        DBGP( "Info: ignoring Wattsup message %s\n", buf );
+        return;
+    }
+
+    gettimeofday( &tv, NULL );
+    rec.timestamp = tv.tv_sec*1000000000ULL + tv.tv_usec*1000;
+
+    pthread_mutex_lock( &dev->lock );
+    dev->latest = rec;
+    dev->valid = 1;
+    dev->log[dev->head] = rec;
+    dev->head = (dev->head + 1) % WUDEV_LOG_LEN;
+    if( dev->count < WUDEV_LOG_LEN )
+        dev->count++;
+    pthread_cond_broadcast( &dev->cond );
+    pthread_mutex_unlock( &dev->lock );
+}
+
+static void *wudev_thread( void *arg )
+{
+    pwr_wudev_t *dev = PWR_WUDEV(arg);
+    struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
+    char buf[WUDEV_REC_LEN], chunk[64];
+    int len = 0, shutdown = 0, i, n;
+
+    while( !shutdown ) {
+        if( (n = poll( &pfd, 1, WUDEV_POLL_MS )) > 0 ) {
+            n = read( dev->fd, chunk, sizeof(chunk) );
+            if( n <= 0 && !(n == -1 && (errno == EAGAIN || errno == EINTR)) ) {
+                fprintf( stderr, "Error: reading from Wattsup device failed\n" );
+                pthread_mutex_lock( &dev->lock );
+                dev->error = n < 0 ? errno : EIO;
+                pthread_cond_broadcast( &dev->cond );
+                pthread_mutex_unlock( &dev->lock );
+                break;
+            }
+
+            for( i = 0; i < n; i++ ) {
+                if( chunk[i] == '\r' || chunk[i] == '\n' )
+                    continue;
+                if( chunk[i] == '#' )
+                    len = 0;
+                if( len < WUDEV_REC_LEN - 1 )
+                    buf[len++] = chunk[i];
+                if( chunk[i] == ';' ) {
+                    buf[len] = '\0';
+                    wudev_store( dev, buf );
+                    len = 0;
+                }
+            }
         }
 
-        if( c != '\r' && c != '\n' )
-            buf[i++] = c;
-    } while( c != term );
+        pthread_mutex_lock( &dev->lock );
+        shutdown = dev->shutdown;
+        pthread_mutex_unlock( &dev->lock );
+    }
+
+    return 0x0;
+}
+
+/*
+ * Copy out the latest record.  Until the meter has sent its first record
+ * this waits for up to a couple of logging intervals, after that a record
+ * older than that is as good as none.
+ */
+static int wudev_latest( pwr_wudev_t *dev, wudev_rec_t *rec )
+{
+    struct timespec deadline;
+    PWR_Time now;
+    int valid, error;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    now = deadline.tv_sec*1000000000ULL + deadline.tv_nsec;
+    deadline.tv_sec += WUDEV_STALE(dev->interval);
+
+    pthread_mutex_lock( &dev->lock );
+    while( !dev->valid && !dev->error && !dev->shutdown )
+        if( pthread_cond_timedwait( &dev->cond, &dev->lock, &deadline ) == ETIMEDOUT )
+            break;
+    error = dev->error;
+    if( (valid = dev->valid) )
+        *rec = dev->latest;
+    pthread_mutex_unlock( &dev->lock );
+
+    if( error ) {
+        fprintf( stderr, "Error: Wattsup device lost (%s)\n", strerror( error ) );
+        return -1;
+    }
+
+    if( !valid ) {
+        fprintf( stderr, "Error: no record received from Wattsup device\n" );
+        return -1;
+    }
+
+    if( now > rec->timestamp &&
+        now - rec->timestamp > WUDEV_STALE(dev->interval) * 1000000000ULL ) {
+        fprintf( stderr, "Error: no record from Wattsup device for %llu s\n",
+            (unsigned long long)(now - rec->timestamp) / 1000000000ULL );
+        return -1;
+    }
 
-    buf[i] = '\0';
     return 0;
 }
 
-static long long wudev_extract( const char *buf, int pos )
+static int wudev_value( const wudev_rec_t *rec, PWR_AttrName attr, double *value )
 {
-    char *token;
-    int i;
+    switch( attr ) {
+        case PWR_ATTR_VOLTAGE:
+            *value = rec->voltage;
+            break;
+        case PWR_ATTR_CURRENT:
+            *value = rec->current;
+            break;
+        case PWR_ATTR_POWER:
+            *value = rec->power;
+            break;
+        case PWR_ATTR_ENERGY:
+            *value = rec->energy;
+            break;
+        default:
+            fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
+            return -1;
+    }
 
-    for( i = 0; i < pos; i++ )
-        if( (token = strtok( i ? NULL : (char *)buf, "," )) == 0x0 )
-            return 0;
+    return 0;
+}
+
+/* undoes a failed init, fd is -1 until the meter is open */
+static plugin_devops_t *wudev_init_failed( plugin_devops_t *dev, int fd )
+{
+    if( fd >= 0 )
+        close( fd );
+    free( dev->private_data );
+    free( dev );
 
-    return atol(token);
+    return 0x0;
 }
 
 plugin_devops_t *pwr_wudev_init( const char *initstr )
 {
-    char port[256] = "";
-    int baud = 0;
+    char port[256] = "", cmd[64];
+    int baud = 0, interval = 0;
+    pwr_wudev_t *wudev;
 
     plugin_devops_t *dev = malloc( sizeof(plugin_devops_t) );
     *dev = devops;
 
     dev->private_data = malloc( sizeof(pwr_wudev_t) );
     bzero( dev->private_data, sizeof(pwr_wudev_t) );
+    wudev = PWR_WUDEV(dev->private_data);
 
     DBGP( "Info: initializing PWR Wattsup device\n" );
 
-    if( initstr == 0x0 || wudev_parse( initstr, port, &baud ) < 0 ) {
+    if( initstr == 0x0 || wudev_parse( initstr, port, &baud, &interval ) < 0 ) {
         fprintf( stderr, "Error: invalid monitor and control hardware initialization string\n" );
-        return 0x0;
+        return wudev_init_failed( dev, -1 );
     }
 
-    if( (PWR_WUDEV(dev->private_data)->fd = wudev_open( port, baud )) < 0 ) {
+    if( (wudev->fd = wudev_open( port, baud )) < 0 ) {
         fprintf( stderr, "Error: wattsup hardware initialization failed\n" );
-        return 0x0;
+        return wudev_init_failed( dev, -1 );
+    }
+    wudev->interval = interval;
+
+    /* switch the meter to external logging, one record per interval */
+    sprintf( cmd, "#L,W,3,E,0,%d;", interval );
+    if( wudev_write( wudev->fd, cmd ) == -1 ) {
+        fprintf( stderr, "Error: command write to Wattsup device failed\n" );
+        return wudev_init_failed( dev, wudev->fd );
     }
 
+    pthread_mutex_init( &wudev->lock, NULL );
+    pthread_cond_init( &wudev->cond, NULL );
+    if( pthread_create( &wudev->thread, NULL, wudev_thread, wudev ) ) {
+        fprintf( stderr, "Error: unable to start Wattsup reader thread\n" );
+        pthread_cond_destroy( &wudev->cond );
+        pthread_mutex_destroy( &wudev->lock );
+        return wudev_init_failed( dev, wudev->fd );
+    }
+    wudev->started = 1;
+
     return dev;
 }
 
 int pwr_wudev_final( plugin_devops_t *dev )
 {
+    pwr_wudev_t *wudev = PWR_WUDEV(dev->private_data);
+
     DBGP( "Info: finalizing PWR Wattsup device\n" );
 
-    close( PWR_WUDEV(dev->private_data)->fd );
+    if( wudev->started ) {
+        pthread_mutex_lock( &wudev->lock );
+        wudev->shutdown = 1;
+        pthread_cond_broadcast( &wudev->cond );
+        pthread_mutex_unlock( &wudev->lock );
+        pthread_join( wudev->thread, NULL );
+    }
+
+    close( wudev->fd );
+    pthread_cond_destroy( &wudev->cond );
+    pthread_mutex_destroy( &wudev->lock );
     free( dev->private_data );
     free( dev );
 
@@ -238,45 +453,17 @@ int pwr_wudev_close( pwr_fd_t fd )
 
 int pwr_wudev_read( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int len, PWR_Time *timestamp )
 {
-    char buf[256] = "";
-    struct timeval tv;
+    wudev_rec_t rec;
 
     DBGP( "Info: reading from PWR Wattsup device\n" );
- 
-    if( wudev_write( (PWR_WUFD(fd)->dev)->fd, "#L,W,3,E,0,1;" ) == -1 ) {
-        fprintf( stderr, "Error: command write to Wattsup device failed\n" );
-        return -1;
-    }
 
-    if( wudev_read( (PWR_WUFD(fd)->dev)->fd, buf, ';' ) != 0 ) {
-        fprintf( stderr, "Error: reading from Wattsup device failed\n" );
+    if( wudev_latest( PWR_WUFD(fd)->dev, &rec ) < 0 )
         return -1;
-    }
 
-    if( strlen( buf ) > 0 ) {
-        DBGP( "Info: read buffer is %s\n", buf );
+    if( wudev_value( &rec, attr, (double *)value ) < 0 )
+        return -1;
+    *timestamp = rec.timestamp;
 
-        switch( attr ) {
-            case PWR_ATTR_VOLTAGE:
-                *((double *)value) = wudev_extract( buf, 5 ) / 10.0;
-                break;
-            case PWR_ATTR_CURRENT:
-                *((double *)value) = wudev_extract( buf, 6 ) / 1000.0;
-                break;
-            case PWR_ATTR_POWER:
-                *((double *)value) = wudev_extract( buf, 4 ) / 10.0;
-                break;
-            case PWR_ATTR_ENERGY:
-                *((double *)value) = wudev_extract( buf, 7 ) / 10.0 * 3600;
-                break;
-            default:
-                fprintf( stderr, "Warning: unknown PWR reading attr (%u) requested\n", attr );
-                break;
-        }
-        gettimeofday( &tv, NULL );
-        *timestamp = tv.tv_sec*1000000000ULL + tv.tv_usec*1000;
-    }
-    
     return 0;
 }
 
@@ -299,10 +486,20 @@ int pwr_wudev_write( pwr_fd_t fd, PWR_AttrName attr, void *value, unsigned int l
 int pwr_wudev_readv( pwr_fd_t fd, unsigned int arraysize,
     const PWR_AttrName attrs[], void *values, PWR_Time timestamp[], int status[] )
 {
+    wudev_rec_t rec;
     unsigned int i;
 
-    for( i = 0; i < arraysize; i++ )
-        status[i] = pwr_wudev_read( fd, attrs[i], (double *)values+i, sizeof(double), timestamp+i );
+    /* every attribute comes from the same record */
+    if( wudev_latest( PWR_WUFD(fd)->dev, &rec ) < 0 ) {
+        for( i = 0; i < arraysize; i++ )
+            status[i] = -1;
+        return 0;
+    }
+
+    for( i = 0; i < arraysize; i++ ) {
+        status[i] = wudev_value( &rec, attrs[i], (double *)values+i );
+        timestamp[i] = rec.timestamp;
+    }
     
     return 0;
 }
@@ -320,11 +517,15 @@ int pwr_wudev_writev( pwr_fd_t fd, unsigned int arraysize,
 
 int pwr_wudev_time( pwr_fd_t fd, PWR_Time *timestamp )
 {
-    double value;
+    wudev_rec_t rec;
 
     DBGP( "Info: getting time from PWR Wattsup device\n" );
 
-    return pwr_wudev_read( fd, PWR_ATTR_POWER, &value, sizeof(double), timestamp);
+    if( wudev_latest( PWR_WUFD(fd)->dev, &rec ) < 0 )
+        return -1;
+    *timestamp = rec.timestamp;
+
+    return 0;
 }
 
 int pwr_wudev_clear( pwr_fd_t fd )
@@ -334,6 +535,62 @@ int pwr_wudev_clear( pwr_fd_t fd )
     return 0;
 }
 
+/* the history ring is filled from init on, so there is nothing to start */
+int pwr_wudev_log_start( pwr_fd_t fd, PWR_AttrName name )
+{
+    wudev_rec_t rec = { 0 };
+    double value;
+
+    return wudev_value( &rec, name, &value );
+}
+
+int pwr_wudev_log_stop( pwr_fd_t fd, PWR_AttrName name )
+{
+    return 0;
+}
+
+static PWR_Time wudev_sample( void *ring, unsigned int i,
+    PWR_AttrName name, double *value )
+{
+    pwr_wudev_t *dev = PWR_WUDEV(ring);
+    wudev_rec_t *rec = &dev->log[(dev->head + WUDEV_LOG_LEN - dev->count + i) % WUDEV_LOG_LEN];
+
+    if( value )
+        wudev_value( rec, name, value );
+
+    return rec->timestamp;
+}
+
+/* resample the history ring the same way pwr_dev_get_samples does */
+int pwr_wudev_get_samples( pwr_fd_t fd, PWR_AttrName name,
+    PWR_Time *timestamp, double period, unsigned int *nSamples, void *buf )
+{
+    pwr_wudev_t *dev = PWR_WUFD(fd)->dev;
+    wudev_rec_t rec = { 0 };
+    double value;
+
+    if( wudev_value( &rec, name, &value ) < 0 )
+        return -1;
+
+    pthread_mutex_lock( &dev->lock );
+
+    if( dev->count == 0 ) {
+        pthread_mutex_unlock( &dev->lock );
+        fprintf( stderr, "Error: no records logged from Wattsup device\n" );
+        return -1;
+    }
+
+    pwr_dev_resample( dev, dev->count, wudev_sample, name,
+        timestamp, period, nSamples, buf );
+
+    pthread_mutex_unlock( &dev->lock );
+
+    DBGP( "Info: returning %u samples of attr %u from %llu\n",
+        *nSamples, name, (unsigned long long)*timestamp );
+
+    return 0;
+}
+
 static plugin_dev_t dev = {
     .init   = pwr_wudev_init,
     .final  = pwr_wudev_final,
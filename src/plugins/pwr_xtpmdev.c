@@ -39,6 +39,9 @@ static plugin_devops_t devops = {
     .writev       = pwr_xtpmdev_writev,
     .time         = pwr_xtpmdev_time,
     .clear        = pwr_xtpmdev_clear,
+    .log_start    = pwr_dev_log_start,
+    .log_stop     = pwr_dev_log_stop,
+    .get_samples  = pwr_dev_get_samples,
 #if 0
     .stat_get     = pwr_dev_stat_get,
     .stat_start   = pwr_dev_stat_start,
@@ -108,6 +111,8 @@ plugin_devops_t *pwr_xtpmdev_init( const char *initstr )
 
     DBGP( "Info: initializing PWR XTPM device\n" );
 
+    pwr_dev_log_init( dev, pwr_xtpmdev_read, PWR_DEV_LOG_PERIOD );
+
     return dev;
 }
 
@@ -115,6 +120,8 @@ int pwr_xtpmdev_final( plugin_devops_t *dev )
 {
     DBGP( "Info: finalizing PWR XTPM device\n" );
 
+    pwr_dev_log_final( dev );
+
     free( dev->private_data );
     free( dev );
     return 0;
@@ -134,6 +141,8 @@ pwr_fd_t pwr_xtpmdev_open( plugin_devops_t *dev, const char *openstr )
         return 0x0;
     }
 
+    pwr_dev_log_open( dev, fd );
+
     return fd;
 }
 
@@ -141,6 +150,8 @@ int pwr_xtpmdev_close( pwr_fd_t fd )
 {
     DBGP( "Info: closing PWR XTPM device\n" );
 
+    pwr_dev_log_close( fd );
+
     PWR_XTPMFD(fd)->dev = 0x0;
     free( fd );
 
@@ -27,10 +27,37 @@ Event* ctx_allocEvent( unsigned int type, SerialBuf& buf )
 	switch( (EventType) type ) {
 	  default:
 		assert(0);	
+	  case CommResp:
+		return EventPool<CommRespEvent>::get( buf );
+	  case CommLogResp:
+		return new CommLogRespEvent( buf );
+	  case CommGetSamplesResp:
+		return new CommGetSamplesRespEvent( buf );
+	}
+	return NULL;
+}
+
+Event* allocBaseEvent( unsigned int type, SerialBuf& buf )
+{
+	switch( (EventType) type ) {
+	  default:
+		assert(0);	
+	  case ServerConnect:
+		return new ServerConnectEvent( buf );
+	  case CommCreate:
+		return new CommCreateEvent( buf );
+	  case CommDestroy:
+		return new CommDestroyEvent( buf );
+	  case CommReq:
+		return new CommReqEvent( buf );
 	  case CommResp:
 		return new CommRespEvent( buf );
+	  case CommLogReq:
+		return new CommLogReqEvent( buf );
 	  case CommLogResp:
 		return new CommLogRespEvent( buf );
+	  case CommGetSamplesReq:
+		return new CommGetSamplesReqEvent( buf );
 	  case CommGetSamplesResp:
 		return new CommGetSamplesRespEvent( buf );
 	}
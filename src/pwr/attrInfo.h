@@ -14,6 +14,7 @@
 
 #include <deque>
 #include <communicator.h>
+#include "pwrdev.h"
 
 namespace PowerAPI {
 
@@ -33,7 +34,16 @@ class AttrInfo {
 		return ! devices.empty() || comm; 
 	}   
 
+	// devices opened on the same plugin device that can be read with one
+	// readm() call, index holds the position of each device in devices
+	struct Batch {
+		Batch( pwr_readm_t func ) : readm( func ) {}
+		pwr_readm_t				readm;
+		std::vector<unsigned>	index;
+	};
+
 	std::vector<Device*> devices;
+	std::vector<Batch>	batches;
 	Communicator*		comm;
 	OpFuncPtr			operation;
 	TimeFuncPtr 		calcTime;
@@ -24,6 +24,19 @@ Object* Cntxt::getObjByName( std::string name )
     return findObject( name );
 }
 
+Object* Cntxt::getObjByHandle( ObjHandle handle )
+{
+    DBGX("%u\n",handle);
+    std::string name = m_config->findObjName( handle );
+    return name.empty() ? NULL : findObject( name );
+}
+
+ObjHandle Cntxt::getObjHandle( std::string name )
+{
+    int index = m_config->findObjIndex( name );
+    return index < 0 ? NO_HANDLE : index;
+}
+
 Object* Cntxt::getSelf()
 {
     DBGX("root=%p\n",m_rootObj);
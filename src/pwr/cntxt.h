@@ -34,6 +34,8 @@ class Cntxt {
 
 	virtual Object* getEntryPoint();
 	virtual Object* getObjByName( std::string );
+	virtual Object* getObjByHandle( ObjHandle );
+	virtual ObjHandle getObjHandle( std::string );
 	virtual Object* getParent( Object* );
 	virtual Grp* 	getChildren( Object* );
 	virtual Object* getSelf();
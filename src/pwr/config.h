@@ -55,6 +55,10 @@ class Config {
 
 	virtual bool hasObject( const std::string ) = 0;
 	virtual PWR_ObjType objType( const std::string ) = 0;
+
+	// position of an object in the object list, -1 if not found
+	virtual int findObjIndex( const std::string ) { return -1; }
+	virtual std::string findObjName( int ) { return ""; }
 	virtual void print( std::ostream& ) {};
 };
 
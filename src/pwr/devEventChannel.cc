@@ -0,0 +1,93 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "devEventChannel.h"
+#include "communicator.h"
+#include "event.h"
+#include "debug.h"
+
+using namespace PowerAPI;
+
+DevEventChannel::DevEventChannel() : EventChannel( NULL, "PWR_Device" )
+{
+	int rc = pipe( m_fd );
+	assert( 0 == rc );
+	pthread_mutex_init( &m_lock, NULL );
+	DBGX2(DBG_EC,"fd=%d\n",m_fd[0]);
+}
+
+// completions nobody took off the channel are freed with it, their
+// requests were never processed and hold nothing else
+DevEventChannel::~DevEventChannel()
+{
+	while ( ! m_queue.empty() ) {
+		delete m_queue.front();
+		m_queue.pop_front();
+	}
+	pthread_mutex_destroy( &m_lock );
+	::close( m_fd[0] );
+	::close( m_fd[1] );
+}
+
+// the pipe never holds more than one byte so the write can not block
+void DevEventChannel::post( CommReq* req )
+{
+	pthread_mutex_lock( &m_lock );
+	if ( m_queue.empty() ) {
+		char c = 0;
+		ssize_t nbytes;
+		do {
+			nbytes = write( m_fd[1], &c, 1 );
+		} while ( nbytes < 0 && errno == EINTR );
+		assert( 1 == nbytes );
+	}
+	m_queue.push_back( req );
+	pthread_mutex_unlock( &m_lock );
+}
+
+Event* DevEventChannel::getEvent( bool blocking )
+{
+	CommReq* req;
+
+	pthread_mutex_lock( &m_lock );
+	while ( m_queue.empty() ) {
+		pthread_mutex_unlock( &m_lock );
+		if ( ! blocking ) {
+			return NULL;
+		}
+		struct pollfd pfd = { m_fd[0], POLLIN, 0 };
+		if ( poll( &pfd, 1, -1 ) < 0 && errno != EINTR ) {
+			return NULL;
+		}
+		pthread_mutex_lock( &m_lock );
+	}
+
+	req = m_queue.front();
+	m_queue.pop_front();
+	if ( m_queue.empty() ) {
+		char c;
+		ssize_t nbytes;
+		do {
+			nbytes = read( m_fd[0], &c, 1 );
+		} while ( nbytes < 0 && errno == EINTR );
+		assert( 1 == nbytes );
+	}
+	pthread_mutex_unlock( &m_lock );
+
+	Event* ev = new Event;
+	ev->id = (EventId) req;
+	DBGX2(DBG_EC2,"req=%p\n",req);
+	return ev;
+}
@@ -0,0 +1,53 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+#ifndef _DEV_EVENT_CHANNEL_H
+#define _DEV_EVENT_CHANNEL_H
+
+#include <pthread.h>
+#include <deque>
+#include <eventChannel.h>
+
+namespace PowerAPI {
+
+class CommReq;
+
+// Carries completed device requests from plugin and worker threads back 
+// to the thread driving the context.  Completions are queued in memory, 
+// the pipe only holds a single byte while the queue is not empty so a 
+// ChannelSelect can wait on it.  A plugin may complete a read on the 
+// context's own thread, which must never block on a full pipe.  getEvent()
+// hands a completion back as the id of an Event so it is processed the 
+// same way as a response from a remote server.
+
+class DevEventChannel : public EventChannel {
+
+  public:
+	DevEventChannel();
+	~DevEventChannel();
+
+	// safe to call from any thread
+	void post( CommReq* );
+
+	virtual Event* getEvent( bool blocking = true );
+	// completions only arrive through post()
+	virtual bool sendEvent( Event* ) { return false; }
+	virtual int getFd() { return m_fd[0]; }
+
+  private:
+	int m_fd[2];
+	pthread_mutex_t m_lock;
+	std::deque<CommReq*> m_queue;
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include <assert.h>
+
+#include "devWorker.h"
+#include "debug.h"
+
+using namespace PowerAPI;
+
+DevWorker::DevWorker() : m_shutdown( false )
+{
+	pthread_mutex_init( &m_lock, NULL );
+	pthread_cond_init( &m_cond, NULL );
+	int rc = pthread_create( &m_thread, NULL, thread, this );
+	assert( 0 == rc );
+}
+
+// work already queued is run before the worker exits
+DevWorker::~DevWorker()
+{
+	pthread_mutex_lock( &m_lock );
+	m_shutdown = true;
+	pthread_cond_signal( &m_cond );
+	pthread_mutex_unlock( &m_lock );
+
+	pthread_join( m_thread, NULL );
+	pthread_cond_destroy( &m_cond );
+	pthread_mutex_destroy( &m_lock );
+}
+
+void DevWorker::submit( WorkFuncPtr func, void* data )
+{
+	pthread_mutex_lock( &m_lock );
+	m_queue.push_back( std::make_pair( func, data ) );
+	pthread_cond_signal( &m_cond );
+	pthread_mutex_unlock( &m_lock );
+}
+
+void* DevWorker::thread( void* data )
+{
+	static_cast<DevWorker*>(data)->run();
+	return NULL;
+}
+
+void DevWorker::run()
+{
+	pthread_mutex_lock( &m_lock );
+	while ( 1 ) {
+		if ( m_queue.empty() ) {
+			if ( m_shutdown ) {
+				break;
+			}
+			pthread_cond_wait( &m_cond, &m_lock );
+			continue;
+		}
+
+		std::pair< WorkFuncPtr, void* > work = m_queue.front();
+		m_queue.pop_front();
+
+		pthread_mutex_unlock( &m_lock );
+		DBGX("\n");
+		work.first( work.second );
+		pthread_mutex_lock( &m_lock );
+	}
+	pthread_mutex_unlock( &m_lock );
+}
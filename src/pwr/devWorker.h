@@ -0,0 +1,50 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _DEV_WORKER_H
+#define _DEV_WORKER_H
+
+#include <pthread.h>
+#include <deque>
+
+namespace PowerAPI {
+
+// Runs device reads of plugins that only have the synchronous interface
+// off the thread driving the context.  There is one worker per plugin
+// device instance so reads of an instance stay serialized, as they were
+// when the context issued them itself, while slow instances do not hold
+// up each other.
+
+class DevWorker {
+
+  public:
+	typedef void (*WorkFuncPtr)( void* );
+
+	DevWorker();
+	~DevWorker();
+
+	void submit( WorkFuncPtr, void* );
+
+  private:
+	static void* thread( void* );
+	void run();
+
+	pthread_t		m_thread;
+	pthread_mutex_t	m_lock;
+	pthread_cond_t	m_cond;
+	bool			m_shutdown;
+	std::deque< std::pair< WorkFuncPtr, void* > > m_queue;
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <inttypes.h>
 
 #include <vector>
+#include <string>
 #include <assert.h>
 #include "pwrdev.h"
 #include "debug.h"
@@ -38,47 +39,49 @@ static inline int opAvg( int num, double input[], double* result, PWR_Time* ts)
 class Device {
 
   public:
-	Device( plugin_devops_t* ops, const std::string config )
-      :  m_ops( ops )
+	Device( plugin_devops_t* ops, const std::string config,
+			pwr_readm_t readm = NULL, pwr_read_async_t readAsync = NULL )
+      :  m_ops( ops ), m_readm( readm ), m_readAsync( readAsync ),
+		m_config( config ), m_fd( NULL )
     {
         DBGX("\n");
-        m_fd = m_ops->open( ops, config.c_str() );
-		assert( m_fd );
     }
 
     virtual ~Device() {
-		m_ops->close( m_fd );
+		if ( m_fd ) {
+			m_ops->close( m_fd );
+		}
     }
 
 	virtual int getValues( const std::vector<PWR_AttrName>& names, void* ptr,
                     std::vector<PWR_Time>& ts, std::vector<int>& status ){
         DBGX("\n");
-        return m_ops->readv( m_fd, names.size(), &names[0], ptr,
+        return m_ops->readv( fd(), names.size(), &names[0], ptr,
                             &ts[0], &status[0] );
     }
 
     virtual int setValues( const std::vector<PWR_AttrName>& names, void* ptr,
                     std::vector<int>& status ){
         DBGX("\n");
-        return m_ops->writev( m_fd, names.size(), &names[0], ptr,
+        return m_ops->writev( fd(), names.size(), &names[0], ptr,
                                                             &status[0] );
     }
 
     virtual int getValue( PWR_AttrName name, void* ptr, size_t len,
 														PWR_Time* ts ){
         DBGX("\n");
-        return m_ops->read( m_fd, name, ptr, len, ts );
+        return m_ops->read( fd(), name, ptr, len, ts );
     }
 
     virtual int setValue( PWR_AttrName name, void* ptr, size_t len ) {
         DBGX("\n");
-        return m_ops->write( m_fd, name, ptr, len );
+        return m_ops->write( fd(), name, ptr, len );
     }
 
     virtual int startLog( PWR_AttrName name ) {
         DBGX("\n");
         if ( m_ops->log_start ) {
-            return m_ops->log_start( m_fd, name );
+            return m_ops->log_start( fd(), name );
         } else {
             return PWR_RET_FAILURE;
         }
@@ -87,7 +90,7 @@ class Device {
     virtual int stopLog( PWR_AttrName name ) {
         DBGX("\n");
         if ( m_ops->log_stop ) {
-            return m_ops->log_stop( m_fd, name );
+            return m_ops->log_stop( fd(), name );
         } else {
             return PWR_RET_FAILURE;
         }
@@ -97,14 +100,35 @@ class Device {
 						double period, unsigned int* nSamples, void* results ) {
         DBGX("\n");
         if ( m_ops->get_samples ) {
-            return m_ops->get_samples( m_fd, name, ts, period, nSamples, results );
+            return m_ops->get_samples( fd(), name, ts, period, nSamples, results );
         } else {
             return PWR_RET_FAILURE;
         }
     }
 
+    // the device is opened on first access, not when an attribute using 
+    // it is resolved
+    pwr_fd_t fd() { 
+		if ( ! m_fd ) {
+        	m_fd = m_ops->open( m_ops, m_config.c_str() );
+			assert( m_fd );
+		}
+		return m_fd; 
+	}
+
+    plugin_devops_t* ops() { return m_ops; }
+
+    // set when the plugin implements version 2 of the plugin interface
+    pwr_readm_t readm() { return m_readm; }
+
+    // set when the plugin implements version 3 of the plugin interface
+    pwr_read_async_t readAsync() { return m_readAsync; }
+
   private:
     plugin_devops_t*	m_ops;
+    pwr_readm_t			m_readm;
+    pwr_read_async_t	m_readAsync;
+    std::string			m_config;
     pwr_fd_t        	m_fd;	
 };
 
@@ -16,8 +16,10 @@
 #endif
 #include <stdlib.h>
 #include <string>
+#include <algorithm>
 #include <assert.h>
 #include <sys/utsname.h>
+#include <sys/time.h>
 
 #include "distCntxt.h"
 #include "distRequest.h"
@@ -31,6 +33,8 @@
 #include "xmlConfig.h"
 #include "util.h"
 #include "device.h"
+#include "devEventChannel.h"
+#include "devWorker.h"
 
 #include "tcpEventChannel.h"
 #include "allocEvent.h"
@@ -50,8 +54,11 @@ static const char* getenv2( std::string prefix, std::string sufix )
 }
 
 DistCntxt::DistCntxt( PWR_CntxtType type, PWR_Role role, const char* name ) :
-	m_name(name)
+	m_devChan(NULL), m_pluginsLoaded(false), m_name(name)
 {
+	struct timeval start, end;
+	gettimeofday( &start, NULL );
+
 	DBGX("name=%s\n",name);
 	m_evChan = initEventChannel();	
 
@@ -106,9 +113,20 @@ DistCntxt::DistCntxt( PWR_CntxtType type, PWR_Role role, const char* name ) :
         printf("error: environment variable `POWERAPI_ROOT` must be set\n");
         exit(-1);
     }
+
+	gettimeofday( &end, NULL );
+	DBGX("init took %ld usec, %lu plugins, %lu devices\n",
+		(end.tv_sec - start.tv_sec) * 1000000L + end.tv_usec - start.tv_usec,
+		m_pluginLibMap.size(), m_devMap.size() );
 }
 DistCntxt::~DistCntxt() 
 {
+	// workers finish queued reads, which post to the device channel
+	while ( ! m_devWorkerMap.empty() ) {
+		delete m_devWorkerMap.begin()->second;
+		m_devWorkerMap.erase( m_devWorkerMap.begin() );
+	}
+
 	delete m_evChan;
 	delete m_config;
 	while ( ! m_objMap.empty() ) { 
@@ -132,6 +150,10 @@ DistCntxt::~DistCntxt()
 		m_devMap.begin()->second.first->final( m_devMap.begin()->second.second );
 		m_devMap.erase( m_devMap.begin() );	
 	}
+
+	// an asynchronous read may complete until its plugin is finalized, 
+	// the channel frees what was completed and never processed
+	delete m_devChan;
 	
 	while ( ! m_pluginLibMap.empty() ) {
 		m_pluginLibMap.erase( m_pluginLibMap.begin() );
@@ -165,6 +187,23 @@ EventChannel* DistCntxt::initEventChannel()
 	return ::getEventChannel("TCP", ctx_allocEvent, config, "PWR_Cntxt" );
 }
 
+EventChannel* DistCntxt::initDevEventChannel()
+{
+	if ( ! m_devChan ) {
+		m_devChan = new DevEventChannel;
+	}
+	return m_devChan;
+}
+
+DevWorker* DistCntxt::getDevWorker( plugin_devops_t* ops )
+{
+	if ( m_devWorkerMap.find( ops ) == m_devWorkerMap.end() ) {
+		DBGX("new worker for ops=%p\n",ops);
+		m_devWorkerMap[ ops ] = new DevWorker;
+	}
+	return m_devWorkerMap[ ops ];
+}
+
 Communicator* DistCntxt::getCommunicator( std::set<std::string> objects )
 {
 	DBGX("\n");
@@ -212,6 +251,24 @@ static void avgOp( void* out, void* in, size_t num )
 	*(double*)out = tmp/num;
 }
 
+static void minOp( void* out, void* in, size_t num )
+{
+	double tmp = ((double*)in)[0];
+	for ( unsigned i = 1; i < num; i++) {
+		tmp = std::min( tmp, ((double*)in)[i] );
+	}
+	*(double*)out = tmp;
+}
+
+static void maxOp( void* out, void* in, size_t num )
+{
+	double tmp = ((double*)in)[0];
+	for ( unsigned i = 1; i < num; i++) {
+		tmp = std::max( tmp, ((double*)in)[i] );
+	}
+	*(double*)out = tmp;
+}
+
 static PWR_Time timeOp( std::vector<PWR_Time> x )
 {
 	return x[0];
@@ -219,7 +276,7 @@ static PWR_Time timeOp( std::vector<PWR_Time> x )
 
 AttrInfo* DistCntxt::initAttr( Object* obj, PWR_AttrName attrName )
 {
-	ValueOp vOp = NO_OP;
+	ValueOp vOp = VOP_NONE;
     DBGX("obj=`%s` attr=%s\n",obj->name().c_str(),attrNameToString(attrName));
 
     std::string op = m_config->findAttrOp( obj->name(),attrName );
@@ -228,9 +285,9 @@ AttrInfo* DistCntxt::initAttr( Object* obj, PWR_AttrName attrName )
     if ( ! op.compare("SUM") ) {
         opFunc = sumOp;
 		if ( ! type.compare("Float") ) {
-			vOp = FP_ADD;
+			vOp = VOP_FP_ADD;
 		} else if ( ! type.compare("Integer") ) {
-			vOp = INT_ADD;
+			vOp = VOP_INT_ADD;
 		} else {
             assert(0);
         }
@@ -239,9 +296,31 @@ AttrInfo* DistCntxt::initAttr( Object* obj, PWR_AttrName attrName )
         opFunc = avgOp;
 
 		if ( ! type.compare("Float") ) {
-			vOp = FP_AVG;
+			vOp = VOP_FP_AVG;
+		} else if ( ! type.compare("Integer") ) {
+			vOp = VOP_INT_AVG;
+		} else {
+            assert(0);
+        }
+
+    } else if ( ! op.compare("MIN") ) {
+        opFunc = minOp;
+
+		if ( ! type.compare("Float") ) {
+			vOp = VOP_FP_MIN;
 		} else if ( ! type.compare("Integer") ) {
-			vOp = INT_AVG;
+			vOp = VOP_INT_MIN;
+		} else {
+            assert(0);
+        }
+
+    } else if ( ! op.compare("MAX") ) {
+        opFunc = maxOp;
+
+		if ( ! type.compare("Float") ) {
+			vOp = VOP_FP_MAX;
+		} else if ( ! type.compare("Integer") ) {
+			vOp = VOP_INT_MAX;
 		} else {
             assert(0);
         }
@@ -249,9 +328,10 @@ AttrInfo* DistCntxt::initAttr( Object* obj, PWR_AttrName attrName )
 
 	AttrInfo* attrInfo = new AttrInfo( opFunc, timeOp, vOp );
 
-	if ( vOp != NO_OP ) {
+	if ( vOp != VOP_NONE ) {
    		std::set<std::string> remote;
 		traverse( obj->name(), attrName, attrInfo->devices, remote );
+		initBatches( attrInfo );
 
 		DBGX("obj='%s' attr=`%s` op=%s type=%s\n",
 						obj->name().c_str(),attrNameToString(attrName),
@@ -294,15 +374,21 @@ void DistCntxt::traverse( std::string objName, PWR_AttrName attrName,
                 assert(0);
             }
         }
+		plugin_dev_t* plugin = m_devMap[dev.device].first;
 		plugin_devops_t* ops = m_devMap[dev.device].second;
+		pwr_readm_t readm = m_pluginVersionMap[plugin] >= 2 ? 
+												plugin->readm : NULL;
+		pwr_read_async_t readAsync = m_pluginVersionMap[plugin] >= 3 ? 
+												plugin->read_async : NULL;
 
 		if ( m_deviceMap.find( ops ) == m_deviceMap.end() ) {
-			m_deviceMap[ops][dev.openString] = new Device( ops, dev.openString );
+			m_deviceMap[ops][dev.openString] = 
+					new Device( ops, dev.openString, readm, readAsync );
 		} else {
 			if ( m_deviceMap[ops].find(dev.openString) == 
 												m_deviceMap[ops].end() ) {
 				m_deviceMap[ops][dev.openString] = 
-											new Device( ops, dev.openString );
+					new Device( ops, dev.openString, readm, readAsync );
 			}	
 		}
 		DBGX("ops=%p %s Device=%p\n",ops, dev.openString.c_str(),
@@ -322,6 +408,38 @@ void DistCntxt::traverse( std::string objName, PWR_AttrName attrName,
 	}
 }
 
+// Group the local devices of an attribute by the plugin device they are
+// opened on, its plugin_devops_t, so a plugin that implements readm() is
+// called once per read instead of once per device.  Two plugin devices
+// of one plugin share readm() but not their state or their worker, and
+// are read apart.  Devices of version 1 plugins get a batch of their own
+// with no readm.
+void DistCntxt::initBatches( AttrInfo* info )
+{
+	std::map< plugin_devops_t*, unsigned > batchMap;
+
+	for ( unsigned i = 0; i < info->devices.size(); i++ ) {
+		pwr_readm_t readm = info->devices[i]->readm();
+		plugin_devops_t* ops = info->devices[i]->ops();
+		unsigned pos;
+
+		if ( readm && batchMap.find( ops ) != batchMap.end() ) {
+			pos = batchMap[ ops ];
+		} else {
+			pos = info->batches.size();
+			info->batches.push_back( AttrInfo::Batch( readm ) );
+			if ( readm ) {
+				batchMap[ ops ] = pos;
+			}
+		}
+		info->batches[pos].index.push_back( i );
+	}
+	DBGX("%lu devices in %lu batches\n", info->devices.size(),
+										info->batches.size() );
+}
+
+// Loads every plugin named in the configuration and indexes the system
+// devices by name.  Runs once, when the first device is needed.
 void DistCntxt::initPlugins( Config& cfg )
 {
 	struct utsname name;
@@ -331,7 +449,7 @@ void DistCntxt::initPlugins( Config& cfg )
 	std::string os( name.sysname);
 
 
-    std::deque< Config::Plugin > plugins = m_config->findPlugins();
+    std::deque< Config::Plugin > plugins = cfg.findPlugins();
     std::deque< Config::Plugin >::iterator iter = plugins.begin();
 
     for ( ; iter != plugins.end(); ++ iter ) {
@@ -351,47 +469,66 @@ void DistCntxt::initPlugins( Config& cfg )
 
         assert( m_pluginLibMap[ plugin.name ] );
     }
+
+    std::deque< Config::SysDev > devices = cfg.findSysDevs();
+    std::deque< Config::SysDev >::iterator dev = devices.begin();
+
+    for ( ; dev != devices.end(); ++dev ) {
+        DBGX("device name=`%s` plugin=`%s` initString=`%s`\n",
+            dev->name.c_str(), dev->plugin.c_str(), dev->initString.c_str() );
+        m_sysDevMap[ dev->name ] = *dev;
+    }
+
+	m_pluginsLoaded = true;
 }
 
 bool DistCntxt::initDevice( std::string& devName )
 {
     DBGX("device name=`%s`\n", devName.c_str() );
-    initPlugins( *m_config );
-
-    std::deque< Config::SysDev > devices = (*m_config).findSysDevs();
-    std::deque< Config::SysDev >::iterator iter = devices.begin();
-
-    for ( ; iter != devices.end(); ++iter ) {
+	if ( ! m_pluginsLoaded ) {
+    	initPlugins( *m_config );
+	}
 
-        Config::SysDev dev = *iter;
-        DBGX("device name=`%s` plugin=`%s` initString=`%s`\n",
-            dev.name.c_str(), dev.plugin.c_str(), dev.initString.c_str() );
+    std::map< std::string, Config::SysDev >::iterator iter = 
+											m_sysDevMap.find( devName );
+    if ( iter == m_sysDevMap.end() ) {
+        return false;
+    }
 
-        if ( 0 == devName.compare( dev.name ) ) {
-            m_devMap[ dev.name ].second =
-                m_pluginLibMap[ dev.plugin ]->init( dev.initString.c_str() );
-            assert( m_devMap[ dev.name ].second );
+    Config::SysDev& dev = iter->second;
+    m_devMap[ dev.name ].second =
+        m_pluginLibMap[ dev.plugin ]->init( dev.initString.c_str() );
+    assert( m_devMap[ dev.name ].second );
 
-            m_devMap[ dev.name ].first = m_pluginLibMap[ dev.plugin ];
-            return true;
-        }
-    }
-    return false;
+    m_devMap[ dev.name ].first = m_pluginLibMap[ dev.plugin ];
+    return true;
 }
 
-int DistCntxt::makeProgress()
+int DistCntxt::makeProgress( EventChannel* ec )
 {
 	DBGX("\n");
-    EventChannel* ec = getEventChannel();
+	if ( ! ec ) {
+    	ec = getEventChannel();
+	}
 
 	Event* ev = ec->getEvent();
+	if ( ! ev ) {
+		return PWR_RET_IPC;
+	}
     DistCommReq* req = static_cast<DistCommReq*>((CommReq*)ev->id);
+	// process() may free req, and the request may still be waiting on 
+	// other local devices or servers
+	DistRequest* distReq = req->m_req;
     req->process( ev );
-	if ( req->m_req ) {
+	if ( distReq && distReq->finished() ) {
 		DBGX("\n");
-		req->m_req->execCallback();
+		// the callback may free the request, only its return value says
+		// whether we own it now
+		if ( distReq->execCallback() ) {
+			delete distReq;
+		}
 	}
-	delete ev;
+	ev->release();
 	DBGX("\n");
 	return PWR_RET_SUCCESS;
 }
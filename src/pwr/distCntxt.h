@@ -16,6 +16,7 @@
 #include <map>
 
 #include "cntxt.h"
+#include "config.h"
 #include "pwrdev.h"
 
 class EventChannel;
@@ -24,6 +25,8 @@ namespace PowerAPI {
 class Config;
 class Communicator;
 class Device;
+class DevEventChannel;
+class DevWorker;
 
 class DistCntxt : public Cntxt {
 
@@ -32,7 +35,12 @@ class DistCntxt : public Cntxt {
     ~DistCntxt( );
 	EventChannel* getEventChannel() { return m_evChan; }
 
-	int makeProgress();
+	// local device reads are asynchronous once the device channel exists
+	DevEventChannel* getDevEventChannel() { return m_devChan; }
+	EventChannel* initDevEventChannel();
+	DevWorker* getDevWorker( plugin_devops_t* );
+
+	int makeProgress( EventChannel* = NULL );
 	AttrInfo* initAttr( Object*, PWR_AttrName );
 	virtual Object* createObject( std::string, PWR_ObjType, Cntxt* );
 
@@ -42,6 +50,7 @@ class DistCntxt : public Cntxt {
   private:
 	void traverse( std::string objName, PWR_AttrName,
 					std::vector<Device*>&, std::set<std::string>& );
+	void initBatches( AttrInfo* );
 
 
 	Communicator* getCommunicator( std::set<std::string> objects );
@@ -51,8 +60,13 @@ class DistCntxt : public Cntxt {
 
 	EventChannel*   initEventChannel();
 	EventChannel*   m_evChan;
+	DevEventChannel* m_devChan;
+	std::map< plugin_devops_t*, DevWorker* > m_devWorkerMap;
 
     std::map< std::string, plugin_dev_t* >     m_pluginLibMap;
+    std::map< plugin_dev_t*, int >             m_pluginVersionMap;
+    std::map< std::string, Config::SysDev >    m_sysDevMap;
+    bool                                       m_pluginsLoaded;
     std::map< std::string, std::pair< plugin_dev_t*, plugin_devops_t* > > m_devMap;
 	std::map< plugin_devops_t*, std::map< std::string, Device* > > m_deviceMap;
 
@@ -18,6 +18,7 @@
 #include "debug.h"
 #include "events.h"
 #include "eventChannel.h"
+#include "objRange.h"
 
 using namespace PowerAPI;
 
@@ -54,13 +55,75 @@ EventChannel& DistComm::getChannel()
 	CommCreateEvent* ev = new CommCreateEvent();
 	ev->commID = m_commID;
 
-	ev->members.push_back( m_objects );
+	addMembers( ev, m_objects );
+	compressMembers( ev );
 
 	m_ec->sendEvent( ev );
 	delete ev;
 	return *m_ec;
 }
 
+// the handles go with the names, if one of the objects has no handle none
+// of them are sent and the daemons fall back to names for the communicator
+void DistComm::addMembers( CommCreateEvent* ev, std::vector<std::string>& objs )
+{
+	bool haveHandles = ev->handles.size() == ev->members.size();
+
+	ev->members.push_back( objs );
+	if ( ! haveHandles ) return;
+
+	std::vector<ObjHandle> handles( objs.size() );
+	for ( unsigned i = 0; i < objs.size(); i++ ) {
+		handles[i] = m_ctx->getObjHandle( objs[i] );
+		if ( NO_HANDLE == handles[i] ) {
+			DBGX("no handle for `%s`\n",objs[i].c_str());
+			ev->handles.clear();
+			return;
+		}
+	}
+	ev->handles.push_back( handles );
+}
+
+// Send the members as ranges when that is shorter.  A group whose members
+// are single objects, nodes say, goes as one list split into a group per
+// name, a group of groups with more than one object each goes as names.
+void DistComm::compressMembers( CommCreateEvent* ev )
+{
+	std::vector<std::string> names;
+	std::vector<ObjHandle> handles;
+	bool split = ev->members.size() > 1;
+
+	if ( ev->members.empty() ) {
+		return;
+	} else if ( split ) {
+		for ( unsigned i = 0; i < ev->members.size(); i++ ) {
+			if ( 1 != ev->members[i].size() ) return;
+			names.push_back( ev->members[i][0] );
+			if ( ! ev->handles.empty() ) {
+				handles.push_back( ev->handles[i][0] );
+			}
+		}
+	} else {
+		names = ev->members[0];
+		if ( ! ev->handles.empty() ) {
+			handles = ev->handles[0];
+		}
+	}
+
+	std::vector<std::string> patterns;
+	if ( ! compressObjNames( names, patterns ) || 
+							patterns.size() >= names.size() ) {
+		return;
+	}
+	DBGX("%zu names in %zu ranges\n", names.size(), patterns.size() );
+
+	ev->ranges.push_back( patterns );
+	ev->splitRanges = split;
+	compressHandles( handles, ev->handleRanges );
+	ev->members.clear();
+	ev->handles.clear();
+}
+
 void DistComm::getValues( int count, PWR_AttrName attr[],
 										ValueOp op[], CommReq* req )
 {
@@ -84,6 +84,9 @@ class DistComm : public Communicator {
 	std::vector<std::string> m_objects;
 
   protected:
+	void addMembers( CommCreateEvent*, std::vector<std::string>& );
+	void compressMembers( CommCreateEvent* );
+
 	static uint32_t m_currentCommID;
 
 	DistCntxt*		m_ctx;
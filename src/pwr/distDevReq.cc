@@ -0,0 +1,152 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include "distDevReq.h"
+#include "distCntxt.h"
+#include "distRequest.h"
+#include "devEventChannel.h"
+#include "devWorker.h"
+#include "device.h"
+#include "debug.h"
+
+using namespace PowerAPI;
+
+DistDevGetCommReq::DistDevGetCommReq( DistRequest* req, DistCntxt* ctx,
+		Object* obj, AttrInfo& info, PWR_AttrName name, 
+		void* buf, PWR_Time* ts ) :
+	DistCommReq( req ), m_ctx( ctx ), m_obj( obj ), m_info( info ),
+	m_name( name ), m_buf( buf ), m_ts( ts ), m_pending( 0 )
+{
+	for ( unsigned i = 0; i < m_info.batches.size(); i++ ) {
+		AttrInfo::Batch& batch = m_info.batches[i];
+		Device* dev = m_info.devices[ batch.index[0] ];
+
+		if ( batch.readm && ! dev->readAsync() ) {
+			addRead( dev, batch.readm );
+			for ( unsigned j = 0; j < batch.index.size(); j++ ) {
+				m_reads.back().fds.push_back( 
+							m_info.devices[ batch.index[j] ]->fd() );
+				m_reads.back().index.push_back( batch.index[j] );
+			}
+		} else {
+			for ( unsigned j = 0; j < batch.index.size(); j++ ) {
+				addRead( m_info.devices[ batch.index[j] ], NULL );
+				m_reads.back().fds.push_back( 
+							m_info.devices[ batch.index[j] ]->fd() );
+				m_reads.back().index.push_back( batch.index[j] );
+			}
+		}
+	}
+	for ( unsigned i = 0; i < m_reads.size(); i++ ) {
+		Read& read = m_reads[i];
+		read.names.resize( read.fds.size(), m_name );
+		read.value.resize( read.fds.size() );
+		read.ts.resize( read.fds.size() );
+		read.status.resize( read.fds.size() );
+	}
+	m_pending = m_reads.size();
+	DBGX("%lu devices in %lu reads\n", m_info.devices.size(), m_reads.size() );
+}
+
+void DistDevGetCommReq::addRead( Device* dev, pwr_readm_t readm )
+{
+	Read read;
+	read.req = this;
+	read.dev = dev;
+	read.readm = readm;
+	read.retval = PWR_RET_SUCCESS;
+	m_reads.push_back( read );
+}
+
+// Devices are opened above, on the thread driving the context, so the
+// workers never open one.  m_reads is complete before the first read is
+// issued, a read may finish and post this request before start() returns
+void DistDevGetCommReq::start()
+{
+	unsigned num = m_reads.size();
+	for ( unsigned i = 0; i < num; i++ ) {
+		Read& read = m_reads[i];
+
+		if ( read.readm ) {
+			m_ctx->getDevWorker( read.dev->ops() )->submit( runReadm, &read );
+
+		} else if ( read.dev->readAsync() ) {
+			int retval = read.dev->readAsync()( read.fds[0], 1, 
+						&read.names[0], &read.value[0], &read.ts[0],
+						&read.status[0], complete, &read );
+			if ( PWR_RET_SUCCESS != retval ) {
+				complete( &read, retval );
+			}
+		} else {
+			m_ctx->getDevWorker( read.dev->ops() )->submit( runRead, &read );
+		}
+	}
+}
+
+void DistDevGetCommReq::runReadm( void* data )
+{
+	Read* read = static_cast<Read*>(data);
+	int retval = read->readm( &read->fds[0], read->fds.size(), 
+						&read->names[0], &read->value[0], &read->ts[0], 
+						&read->status[0] );
+	complete( read, retval );
+}
+
+void DistDevGetCommReq::runRead( void* data )
+{
+	Read* read = static_cast<Read*>(data);
+	read->status[0] = read->dev->getValue( read->names[0], &read->value[0],
+										8, &read->ts[0] );
+	complete( read, read->status[0] );
+}
+
+void DistDevGetCommReq::complete( void* data, int retval )
+{
+	Read* read = static_cast<Read*>(data);
+	DistDevGetCommReq* req = read->req;
+
+	read->retval = retval;
+	if ( 0 == __sync_sub_and_fetch( &req->m_pending, 1 ) ) {
+		req->m_ctx->getDevEventChannel()->post( req );
+	}
+}
+
+void DistDevGetCommReq::process( Event* )
+{
+	std::vector<uint64_t> value( m_info.devices.size() );
+	std::vector<PWR_Time> ts( m_info.devices.size() );
+	int retval = PWR_RET_SUCCESS;
+
+	DBGX("\n");
+	for ( unsigned i = 0; i < m_reads.size(); i++ ) {
+		Read& read = m_reads[i];
+
+		if ( PWR_RET_SUCCESS != read.retval ) {
+			retval = read.retval;
+		}
+		for ( unsigned j = 0; j < read.index.size(); j++ ) {
+			if ( PWR_RET_SUCCESS != read.status[j] ) {
+				retval = read.status[j];
+			}
+			value[ read.index[j] ] = read.value[j];
+			ts[ read.index[j] ] = read.ts[j];
+		}
+	}
+
+	if ( PWR_RET_SUCCESS == retval ) {
+		m_info.operation( m_buf, &value[0], value.size() );
+		*m_ts = m_info.calcTime( ts );
+	}
+
+	// the request deletes this, nothing can be touched after the call
+	m_req->getDevValue( this, m_obj, m_name, retval );
+}
@@ -0,0 +1,70 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _DIST_DEV_REQ_H
+#define _DIST_DEV_REQ_H
+
+#include <vector>
+#include "distComm.h"
+#include "attrInfo.h"
+
+namespace PowerAPI {
+
+class Device;
+class DistCntxt;
+
+// Reads one attribute from the local devices of an object without 
+// blocking the calling thread.  Devices of plugins with read_async are 
+// read through it, all others are read on the DevWorker of their plugin
+// instance, keeping readm batches together.  When the last read completes
+// the request is posted to the context's DevEventChannel and process() 
+// combines the values on the thread driving the context.
+
+class DistDevGetCommReq : public DistCommReq {
+  public:
+	DistDevGetCommReq( DistRequest*, DistCntxt*, Object*, AttrInfo&,
+				PWR_AttrName, void* buf, PWR_Time* ts );
+	void start();
+	void process( Event* );
+
+  private:
+	struct Read {
+		DistDevGetCommReq*		req;
+		Device*					dev;
+		pwr_readm_t				readm;
+		std::vector<pwr_fd_t>	fds;
+		std::vector<unsigned>	index;
+		std::vector<PWR_AttrName> names;
+		std::vector<uint64_t>	value;
+		std::vector<PWR_Time>	ts;
+		std::vector<int>		status;
+		int						retval;
+	};
+
+	void addRead( Device*, pwr_readm_t );
+	static void runReadm( void* );
+	static void runRead( void* );
+	static void complete( void*, int );
+
+	DistCntxt*		m_ctx;
+	Object*			m_obj;
+	AttrInfo&		m_info;
+	PWR_AttrName	m_name;
+	void*			m_buf;
+	PWR_Time*		m_ts;
+	std::vector<Read> m_reads;
+	int				m_pending;
+};
+
+}
+
+#endif
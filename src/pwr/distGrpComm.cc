@@ -21,8 +21,9 @@ DistGrpComm::DistGrpComm( DistCntxt* cntxt,
 	for ( unsigned i = 0; i < objs.size(); i++ ) {
 		DBGX("obj `%s` \n",objs[i]->name().c_str() );
 
-		ev->members.push_back(  objs[i]->getComm()->getObjects() );
+		addMembers( ev, objs[i]->getComm()->getObjects() );
 	} 
+	compressMembers( ev );
 
 	m_ec->sendEvent( ev );
 	delete ev;
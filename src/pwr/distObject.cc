@@ -16,6 +16,8 @@
 #include "attrInfo.h"
 #include "distRequest.h"
 #include "distComm.h"
+#include "distCntxt.h"
+#include "distDevReq.h"
 #include "status.h"
 #include "debug.h"
 #include "util.h"
@@ -66,6 +68,34 @@ int DistObject::attrGetValue( PWR_AttrName attr, void* buf,
     return retval;
 }
 
+int DistObject::attrGetValueFrom( PWR_AttrName attr, void* buf,
+                                PWR_Time* ts, PWR_Obj* from )
+{
+    int retval;
+	Status	status;
+    DBGX("\n");
+	DistRequest req( getCntxt(), &status );
+
+	// the daemons name the object a minimum or maximum came from
+	*from = static_cast<Object*>(this);
+	req.valueObj[0] = from;
+
+	attrGetValues( 1, &attr, buf, ts, &status, &req );
+
+	retval = req.wait( );
+	if ( retval != PWR_RET_SUCCESS ) {
+		return retval;
+	}
+	if ( ! status.empty() ) {
+        PWR_AttrAccessError error;
+        retval = status.pop( &error );
+        assert( retval == PWR_RET_SUCCESS );
+        retval = error.error;
+	}
+
+    return retval;
+}
+
 int DistObject::attrSetValue( PWR_AttrName attr, void* buf )
 {
     int retval;
@@ -164,9 +194,14 @@ int DistObject::attrGetValues( int count, PWR_AttrName names[],
 	req->value[0] = buf;
 	req->timeStamp[0] = ts;
 
-	// we don't care about the return value because errors will be
-	// flagged in the status structure
-    Object::attrGetValues( count, names, buf, ts, status );
+	DistCntxt* ctx = static_cast<DistCntxt*>( getCntxt() );
+	if ( ctx->getDevEventChannel() ) {
+		attrGetValuesDeviceAsync( count, names, buf, ts, status, distReq );
+	} else {
+		// we don't care about the return value because errors will be
+		// flagged in the status structure
+    	Object::attrGetValues( count, names, buf, ts, status );
+	}
 
 	AttrInfo* info = m_attrInfo[ names[0] ];
 	std::vector<ValueOp> valueOp(count);
@@ -200,6 +235,38 @@ int DistObject::attrGetValues( int count, PWR_AttrName names[],
 }
 
 
+// Same checks as Object::attrGetValues but the device reads of each 
+// attribute complete later through the context's device channel.
+void DistObject::attrGetValuesDeviceAsync( int count, PWR_AttrName names[],
+				void* buf, PWR_Time ts[], Status* status, DistRequest* req )
+{
+	DistCntxt* ctx = static_cast<DistCntxt*>( getCntxt() );
+	uint64_t* ptr = (uint64_t*) buf; 
+
+	DBGX("\n");
+
+	// nothing is started unless every name is valid, a read left in flight
+	// would complete into a request the caller fails and frees
+	for ( int i = 0; i < count; i++ ) {
+		ptr[i] = 0;
+		ts[i] = 0;
+
+		if ( ! m_attrInfo[ names[i] ]->isValid() ) {
+			status->add( this, names[i], PWR_RET_INVALID );
+			return;
+		}
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		if ( ! m_attrInfo[ names[i] ]->devices.empty() ) {
+			DistDevGetCommReq* devReq = new DistDevGetCommReq( req, ctx, this, 
+						*m_attrInfo[ names[i] ], names[i], &ptr[i], &ts[i] );
+			req->insertDev( devReq );
+			devReq->start();
+		}
+	}
+}
+
 int DistObject::attrSetValues( int count, PWR_AttrName names[],
                                 void* buf, Status* status, Request* req )
 {
@@ -19,6 +19,7 @@ namespace PowerAPI {
 class Request;
 class Status;
 class DistComm;
+class DistRequest;
 
 class DistObject : public Object {
 
@@ -30,6 +31,8 @@ class DistObject : public Object {
     virtual int attrGetValue( PWR_AttrName attr, void* buf, 
 								PWR_Time* ts );
     virtual int attrSetValue( PWR_AttrName attr, void* buf );
+	int attrGetValueFrom( PWR_AttrName attr, void* buf, PWR_Time* ts,
+								PWR_Obj* from );
 	virtual int attrGetValues( int count, PWR_AttrName names[],
 								void* buf, PWR_Time ts[], Status* );
     virtual int attrSetValues( int count, PWR_AttrName names[],
@@ -55,6 +58,9 @@ class DistObject : public Object {
 					double period, unsigned int* count, void* buf, Request* );
 
   private:
+	void attrGetValuesDeviceAsync( int count, PWR_AttrName names[], 
+				void* buf, PWR_Time ts[], Status*, DistRequest* );
+
 	DistComm* m_comm;
 };
 
@@ -25,15 +25,45 @@
 #include "event.h"
 #include "events.h"
 #include "distComm.h"
+#include "devEventChannel.h"
 
 using namespace PowerAPI;
 
 DistRequest::~DistRequest( ) {
 }
 
+// daemons report the object of an error by handle when they have one
+static Object* errObject( DistCntxt* ctx, std::vector<ObjID>& names,
+						std::vector<ObjHandle>& handles, unsigned i )
+{
+	if ( i < handles.size() && NO_HANDLE != handles[i] ) {
+		return ctx->getObjByHandle( handles[i] );
+	}
+	return ctx->getObjByName( names[i] );
+}
+
 int DistRequest::wait( )
 {
 	DistCntxt* ctx = static_cast<DistCntxt*>(m_cntxt);
+
+	// local device reads complete on their own channel, which may also
+	// deliver completions for other outstanding requests
+	while ( m_numDevReqs ) {
+		Event* ev = ctx->getDevEventChannel()->getEvent();
+		if ( ! ev ) {
+			return PWR_RET_IPC;	
+		}
+		DistCommReq* req = static_cast<DistCommReq*>((CommReq*)ev->id);
+		DistRequest* distReq = req->m_req;
+		req->process( ev );
+		delete ev;
+		if ( distReq != this && distReq->finished() ) {
+			if ( distReq->execCallback( ) ) {
+				delete distReq;
+			}
+		}
+	}
+
 	EventChannel* ec = ctx->getEventChannel();
 
 	while ( ! m_commReqs.empty() ) {	
@@ -76,9 +106,9 @@ void DistRequest::setRetval( DistCommReq* req, CommLogRespEvent* ev )
 {
 	DBGX("\n");
 	for ( unsigned i = 0; i < ev->errValue.size(); i++ ) {
-		PWR_Obj obj;
-		PWR_CntxtGetObjByName( m_cntxt, ev->errObj[i].c_str(), &obj ); 
-		m_status->add( (Object*) obj, ev->errAttr[i], ev->errValue[i] );
+		Object* obj = errObject( static_cast<DistCntxt*>(m_cntxt),
+										ev->errObj, ev->errHandle, i );
+		m_status->add( obj, ev->errAttr[i], ev->errValue[i] );
 	} 
 	m_commReqs.erase( req ); 
 }
@@ -93,12 +123,25 @@ void DistRequest::getValue( DistCommReq* req, CommRespEvent* ev )
 			((uint64_t*)value[i])[j] = ev->value[i][j];
 			timeStamp[i][j] = ev->timeStamp[i][j];
 		}
+		// only a single object's reads ask for where the value came from,
+		// a reply that names no object leaves the object read
+		if ( i >= valueObj.size() || ! valueObj[i] ||
+										i >= ev->valueObj.size() ) {
+			continue;
+		}
+		for ( unsigned j = 0; j < ev->valueObj[i].size(); j++ ) {
+			ObjHandle handle = ev->valueObj[i][j];
+			if ( NO_HANDLE != handle ) {
+				valueObj[i][j] = static_cast<DistCntxt*>(m_cntxt)->
+											getObjByHandle( handle );
+			}
+		}
 	}
 
 	for ( unsigned i = 0; i < ev->errValue.size(); i++ ) {
-		PWR_Obj obj;
-		PWR_CntxtGetObjByName( m_cntxt, ev->errObj[i].c_str(), &obj ); 
-		m_status->add( (Object*) obj, ev->errAttr[i], ev->errValue[i] );
+		Object* obj = errObject( static_cast<DistCntxt*>(m_cntxt),
+										ev->errObj, ev->errHandle, i );
+		m_status->add( obj, ev->errAttr[i], ev->errValue[i] );
 	} 
 
 	m_commReqs.erase( req ); 
@@ -109,10 +152,24 @@ void DistRequest::setValue( DistCommReq* req, CommRespEvent* ev )
 	DBGX("\n");
 
 	for ( unsigned i = 0; i < ev->errValue.size(); i++ ) {
-		PWR_Obj obj;
-		PWR_CntxtGetObjByName( m_cntxt, ev->errObj[i].c_str(), &obj ); 
-		m_status->add( (Object*) obj, ev->errAttr[i], ev->errValue[i] );
+		Object* obj = errObject( static_cast<DistCntxt*>(m_cntxt),
+										ev->errObj, ev->errHandle, i );
+		m_status->add( obj, ev->errAttr[i], ev->errValue[i] );
 	} 
 
 	m_commReqs.erase( req ); 
 }
+
+void DistRequest::getDevValue( DistCommReq* req, Object* obj, 
+									PWR_AttrName name, int retval )
+{
+	DBGX("\n");
+
+	if ( PWR_RET_SUCCESS != retval ) {
+		m_status->add( obj, name, retval );
+	}
+
+	m_commReqs.erase( req ); 
+	--m_numDevReqs;
+	delete req;
+}
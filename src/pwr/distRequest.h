@@ -23,6 +23,7 @@ struct CommGetSamplesRespEvent;
 namespace PowerAPI {
 
 class Status;
+class Object;
 class DistCommReq;
 
 class DistRequest : public Request {
@@ -30,7 +31,7 @@ class DistRequest : public Request {
   public:
 	DistRequest( Cntxt* ctx, Status* status,
 			Callback callback = NULL, void* data = NULL ) :
-		Request( ctx, status, callback, data )
+		Request( ctx, status, callback, data ), m_numDevReqs( 0 )
 	{}
 	~DistRequest( );
 
@@ -51,13 +52,19 @@ class DistRequest : public Request {
 
 	void getValue( DistCommReq*, CommRespEvent* );
 	void setValue( DistCommReq*, CommRespEvent* );
+	void getDevValue( DistCommReq*, Object*, PWR_AttrName, int retval );
 	void insert( DistCommReq* req ) {
 		m_commReqs.insert( req );
 	}
+	void insertDev( DistCommReq* req ) {
+		m_commReqs.insert( req );
+		++m_numDevReqs;
+	}
 
   protected:
 
 	std::set<DistCommReq*> m_commReqs;
+	unsigned m_numDevReqs;
 };
 
 }
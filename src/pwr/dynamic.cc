@@ -30,5 +30,13 @@ plugin_dev_t* DistCntxt::getDev( std::string lib, std::string name )
 
     getDevFuncPtr_t funcPtr = (getDevFuncPtr_t) dlsym( ptr, GETDEVFUNC ); 
 	assert(funcPtr);
-	return funcPtr();
+	plugin_dev_t* dev = funcPtr();
+
+	// plugins built before version 2 do not export getDevVersion
+	getDevVersionFuncPtr_t versionPtr =
+			(getDevVersionFuncPtr_t) dlsym( ptr, GETDEVVERSIONFUNC );
+	m_pluginVersionMap[ dev ] = versionPtr ? versionPtr() : 1;
+	DBGX("lib %s version %d\n", lib.c_str(), m_pluginVersionMap[ dev ] );
+
+	return dev;
 }
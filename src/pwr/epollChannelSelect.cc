@@ -0,0 +1,220 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+#include <sys/epoll.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "epollChannelSelect.h"
+#include "debug.h"
+
+#define MAX_EVENTS 256
+
+EpollChannelSelect::EpollChannelSelect( bool edgeTriggered ) :
+	m_edgeTriggered( edgeTriggered ), m_dirty( NULL )
+{
+	m_epfd = epoll_create( MAX_EVENTS );
+	assert( m_epfd >= 0 );
+}
+
+EpollChannelSelect::~EpollChannelSelect()
+{
+	std::map<EventChannel*,Entry*>::iterator iter = m_chanMap.begin();
+	for ( ; iter != m_chanMap.end(); ++iter ) {
+		iter->first->setWatcher( NULL );
+		delete iter->second;
+	}
+	::close( m_epfd );
+}
+
+// channels are only touched by the thread that waits on them, the list
+// needs no lock
+void EpollChannelSelect::markDirty( Entry* entry )
+{
+	if ( entry->dirty ) {
+		return;
+	}
+	entry->dirty = true;
+	entry->prev = NULL;
+	entry->next = m_dirty;
+	if ( m_dirty ) {
+		m_dirty->prev = entry;
+	}
+	m_dirty = entry;
+}
+
+void EpollChannelSelect::unlinkDirty( Entry* entry )
+{
+	if ( ! entry->dirty ) {
+		return;
+	}
+	entry->dirty = false;
+	if ( entry->prev ) {
+		entry->prev->next = entry->next;
+	} else {
+		m_dirty = entry->next;
+	}
+	if ( entry->next ) {
+		entry->next->prev = entry->prev;
+	}
+}
+
+bool EpollChannelSelect::addFd( Entry* entry )
+{
+	struct epoll_event ev;
+
+	memset( &ev, 0, sizeof(ev) );
+	ev.events = EPOLLIN;
+	if ( m_edgeTriggered ) {
+		ev.events |= EPOLLET;
+	}
+	ev.data.ptr = entry;
+
+	if ( epoll_ctl( m_epfd, EPOLL_CTL_ADD, entry->fd, &ev ) ) {
+		DBGX2(DBG_EC,"epoll_ctl fd=%d failed %s\n",entry->fd,strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool EpollChannelSelect::addChannel( EventChannel* chan, Data* ptr )
+{
+	DBGX2(DBG_EC,"name='%s'\n",chan->getName().c_str() );
+    assert( m_chanMap.find( chan ) == m_chanMap.end() );
+
+	Entry* entry = new Entry;
+	entry->sel = this;
+	entry->chan = chan;
+	entry->data = ptr;
+	entry->dirty = false;
+	// a client channel only gets its descriptor once it has connected, and
+	// may have queued or read something already
+	entry->fd = chan->getFd();
+	if ( entry->fd > -1 ) {
+		addFd( entry );
+	}
+	markDirty( entry );
+	chan->setWatcher( entry );
+    m_chanMap[chan] = entry;
+
+    return false;
+}
+
+bool EpollChannelSelect::delChannel( EventChannel* chan )
+{
+	DBGX2(DBG_EC,"\n");
+    assert( m_chanMap.find( chan ) != m_chanMap.end() );
+
+	Entry* entry = m_chanMap[chan];
+	if ( entry->fd > -1 ) {
+		epoll_ctl( m_epfd, EPOLL_CTL_DEL, entry->fd, NULL );
+	}
+	chan->setWatcher( NULL );
+	unlinkDirty( entry );
+	m_readySet.erase( entry );
+	m_batch.erase( std::remove( m_batch.begin(), m_batch.end(), entry->data ),
+					m_batch.end() );
+    m_chanMap.erase(chan);
+	delete entry;
+
+    return false;
+}
+
+// is there still something to read on a channel that was reported ready
+bool EpollChannelSelect::readable( Entry* entry )
+{
+	struct pollfd pfd;
+	pfd.fd = entry->fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return 1 == ::poll( &pfd, 1, 0 ) && ( pfd.revents & (POLLIN|POLLHUP) );
+}
+
+void EpollChannelSelect::wait( std::vector<Data*>& ready )
+{
+	std::set<Entry*> found;
+
+	// send what the last iteration queued before going to sleep, pick up
+	// descriptors of channels that connected, and hand out frames already
+	// read off a socket, they do not wake up epoll.  A channel whose send
+	// failed is handed out too, its owner reads nothing and closes it.
+	// Channels stay dirty while they have no descriptor or a frame waits.
+	Entry* dirty = m_dirty;
+	m_dirty = NULL;
+	while ( dirty ) {
+		Entry* entry = dirty;
+		dirty = entry->next;
+		entry->dirty = false;
+
+		bool sent = entry->chan->flush();
+		if ( -1 == entry->fd && ( entry->fd = entry->chan->getFd() ) > -1 ) {
+			addFd( entry );
+		}
+		bool pending = entry->chan->pending();
+		if ( ! sent || pending ) {
+			found.insert( entry );
+		}
+		if ( -1 == entry->fd || pending ) {
+			markDirty( entry );
+		}
+	}
+
+	if ( m_edgeTriggered ) {
+		std::set<Entry*>::iterator ri = m_readySet.begin();
+		while ( ri != m_readySet.end() ) {
+			if ( found.count( *ri ) || readable( *ri ) ) {
+				found.insert( *ri );
+				++ri;
+			} else {
+				m_readySet.erase( ri++ );
+			}
+		}
+	}
+
+	while ( found.empty() ) {
+		struct epoll_event events[ MAX_EVENTS ];
+
+		DBGX2(DBG_EC,"calling epoll_wait\n");
+		int n = epoll_wait( m_epfd, events, MAX_EVENTS, -1 );
+		if ( n < 0 ) {
+			assert( EINTR == errno );
+			continue;
+		}
+		for ( int i = 0; i < n; i++ ) {
+			Entry* entry = static_cast<Entry*>( events[i].data.ptr );
+			found.insert( entry );
+			if ( m_edgeTriggered ) {
+				m_readySet.insert( entry );
+			}
+		}
+	}
+
+	std::set<Entry*>::iterator fi = found.begin();
+	for ( ; fi != found.end(); ++fi ) {
+		DBGX2(DBG_EC,"ready %s\n",(*fi)->chan->getName().c_str());
+		ready.push_back( (*fi)->data );
+	}
+}
+
+ChannelSelect::Data* EpollChannelSelect::wait()
+{
+	if ( m_batch.empty() ) {
+		std::vector<Data*> ready;
+		wait( ready );
+		m_batch.insert( m_batch.end(), ready.begin(), ready.end() );
+	}
+	Data* data = m_batch.front();
+	m_batch.pop_front();
+	return data;
+}
@@ -0,0 +1,65 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+#ifndef _EPOLL_CHANNEL_SELECT_H
+#define _EPOLL_CHANNEL_SELECT_H
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <eventChannel.h>
+
+// ChannelSelect on top of epoll.  A channel's descriptor is registered 
+// once, when it is added or as soon as it has one, and wait() hands back
+// every channel epoll reports ready in one batch.  In edge-triggered mode
+// a channel stays on a ready list until it has been drained, because
+// epoll will not report the data that is still waiting on it again.
+// Before it waits it only looks at the channels on its dirty list, those
+// with queued output, input already read off the descriptor, or no
+// descriptor yet, which the channels report through their Watcher.
+
+class EpollChannelSelect : public ChannelSelect {
+  public:
+    EpollChannelSelect( bool edgeTriggered = false ); 
+    ~EpollChannelSelect(); 
+    virtual bool addChannel( EventChannel*, Data* );
+    virtual bool delChannel( EventChannel* );
+    virtual Data* wait();
+    virtual void wait( std::vector<Data*>& );
+
+  private:
+	struct Entry : public EventChannel::Watcher {
+		EpollChannelSelect* sel;
+		EventChannel* chan;
+		Data*		  data;
+		int			  fd;
+		bool		  dirty;
+		Entry*		  prev;
+		Entry*		  next;
+
+		void notify() { sel->markDirty( this ); }
+	};
+
+	bool addFd( Entry* );
+	bool readable( Entry* );
+	void markDirty( Entry* );
+	void unlinkDirty( Entry* );
+
+	int		m_epfd;
+	bool	m_edgeTriggered;
+    std::map<EventChannel*,Entry*> m_chanMap;
+	std::set<Entry*>	m_readySet;
+	Entry*				m_dirty;
+	std::deque<Data*>	m_batch;
+};
+
+#endif
@@ -36,6 +36,9 @@ struct Event : public EventBase {
 	Event( EventType _type = NotSet ) : type(_type), id(0), status(0) {}
 	virtual ~Event() {}
 
+	// done with a received event, pooled events go back to their pool
+	virtual void release() { delete this; }
+
     Event& operator=(const Event& other ) {
         type = other.type;
         id =   other.id;
@@ -55,11 +58,19 @@ struct Event : public EventBase {
 		EventBase::serialize_out( buf ); 
 	}
 
+	// in the original encoding a subclass reads its own fields, last to
+	// first, before those of its base
 	virtual void serialize_in( SerialBuf& buf ) {
+		if ( buf.backward() ) {
+			buf >> status;
+			buf >> type;
+			buf >> id;
+		} else {
+			buf >> id;
+			buf >> type;
+			buf >> status;
+		}
 		EventBase::serialize_in( buf ); 
-		buf >> status;
-		buf >> type;
-		buf >> id;
 	}
 };
 
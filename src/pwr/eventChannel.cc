@@ -10,6 +10,10 @@
 */
 
 #include <tcpEventChannel.h>
+#include <epollChannelSelect.h>
+#include <localEventChannel.h>
+#include <shmEventChannel.h>
+#include <unistd.h>
 #include <iostream>
 
 EventChannel* getEventChannel( const std::string& type,
@@ -17,8 +21,32 @@ EventChannel* getEventChannel( const std::string& type,
 		const std::string& name )
 {
     if ( 0 == type.compare("TCP") ) {
+		// a server in this process, or on this node, is reached without
+		// going through TCP
+		if ( config.find("server=") != std::string::npos ) {
+			EventChannel* chan = LocalEventChannel::connect( func, config, name );
+			if ( chan ) {
+				return chan;
+			}
+			chan = ShmEventChannel::connect( func, config, name );
+			if ( chan ) {
+				return chan;
+			}
+		}
         return new TcpEventChannel( func, config, name );
     }
+    if ( 0 == type.compare("LOCAL") ) {
+		if ( config.find("listenPort=") != std::string::npos ) {
+        	return new LocalEventChannel( func, config, name );
+		}
+		return LocalEventChannel::connect( func, config, name );
+    }
+    if ( 0 == type.compare("SHM") ) {
+		if ( config.find("listenPort=") != std::string::npos ) {
+        	return new ShmEventChannel( func, config, name );
+		}
+		return ShmEventChannel::connect( func, config, name );
+    }
     return NULL;
 }
 
@@ -27,5 +55,33 @@ ChannelSelect* getChannelSelect( const std::string& type )
     if ( 0 == type.compare("TCP") ) {
         return new TcpChannelSelect( );
     }
+    if ( 0 == type.compare("EPOLL") ) {
+        return new EpollChannelSelect( );
+    }
+    if ( 0 == type.compare("EPOLL_ET") ) {
+        return new EpollChannelSelect( true );
+    }
     return NULL;   
 }
+
+std::string getConfigValue( const std::string& config, const std::string& key )
+{
+	size_t pos = 0;
+	while ( ( pos = config.find( key + "=", pos ) ) != std::string::npos ) {
+		if ( 0 == pos || ' ' == config[pos-1] ) {
+			pos += key.length() + 1;
+			return config.substr( pos, config.find_first_of( ' ', pos ) - pos );
+		}
+		++pos;
+	}
+	return "";
+}
+
+bool isLocalHost( const std::string& host )
+{
+	char name[256];
+	if ( 0 == host.compare( "localhost" ) || 0 == host.compare( 0, 4, "127." ) ) {
+		return true;
+	}
+	return 0 == gethostname( name, sizeof(name) ) && 0 == host.compare( name );
+}
@@ -13,18 +13,35 @@
 #define _EVENT_CHANNEL_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
+#include "serialize.h"
 
 struct Event;
-struct SerialBuf;
+
+// The top byte of a frame's type word is the encoding version of the event
+// in it, peers that predate versions send 0 there, the type was all of the
+// word then, and are answered in the original encoding.
+#define FRAME_WORD( type, version ) ( (uint32_t)(type) | (uint32_t)(version) << 24 )
+#define FRAME_TYPE( word )		( (word) & 0xffffff )
+#define FRAME_VERSION( word )	( (word) >> 24 )
 
 class EventChannel {
 
   public:
 	typedef Event* (*AllocFuncPtr)(unsigned int, SerialBuf& );
 
+	// told when the channel has queued output or input it has already
+	// read off its descriptor, neither wakes up a ChannelSelect waiting
+	// on the descriptor
+	struct Watcher {
+		virtual ~Watcher() {}
+		virtual void notify() = 0;
+	};
+
 	EventChannel( AllocFuncPtr func, std::string name = "" ) : 
-			m_allocFunc(func), m_name(name) {}
+			m_allocFunc(func), m_name(name), m_watcher(NULL) {}
     virtual ~EventChannel() {}
 
 	virtual EventChannel* accept() { assert(0); }
@@ -33,9 +50,39 @@ class EventChannel {
     virtual Event* getEvent( bool blocking = true ) = 0;
     virtual bool sendEvent( Event* ) = 0;
 	virtual std::string& getName() { return m_name; }
+
+	// descriptor a ChannelSelect waits on, -1 if there is none yet
+	virtual int getFd() { return -1; }
+
+	// With the output queue on, sendEvent() only queues the event and the
+	// queued events go out together on flush(), which a ChannelSelect
+	// calls for its channels before it waits.  Once a send has failed the
+	// channel is broken, getEvent() returns NULL and the ChannelSelect
+	// hands the channel out so its owner closes it as after a read error.
+	virtual void setOutputQueue( bool ) {}
+	virtual bool flush() { return true; }
+
+	// true if a complete event has already been received, getEvent() will
+	// then return it without waiting
+	virtual bool pending() { return false; }
+
+	// encoding version events are sent with, once the peer has said it 
+	// reads it, received events can be in any version.  A peer that sends
+	// the original encoding is answered in it.
+	virtual void setVersion( unsigned int ) {}
+	virtual unsigned int getVersion() { return PROTO_VERSION_FIXED; }
+
+	void setWatcher( Watcher* watcher ) { m_watcher = watcher; }
   protected:
+	void notify() { 
+		if ( m_watcher ) {
+			m_watcher->notify();
+		}
+	}
+
 	AllocFuncPtr m_allocFunc;
 	std::string m_name;
+	Watcher*	m_watcher;
 };
 
 class ChannelSelect {
@@ -48,6 +95,12 @@ class ChannelSelect {
     virtual bool addChannel( EventChannel*, Data* ) = 0;
     virtual bool delChannel( EventChannel* ) = 0;
     virtual Data* wait() = 0;
+
+	// adds every channel that is ready to the vector, at least one
+	virtual void wait( std::vector<Data*>& ready ) {
+		ready.push_back( wait() );
+	}
+    virtual ~ChannelSelect() {}
 };
 
 EventChannel* getEventChannel( const std::string& type, 
@@ -55,4 +108,8 @@ EventChannel* getEventChannel( const std::string& type,
 
 ChannelSelect* getChannelSelect( const std::string& type );
 
+// value of "key=value" in a channel config string, empty if it is not there
+std::string getConfigValue( const std::string& config, const std::string& key );
+bool isLocalHost( const std::string& host );
+
 #endif
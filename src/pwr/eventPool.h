@@ -0,0 +1,67 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+
+#ifndef _EVENT_POOL_H
+#define _EVENT_POOL_H
+
+#include "event.h"
+
+#define EVENT_POOL_LEN 256
+
+// Free list for one Event subclass that the allocEvent factories use for
+// the events they create for every message received.  get() reuses a
+// released event by decoding the new message into it, so its vectors and
+// strings keep their capacity.  The pooled class overrides release() to
+// call put(), which keeps at most EVENT_POOL_LEN events and deletes the
+// rest.  An event released by another thread goes to that thread's list,
+// pools are per thread and need no locking.
+
+template <class T>
+class EventPool {
+  public:
+	static T* get( SerialBuf& buf ) {
+		if ( 0 == s_count ) {
+			++s_allocs;
+			return new T( buf );
+		}
+		++s_reuses;
+		T* ev = s_free[ --s_count ];
+		ev->serialize_in( buf );
+		return ev;
+	}
+
+	static void put( T* ev ) {
+		if ( s_count == EVENT_POOL_LEN ) {
+			delete ev;
+		} else {
+			s_free[ s_count++ ] = ev;
+		}
+	}
+
+	// events created because the pool was empty and events reused
+	static uint64_t allocs() { return s_allocs; }
+	static uint64_t reuses() { return s_reuses; }
+
+  private:
+	static __thread T* s_free[ EVENT_POOL_LEN ];
+	static __thread unsigned int s_count;
+	static __thread uint64_t s_allocs;
+	static __thread uint64_t s_reuses;
+};
+
+template <class T> __thread T* EventPool<T>::s_free[ EVENT_POOL_LEN ];
+template <class T> __thread unsigned int EventPool<T>::s_count;
+template <class T> __thread uint64_t EventPool<T>::s_allocs;
+template <class T> __thread uint64_t EventPool<T>::s_reuses;
+
+#endif
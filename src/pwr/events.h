@@ -17,25 +17,48 @@
 #include "pwrtypes.h"
 #include "impTypes.h"
 #include "event.h"
+#include "eventPool.h"
 
 typedef std::string ObjID;
 typedef uint64_t CommID;
 
+// ServerConnect and CommCreate open a connection, they end with the
+// highest encoding version the sender reads.  Every sender since versioned
+// frames writes the field; when it is missing the sender is taken to read
+// only the fixed width encoding.  Fields added later to other events are
+// trailing in the same way.  Events in the original encoding have none of
+// these fields, and their sender reads only that encoding.
+
 struct ServerConnectEvent : public Event {
-	ServerConnectEvent() : Event( ServerConnect ) {} 
+	ServerConnectEvent() : Event( ServerConnect ), version( PROTO_VERSION ) {} 
 	ServerConnectEvent( SerialBuf& buf ) {
 		serialize_in(buf);
 	}
 
 	ObjID name; 
+	uint32_t version;
+
 	virtual void serialize_out( SerialBuf& buf ) {
 		Event::serialize_out(buf);
 		buf << name;
+		if ( ! buf.backward() ) {
+			buf << version;
+		}
 	}
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> name;
+		if ( buf.backward() ) {
+			buf >> name;
+			Event::serialize_in(buf);
+			version = PROTO_VERSION_NONE;
+			return;
+		}
 		Event::serialize_in(buf);
+		buf >> name;
+		version = PROTO_VERSION_FIXED;
+		if ( buf.remaining() ) {
+			buf >> version;
+		}
 	}
 };
 
@@ -60,30 +83,82 @@ struct CommEvent : public Event {
 	}
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> op;
-		buf >> commID;
+		if ( buf.backward() ) {
+			buf >> op;
+			buf >> commID;
+			Event::serialize_in(buf);
+			return;
+		}
 		Event::serialize_in(buf);
+		buf >> commID;
+		buf >> op;
 	}
 };
 
 struct CommCreateEvent : public CommEvent {
-	CommCreateEvent( ) : CommEvent( CommCreate )  {}
+	CommCreateEvent( ) : CommEvent( CommCreate ), version( PROTO_VERSION ),
+		splitRanges( false ) {}
 	CommCreateEvent( SerialBuf& buf ) {
 		serialize_in(buf);
 	}
 
-	CommCreateEvent(const CommCreateEvent& x) : members(x.members) {}
+	CommCreateEvent(const CommCreateEvent& x) : members(x.members), 
+		version(x.version), handles(x.handles), ranges(x.ranges),
+		splitRanges(x.splitRanges), handleRanges(x.handleRanges) {}
 
     std::vector< std::vector<ObjID > > members;
+	uint32_t version;
+
+	// members as handles, the communicator's requests and errors refer to
+	// the objects by handle from here on, empty if the sender has no config
+    std::vector< std::vector<ObjHandle > > handles;
+
+	// the members as hostlist patterns, see objRange.h, sent in place of
+	// members and handles.  ranges[j] are the patterns of group j, with
+	// splitRanges there is one list and each name in it is a group.  The
+	// handles, in the order the names expand, are (first,count) pairs.
+    std::vector< std::vector<std::string > > ranges;
+	bool splitRanges;
+	std::vector< ObjHandle > handleRanges;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> members;
+		handles.clear();
+		ranges.clear();
+		splitRanges = false;
+		handleRanges.clear();
+		if ( buf.backward() ) {
+			buf >> members;
+			CommEvent::serialize_in(buf);
+			version = PROTO_VERSION_NONE;
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> members;
+		version = PROTO_VERSION_FIXED;
+		if ( buf.remaining() ) {
+			buf >> version;
+		}
+		if ( buf.remaining() ) {
+			buf >> handles;
+		}
+		if ( buf.remaining() ) {
+			buf >> ranges;
+			buf >> splitRanges;
+			buf >> handleRanges;
+		}
 	} 
 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
 		buf << members;
+		if ( buf.backward() ) {
+			return;
+		}
+		buf << version;
+		buf << handles;
+		buf << ranges;
+		buf << splitRanges;
+		buf << handleRanges;
 	} 
 };
 
@@ -114,11 +189,19 @@ struct CommReqEvent : public CommEvent {
 	std::vector<ValueOp> valueOp;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> grpIndex;
-		buf >> valueOp;
-		buf >> attrName;
-		buf >> setValues;
+		if ( buf.backward() ) {
+			buf >> grpIndex;
+			buf >> valueOp;
+			buf >> attrName;
+			buf >> setValues;
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> setValues;
+		buf >> attrName;
+		buf >> valueOp;
+		buf >> grpIndex;
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
@@ -135,23 +218,63 @@ struct CommRespEvent : public CommEvent {
 		serialize_in(buf);
 	}
 
+	virtual void release() { EventPool<CommRespEvent>::put( this ); }
+
     std::vector< std::vector<PWR_Time> > timeStamp;
     std::vector< std::vector<uint64_t> > value;
 	uint64_t grpIndex; 
 
+	// an error names its object by handle, errObj is empty then, or by
+	// name with errHandle NO_HANDLE
 	std::vector< ObjID >  		errObj;
 	std::vector< PWR_AttrName > errAttr;
 	std::vector< int >   		errValue;
+	std::vector< ObjHandle >	errHandle;
 
-	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> errObj;
-		buf >> errAttr;
-		buf >> errValue;
+	// per value, how many values it was reduced from and, when it is one
+	// object's value such as a minimum, the client's handle of that
+	// object, 1 and NO_HANDLE when absent.  A router weighs the averages other routers
+	// send it by count and keeps the object of the value it keeps
+    std::vector< std::vector<uint64_t> > count;
+    std::vector< std::vector<ObjHandle> > valueObj;
 
-		buf >> grpIndex;
-		buf >> value;
-		buf >> timeStamp;
+	// what the message does not have is cleared, what it has is decoded
+	// over what a pooled event held so its vectors keep their capacity
+	virtual void serialize_in( SerialBuf& buf ) {
+		if ( buf.backward() ) {
+			errHandle.clear();
+			count.clear();
+			valueObj.clear();
+			buf >> errObj;
+			buf >> errAttr;
+			buf >> errValue;
+
+			buf >> grpIndex;
+			buf >> value;
+			buf >> timeStamp;
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> timeStamp;
+		buf >> value;
+		buf >> grpIndex;
+
+		buf >> errValue;
+		buf >> errAttr;
+		buf >> errObj;
+		if ( buf.remaining() ) {
+			buf >> errHandle;
+		} else {
+			errHandle.clear();
+		}
+		if ( buf.remaining() ) {
+			buf >> count;
+			buf >> valueObj;
+		} else {
+			count.clear();
+			valueObj.clear();
+		}
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
@@ -162,6 +285,12 @@ struct CommRespEvent : public CommEvent {
 		buf << errValue;
 		buf << errAttr;
 		buf << errObj;
+		if ( buf.backward() ) {
+			return;
+		}
+		buf << errHandle;
+		buf << count;
+		buf << valueObj;
 	} 
 };
 
@@ -173,8 +302,13 @@ struct CommLogReqEvent : public CommEvent {
     PWR_AttrName attrName;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> attrName;
+		if ( buf.backward() ) {
+			buf >> attrName;
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> attrName;
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
@@ -192,24 +326,40 @@ struct CommLogRespEvent : public CommEvent {
         errObj = other.errObj;
         errAttr = other.errAttr;
         errValue = other.errValue;
+        errHandle = other.errHandle;
         return *this;
     }
 
 	std::vector< ObjID >  		errObj;
 	std::vector< PWR_AttrName > errAttr;
 	std::vector< int >   		errValue;
+	std::vector< ObjHandle >	errHandle;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> errObj;
-		buf >> errAttr;
-		buf >> errValue;
+		errHandle.clear();
+		if ( buf.backward() ) {
+			buf >> errObj;
+			buf >> errAttr;
+			buf >> errValue;
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> errValue;
+		buf >> errAttr;
+		buf >> errObj;
+		if ( buf.remaining() ) {
+			buf >> errHandle;
+		}
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
 		buf << errValue;
 		buf << errAttr;
 		buf << errObj;
+		if ( ! buf.backward() ) {
+			buf << errHandle;
+		}
 	} 
 };
 
@@ -224,11 +374,19 @@ struct CommGetSamplesReqEvent : public CommEvent {
 	uint32_t count;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> attrName;
-		buf >> startTime;
-		buf >> period;
-		buf >> count; 
+		if ( buf.backward() ) {
+			buf >> attrName;
+			buf >> startTime;
+			buf >> period;
+			buf >> count; 
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+		buf >> count; 
+		buf >> period;
+		buf >> startTime;
+		buf >> attrName;
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
@@ -249,6 +407,7 @@ struct CommGetSamplesRespEvent : public CommEvent {
         errObj = other.errObj;
         errAttr = other.errAttr;
         errValue = other.errValue;
+        errHandle = other.errHandle;
         startTime = other.startTime;
         count = other.count;
         data = other.data;
@@ -262,15 +421,31 @@ struct CommGetSamplesRespEvent : public CommEvent {
 	std::vector< ObjID >  		errObj;
 	std::vector< PWR_AttrName > errAttr;
 	std::vector< int32_t >   		errValue;
+	std::vector< ObjHandle >	errHandle;
 
 	virtual void serialize_in( SerialBuf& buf ) {
-		buf >> startTime;
-		buf >> count;
-		buf >> data;
-		buf >> errValue;
-		buf >> errAttr;
-		buf >> errObj;
+		errHandle.clear();
+		if ( buf.backward() ) {
+			buf >> startTime;
+			buf >> count;
+			buf >> data;
+			buf >> errValue;
+			buf >> errAttr;
+			buf >> errObj;
+			CommEvent::serialize_in(buf);
+			return;
+		}
 		CommEvent::serialize_in(buf);
+
+		buf >> errObj;
+		buf >> errAttr;
+		buf >> errValue;
+		buf >> data;
+		buf >> count;
+		buf >> startTime;
+		if ( buf.remaining() ) {
+			buf >> errHandle;
+		}
 	} 
 	virtual void serialize_out( SerialBuf& buf ) {
 		CommEvent::serialize_out(buf);
@@ -281,9 +456,15 @@ struct CommGetSamplesRespEvent : public CommEvent {
 		buf << data;
 		buf << count;
 		buf << startTime;
-
+		if ( ! buf.backward() ) {
+			buf << errHandle;
+		}
 	} 
 };
 
+// the libpwr event for any type, for code that only decodes and encodes
+// again
+Event* allocBaseEvent( unsigned int type, SerialBuf& buf );
+
 #endif
 
@@ -12,6 +12,16 @@
 #ifndef _IMP_TYPES_H
 #define _IMP_TYPES_H
 
-enum ValueOp { NO_OP, FP_ADD, INT_ADD, FP_AVG, INT_AVG };
+#include <stdint.h>
+
+// how the router reduces an attribute's values, prefixed so the names
+// stay clear of the limits.h macros
+enum ValueOp { VOP_NONE, VOP_FP_ADD, VOP_INT_ADD, VOP_FP_AVG, VOP_INT_AVG,
+				VOP_FP_MIN, VOP_INT_MIN, VOP_FP_MAX, VOP_INT_MAX };
+
+// an object's position in the config's object list, every process reading
+// the config agrees on it so it stands in for the name on the wire
+typedef uint32_t ObjHandle;
+#define NO_HANDLE ((ObjHandle)-1)
 
 #endif
@@ -0,0 +1,268 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <map>
+
+#include "localEventChannel.h"
+#include "events.h"
+#include "debug.h"
+
+// Events cross the queue encoded, the receiving end allocates its own
+// Event subclass from them just like it does for a TCP frame, the two ends
+// do not share Event classes.  The encoding lives in the node, a send is
+// one allocation.  A closed node tells the receiver the other end has gone.
+struct Node {
+	Node( bool _closed = false ) : next(NULL), type(0), closed(_closed), 
+		chan(NULL) {}
+	Node*		next;
+	uint32_t	type;
+	bool		closed;
+	SerialBuf	buf;
+	LocalEventChannel* chan;
+};
+
+// Multi-producer single-consumer queue, producers swap themselves in at
+// the head and the consumer follows next pointers from a dummy node at 
+// the tail.  A producer counts its node on the eventfd once it is linked.
+// The consumer reads all the counts there are at once into m_credit and
+// spends one per node it pops, reading again only when a pop finds none
+// left, so a wakeup is one read however many nodes it brings.  A count is
+// never read before the pop of its node and a ChannelSelect never wakes
+// up to an empty queue.  Nodes whose counts are already in the credit do
+// not keep the eventfd readable, the channel reports them through
+// pending() and notify() instead, connections on a listener included.
+struct LocalEventChannel::Queue {
+	Queue() : m_credit( 0 ) {
+		m_head = m_tail = new Node;
+		m_fd = eventfd( 0, EFD_NONBLOCK );
+		assert( m_fd >= 0 );
+	}
+	~Queue() {
+		while ( m_tail ) {
+			Node* next = m_tail->next;
+			delete m_tail;
+			m_tail = next;
+		}
+		::close( m_fd );
+	}
+
+	void push( Node* node ) {
+		node->next = NULL;
+		Node* prev = __atomic_exchange_n( &m_head, node, __ATOMIC_ACQ_REL );
+		__atomic_store_n( &prev->next, node, __ATOMIC_RELEASE );
+
+		uint64_t one = 1;
+		ssize_t nbytes;
+		do {
+			nbytes = write( m_fd, &one, sizeof(one) );
+		} while ( nbytes < 0 && EINTR == errno );
+		assert( nbytes == sizeof(one) );
+	}
+
+	bool ready() {
+		return NULL != __atomic_load_n( &m_tail->next, __ATOMIC_ACQUIRE );
+	}
+
+	// blocks until something is queued, the node stays queued until pop()
+	Node* front() {
+		while ( ! ready() ) {
+			take();
+		}
+		return m_tail->next;
+	}
+
+	// true if more is queued.  The node's count may not be written yet, 
+	// its producer is between linking it and writing, wait for it.
+	bool pop() {
+		if ( 0 == m_credit ) {
+			take();
+		}
+		--m_credit;
+		Node* next = m_tail->next;
+		delete m_tail;
+		m_tail = next;
+		return ready();
+	}
+
+	// adds the counts written so far to the credit, waits for one if
+	// there are none
+	void take() {
+		uint64_t cnt;
+		while ( read( m_fd, &cnt, sizeof(cnt) ) < 0 ) {
+			if ( EAGAIN == errno ) {
+				struct pollfd pfd = { m_fd, POLLIN, 0 };
+				poll( &pfd, 1, -1 );
+			} else {
+				assert( EINTR == errno );
+			}
+		}
+		m_credit += cnt;
+	}
+
+	Node*		m_head;
+	Node*		m_tail;
+	int			m_fd;
+	uint64_t	m_credit;
+};
+
+// q[side] is what that side of the connection receives
+struct LocalEventChannel::Link {
+	Link() : refs(2) {}
+	Queue q[2];
+	int refs;
+};
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string,LocalEventChannel*> s_listeners;
+
+LocalEventChannel::LocalEventChannel( AllocFuncPtr func, std::string config, 
+		std::string name ) : 
+	EventChannel( func, name ), m_link( NULL ), m_side( 0 ), m_listenQ( NULL )
+{
+	m_port = getConfigValue( config, "listenPort" );
+	assert( ! m_port.empty() );
+
+	m_listenQ = new Queue;
+
+	pthread_mutex_lock( &s_mutex );
+	assert( s_listeners.find( m_port ) == s_listeners.end() );
+	s_listeners[ m_port ] = this;
+	pthread_mutex_unlock( &s_mutex );
+
+	DBGX2(DBG_EC,"%s listenPort=%s fd=%d\n",getName().c_str(),m_port.c_str(),
+						m_listenQ->m_fd);
+}
+
+LocalEventChannel::LocalEventChannel( AllocFuncPtr func, Link* link, int side,
+		std::string name ) : 
+	EventChannel( func, name ), m_link( link ), m_side( side ), m_listenQ( NULL )
+{
+	DBGX2(DBG_EC,"%s side=%d\n",getName().c_str(),m_side);
+}
+
+LocalEventChannel::~LocalEventChannel()
+{
+	DBGX2(DBG_EC,"%s\n",getName().c_str());
+	if ( m_listenQ ) {
+		pthread_mutex_lock( &s_mutex );
+		s_listeners.erase( m_port );
+		pthread_mutex_unlock( &s_mutex );
+
+		while ( m_listenQ->ready() ) {
+			delete m_listenQ->front()->chan;
+			m_listenQ->pop();
+		}
+		delete m_listenQ;
+	} else {
+		m_link->q[ 1 - m_side ].push( new Node( true ) );
+		if ( 0 == __sync_sub_and_fetch( &m_link->refs, 1 ) ) {
+			delete m_link;
+		}
+	}
+}
+
+LocalEventChannel* LocalEventChannel::connect( AllocFuncPtr func, 
+		const std::string& config, const std::string& name )
+{
+	std::string server = getConfigValue( config, "server" );
+	std::string port = getConfigValue( config, "serverPort" );
+	LocalEventChannel* chan = NULL;
+
+	if ( server.empty() || ! isLocalHost( server ) ) {
+		return NULL;
+	}
+
+	pthread_mutex_lock( &s_mutex );
+	std::map<std::string,LocalEventChannel*>::iterator iter = 
+										s_listeners.find( port );
+	if ( iter != s_listeners.end() ) {
+		LocalEventChannel* listener = iter->second;
+		Link* link = new Link;
+
+		chan = new LocalEventChannel( func, link, 0, name );
+
+		Node* node = new Node;
+		node->chan = new LocalEventChannel( listener->m_allocFunc, link, 1,
+						listener->getName() + "-recv" );
+		listener->m_listenQ->push( node );
+	}
+	pthread_mutex_unlock( &s_mutex );
+
+	DBGX2(DBG_EC,"server=%s port=%s %s\n",server.c_str(),port.c_str(),
+						chan ? "local" : "not local" );
+	return chan;
+}
+
+EventChannel* LocalEventChannel::accept()
+{
+	assert( m_listenQ );
+	LocalEventChannel* chan = m_listenQ->front()->chan;
+	if ( m_listenQ->pop() ) {
+		notify();
+	}
+	DBGX2(DBG_EC,"%s\n",chan->getName().c_str());
+	return chan;
+}
+
+int LocalEventChannel::getFd()
+{
+	return m_listenQ ? m_listenQ->m_fd : m_link->q[m_side].m_fd;
+}
+
+bool LocalEventChannel::pending()
+{
+	return m_listenQ ? m_listenQ->ready() : m_link->q[m_side].ready();
+}
+
+// what is left queued after a wakeup does not wake a ChannelSelect up
+// again, the channel tells it through notify()
+Event* LocalEventChannel::getEvent( bool blocking )
+{
+	Queue& q = m_link->q[m_side];
+	Node* node = q.front();
+
+	if ( node->closed ) {
+		DBGX2(DBG_EC,"%s closed\n",getName().c_str());
+		// leave the close marker for the next caller
+		return NULL;
+	}
+
+	Event* ev = m_allocFunc( node->type, node->buf );
+
+	DBGX2(DBG_EC2,"%s event type %d, length=%lu \n",getName().c_str(), 
+						ev->type, node->buf.length());
+
+	if ( q.pop() ) {
+		notify();
+	}
+	return ev;
+}
+
+bool LocalEventChannel::sendEvent( Event* event )
+{
+	Node* node = new Node;
+	node->type = event->type;
+	node->buf.reserve( 256 );
+	event->serialize_out( node->buf );
+
+	DBGX2(DBG_EC2,"%s event type %d, length=%lu \n",getName().c_str(), 
+						event->type, node->buf.length());
+
+	m_link->q[ 1 - m_side ].push( node );
+	return true;
+}
@@ -0,0 +1,54 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _LOCAL_EVENT_CHANNEL_H
+#define _LOCAL_EVENT_CHANNEL_H
+
+#include <string>
+#include <eventChannel.h>
+
+// EventChannel between threads of one process.  A listening channel is
+// registered under its listenPort, and getEventChannel() hands out a
+// connected LocalEventChannel instead of a TcpEventChannel when a client
+// asks for a port that is listened on in this process.  Each end has a 
+// lock-free multi-producer queue of encoded events and an eventfd that a
+// ChannelSelect waits on, which is only read again once the events it
+// counted have been taken.
+
+class LocalEventChannel : public EventChannel {
+  public:
+	struct Link;
+	struct Queue;
+
+    LocalEventChannel( AllocFuncPtr, std::string config, std::string name = "" );
+    ~LocalEventChannel();
+
+	// NULL if nothing in this process listens on the config's serverPort
+	static LocalEventChannel* connect( AllocFuncPtr, const std::string& config,
+												const std::string& name );
+
+    virtual Event* getEvent( bool blocking = true );
+    virtual bool sendEvent( Event* );
+	virtual EventChannel* accept();
+	virtual int getFd();
+	virtual bool pending();
+
+  private:
+    LocalEventChannel( AllocFuncPtr, Link*, int side, std::string name );
+
+	std::string	m_port;
+	Link*		m_link;
+	int			m_side;
+	Queue*		m_listenQ;
+};
+
+#endif
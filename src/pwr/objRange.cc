@@ -0,0 +1,301 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+
+#include "objRange.h"
+
+typedef std::vector< std::pair<uint32_t,uint32_t> > Spans;
+
+// numbers longer than this stay text
+#define MAX_DIGITS 9
+
+static unsigned padWidth( const std::string& digits )
+{
+	return ( digits.size() > 1 && '0' == digits[0] ) ? digits.size() : 0;
+}
+
+static void printNum( std::string& out, uint32_t value, unsigned width )
+{
+	char buf[16];
+	snprintf( buf, sizeof(buf), "%0*u", width, value );
+	out += buf;
+}
+
+void ObjRange::assign( const std::string& pattern )
+{
+	m_text.clear();
+	m_fields.clear();
+	m_text.push_back( "" );
+
+	size_t pos = 0;
+	while ( pos < pattern.size() ) {
+		if ( '[' != pattern[pos] ) {
+			m_text.back() += pattern[pos++];
+			continue;
+		}
+
+		Field field;
+		field.width = 0;
+		++pos;
+		while ( pos < pattern.size() ) {
+			size_t end = pos;
+			while ( end < pattern.size() && isdigit( pattern[end] ) ) ++end;
+			if ( end == pos ) break;
+
+			std::string lo = pattern.substr( pos, end - pos );
+			uint32_t first = strtoul( lo.c_str(), NULL, 10 );
+			uint32_t last = first;
+			if ( field.spans.empty() ) {
+				field.width = padWidth( lo );
+			}
+
+			pos = end;
+			if ( pos < pattern.size() && '-' == pattern[pos] ) {
+				end = ++pos;
+				while ( end < pattern.size() && isdigit( pattern[end] ) ) ++end;
+				if ( end == pos ) break;
+				last = strtoul( pattern.substr( pos, end - pos ).c_str(),
+																NULL, 10 );
+				pos = end;
+			}
+			if ( last < first ) {
+				std::swap( first, last );
+			}
+			field.spans.push_back( std::make_pair( first, last ) );
+
+			if ( pos < pattern.size() && ',' == pattern[pos] ) {
+				++pos;
+			} else {
+				break;
+			}
+		}
+
+		if ( pos >= pattern.size() || ']' != pattern[pos] ||
+										field.spans.empty() ) {
+			// not a pattern after all, it is a single name
+			m_text.assign( 1, pattern );
+			m_fields.clear();
+			break;
+		}
+		++pos;
+		m_fields.push_back( field );
+		m_text.push_back( "" );
+	}
+	rewind();
+}
+
+void ObjRange::rewind()
+{
+	for ( unsigned i = 0; i < m_fields.size(); i++ ) {
+		m_fields[i].span = 0;
+		m_fields[i].value = m_fields[i].spans[0].first;
+	}
+	m_done = false;
+}
+
+size_t ObjRange::size()
+{
+	size_t size = 1;
+	for ( unsigned i = 0; i < m_fields.size(); i++ ) {
+		size_t count = 0;
+		for ( unsigned j = 0; j < m_fields[i].spans.size(); j++ ) {
+			count += m_fields[i].spans[j].second - 
+								m_fields[i].spans[j].first + 1;
+		}
+		size *= count;
+	}
+	return size;
+}
+
+bool ObjRange::next( std::string& name )
+{
+	if ( m_done ) return false;
+
+	name = m_text[0];
+	for ( unsigned i = 0; i < m_fields.size(); i++ ) {
+		printNum( name, m_fields[i].value, m_fields[i].width );
+		name += m_text[i + 1];
+	}
+
+	int i = m_fields.size() - 1;
+	for ( ; i >= 0; i-- ) {
+		Field& field = m_fields[i];
+		if ( field.value < field.spans[field.span].second ) {
+			++field.value;
+			break;
+		}
+		if ( field.span + 1 < field.spans.size() ) {
+			field.value = field.spans[++field.span].first;
+			break;
+		}
+		field.span = 0;
+		field.value = field.spans[0].first;
+	}
+	if ( i < 0 ) {
+		m_done = true;
+	}
+	return true;
+}
+
+namespace {
+
+// a pattern while it is being built, a name is a pattern whose fields
+// each hold one number
+struct Pattern {
+	std::vector< std::string >	text;
+	std::vector< Spans >		spans;
+	std::vector< unsigned >		width;
+
+	bool parse( const std::string& name );
+	bool merge( const Pattern& next );
+	std::string str();
+};
+
+bool Pattern::parse( const std::string& name )
+{
+	text.push_back( "" );
+	size_t pos = 0;
+	while ( pos < name.size() ) {
+		if ( '[' == name[pos] || ']' == name[pos] ) {
+			return false;
+		}
+		size_t end = pos;
+		while ( end < name.size() && isdigit( name[end] ) ) ++end;
+
+		if ( end == pos || end - pos > MAX_DIGITS ) {
+			text.back() += name.substr( pos, std::max( end - pos, 
+														(size_t) 1 ) );
+			pos = std::max( end, pos + 1 );
+			continue;
+		}
+
+		std::string digits = name.substr( pos, end - pos );
+		uint32_t value = strtoul( digits.c_str(), NULL, 10 );
+		spans.push_back( Spans( 1, std::make_pair( value, value ) ) );
+		width.push_back( padWidth( digits ) );
+		text.push_back( "" );
+		pos = end;
+	}
+	return true;
+}
+
+// Appending next keeps the order of the names if they differ in one field
+// only, every field left of it holds one number, and its numbers in next
+// all come after the ones here.
+bool Pattern::merge( const Pattern& next )
+{
+	if ( text != next.text || width != next.width ) {
+		return false;
+	}
+
+	size_t field = spans.size();
+	for ( size_t i = 0; i < spans.size(); i++ ) {
+		if ( spans[i] == next.spans[i] ) {
+			continue;
+		}
+		if ( field < spans.size() ) {
+			return false;
+		}
+		field = i;
+	}
+	if ( field == spans.size() ) {
+		return false;
+	}
+
+	for ( size_t i = 0; i < field; i++ ) {
+		if ( spans[i].size() != 1 || spans[i][0].first != spans[i][0].second ) {
+			return false;
+		}
+	}
+
+	Spans& to = spans[field];
+	const Spans& from = next.spans[field];
+	if ( to.back().second >= from.front().first ) {
+		return false;
+	}
+
+	Spans::const_iterator iter = from.begin();
+	if ( to.back().second + 1 == iter->first ) {
+		to.back().second = iter->second;
+		++iter;
+	}
+	to.insert( to.end(), iter, from.end() );
+	return true;
+}
+
+std::string Pattern::str()
+{
+	std::string out = text[0];
+	for ( size_t i = 0; i < spans.size(); i++ ) {
+		if ( 1 == spans[i].size() && spans[i][0].first == spans[i][0].second ) {
+			printNum( out, spans[i][0].first, width[i] );
+		} else {
+			out += '[';
+			for ( size_t j = 0; j < spans[i].size(); j++ ) {
+				if ( j ) out += ',';
+				printNum( out, spans[i][j].first, width[i] );
+				if ( spans[i][j].first != spans[i][j].second ) {
+					out += '-';
+					printNum( out, spans[i][j].second, width[i] );
+				}
+			}
+			out += ']';
+		}
+		out += text[i + 1];
+	}
+	return out;
+}
+
+}
+
+bool compressObjNames( const std::vector<std::string>& names,
+						std::vector<std::string>& patterns )
+{
+	std::vector< Pattern > out;
+
+	for ( size_t i = 0; i < names.size(); i++ ) {
+		out.push_back( Pattern() );
+		if ( ! out.back().parse( names[i] ) ) {
+			return false;
+		}
+		// a merge can complete the one before it, board0.node[0-3] and
+		// board1.node[0-2] merge once board1.node3 arrives
+		while ( out.size() > 1 && out[out.size() - 2].merge( out.back() ) ) {
+			out.pop_back();
+		}
+	}
+
+	patterns.clear();
+	for ( size_t i = 0; i < out.size(); i++ ) {
+		patterns.push_back( out[i].str() );
+	}
+	return true;
+}
+
+void compressHandles( const std::vector<ObjHandle>& handles,
+						std::vector<ObjHandle>& ranges )
+{
+	ranges.clear();
+	for ( size_t i = 0; i < handles.size(); i++ ) {
+		if ( ! ranges.empty() && 
+				ranges[ ranges.size() - 2 ] + ranges.back() == handles[i] ) {
+			++ranges.back();
+		} else {
+			ranges.push_back( handles[i] );
+			ranges.push_back( 1 );
+		}
+	}
+}
@@ -0,0 +1,63 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _OBJ_RANGE_H
+#define _OBJ_RANGE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "impTypes.h"
+
+// Object names in hostlist form, "plat.cab[0-99].board[0-7].node[0-3]" is
+// 3200 nodes with the rightmost bracket varying fastest.  A bracket holds
+// comma separated numbers and ranges, "[0-3,8]", and a zero padded low
+// bound, "[00-15]", pads every number in the bracket to its width.
+
+class ObjRange {
+  public:
+	ObjRange() : m_done( true ) {}
+	ObjRange( const std::string& pattern ) { assign( pattern ); }
+
+	void assign( const std::string& pattern );
+	void rewind();
+	size_t size();
+
+	// the next name, false once all of them were returned
+	bool next( std::string& name );
+
+  private:
+	struct Field {
+		std::vector< std::pair<uint32_t,uint32_t> > spans;
+		unsigned width;
+
+		size_t		span;
+		uint32_t	value;
+	};
+
+	// m_text[i] comes before m_fields[i], the last one after all of them
+	std::vector< std::string >	m_text;
+	std::vector< Field >		m_fields;
+	bool						m_done;
+};
+
+// patterns that expand to names, in the same order, false if a name can't
+// be written as a pattern
+bool compressObjNames( const std::vector<std::string>& names,
+						std::vector<std::string>& patterns );
+
+// handles as (first,count) pairs
+void compressHandles( const std::vector<ObjHandle>& handles,
+						std::vector<ObjHandle>& ranges );
+
+#endif
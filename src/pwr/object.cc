@@ -99,11 +99,51 @@ int Object::attrGetValuesDevice( AttrInfo& info, PWR_AttrName name,
 	std::vector<uint64_t> value(info.devices.size());
 	std::vector<PWR_Time> tmpTS(info.devices.size());
 
-	for ( unsigned i = 0 ; i < info.devices.size(); i++ ) {
-		int retval = info.devices[i]->getValue( name, &value[i], 8, &tmpTS[i] );
+	if ( info.batches.empty() ) {
+		for ( unsigned i = 0 ; i < info.devices.size(); i++ ) {
+			int retval = info.devices[i]->getValue( name, &value[i], 8, &tmpTS[i] );
+			if ( PWR_RET_SUCCESS != retval ) {
+				return retval;
+			}
+		}
+	}
+
+	for ( unsigned i = 0 ; i < info.batches.size(); i++ ) {
+		AttrInfo::Batch& batch = info.batches[i];
+
+		if ( ! batch.readm ) {
+			unsigned pos = batch.index[0];
+			int retval = info.devices[pos]->getValue( name, &value[pos], 8,
+															&tmpTS[pos] );
+			if ( PWR_RET_SUCCESS != retval ) {
+				return retval;
+			}
+			continue;
+		}
+
+		unsigned num = batch.index.size();
+		std::vector<pwr_fd_t> fds( num );
+		std::vector<PWR_AttrName> names( num, name );
+		std::vector<uint64_t> tmpValue( num );
+		std::vector<PWR_Time> ts( num );
+		std::vector<int> status( num );
+
+		for ( unsigned j = 0; j < num; j++ ) {
+			fds[j] = info.devices[ batch.index[j] ]->fd();
+		}
+
+		int retval = batch.readm( &fds[0], num, &names[0],
+									&tmpValue[0], &ts[0], &status[0] );
 		if ( PWR_RET_SUCCESS != retval ) {
 			return retval;
 		}
+		for ( unsigned j = 0; j < num; j++ ) {
+			if ( PWR_RET_SUCCESS != status[j] ) {
+				return status[j];
+			}
+			value[ batch.index[j] ] = tmpValue[j];
+			tmpTS[ batch.index[j] ] = ts[j];
+		}
 	}
 
 	if ( info.devices.size() ) {
@@ -17,6 +17,7 @@
 #include "distCntxt.h"
 #include "distObject.h"
 #include "distRequest.h"
+#include "devEventChannel.h"
 
 #include "pwr.h"
 #include "group.h"
@@ -116,6 +117,12 @@ int PWR_ObjAttrGetValue( PWR_Obj obj, PWR_AttrName type, void* ptr, PWR_Time* ts
     return OBJECT(obj)->attrGetValue( type, ptr, ts );
 }
 
+int PWR_ObjAttrGetValueFrom( PWR_Obj obj, PWR_AttrName type, void* ptr,
+						PWR_Time* ts, PWR_Obj* from )
+{
+    return DISTOBJECT(obj)->attrGetValueFrom( type, ptr, ts, from );
+}
+
 int PWR_ObjAttrGetValues_NB( PWR_Obj obj, int count, PWR_AttrName type[],
 			void* ptr, PWR_Time ts[], PWR_Request req )
 {
@@ -374,6 +381,23 @@ int PWR_CntxtMakeProgress( PWR_Cntxt ctx )
     return DISTCNTXT(ctx)->makeProgress();
 }
 
+int PWR_CntxtGetObjByHandle( PWR_Cntxt ctx, uint32_t handle, PWR_Obj* obj )
+{
+    *obj = CNTXT(ctx)->getObjByHandle( handle );
+    return PWR_RET_SUCCESS;
+}
+
+EventChannel* PWR_CntxtGetDevEventChannel( PWR_Cntxt ctx )
+{
+    return DISTCNTXT(ctx)->initDevEventChannel();
+}
+
+int PWR_CntxtMakeDevProgress( PWR_Cntxt ctx )
+{
+    return DISTCNTXT(ctx)->makeProgress( 
+				DISTCNTXT(ctx)->getDevEventChannel() );
+}
+
 int PWR_ReqWait( PWR_Request req )
 {
     return static_cast<Request*>(req)->wait( );
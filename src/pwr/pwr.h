@@ -68,6 +68,13 @@ int         PWR_CntxtGetGrpByName( PWR_Cntxt, const char* name, PWR_Grp* );
 int         PWR_ObjAttrGetValue( PWR_Obj, PWR_AttrName name, void* val, PWR_Time* );
 int         PWR_ObjAttrSetValue( PWR_Obj, PWR_AttrName name, const void* val );
 
+/* As PWR_ObjAttrGetValue, and the object the value came from: the one a
+ * minimum or maximum over the object's descendants came from, the object
+ * itself otherwise.  Daemons name the objects they serve, a daemon that
+ * reduces deeper objects itself names its own object. */
+int         PWR_ObjAttrGetValueFrom( PWR_Obj, PWR_AttrName name, void* val,
+								PWR_Time*, PWR_Obj* from );
+
 int         PWR_StatusCreate( PWR_Status* );
 int         PWR_StatusDestroy( PWR_Status );
 int         PWR_StatusPopError( PWR_Status, PWR_AttrAccessError* );
@@ -144,6 +151,16 @@ PWR_Obj PWR_ObjGetAncestorByType( PWR_Obj, PWR_ObjType );
 EventChannel* PWR_CntxtGetEventChannel( PWR_Cntxt ctx );
 int PWR_CntxtMakeProgress( PWR_Cntxt ctx );
 
+/* The object at a handle, its index in the context's configuration, NULL
+ * if the configuration has no such index. */
+int PWR_CntxtGetObjByHandle( PWR_Cntxt, uint32_t handle, PWR_Obj* );
+
+/* Returns a channel that becomes readable when local device reads finish.
+ * Once it has been requested, non-blocking reads of local devices no longer
+ * block the caller and complete from PWR_CntxtMakeDevProgress(). */
+EventChannel* PWR_CntxtGetDevEventChannel( PWR_Cntxt ctx );
+int PWR_CntxtMakeDevProgress( PWR_Cntxt ctx );
+
 PWR_Request PWR_ReqCreate( PWR_Cntxt, PWR_Status );
 PWR_Request PWR_ReqCreateCallback( PWR_Cntxt, PWR_Status, Callback callback,
 										void* data );
@@ -68,14 +68,45 @@ typedef struct plugin_devops_t {
 typedef plugin_devops_t* (*pwr_init_t)( const char *initstr );
 typedef int (*pwr_final_t)( plugin_devops_t* );
 
+/*
+ * Version 2 of the plugin interface adds readm, which reads names[i] from
+ * fds[i] for nfds descriptors opened through any plugin_devops_t of the
+ * plugin, so a backend can serve many devices from one access.
+ */
+typedef int (*pwr_readm_t)( pwr_fd_t fds[], unsigned int nfds,
+    const PWR_AttrName names[], void* ptr, PWR_Time ts[], int status[] );
+
+/*
+ * Version 3 adds read_async, which starts a read of names[0..arraysize-1]
+ * from fd and returns without waiting for the device.  The plugin calls
+ * cb( ctx, retval ) exactly once when buf, ts and status are filled in,
+ * from any thread, possibly before read_async returns.  A non-zero return
+ * from read_async means the read was not started and cb will not be called.
+ */
+typedef void (*pwr_read_cb_t)( void* ctx, int retval );
+typedef int (*pwr_read_async_t)( pwr_fd_t fd, unsigned int arraysize,
+    const PWR_AttrName names[], void* buf, PWR_Time ts[], int status[],
+    pwr_read_cb_t cb, void* ctx );
+
+#define PWR_PLUGIN_VERSION 3
+
 typedef struct {
     pwr_init_t  init;
     pwr_final_t final;
+
+    /* only valid when the plugin exports GETDEVVERSIONFUNC returning >= 2 */
+    pwr_readm_t readm;
+
+    /* only valid when the plugin exports GETDEVVERSIONFUNC returning >= 3 */
+    pwr_read_async_t read_async;
 } plugin_dev_t;
 
 #define GETDEVFUNC "getDev"
 typedef plugin_dev_t* (*getDevFuncPtr_t)(void); 
 
+#define GETDEVVERSIONFUNC "getDevVersion"
+typedef int (*getDevVersionFuncPtr_t)(void);
+
 #ifdef __cplusplus
 }
 #endif
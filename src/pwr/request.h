@@ -28,6 +28,7 @@ class Request {
 				Callback callback = NULL, void* data = NULL ) : 
 		value(1),
 		timeStamp(1),
+		valueObj(1),
 		m_cntxt( ctx),
 		m_status( status ),
 		m_callback( callback ),
@@ -41,6 +42,8 @@ class Request {
 	// getAttr
 	std::vector<void*> 		value;
 	std::vector<PWR_Time*> 	timeStamp;
+	// where to put the object a minimum or maximum came from, if wanted
+	std::vector<PWR_Obj*> 	valueObj;
 
 	// where to put the number of samples returned 
 	unsigned int* count;
@@ -15,112 +15,245 @@
 #include <sstream>
 #include <assert.h>
 #include <vector>
+#include <string>
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
+#include <limits>
 
+// Encoding versions.  Frames of peers that predate versions carry 0, their
+// events are in the original back to front encoding.
+#define PROTO_VERSION_NONE		0
+#define PROTO_VERSION_FIXED		1
+#define PROTO_VERSION_COMPACT	2
+#define PROTO_VERSION			PROTO_VERSION_COMPACT
+
+/*
+ * Contiguous, forward encoded byte buffer.  Fields are appended in the
+ * order they are written and read back in the same order through a read
+ * cursor.  Scalars and vectors of scalars are copied with one memcpy,
+ * strings and vectors are prefixed with their length as a uint64_t.
+ *
+ * In the compact encoding, integers, enums and lengths are varints and
+ * signed values are zigzag encoded first, only floating point values and
+ * bytes are still copied as they are.
+ *
+ * In the original encoding, version 0, lengths follow what they are the
+ * length of and fields are read back from the end of the buffer, last
+ * written first.  The read cursor then counts from the end.
+ */
 struct SerialBuf {
 
-	SerialBuf() {}
-	SerialBuf( size_t length ) { buf.resize(length,0); }
+	SerialBuf() : pos(0), version(PROTO_VERSION_FIXED) {}
+	SerialBuf( size_t length ) : buf(length,0), pos(0), 
+									version(PROTO_VERSION_FIXED) {}
 
-	SerialBuf& operator<<( const std::string& str ) {
-		size_t len = str.length();
-        for ( unsigned int i = 0; i < len ; i++ ) {
-            buf.push_back( str[i] );
-        }
+	void reserve( size_t length ) { buf.reserve( length ); }
+	void rewind() { pos = 0; }
+	// empty, but keeps the memory for the next encoding
+	void clear() { buf.clear(); pos = 0; }
 
-		*this << len;
-		
-		return *this;
-	}
 	void print( ) {
 		for ( unsigned i = 0; i < buf.size(); i++ ) {
 			fprintf(stderr,"%02x ", buf[i]);
 		}
 	}
 
-	const SerialBuf& operator>>( std::string& str ) {
-		size_t len;
-		*this >> len;
+	void out( const void* ptr, size_t len ) {
+		if ( 0 == len ) return;
+		size_t cur = buf.size();
+		buf.resize( cur + len );
+		memcpy( &buf[cur], ptr, len );
+	}
 
-		str.resize(len);
-        for ( unsigned int i = len; i > 0 ; i-- ) {
-			str[ i - 1 ] = buf.back();
-			buf.pop_back();
-        }
-		return *this;
+	bool backward() { return PROTO_VERSION_NONE == version; }
+
+	// the next len bytes the cursor moves over
+	const unsigned char* take( size_t len ) {
+		if ( 0 == len ) return NULL;
+		assert( pos + len <= buf.size() );
+		const unsigned char* ptr = backward() ? 
+					&buf[ buf.size() - pos - len ] : &buf[pos];
+		pos += len;
+		return ptr;
 	}
 
-	template<typename T> SerialBuf& operator<<( const std::vector<T>& vec ) {
-		size_t len = vec.size();
+	void in( void* ptr, size_t len ) {
+		if ( 0 == len ) return;
+		memcpy( ptr, take( len ), len );
+	}
+
+	size_t remaining() { return buf.size() - pos; }
+
+	// a length goes in front of its elements, or after them in the
+	// original encoding, it is always read first
+	void lengthBefore( uint64_t len ) {
+		if ( ! backward() ) *this << len;
+	}
+	void lengthAfter( uint64_t len ) {
+		if ( backward() ) *this << len;
+	}
+	// index of the i'th of len elements read
+	uint64_t index( uint64_t i, uint64_t len ) {
+		return backward() ? len - 1 - i : i;
+	}
+
+	void outVarint( uint64_t v ) {
+		unsigned char tmp[10];
+		size_t len = 0;
+		while ( v >= 0x80 ) {
+			tmp[len++] = (unsigned char) ( v | 0x80 );
+			v >>= 7;
+		}
+		tmp[len++] = (unsigned char) v;
+		out( tmp, len );
+	}
+
+	uint64_t inVarint() {
+		uint64_t v = 0;
+		unsigned int shift = 0;
+		unsigned char c;
+		do {
+			assert( pos < buf.size() && shift < 64 );
+			c = buf[pos++];
+			v |= (uint64_t) ( c & 0x7f ) << shift;
+			shift += 7;
+		} while ( c & 0x80 );
+		return v;
+	}
+
+	// integers and enums, anything else numeric_limits does not know
+	// about, are varints, bytes are not worth it
+	template<typename T> static bool isVarint() {
+		return sizeof(T) > 1 && ( std::numeric_limits<T>::is_integer ||
+						! std::numeric_limits<T>::is_specialized );
+	}
 
-        for ( unsigned int i = 0; i < len ; i++ ) {
-        	*this << vec[i];
-        }
-		*this << len;
+	template<typename T> void outValue( const T& t ) {
+		if ( std::numeric_limits<T>::is_integer && 
+							! std::numeric_limits<T>::is_signed ) {
+			outVarint( (uint64_t) t );
+		} else {
+			int64_t v = (int64_t) t;
+			outVarint( ( (uint64_t) v << 1 ) ^ (uint64_t) ( v >> 63 ) );
+		}
+	}
+
+	template<typename T> void inValue( T& t ) {
+		uint64_t v = inVarint();
+		if ( std::numeric_limits<T>::is_integer && 
+							! std::numeric_limits<T>::is_signed ) {
+			t = (T) v;
+		} else {
+			t = (T) (int64_t) ( ( v >> 1 ) ^ ( 0 - ( v & 1 ) ) );
+		}
+	}
+
+	SerialBuf& operator<<( const std::string& str ) {
+		lengthBefore( str.length() );
+		out( str.data(), str.length() );
+		lengthAfter( str.length() );
 		return *this;
 	}
 
-	template<typename T> const SerialBuf& operator>>( std::vector<T>& vec ) {
-		size_t len;
+	SerialBuf& operator>>( std::string& str ) {
+		uint64_t len;
 		*this >> len;
+		str.assign( (const char*) take( len ), len );
+		return *this;
+	}
 
-		vec.resize(len);
-        for ( unsigned int i = len; i > 0 ; i-- ) {
-			*this >> vec[i-1];
-        }
+	SerialBuf& operator<<( const std::vector<std::string>& vec ) {
+		lengthBefore( vec.size() );
+		for ( unsigned int i = 0; i < vec.size(); i++ ) {
+			*this << vec[i];
+		}
+		lengthAfter( vec.size() );
 		return *this;
 	}
 
-    template<typename T> SerialBuf& operator<<( const T t ) {
-		
-		assert( sizeof( T ) <= sizeof(uint64_t) );
+	SerialBuf& operator>>( std::vector<std::string>& vec ) {
+		uint64_t len;
+		*this >> len;
+		vec.resize(len);
+		for ( unsigned int i = 0; i < len; i++ ) {
+			*this >> vec[ index( i, len ) ];
+		}
+		return *this;
+	}
 
-		uint64_t tmp = (uint64_t) t;
+	template<typename T> SerialBuf& operator<<( const std::vector< std::vector<T> >& vec ) {
+		lengthBefore( vec.size() );
+		for ( unsigned int i = 0; i < vec.size(); i++ ) {
+			*this << vec[i];
+		}
+		lengthAfter( vec.size() );
+		return *this;
+	}
 
-		out(tmp,sizeof(T)); 
-        return *this;
+	template<typename T> SerialBuf& operator>>( std::vector< std::vector<T> >& vec ) {
+		uint64_t len;
+		*this >> len;
+		vec.resize(len);
+		for ( unsigned int i = 0; i < len; i++ ) {
+			*this >> vec[ index( i, len ) ];
+		}
+		return *this;
 	}
 
-    SerialBuf& operator<<( const double t ) {
+	// vectors of scalars go in and out as one block, unless they are
+	// varints
+	template<typename T> SerialBuf& operator<<( const std::vector<T>& vec ) {
+		lengthBefore( vec.size() );
+		if ( version >= PROTO_VERSION_COMPACT && isVarint<T>() ) {
+			for ( unsigned int i = 0; i < vec.size(); i++ ) {
+				outValue( vec[i] );
+			}
+		} else if ( ! vec.empty() ) {
+			out( &vec[0], vec.size() * sizeof(T) );
+		}
+		lengthAfter( vec.size() );
+		return *this;
+	}
 
-		uint64_t tmp = *(uint64_t*) &t;
-		out(tmp,sizeof(t));
-        return *this;
+	template<typename T> SerialBuf& operator>>( std::vector<T>& vec ) {
+		uint64_t len;
+		*this >> len;
+		vec.resize(len);
+		if ( version >= PROTO_VERSION_COMPACT && isVarint<T>() ) {
+			for ( unsigned int i = 0; i < len; i++ ) {
+				inValue( vec[i] );
+			}
+		} else if ( len ) {
+			in( &vec[0], len * sizeof(T) );
+		}
+		return *this;
 	}
 
-	void out( uint64_t tmp, size_t len ) { 
-        for ( unsigned int i = 0; i < len ; i++ ) {
-			unsigned char c = tmp >> (8 * i ) & 0xff;
-            buf.push_back( c );
-        }
-    }
+	template<typename T> SerialBuf& operator<<( const T& t ) {
+		assert( sizeof( T ) <= sizeof(uint64_t) );
+		if ( version >= PROTO_VERSION_COMPACT && isVarint<T>() ) {
+			outValue( t );
+		} else {
+			out( &t, sizeof(T) );
+		}
+		return *this;
+	}
 
-    template<typename T> SerialBuf& operator>>( T& t ) {
+	template<typename T> SerialBuf& operator>>( T& t ) {
 		assert( sizeof( T ) <= sizeof(uint64_t) );
-		t =	(T) in(sizeof(T));
-		return *this; 
-	}	
-
-    SerialBuf& operator>>( double& t ) {
-				
-		uint64_t tmp = in(sizeof(t));
-		t = *(double*) &tmp;			
-        return *this;
-	}
-
-	uint64_t in(size_t len ) { 
-        uint64_t tmp = 0;
-        for ( unsigned int i = len; i > 0 ; i-- ) {
-			uint64_t c = buf.back();
-            buf.pop_back();
-			tmp |= (c << (8 * (i-1)) );
-        }
-		return tmp;
-    }
-
-    std::vector<unsigned char > buf;
-	size_t length() { return buf.size(); } 
+		if ( version >= PROTO_VERSION_COMPACT && isVarint<T>() ) {
+			inValue( t );
+		} else {
+			in( &t, sizeof(T) );
+		}
+		return *this;
+	}
+
+	std::vector<unsigned char > buf;
+	size_t pos;
+	unsigned int version;
+	size_t length() { return buf.size(); }
 	void* addr() { return &buf[0]; }
 };
 
@@ -0,0 +1,558 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "shmEventChannel.h"
+#include "events.h"
+#include "debug.h"
+
+#define RING_LEN	( 1 << 20 )
+#define HDR_LEN		8
+#define WRAP_TYPE	0xffffffff
+#define MORE_TYPE	0xfffffffe
+#define CHUNK_LEN	( RING_LEN / 4 )
+
+// how many times a client looks at its ring before it sleeps, spinning
+// only helps if the other side can run at the same time
+#define SPIN_LOOPS	( 1 << 16 )
+
+static unsigned int spinLoops()
+{
+	static int cpus = sysconf( _SC_NPROCESSORS_ONLN );
+	return cpus > 1 ? SPIN_LOOPS : 0;
+}
+
+// Each frame is a type and length header followed by the encoded event,
+// padded so the next header is aligned.  A frame never wraps, a header
+// with WRAP_TYPE sends the consumer back to the start of the ring.  An
+// event longer than CHUNK_LEN goes as several frames, all but the last
+// of type MORE_TYPE, the receiver puts them back together.  head and tail
+// only grow and are on their own cache lines.
+struct ShmEventChannel::Ring {
+	uint64_t	head;
+	char		pad0[56];
+	uint64_t	tail;
+	char		pad1[56];
+	uint32_t	armed;
+	uint32_t	counted;
+	uint32_t	closed;
+	char		pad2[52];
+	unsigned char data[ RING_LEN ];
+
+	bool ready() {
+		return __atomic_load_n( &head, __ATOMIC_ACQUIRE ) != tail;
+	}
+	bool isClosed() {
+		return __atomic_load_n( &closed, __ATOMIC_ACQUIRE );
+	}
+};
+
+// ring[side] is what that side of the connection receives, side 0 is the
+// connecting side
+struct ShmEventChannel::Segment {
+	Ring ring[2];
+};
+
+static std::string sockName( const std::string& port )
+{
+	// abstract namespace, goes away with the listener
+	return std::string( 1, '\0' ) + "pwrapi-shm-" + port;
+}
+
+static void sockAddr( const std::string& name, struct sockaddr_un& addr, 
+													socklen_t& len )
+{
+	bzero( &addr, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	assert( name.length() < sizeof(addr.sun_path) );
+	memcpy( addr.sun_path, name.data(), name.length() );
+	len = offsetof( struct sockaddr_un, sun_path ) + name.length();
+}
+
+static void signal( ShmEventChannel::Ring* ring, int fd )
+{
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	if ( __atomic_load_n( &ring->counted, __ATOMIC_SEQ_CST ) || 
+				__atomic_exchange_n( &ring->armed, 0, __ATOMIC_SEQ_CST ) ) {
+		uint64_t one = 1;
+		while ( write( fd, &one, sizeof(one) ) < 0 && EINTR == errno );
+	}
+}
+
+ShmEventChannel::ShmEventChannel( AllocFuncPtr func, std::string config, 
+		std::string name ) : 
+	EventChannel( func, name ), m_listenFd( -1 ), m_seg( NULL ), m_side( 0 ),
+	m_sock( -1 ), m_pollFd( -1 ), m_broken( false )
+{
+	std::string port = getConfigValue( config, "listenPort" );
+	assert( ! port.empty() );
+	m_efd[0] = m_efd[1] = -1;
+
+	struct sockaddr_un addr;
+	socklen_t len;
+	sockAddr( sockName( port ), addr, len );
+
+	m_listenFd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+	assert( m_listenFd >= 0 );
+
+	if ( bind( m_listenFd, (struct sockaddr*) &addr, len ) < 0 ||
+							listen( m_listenFd, 128 ) < 0 ) {
+		fprintf(stderr,"Error: SHM listen on port %s failed, %s\n",
+							port.c_str(), strerror(errno) );
+		::close( m_listenFd );
+		m_listenFd = -1;
+	}
+	DBGX2(DBG_EC,"%s listenPort=%s fd=%d\n",getName().c_str(),port.c_str(),
+						m_listenFd);
+}
+
+ShmEventChannel::ShmEventChannel( AllocFuncPtr func, Segment* seg, int fd[2],
+		int sock, int side, std::string name ) : 
+	EventChannel( func, name ), m_listenFd( -1 ), m_seg( seg ), m_side( side ),
+	m_sock( sock ), m_pollFd( -1 ), m_broken( false )
+{
+	m_efd[0] = fd[0];
+	m_efd[1] = fd[1];
+
+	// a ChannelSelect waits on one descriptor, it is woken by an event or
+	// by the peer going away
+	if ( m_side ) {
+		m_pollFd = epoll_create1( EPOLL_CLOEXEC );
+		assert( m_pollFd >= 0 );
+		struct epoll_event ev;
+		memset( &ev, 0, sizeof(ev) );
+		ev.events = EPOLLIN;
+		int rc = epoll_ctl( m_pollFd, EPOLL_CTL_ADD, m_efd[m_side], &ev );
+		assert( 0 == rc );
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		rc = epoll_ctl( m_pollFd, EPOLL_CTL_ADD, m_sock, &ev );
+		assert( 0 == rc );
+	}
+	DBGX2(DBG_EC,"%s side=%d fd=%d\n",getName().c_str(),m_side,m_efd[m_side]);
+}
+
+ShmEventChannel::~ShmEventChannel()
+{
+	DBGX2(DBG_EC,"%s\n",getName().c_str());
+	if ( m_listenFd > -1 ) {
+		::close( m_listenFd );
+	}
+	if ( m_seg ) {
+		// a producer waiting for room gives up once the ring is closed
+		__atomic_store_n( &m_seg->ring[m_side].closed, 1, __ATOMIC_RELEASE );
+		__atomic_store_n( &m_seg->ring[1-m_side].closed, 1, __ATOMIC_RELEASE );
+		signal( &m_seg->ring[1-m_side], m_efd[1-m_side] );
+
+		munmap( m_seg, sizeof(Segment) );
+		::close( m_efd[0] );
+		::close( m_efd[1] );
+		::close( m_sock );
+		if ( m_pollFd > -1 ) {
+			::close( m_pollFd );
+		}
+	}
+}
+
+ShmEventChannel* ShmEventChannel::connect( AllocFuncPtr func, 
+		const std::string& config, const std::string& name )
+{
+	std::string server = getConfigValue( config, "server" );
+	std::string port = getConfigValue( config, "serverPort" );
+
+	if ( server.empty() || ! isLocalHost( server ) ) {
+		return NULL;
+	}
+
+	struct sockaddr_un addr;
+	socklen_t len;
+	sockAddr( sockName( port ), addr, len );
+
+	int sock = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+	assert( sock >= 0 );
+	if ( ::connect( sock, (struct sockaddr*) &addr, len ) < 0 ) {
+		DBG3(DBG_EC,"ShmEventChannel","server=%s port=%s not listening\n",server.c_str(),
+															port.c_str());
+		::close( sock );
+		return NULL;
+	}
+
+	static int count = 0;
+	char shmName[64];
+	snprintf( shmName, sizeof(shmName), "/pwrapi-%d-%d", getpid(), 
+							__sync_fetch_and_add( &count, 1 ) );
+
+	// the name is only needed until the segment is open, the listener 
+	// gets the descriptor
+	int shmFd = shm_open( shmName, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600 );
+	assert( shmFd >= 0 );
+	shm_unlink( shmName );
+
+	int rc = ftruncate( shmFd, sizeof(Segment) );
+	assert( 0 == rc );
+	Segment* seg = (Segment*) mmap( NULL, sizeof(Segment), 
+						PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0 );
+	assert( MAP_FAILED != seg );
+	seg->ring[1].counted = 1;
+
+	int fd[3];
+	fd[0] = shmFd;
+	fd[1] = eventfd( 0, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC );
+	fd[2] = eventfd( 0, EFD_SEMAPHORE | EFD_CLOEXEC );
+	assert( fd[1] >= 0 && fd[2] >= 0 );
+
+	char c = 0;
+	struct iovec iov = { &c, 1 };
+	char ctrl[ CMSG_SPACE( sizeof(fd) ) ];
+	struct msghdr msg;
+	bzero( &msg, sizeof(msg) );
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR( &msg );
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN( sizeof(fd) );
+	memcpy( CMSG_DATA( cmsg ), fd, sizeof(fd) );
+
+	ssize_t nbytes;
+	do {
+		nbytes = sendmsg( sock, &msg, 0 );
+	} while ( nbytes < 0 && EINTR == errno );
+
+	::close( shmFd );
+
+	if ( nbytes != 1 ) {
+		::close( sock );
+		munmap( seg, sizeof(Segment) );
+		::close( fd[1] );
+		::close( fd[2] );
+		return NULL;
+	}
+
+	DBG3(DBG_EC,"ShmEventChannel","server=%s port=%s segment=%s\n",server.c_str(),port.c_str(),
+																shmName);
+	// the socket stays open, it hangs up when the listener goes away
+	return new ShmEventChannel( func, seg, &fd[1], sock, 0, name );
+}
+
+// NULL if the connection is refused, only processes of our own user may
+// map a segment into the daemon
+EventChannel* ShmEventChannel::accept()
+{
+	assert( m_listenFd > -1 );
+	int sock;
+	do {
+		sock = ::accept4( m_listenFd, NULL, NULL, SOCK_CLOEXEC );
+	} while ( sock < 0 && EINTR == errno );
+	if ( sock < 0 ) {
+		DBGX2(DBG_EC,"%s accept failed %s\n",getName().c_str(),
+							strerror(errno));
+		return NULL;
+	}
+
+	struct ucred cred;
+	socklen_t credLen = sizeof(cred);
+	cred.uid = (uid_t) -1;
+	if ( getsockopt( sock, SOL_SOCKET, SO_PEERCRED, &cred, &credLen ) < 0 ||
+										cred.uid != geteuid() ) {
+		fprintf(stderr,"Error: %s refused a connection from uid %d\n",
+							getName().c_str(), (int) cred.uid );
+		::close( sock );
+		return NULL;
+	}
+
+	int fd[3];
+	char c;
+	struct iovec iov = { &c, 1 };
+	char ctrl[ CMSG_SPACE( sizeof(fd) ) ];
+	struct msghdr msg;
+	bzero( &msg, sizeof(msg) );
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	ssize_t nbytes;
+	do {
+		nbytes = recvmsg( sock, &msg, MSG_CMSG_CLOEXEC );
+	} while ( nbytes < 0 && EINTR == errno );
+
+	struct cmsghdr* cmsg = nbytes > 0 ? CMSG_FIRSTHDR( &msg ) : NULL;
+	if ( 1 != nbytes || NULL == cmsg || SOL_SOCKET != cmsg->cmsg_level ||
+				SCM_RIGHTS != cmsg->cmsg_type ) {
+		fprintf(stderr,"Error: %s bad handshake\n",getName().c_str());
+		::close( sock );
+		return NULL;
+	}
+	if ( cmsg->cmsg_len != CMSG_LEN( sizeof(fd) ) ) {
+		int* recvd = (int*) CMSG_DATA( cmsg );
+		for ( unsigned int i = 0; 
+				i < ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof(int); i++ ) {
+			::close( recvd[i] );
+		}
+		fprintf(stderr,"Error: %s bad handshake\n",getName().c_str());
+		::close( sock );
+		return NULL;
+	}
+	memcpy( fd, CMSG_DATA( cmsg ), sizeof(fd) );
+
+	// a segment shorter than it claims would fault on first touch
+	struct stat st;
+	Segment* seg = (Segment*) MAP_FAILED;
+	if ( 0 == fstat( fd[0], &st ) && st.st_size >= (off_t) sizeof(Segment) ) {
+		seg = (Segment*) mmap( NULL, sizeof(Segment), 
+						PROT_READ | PROT_WRITE, MAP_SHARED, fd[0], 0 );
+	}
+	::close( fd[0] );
+	if ( MAP_FAILED == seg ) {
+		fprintf(stderr,"Error: %s bad segment\n",getName().c_str());
+		::close( sock );
+		::close( fd[1] );
+		::close( fd[2] );
+		return NULL;
+	}
+
+	// the socket stays open, it hangs up when the client goes away
+	ShmEventChannel* chan = new ShmEventChannel( m_allocFunc, seg, &fd[1], 
+										sock, 1, getName() + "-recv" );
+	DBGX2(DBG_EC,"%s\n",chan->getName().c_str());
+	return chan;
+}
+
+int ShmEventChannel::getFd()
+{
+	if ( NULL == m_seg ) {
+		return m_listenFd;
+	}
+	// a connecting side that is selected on, a server daemon's context,
+	// has nothing to arm its ring, from here on it counts every event too.
+	// A wake left over from an arming that found the event is dropped.
+	Ring* ring = &m_seg->ring[m_side];
+	if ( 0 == m_side && ! __atomic_load_n( &ring->counted, __ATOMIC_SEQ_CST ) ) {
+		__atomic_store_n( &ring->counted, 1, __ATOMIC_SEQ_CST );
+		__atomic_store_n( &ring->armed, 0, __ATOMIC_SEQ_CST );
+		uint64_t cnt;
+		while ( read( m_efd[0], &cnt, sizeof(cnt) ) > 0 || EINTR == errno );
+	}
+	return m_pollFd > -1 ? m_pollFd : m_efd[m_side];
+}
+
+// nothing is ever sent on the socket after the handshake, it only becomes
+// readable when the peer has closed it, orderly or by dying
+bool ShmEventChannel::peerGone()
+{
+	struct pollfd pfd = { m_sock, POLLIN | POLLRDHUP, 0 };
+	while ( poll( &pfd, 1, 0 ) < 0 && EINTR == errno );
+	return 0 != pfd.revents;
+}
+
+bool ShmEventChannel::pending()
+{
+	return m_seg ? m_seg->ring[m_side].ready() : false;
+}
+
+// false if the ring is closed and empty, or the peer is gone
+bool ShmEventChannel::wait( Ring* ring )
+{
+	struct pollfd pfd[2] = { { m_efd[m_side], POLLIN, 0 },
+							 { m_sock, POLLIN | POLLRDHUP, 0 } };
+
+	if ( __atomic_load_n( &ring->counted, __ATOMIC_SEQ_CST ) ) {
+		// one count for every event and one for the close, a peer that
+		// died has counted what it queued
+		while ( poll( pfd, 2, -1 ) < 0 && EINTR == errno );
+		if ( ! ( pfd[0].revents & POLLIN ) ) {
+			DBGX2(DBG_EC,"%s peer gone\n",getName().c_str());
+			return false;
+		}
+		uint64_t cnt;
+		while ( read( m_efd[m_side], &cnt, sizeof(cnt) ) < 0 && EINTR == errno );
+		if ( ! ring->ready() ) {
+			signal( ring, m_efd[m_side] );
+			return false;
+		}
+		return true;
+	}
+
+	unsigned int spin = spinLoops();
+	for ( unsigned int i = 0; ! ring->ready(); i++ ) {
+		if ( ring->isClosed() ) {
+			return ring->ready();
+		}
+		if ( i < spin ) {
+			continue;
+		}
+
+		__atomic_store_n( &ring->armed, 1, __ATOMIC_SEQ_CST );
+		__atomic_thread_fence( __ATOMIC_SEQ_CST );
+		if ( ring->ready() || ring->isClosed() ) {
+			continue;
+		}
+
+		while ( poll( pfd, 2, -1 ) < 0 && EINTR == errno );
+		if ( pfd[1].revents ) {
+			DBGX2(DBG_EC,"%s peer gone\n",getName().c_str());
+			return ring->ready();
+		}
+
+		uint64_t cnt;
+		while ( read( m_efd[m_side], &cnt, sizeof(cnt) ) < 0 && EINTR == errno );
+	}
+	return true;
+}
+
+// The ring is shared with the peer, nothing in it is trusted.  A frame
+// that does not lie between tail and head breaks the channel.  The rest
+// of an event that came in pieces is on its way, the sender is copying
+// it in as the ring frees up, it is waited for.
+Event* ShmEventChannel::getEvent( bool blocking )
+{
+	Ring* ring = &m_seg->ring[m_side];
+	uint32_t word = MORE_TYPE;
+
+	m_decodeBuf.clear();
+	while ( MORE_TYPE == word ) {
+		if ( m_broken || ! wait( ring ) ) {
+			DBGX2(DBG_EC,"%s closed\n",getName().c_str());
+			return NULL;
+		}
+		if ( ! takeFrame( ring, word ) ) {
+			return NULL;
+		}
+	}
+
+	m_decodeBuf.version = FRAME_VERSION( word );
+	Event* ev = m_allocFunc( FRAME_TYPE( word ), m_decodeBuf );
+
+	DBGX2(DBG_EC2,"%s event type %d, length=%zu \n",getName().c_str(), 
+						ev->type, m_decodeBuf.length());
+	return ev;
+}
+
+// appends the frame at the tail to m_decodeBuf
+bool ShmEventChannel::takeFrame( Ring* ring, uint32_t& word )
+{
+	uint64_t head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+	uint64_t tail = ring->tail;
+	uint64_t avail = head - tail;
+	size_t off = tail % RING_LEN;
+	uint32_t hdr[2];
+
+	if ( avail > RING_LEN || avail < HDR_LEN || ( off & 7 ) ) {
+		return broken( "ring" );
+	}
+	memcpy( hdr, &ring->data[ off ], HDR_LEN );
+	if ( WRAP_TYPE == hdr[0] ) {
+		if ( avail <= RING_LEN - off ) {
+			return broken( "wrap" );
+		}
+		avail -= RING_LEN - off;
+		tail += RING_LEN - off;
+		off = 0;
+		memcpy( hdr, &ring->data[0], HDR_LEN );
+	}
+	uint64_t size = ( (uint64_t) HDR_LEN + hdr[1] + 7 ) & ~7;
+	if ( WRAP_TYPE == hdr[0] || hdr[1] > RING_LEN - off - HDR_LEN || 
+												size > avail ) {
+		return broken( "frame" );
+	}
+
+	m_decodeBuf.out( &ring->data[ off + HDR_LEN ], hdr[1] );
+	__atomic_store_n( &ring->tail, tail + size, __ATOMIC_RELEASE );
+	word = hdr[0];
+	return true;
+}
+
+bool ShmEventChannel::broken( const char* what )
+{
+	fprintf(stderr,"Error: %s bad %s from peer, closing\n",
+						getName().c_str(), what );
+	m_broken = true;
+	return false;
+}
+
+bool ShmEventChannel::sendEvent( Event* event )
+{
+	Ring* ring = &m_seg->ring[1-m_side];
+
+	SerialBuf& buf = m_encodeBuf;
+	buf.clear();
+	event->serialize_out( buf );
+
+	const unsigned char* data = (const unsigned char*) buf.addr();
+	size_t length = buf.length();
+	for ( ; length > CHUNK_LEN; data += CHUNK_LEN, length -= CHUNK_LEN ) {
+		if ( ! putFrame( ring, MORE_TYPE, data, CHUNK_LEN ) ) {
+			return false;
+		}
+	}
+	if ( ! putFrame( ring, FRAME_WORD( event->type, buf.version ), data, 
+															length ) ) {
+		return false;
+	}
+
+	DBGX2(DBG_EC2,"%s event type %d, length=%zu \n",getName().c_str(), 
+						event->type, buf.length());
+	return true;
+}
+
+// false if the peer has gone, waits for the room otherwise
+bool ShmEventChannel::putFrame( Ring* ring, uint32_t word, 
+						const unsigned char* data, size_t length )
+{
+	uint32_t hdr[2] = { word, (uint32_t) length };
+	size_t size = ( HDR_LEN + hdr[1] + 7 ) & ~7;
+
+	uint64_t head = ring->head;
+	size_t off = head % RING_LEN;
+	size_t pad = RING_LEN - off < size ? RING_LEN - off : 0;
+
+	while ( RING_LEN - ( head - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE ) ) 
+														< pad + size ) {
+		if ( ring->isClosed() || peerGone() ) {
+			return false;
+		}
+		sched_yield();
+	}
+
+	if ( pad ) {
+		uint32_t wrap[2] = { WRAP_TYPE, 0 };
+		memcpy( &ring->data[off], wrap, HDR_LEN );
+		head += pad;
+		off = 0;
+	}
+
+	memcpy( &ring->data[off], hdr, HDR_LEN );
+	if ( hdr[1] ) {
+		memcpy( &ring->data[ off + HDR_LEN ], data, hdr[1] );
+	}
+	__atomic_store_n( &ring->head, head + size, __ATOMIC_RELEASE );
+
+	signal( ring, m_efd[1-m_side] );
+	return true;
+}
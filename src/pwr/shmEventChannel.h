@@ -0,0 +1,83 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+
+#ifndef _SHM_EVENT_CHANNEL_H
+#define _SHM_EVENT_CHANNEL_H
+
+#include <string>
+#include <eventChannel.h>
+#include <serialize.h>
+
+// EventChannel between processes on one node.  The connecting side creates
+// a /dev/shm segment holding one single-producer single-consumer ring of
+// encoded events per direction and passes it, along with an eventfd per
+// ring, to the listener over a unix socket named after the listenPort.
+// After that no system call is needed to move an event, only to wake a
+// receiver that is sleeping.
+//
+// The listening side receives through a ChannelSelect, so every event sent
+// to it counts one on its eventfd.  The connecting side is a client waiting
+// for its response, it spins on its ring for a while before it arms its
+// eventfd and sleeps, and is only signalled when armed.  A connecting side
+// that is itself put in a ChannelSelect, as a server daemon's context is,
+// switches to counting every event when asked for its descriptor, which is
+// done before it has anything in flight.
+//
+// The listener only accepts processes of its own user, and checks every
+// frame against the ring before it copies it out.
+//
+// Both sides keep the unix socket open after the handshake.  It hangs up
+// when the peer exits, also when it crashes without closing its rings, and
+// the listening side's ChannelSelect descriptor covers it.  getEvent() then
+// returns NULL, and deleting the channel drops the last mapping of the
+// segment, whose name was unlinked as soon as it was created.
+
+class ShmEventChannel : public EventChannel {
+  public:
+	struct Ring;
+	struct Segment;
+
+    ShmEventChannel( AllocFuncPtr, std::string config, std::string name = "" );
+    ~ShmEventChannel();
+
+	// NULL if nothing on this node listens on the config's serverPort
+	static ShmEventChannel* connect( AllocFuncPtr, const std::string& config,
+												const std::string& name );
+
+    virtual Event* getEvent( bool blocking = true );
+    virtual bool sendEvent( Event* );
+	virtual EventChannel* accept();
+	virtual int getFd();
+	virtual bool pending();
+
+  private:
+    ShmEventChannel( AllocFuncPtr, Segment*, int fd[2], int sock, int side,
+												std::string name );
+	bool wait( Ring* );
+	bool takeFrame( Ring*, uint32_t& word );
+	bool putFrame( Ring*, uint32_t word, const unsigned char*, size_t );
+	bool peerGone();
+	bool broken( const char* );
+
+	int			m_listenFd;
+	Segment*	m_seg;
+	int			m_side;
+	int			m_efd[2];
+	int			m_sock;
+	int			m_pollFd;
+	bool		m_broken;
+	SerialBuf	m_decodeBuf;
+	SerialBuf	m_encodeBuf;
+};
+
+#endif
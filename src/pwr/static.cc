@@ -9,25 +9,96 @@
  * distribution.
 */
 
-#include "cntxt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pwr_config.h"
+#include "distCntxt.h"
 #include "debug.h"
+#include "pwrdev.h"
 
 using namespace PowerAPI;
 
-extern "C" {
-	getDevFuncPtr_t PowerInsight_getDev(); 
-}
+// Plugins linked into libpwr, see PWR_STATIC_PLUGIN in plugins/pwr_dev.h.
+// Plugins that predate version 2 have no getDevVersion.
 
-plugin_dev_t* Cntxt::getDev( std::string lib, std::string name )
-{
-    DBGX("lib %s name=`%s`\n", lib.c_str(), name.c_str() );
-#if 0
-#ifdef  HAVE_POWER_INSIGHT	
-	if ( ! name.compare("PowerInsight") ) {
-		getDevFuncPtr_t tmp = PowerInsight_getDev;
-		return tmp; 
-	}
+#define PLUGIN_V1( NAME ) \
+	extern "C" plugin_dev_t* NAME##_getDev();
+#define PLUGIN( NAME ) \
+	extern "C" plugin_dev_t* NAME##_getDev(); \
+	extern "C" int NAME##_getDevVersion();
+
+PLUGIN_V1( pwr_rapldev )
+PLUGIN( pwr_powercapdev )
+PLUGIN_V1( pwr_apmdev )
+PLUGIN_V1( pwr_xtpmdev )
+PLUGIN_V1( pwr_pmcdev )
+PLUGIN_V1( pwr_wudev )
+PLUGIN_V1( pwr_cpudev )
+PLUGIN( pwr_tracedev )
+PLUGIN( dummy_dev )
+#if HAVE_POWERGADGET
+PLUGIN_V1( pwr_pgdev )
+#endif
+#if HAVE_PIAPI
+PLUGIN_V1( pwr_piapidev )
+#endif
+#if HAVE_POWERINSIGHT
+PLUGIN_V1( pwr_pidev )
+#endif
+
+#undef PLUGIN_V1
+#undef PLUGIN
+#define PLUGIN_V1( NAME ) { "lib" #NAME, NAME##_getDev, NULL },
+#define PLUGIN( NAME ) { "lib" #NAME, NAME##_getDev, NAME##_getDevVersion },
+
+static struct {
+	const char*				lib;
+	getDevFuncPtr_t			getDev;
+	getDevVersionFuncPtr_t	getDevVersion;
+} _plugins[] = {
+	PLUGIN_V1( pwr_rapldev )
+	PLUGIN( pwr_powercapdev )
+	PLUGIN_V1( pwr_apmdev )
+	PLUGIN_V1( pwr_xtpmdev )
+	PLUGIN_V1( pwr_pmcdev )
+	PLUGIN_V1( pwr_wudev )
+	PLUGIN_V1( pwr_cpudev )
+	PLUGIN( pwr_tracedev )
+	PLUGIN( dummy_dev )
+#if HAVE_POWERGADGET
+	PLUGIN_V1( pwr_pgdev )
 #endif
+#if HAVE_PIAPI
+	PLUGIN_V1( pwr_piapidev )
 #endif
-    return NULL;
+#if HAVE_POWERINSIGHT
+	PLUGIN_V1( pwr_pidev )
+#endif
+};
+
+// The configuration names a plugin by library, so match on the library's 
+// file name without directory or suffix, e.g. "libdummy_dev".
+plugin_dev_t* DistCntxt::getDev( std::string lib, std::string name )
+{
+	DBGX("lib %s name=`%s`\n", lib.c_str(), name.c_str() );
+
+	size_t pos = lib.find_last_of( '/' );
+	if ( std::string::npos != pos ) {
+		lib = lib.substr( pos + 1 );
+	}
+	lib = lib.substr( 0, lib.find_first_of( '.' ) );
+
+	for ( unsigned i = 0; i < sizeof(_plugins)/sizeof(_plugins[0]); i++ ) {
+		if ( 0 == lib.compare( _plugins[i].lib ) ) {
+			plugin_dev_t* dev = _plugins[i].getDev();
+			m_pluginVersionMap[ dev ] = _plugins[i].getDevVersion ?
+									_plugins[i].getDevVersion() : 1;
+			return dev;
+		}
+	}
+
+	printf("error: plugin library `%s` is not linked into libpwr\n", 
+															lib.c_str());
+	exit(-1);
 }
@@ -11,6 +11,7 @@
 
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -19,8 +20,13 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <iostream>
+#include <algorithm>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "tcpEventChannel.h" 
 #include "events.h"
@@ -29,8 +35,17 @@
 static void split( const std::string &str, 
             std::map<std::string,std::string>& foo );
 
+// a client that finds nobody listening tries again after CONNECT_MIN_MS,
+// doubling the wait up to CONNECT_MAX_MS, and gives up after
+// CONNECT_TIMEOUT_MS
+#define CONNECT_MIN_MS 1
+#define CONNECT_MAX_MS 256
+#define CONNECT_TIMEOUT_MS 60000
+
 TcpEventChannel::TcpEventChannel( AllocFuncPtr func, std::string config, std::string name ) : 
-	EventChannel( func, name ), m_fd( -1 ) 
+	EventChannel( func, name ), m_fd( -1 ), m_connFd( -1 ), m_queued( false ),
+	m_broken( false ), m_version( PROTO_VERSION_FIXED ), m_inPos( 0 ), 
+	m_inLen( 0 )
 {
     std::map<std::string,std::string> foo;
 
@@ -43,22 +58,70 @@ TcpEventChannel::TcpEventChannel( AllocFuncPtr func, std::string config, std::st
 	} else {
 		m_clientServer = foo["server"];
 		m_clientServerPort = foo["serverPort"];
+		// connect in the background, the first send or receive waits
+		m_connFd = startConnect();
 	}
 }
 
-int TcpEventChannel::xx()
+static long elapsedMs( struct timespec& start )
 {
-	int fd;
-	int count = 60;
-	do { 
-		fd = initClient( m_clientServer, m_clientServerPort );
-	} while ( fd < 0 && count-- && sleep(1) == 0  );
-	DBGX2(DBG_EC,"client fd=%d\n",fd);
-	return fd;
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return ( now.tv_sec - start.tv_sec ) * 1000 + 
+						( now.tv_nsec - start.tv_nsec ) / 1000000;
+}
+
+// Finish the connect the constructor started.  While nobody listens yet,
+// the router may still be starting, try again with backoff.
+int TcpEventChannel::waitConnect()
+{
+	struct timespec start;
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	long delay = CONNECT_MIN_MS;
+
+	while ( 1 ) {
+		if ( -1 == m_connFd ) {
+			m_connFd = startConnect();
+		}
+		if ( m_connFd > -1 ) {
+			struct pollfd pfd;
+			pfd.fd = m_connFd;
+			pfd.events = POLLOUT;
+			long timeout = CONNECT_TIMEOUT_MS - elapsedMs( start );
+			int rc = ::poll( &pfd, 1, timeout > 0 ? timeout : 0 ); 
+
+			int err = -1;
+			socklen_t len = sizeof(err);
+			if ( rc > 0 ) {
+				getsockopt( m_connFd, SOL_SOCKET, SO_ERROR, &err, &len );
+			}
+			if ( 0 == err ) {
+				int fd = m_connFd;
+				m_connFd = -1;
+				fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) & ~O_NONBLOCK );
+				DBGX2(DBG_EC,"client fd=%d after %ld ms\n",fd,
+												elapsedMs( start ));
+				return fd;
+			}
+			::close( m_connFd );
+			m_connFd = -1;
+		}
+
+		if ( elapsedMs( start ) + delay >= CONNECT_TIMEOUT_MS ) {
+			fprintf(stderr,"Error: %s can't connect to %s:%s\n",
+						getName().c_str(), m_clientServer.c_str(),
+						m_clientServerPort.c_str() );
+			return -1;
+		}
+		usleep( delay * 1000 );
+		delay = std::min( delay * 2, (long) CONNECT_MAX_MS );
+	}
 }
 
 TcpEventChannel::TcpEventChannel( AllocFuncPtr func, int fd, std::string name ) : 
-	EventChannel( func, name ), m_fd( fd )
+	EventChannel( func, name ), m_fd( fd ), m_connFd( -1 ), m_queued( false ),
+	m_broken( false ), m_version( PROTO_VERSION_FIXED ), m_inPos( 0 ), 
+	m_inLen( 0 )
 {
 	DBGX2(DBG_EC,"%s fd=%d\n",getName().c_str(),m_fd);
 }
@@ -66,37 +129,81 @@ TcpEventChannel::TcpEventChannel( AllocFuncPtr func, int fd, std::string name )
 TcpEventChannel::~TcpEventChannel( ) 
 {
 	DBGX2(DBG_EC,"%s fd=%d\n",getName().c_str(),m_fd);
+	while ( ! m_outQ.empty() ) {
+		delete m_outQ.front();
+		m_outQ.pop_front();
+	}
+	while ( ! m_freeBufs.empty() ) {
+		delete m_freeBufs.back();
+		m_freeBufs.pop_back();
+	}
 	if ( m_fd > -1 ) ::close( m_fd );
+	if ( m_connFd > -1 ) ::close( m_connFd );
 }
-int TcpEventChannel::initClient( std::string hostname, std::string portStr )
+// names are looked up once per process, every channel to the router from
+// the threads of a daemon resolves the same host
+static bool resolve( const std::string& hostname, struct in_addr& addr )
+{
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	static std::map< std::string, struct in_addr > cache;
+
+	pthread_mutex_lock( &lock );
+	std::map< std::string, struct in_addr >::iterator iter = 
+											cache.find( hostname );
+	if ( iter == cache.end() ) {
+		struct addrinfo hints;
+		struct addrinfo* res;
+		memset( &hints, 0, sizeof(hints) );
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+
+		if ( 0 == getaddrinfo( hostname.c_str(), NULL, &hints, &res ) ) {
+			iter = cache.insert( std::make_pair( hostname, 
+					((struct sockaddr_in*)res->ai_addr)->sin_addr ) ).first;
+			freeaddrinfo( res );
+		}
+	}
+	bool found = iter != cache.end();
+	if ( found ) {
+		addr = iter->second;
+	}
+	pthread_mutex_unlock( &lock );
+	return found;
+}
+
+// a non-blocking socket with its connect under way, -1 if it failed
+int TcpEventChannel::startConnect()
 {
 	DBGX2(DBG_EC,"\n");
-	unsigned short port = atoi( portStr.c_str() );
+	unsigned short port = atoi( m_clientServerPort.c_str() );
 	struct sockaddr_in serv_addr;
-	struct hostent *he;
-	int fd;
 
-	fd = socket( AF_INET, SOCK_STREAM, 0 );
+    memset(&serv_addr, 0, sizeof(serv_addr));
+	if ( ! resolve( m_clientServer, serv_addr.sin_addr ) ) {
+		DBGX2(DBG_EC,"can't resolve %s\n",m_clientServer.c_str());
+		return -1;
+	}
+	serv_addr.sin_family = AF_INET;
+	serv_addr.sin_port = htons( port );
+
+	int fd = socket( AF_INET, SOCK_STREAM, 0 );
 	assert( fd >= 0 );
 
     int flag = 1;
     int rc = setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag) );
     assert( rc == 0 );
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
 
-	he = gethostbyname( hostname.c_str() );
-	assert( he );
-
-    memset(&serv_addr, 0, sizeof(serv_addr));
-	memcpy(&serv_addr.sin_addr, he->h_addr_list[0], he->h_length ); 
-
-	serv_addr.sin_family = AF_INET;
-	serv_addr.sin_port = htons( port );
-
-	int ret = connect( fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)); 	
+	int ret = ::connect( fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)); 	
 
-	DBGX2(DBG_EC,"host=%s serverPort=%d fd=%d\n",hostname.c_str(),port,ret);
+	DBGX2(DBG_EC,"host=%s serverPort=%d ret=%d\n",m_clientServer.c_str(),
+											port,ret);
 
-	return ret == 0 ? fd : -1; 
+	if ( ret < 0 && EINPROGRESS != errno ) {
+		::close( fd );
+		return -1;
+	}
+	return fd; 
 }
 
 int TcpEventChannel::initServer( std::string portStr )
@@ -155,6 +262,12 @@ EventChannel* TcpEventChannel::accept( )
 	
 	return new TcpEventChannel( m_allocFunc, cliFd, getName() + "-recv" );
 }
+// a fixed width frame has a size_t length, a compact frame a uint32_t
+#define HDR_LEN ( sizeof(uint32_t) + sizeof(size_t) )
+#define HDR_LEN_V1 ( sizeof(uint32_t) + sizeof(uint32_t) )
+#define MAX_IOV 64
+#define RECV_LEN ( 64 * 1024 )
+
 #if 1 
 #define print(x,y)
 #else
@@ -174,35 +287,118 @@ static void _print( unsigned char* buf, size_t len )
 }
 #endif
 
+// length of the frame at the front of the receive buffer, 0 if its header
+// has not arrived yet
+size_t TcpEventChannel::frameLength()
+{
+	uint32_t word;
+	if ( m_inLen - m_inPos < sizeof(word) ) {
+		return 0;
+	}
+	memcpy( &word, &m_inBuf[ m_inPos ], sizeof(word) );
+
+	if ( FRAME_VERSION( word ) >= PROTO_VERSION_COMPACT ) {
+		uint32_t length;
+		if ( m_inLen - m_inPos < HDR_LEN_V1 ) {
+			return 0;
+		}
+		memcpy( &length, &m_inBuf[ m_inPos + sizeof(word) ], sizeof(length) );
+		return HDR_LEN_V1 + length;
+	} else {
+		size_t length;
+		if ( m_inLen - m_inPos < HDR_LEN ) {
+			return 0;
+		}
+		memcpy( &length, &m_inBuf[ m_inPos + sizeof(word) ], sizeof(length) );
+		return HDR_LEN + length;
+	}
+}
+
+bool TcpEventChannel::pending()
+{
+	size_t length = frameLength();
+	return length && m_inLen - m_inPos >= length;
+}
+
+// one recv of whatever the kernel has, after moving a partial frame to the
+// front and making room for all of it
+ssize_t TcpEventChannel::fill()
+{
+	if ( m_inPos ) {
+		memmove( &m_inBuf[0], &m_inBuf[m_inPos], m_inLen - m_inPos );
+		m_inLen -= m_inPos;
+		m_inPos = 0;
+	}
+
+	size_t need = frameLength();
+	if ( need < m_inLen + RECV_LEN ) {
+		need = m_inLen + RECV_LEN;
+	}
+	if ( m_inBuf.size() < need ) {
+		m_inBuf.resize( need );
+	}
+
+	ssize_t nbytes;
+	do {
+		nbytes = ::recv( m_fd, &m_inBuf[m_inLen], m_inBuf.size() - m_inLen, 0 );
+	} while ( nbytes < 0 && EINTR == errno );
+
+	if ( nbytes > 0 ) {
+		print( &m_inBuf[m_inLen], nbytes );
+		m_inLen += nbytes;
+	}
+	return nbytes;
+}
+
 Event* TcpEventChannel::getEvent( bool blocking ) 
 {
 //	printf("%s() waiting\n",__func__); getchar();
 	if ( -1 == m_fd ) {
-		m_fd = xx();
+		m_fd = waitConnect();
 	}
 
-	EventType type;
-	size_t nbytes = read( m_fd, &type, sizeof(type) );
-	print( (unsigned char*) &type, nbytes );
-		
-	if ( 0 == nbytes ) {
+	// a write failed, the owner closes the channel as if a read had
+	if ( m_broken ) {
 		return NULL;
 	}
-	assert( nbytes == sizeof(type) );
 
-	size_t length;
-	nbytes = read( m_fd, &length, sizeof(length) );
-	assert( nbytes == sizeof(length) );
-	print( (unsigned char*) &length, nbytes );
+	while ( ! pending() ) {
+		if ( fill() <= 0 ) {
+			return NULL;
+		}
+	}
 
+	uint32_t word;
+	memcpy( &word, &m_inBuf[m_inPos], sizeof(word) );
+	unsigned int version = FRAME_VERSION( word );
+	size_t hdrLen = version >= PROTO_VERSION_COMPACT ? HDR_LEN_V1 : HDR_LEN; 
+	size_t length = frameLength() - hdrLen;
 
-	SerialBuf buf(length);	
-	nbytes = read( m_fd, buf.addr(), buf.length() );
-	assert( nbytes == buf.length() );
-	print( (unsigned char*) buf.addr(), nbytes );
+	if ( version > PROTO_VERSION ) {
+		fprintf(stderr,"Error: %s received encoding version %u\n",
+						getName().c_str(), version );
+		return NULL;
+	}
+	// the peer reads what it sends, a peer that predates versions reads
+	// nothing else
+	if ( PROTO_VERSION_NONE == version && m_version != version ) {
+		DBGX2(DBG_EC,"%s original encoding\n",getName().c_str() );
+		m_version = version;
+	} else if ( version > m_version ) {
+		DBGX2(DBG_EC,"%s version %u\n",getName().c_str(), version );
+		m_version = version;
+	}
 
+	// the decode buffer is reused, events copy out what they keep
+	m_decodeBuf.clear();
+	m_decodeBuf.version = version;
+	m_decodeBuf.out( &m_inBuf[ m_inPos + hdrLen ], length );
+	m_inPos += hdrLen + length;
+	if ( m_inPos < m_inLen ) {
+		notify();
+	}
 
-	Event* ev =m_allocFunc( type, buf );
+	Event* ev =m_allocFunc( FRAME_TYPE( word ), m_decodeBuf );
 
 	DBGX2(DBG_EC2,"%s event type %d, length=%lu \n",getName().c_str(), 
 						ev->type, length);
@@ -214,29 +410,132 @@ bool TcpEventChannel::sendEvent( Event* event )
 {
 //	printf("%s() waiting\n",__func__); getchar();
 	if ( -1 == m_fd ) {
-		m_fd = xx();
+		m_fd = waitConnect();
 	}
 
-	SerialBuf buf;
-	event->serialize_out(buf);
-
-	size_t nbytes = write( m_fd, &event->type, sizeof(event->type) ); 
-	assert( nbytes == sizeof(event->type) );
-	print( (unsigned char*) &event->type, nbytes );
-
-	size_t length = buf.length(); 
-	nbytes = write( m_fd, &length, sizeof(length) ); 
-	assert( nbytes == sizeof(length) );
-	print( (unsigned char*) &length, nbytes );
-	
-	nbytes = write( m_fd, buf.addr(), buf.length() ); 
-	assert( nbytes == buf.length() );
-	print( (unsigned char*) buf.addr(), nbytes );
+	// the type and length header is encoded in front of the event so a
+	// frame is one contiguous buffer
+	SerialBuf* buf;
+	if ( m_freeBufs.empty() ) {
+		buf = new SerialBuf;
+		buf->reserve( HDR_LEN + 256 );
+	} else {
+		buf = m_freeBufs.back();
+		m_freeBufs.pop_back();
+		buf->clear();
+	}
+	uint32_t word = FRAME_WORD( event->type, m_version );
+	size_t hdrLen = m_version >= PROTO_VERSION_COMPACT ? HDR_LEN_V1 : HDR_LEN; 
+	size_t length = 0;
+	buf->out( &word, sizeof(word) );
+	buf->out( &length, hdrLen - sizeof(word) );
+
+	buf->version = m_version;
+	event->serialize_out(*buf);
+
+	length = buf->length() - hdrLen; 
+	if ( m_version >= PROTO_VERSION_COMPACT ) {
+		uint32_t length32 = length;
+		memcpy( (char*) buf->addr() + sizeof(word), &length32, sizeof(length32) );
+	} else {
+		memcpy( (char*) buf->addr() + sizeof(word), &length, sizeof(length) );
+	}
 
 	DBGX2(DBG_EC2,"%s event type %d, length=%lu \n",getName().c_str(), 
 						event->type, length);
 
-    return true;
+	m_outQ.push_back( buf );
+	if ( m_queued ) {
+		notify();
+		return true;
+	}
+	if ( ! flush() ) {
+		notify();
+		return false;
+	}
+	return true;
+}
+
+bool TcpEventChannel::flush()
+{
+	struct iovec iov[ MAX_IOV ];
+
+	while ( ! m_outQ.empty() ) {
+		if ( m_broken ) {
+			while ( ! m_outQ.empty() ) {
+				delete m_outQ.front();
+				m_outQ.pop_front();
+			}
+			return false;
+		}
+		unsigned int cnt = 0;
+		while ( cnt < m_outQ.size() && cnt < MAX_IOV ) {
+			iov[cnt].iov_base = m_outQ[cnt]->addr();
+			iov[cnt].iov_len = m_outQ[cnt]->length();
+			print( (unsigned char*) iov[cnt].iov_base, iov[cnt].iov_len );
+			++cnt;
+		}
+
+		bool ok = writeAll( iov, cnt );
+
+		for ( unsigned int i = 0; i < cnt; i++ ) {
+			if ( m_freeBufs.size() < MAX_IOV ) {
+				m_freeBufs.push_back( m_outQ.front() );
+			} else {
+				delete m_outQ.front();
+			}
+			m_outQ.pop_front();
+		}
+		if ( ! ok ) {
+			m_broken = true;
+		}
+	}
+	return ! m_broken;
+}
+
+// a peer that went away fails the send instead of raising SIGPIPE
+bool TcpEventChannel::writeAll( struct iovec* iov, int cnt )
+{
+	while ( cnt ) {
+		struct msghdr msg;
+		memset( &msg, 0, sizeof(msg) );
+		msg.msg_iov = iov;
+		msg.msg_iovlen = cnt;
+		ssize_t nbytes = ::sendmsg( m_fd, &msg, MSG_NOSIGNAL );
+		if ( nbytes < 0 ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			DBGX2(DBG_EC,"%s sendmsg failed %s\n",getName().c_str(),
+						strerror(errno));
+			return false;
+		}
+		// skip what went out, the kernel may take part of an iovec
+		while ( cnt && (size_t) nbytes >= iov->iov_len ) {
+			nbytes -= iov->iov_len;
+			++iov;
+			--cnt;
+		}
+		if ( cnt ) {
+			iov->iov_base = (char*) iov->iov_base + nbytes;
+			iov->iov_len -= nbytes;
+		}
+	}
+	return true;
+}
+
+void TcpEventChannel::setVersion( unsigned int version )
+{
+	m_version = version < PROTO_VERSION ? version : PROTO_VERSION;
+	DBGX2(DBG_EC,"%s version %u\n",getName().c_str(), m_version );
+}
+
+void TcpEventChannel::setOutputQueue( bool queued )
+{
+	m_queued = queued;
+	if ( ! m_queued ) {
+		flush();
+	}
 }
 
 /************************************************************************/
@@ -297,7 +596,17 @@ ChannelSelect::Data* TcpChannelSelect::wait()
     int     fdmax = 0;;
     fd_set  read_fds;
     fd_set  write_fds;
-	EventChannel* chan;
+	EventChannel* chan = NULL;
+
+	// send what the last iteration queued before going to sleep, and
+	// hand out frames already read off a socket, they do not wake up select,
+	// and channels whose send failed, their owner reads nothing and closes
+	std::map<EventChannel*,Data*>::iterator iter = m_chanMap.begin();
+	for ( ; iter != m_chanMap.end(); ++iter ) {
+		if ( ! iter->first->flush() || iter->first->pending() ) {
+			return iter->second;
+		}
+	}
 
 	std::map< int, EventChannel* > fdMap;
 	do {
@@ -307,11 +616,11 @@ ChannelSelect::Data* TcpChannelSelect::wait()
 		std::map<EventChannel*,Data*>::iterator iter = m_chanMap.begin();
 
 		while ( iter != m_chanMap.end() ) {
-    		int fd = static_cast<TcpEventChannel*>(iter->first)->getFd();
+    		int fd = iter->first->getFd();
 
 			if ( fd > -1 ) {
 				DBGX2(DBG_EC,"fd=%d %s\n",fd, 
-					static_cast<TcpEventChannel*>(iter->first)->getName().c_str());
+					iter->first->getName().c_str());
     			fdmax = fd > fdmax ? fd : fdmax; 
     			FD_SET( fd, &read_fds );
     			FD_SET( fd, &write_fds );
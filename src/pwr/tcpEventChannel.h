@@ -16,7 +16,13 @@
 #include <string>
 #include <map>
 #include <set>
+#include <deque>
+#include <vector>
+#include <sys/types.h>
 #include <eventChannel.h>
+#include <serialize.h>
+
+struct iovec;
 
 class TcpEventChannel : public EventChannel {
   public:
@@ -30,12 +36,32 @@ class TcpEventChannel : public EventChannel {
 
     int getFd( ) { return m_fd; } 
 
+	virtual bool flush();
+	virtual void setOutputQueue( bool );
+	virtual bool pending();
+	virtual void setVersion( unsigned int );
+	virtual unsigned int getVersion() { return m_version; }
+
   private:
-	int initClient( std::string hostname, std::string port);
+	int startConnect();
+	int waitConnect();
 	int initServer( std::string port );
     int setupRecv( int port );
-	int xx();
+	bool writeAll( struct iovec*, int );
+	size_t frameLength();
+	ssize_t fill();
     int         m_fd;
+	int			m_connFd;
+	bool		m_queued;
+	bool		m_broken;
+	unsigned int m_version;
+	std::deque<SerialBuf*> m_outQ;
+	std::vector<SerialBuf*> m_freeBufs;
+	SerialBuf	m_decodeBuf;
+
+	std::vector<unsigned char> m_inBuf;
+	size_t		m_inPos;
+	size_t		m_inLen;
 	std::string m_clientServer;
 	std::string m_clientServerPort;
 };
@@ -77,6 +77,39 @@ PWR_ObjType XmlConfig::objType( const std::string name )
 	return elm ?  getType( elm ) : PWR_OBJ_INVALID;
 }
 
+int XmlConfig::findObjIndex( const std::string name )
+{
+	indexObjects();
+	std::map< std::string, int >::iterator iter = m_objIndex.find( name );
+	return iter != m_objIndex.end() ? iter->second : -1;
+}
+
+std::string XmlConfig::findObjName( int index )
+{
+	indexObjects();
+	if ( index < 0 || index >= (int) m_objNames.size() ) {
+		return "";
+	}
+	return m_objNames[index];
+}
+
+void XmlConfig::indexObjects()
+{
+	if ( ! m_objNames.empty() ) return;
+
+	XMLNode* node = findNodes1stChild( m_systemNode->FirstChild(), "Objects" );
+
+	while ( node ) {
+        XMLElement* elm = static_cast<XMLElement*>(node);
+
+		m_objIndex[ elm->Attribute("name") ] = m_objNames.size();
+		m_objNames.push_back( elm->Attribute("name") );
+
+        node = node->NextSibling();
+	}
+	DBGX2(DBG_CONFIG,"%lu objects\n", m_objNames.size() );
+}
+
 PWR_ObjType XmlConfig::getType( XMLElement* elm )
 {
 	return objTypeStrToInt( elm->Attribute("type") );
@@ -12,6 +12,9 @@
 #ifndef _PWR_XMLCONFIG_H
 #define _PWR_XMLCONFIG_H
 
+#include <map>
+#include <vector>
+
 #include "pwrtypes.h"
 #include "config.h"
 #include "tinyxml2.h"
@@ -39,6 +42,8 @@ class XmlConfig : public Config {
 	virtual bool hasServer( std::string );
 	bool hasObject( const std::string name );
 	PWR_ObjType objType( const std::string );
+	int findObjIndex( const std::string );
+	std::string findObjName( int );
 	void print( std::ostream& );
 
   private:
@@ -56,9 +61,13 @@ class XmlConfig : public Config {
 	std::string attrNameToString( PWR_AttrName );
 	PWR_ObjType objTypeStrToInt( const std::string );
 	std::string objTypeToString( PWR_ObjType type );
+	void indexObjects();
 
 	XMLDocument* 	m_xml;
 	XMLNode* 		m_systemNode;
+
+	std::vector< std::string >		m_objNames;
+	std::map< std::string, int >	m_objIndex;
 };
 
 }
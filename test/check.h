@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/*
+ * Scaffolding of the unit checks run by make check.  A check prints each
+ * condition with its outcome and returns checkResults() from main(), 77
+ * when it cannot run here, which make check reports as a skip.
+ */
+
+static int failures;
+
+/* X is evaluated once, it may have side effects */
+#define CHECK( X ) \
+    do { \
+        int check_ok = (X) ? 1 : 0; \
+        printf( "\t%s: %s\n", #X, check_ok ? "SUCCESS" : "FAILURE" ); \
+        if( !check_ok ) failures++; \
+    } while( 0 )
+
+#define CHECK_SKIPPED 77
+
+static inline void checkBegin( const char* name )
+{
+    printf( "Instantiating %s check\n", name );
+}
+
+static inline int checkSkip( const char* name, const char* why )
+{
+    printf( "Results from %s check: SKIPPED (%s)\n", name, why );
+    return CHECK_SKIPPED;
+}
+
+static inline int checkResults( const char* name )
+{
+    printf( "Results from %s check: %s\n", name,
+        failures ? "FAILURE" : "SUCCESS" );
+    return failures != 0;
+}
+
+#endif
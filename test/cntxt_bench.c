@@ -0,0 +1,149 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Cost of a context over a configuration with many devices.  The
+ * configuration is a platform of nodes, each with a device of its own
+ * from the dummy plugin, and the platform's power the sum of theirs.
+ * Each round creates a context, reads the platform's power, which loads
+ * the plugin and opens every device, and destroys the context.  One round
+ * is run untimed first so the plugin library and the configuration file
+ * are already in memory when the timed rounds run.
+ *
+ * usage: cntxt_bench nodes [rounds]
+ *
+ * Not part of make check, build it with make cntxt_bench.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <pwr.h>
+
+static char dir[64], configFile[128];
+
+static int writeConfig( int nodes )
+{
+    FILE *fp = fopen( configFile, "w" );
+    int i;
+
+    if( fp == 0x0 )
+        return -1;
+
+    fprintf( fp, "<?xml version=\"1.0\"?>\n<System>\n<Plugins>\n"
+        "    <plugin name=\"Dummy\" lib=\"" PLUGIN_DIR "/libdummy_dev\"/>\n"
+        "</Plugins>\n<Devices>\n" );
+    for( i = 0; i < nodes; i++ )
+        fprintf( fp, "    <device name=\"Dummy-node%d\" plugin=\"Dummy\" "
+            "initString=\"node%d\"/>\n", i, i );
+    fprintf( fp, "</Devices>\n<Objects>\n<obj name=\"plat\" type=\"Platform\">\n"
+        "    <attributes>\n        <attr name=\"POWER\" op=\"SUM\">\n" );
+    for( i = 0; i < nodes; i++ )
+        fprintf( fp, "            <src type=\"child\" name=\"node%d\"/>\n", i );
+    fprintf( fp, "        </attr>\n    </attributes>\n    <children>\n" );
+    for( i = 0; i < nodes; i++ )
+        fprintf( fp, "        <child name=\"node%d\"/>\n", i );
+    fprintf( fp, "    </children>\n</obj>\n" );
+    for( i = 0; i < nodes; i++ )
+        fprintf( fp, "<obj name=\"plat.node%d\" type=\"Node\">\n"
+            "    <devices> <dev name=\"dev1\" device=\"Dummy-node%d\" "
+            "openString=\"node%d\"/> </devices>\n"
+            "    <attributes>\n        <attr name=\"POWER\" op=\"SUM\"> "
+            "<src type=\"device\" name=\"dev1\"/> </attr>\n"
+            "    </attributes>\n</obj>\n", i, i, i );
+    fprintf( fp, "</Objects>\n</System>\n" );
+
+    return fclose( fp );
+}
+
+static double now( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/* init, first read and destroy of one context, in usecs */
+static int timeContext( double times[3] )
+{
+    PWR_Cntxt cntxt;
+    PWR_Obj plat;
+    PWR_Time ts;
+    double value, start;
+    int rc;
+
+    start = now();
+    if( PWR_CntxtInit( PWR_CNTXT_DEFAULT, PWR_ROLE_APP, "App", &cntxt ) != PWR_RET_SUCCESS )
+        return -1;
+    times[0] += now() - start;
+
+    start = now();
+    PWR_CntxtGetEntryPoint( cntxt, &plat );
+    rc = PWR_ObjAttrGetValue( plat, PWR_ATTR_POWER, &value, &ts );
+    times[1] += now() - start;
+
+    start = now();
+    PWR_CntxtDestroy( cntxt );
+    times[2] += now() - start;
+
+    return rc == PWR_RET_SUCCESS ? 0 : -1;
+}
+
+int main( int argc, char* argv[] )
+{
+    double times[3] = { 0, 0, 0 };
+    int nodes, rounds, i, rc = 0;
+
+    if( argc != 2 && argc != 3 ) {
+        fprintf( stderr, "usage: %s nodes [rounds]\n", argv[0] );
+        return 1;
+    }
+    nodes = atoi( argv[1] );
+    rounds = argc == 3 ? atoi( argv[2] ) : 10;
+    if( nodes <= 0 || rounds <= 0 ) {
+        fprintf( stderr, "bad node or round count\n" );
+        return 1;
+    }
+
+    strcpy( dir, "/tmp/cntxtbenchXXXXXX" );
+    if( mkdtemp( dir ) == 0x0 ) {
+        perror( "mkdtemp" );
+        return 1;
+    }
+    sprintf( configFile, "%s/config.xml", dir );
+    if( writeConfig( nodes ) ) {
+        perror( configFile );
+        rmdir( dir );
+        return 1;
+    }
+    setenv( "POWERAPI_CONFIG", configFile, 1 );
+    setenv( "POWERAPI_ROOT", "plat", 1 );
+
+    if( timeContext( times ) ) {
+        fprintf( stderr, "context over %s failed\n", configFile );
+        rc = 1;
+    } else {
+        times[0] = times[1] = times[2] = 0;
+        for( i = 0; i < rounds && rc == 0; i++ )
+            rc = timeContext( times ) ? 1 : 0;
+        printf( "nodes=%d rounds=%d init %.0f us, first read %.0f us, "
+            "destroy %.0f us\n", nodes, rounds, times[0] / rounds,
+            times[1] / rounds, times[2] / rounds );
+    }
+
+    unlink( configFile );
+    rmdir( dir );
+    return rc;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Reproducibility of the dummy plugin: devices opened with the same seed
+ * on a dt clock read the same values, timestamps and injected failures,
+ * also when one of them is sampled by its logging thread in between, and
+ * a different seed reads differently.
+ */
+
+#include "pwrdev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+
+#define READS 200
+
+#define OPEN_STR "node0:jitter=20:fail=0.2:wave=walk:amp=2:period=0.5:dt=0.1:energy=mono"
+
+plugin_dev_t *getDev( void );
+
+typedef struct {
+    double power[READS], energy[READS];
+    PWR_Time ts[READS];
+    int rc[READS];
+} reads_t;
+
+static reads_t first, second, logged, other;
+
+/* READS reads alternating power and energy, sleeping on the way if logged */
+static int run( const char *openstr, reads_t *r, int logged )
+{
+    plugin_devops_t *dev = getDev()->init( "" );
+    pwr_fd_t fd;
+    PWR_Time ts;
+    int i;
+
+    if( dev == 0x0 )
+        return -1;
+    if( (fd = dev->open( dev, openstr )) == 0x0 ) {
+        getDev()->final( dev );
+        return -1;
+    }
+
+    if( logged )
+        dev->log_start( fd, PWR_ATTR_POWER );
+    for( i = 0; i < READS; i++ ) {
+        r->rc[i] = dev->read( fd, PWR_ATTR_POWER, &r->power[i], sizeof(double), &r->ts[i] );
+        if( r->rc[i] == PWR_RET_SUCCESS )
+            dev->read( fd, PWR_ATTR_ENERGY, &r->energy[i], sizeof(double), &ts );
+        if( logged && i % 20 == 0 )
+            usleep( 15000 );
+    }
+    if( logged )
+        dev->log_stop( fd, PWR_ATTR_POWER );
+
+    dev->close( fd );
+    getDev()->final( dev );
+    return 0;
+}
+
+/* timestamps count from when the device was opened, compare their steps */
+static int same( reads_t *a, reads_t *b )
+{
+    int i, base = -1;
+
+    for( i = 0; i < READS; i++ ) {
+        if( a->rc[i] != b->rc[i] )
+            return 0;
+        if( a->rc[i] != PWR_RET_SUCCESS )
+            continue;
+        if( base < 0 )
+            base = i;
+        if( a->power[i] != b->power[i] || a->energy[i] != b->energy[i] ||
+            a->ts[i] - a->ts[base] != b->ts[i] - b->ts[base] )
+            return 0;
+    }
+    return 1;
+}
+
+static int failed( reads_t *r )
+{
+    int i, n = 0;
+
+    for( i = 0; i < READS; i++ )
+        if( r->rc[i] != PWR_RET_SUCCESS )
+            n++;
+    return n;
+}
+
+int main( int argc, char* argv[] )
+{
+    checkBegin( "dummy device" );
+
+    CHECK( run( OPEN_STR ":seed=7", &first, 0 ) == 0 );
+    CHECK( run( OPEN_STR ":seed=7", &second, 0 ) == 0 );
+    CHECK( run( OPEN_STR ":seed=7", &logged, 1 ) == 0 );
+    CHECK( run( OPEN_STR ":seed=8", &other, 0 ) == 0 );
+
+    /* failures are injected, and at the same reads */
+    CHECK( failed( &first ) > 0 && failed( &first ) < READS );
+    CHECK( same( &first, &second ) );
+    CHECK( same( &first, &logged ) );
+    CHECK( ! same( &first, &other ) );
+
+    return checkResults( "dummy device" );
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * EventPool as the channels use it: responses decoded into released
+ * events, what the pool counts, what it keeps when more is released than
+ * it holds, and that once the first event's vectors have grown decoding
+ * and releasing allocates nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include "events.h"
+#include "eventPool.h"
+#include "check.h"
+
+#define LOOPS 10000
+
+typedef EventPool<CommRespEvent> Pool;
+
+// every allocation of the process, the library's included
+static unsigned long news;
+
+void* operator new( size_t size )
+{
+	++news;
+	void* ptr = malloc( size ? size : 1 );
+	if ( ! ptr ) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	free( ptr );
+}
+
+// a response of one group with num values and, if err, an error
+static void encode( SerialBuf& buf, unsigned int num, bool err )
+{
+	CommRespEvent resp;
+	resp.id = num;
+	resp.grpIndex = 0;
+	resp.value.resize( 1 );
+	resp.timeStamp.resize( 1 );
+	resp.count.resize( 1 );
+	resp.valueObj.resize( 1 );
+	for ( unsigned int i = 0; i < num; i++ ) {
+		resp.value[0].push_back( i );
+		resp.timeStamp[0].push_back( i * 10 );
+		resp.count[0].push_back( 1 );
+		resp.valueObj[0].push_back( NO_HANDLE );
+	}
+	if ( err ) {
+		resp.errValue.push_back( -1 );
+		resp.errAttr.push_back( PWR_ATTR_POWER );
+		resp.errObj.push_back( "plat.node0" );
+		resp.errHandle.push_back( NO_HANDLE );
+	}
+	buf.clear();
+	resp.serialize_out( buf );
+}
+
+static void checkReuse()
+{
+	SerialBuf big, small;
+	encode( big, 8, true );
+	encode( small, 2, false );
+
+	checkBegin( "reuse" );
+	uint64_t allocs = Pool::allocs();
+	uint64_t reuses = Pool::reuses();
+
+	big.rewind();
+	CommRespEvent* ev = Pool::get( big );
+	CHECK( 8 == ev->id && 8 == ev->value[0].size() && 1 == ev->errObj.size() );
+	ev->release();
+	CHECK( allocs + 1 == Pool::allocs() && reuses == Pool::reuses() );
+
+	// the event comes back, with nothing of the last message left in it
+	small.rewind();
+	CommRespEvent* again = Pool::get( small );
+	CHECK( again == ev );
+	CHECK( 2 == again->id && 2 == again->value[0].size() );
+	CHECK( 1 == again->value[0][1] && 10 == again->timeStamp[0][1] );
+	CHECK( again->errObj.empty() && again->errHandle.empty() );
+	again->release();
+	CHECK( allocs + 1 == Pool::allocs() && reuses + 1 == Pool::reuses() );
+}
+
+static void checkFull()
+{
+	SerialBuf buf;
+	encode( buf, 1, false );
+
+	checkBegin( "full pool" );
+	std::vector<CommRespEvent*> evs;
+	for ( unsigned int i = 0; i < EVENT_POOL_LEN + 10; i++ ) {
+		buf.rewind();
+		evs.push_back( Pool::get( buf ) );
+	}
+	for ( unsigned int i = 0; i < evs.size(); i++ ) {
+		evs[i]->release();
+	}
+
+	// only EVENT_POOL_LEN were kept, the rest were deleted
+	uint64_t allocs = Pool::allocs();
+	uint64_t reuses = Pool::reuses();
+	for ( unsigned int i = 0; i < evs.size(); i++ ) {
+		buf.rewind();
+		evs[i] = Pool::get( buf );
+	}
+	CHECK( reuses + EVENT_POOL_LEN == Pool::reuses() );
+	CHECK( allocs + 10 == Pool::allocs() );
+	for ( unsigned int i = 0; i < evs.size(); i++ ) {
+		evs[i]->release();
+	}
+}
+
+static void checkSteadyState()
+{
+	SerialBuf buf;
+	encode( buf, 8, true );
+
+	checkBegin( "steady state" );
+	buf.rewind();
+	Pool::get( buf )->release();
+
+	uint64_t allocs = Pool::allocs();
+	unsigned long before = news;
+	for ( unsigned int i = 0; i < LOOPS; i++ ) {
+		buf.rewind();
+		Pool::get( buf )->release();
+	}
+	printf( "\t%lu allocations in %d decodes\n", news - before, LOOPS );
+	CHECK( news == before );
+	CHECK( allocs == Pool::allocs() );
+}
+
+int main( int argc, char* argv[] )
+{
+	checkReuse();
+	checkFull();
+	checkSteadyState();
+
+	return checkResults( "EventPool" );
+}
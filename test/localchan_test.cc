@@ -0,0 +1,177 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * LocalEventChannel under concurrent senders: every wakeup of a 
+ * ChannelSelect finds an event to take, getEvent() never waits after one,
+ * and every event sent arrives once.  Connections queued on a listener
+ * all wake its ChannelSelect up.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "localEventChannel.h"
+#include "epollChannelSelect.h"
+#include "events.h"
+#include "check.h"
+
+#define NUM_SENDERS	4
+#define NUM_ROUNDS	100000
+#define BURST		2
+
+static EventChannel* s_send;
+static unsigned s_taken;
+
+// bursts of sends, each sender waits for the receiver to take everything
+// sent so far, a wakeup the receiver cannot take anything on then hangs it
+static void* sendAll( void* arg )
+{
+	CommReqEvent req;
+	req.commID = 42;
+	req.op = CommEvent::Get;
+	for ( unsigned round = 0; round < NUM_ROUNDS; round++ ) {
+		for ( unsigned i = 0; i < BURST; i++ ) {
+			req.grpIndex = round;
+			s_send->sendEvent( &req );
+		}
+		while ( __atomic_load_n( &s_taken, __ATOMIC_ACQUIRE ) < 
+								( round + 1 ) * BURST * NUM_SENDERS ) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static const char* s_hung;
+
+static void hung( int )
+{
+	printf( "\t%s: FAILURE\n", s_hung );
+	_exit( 1 );
+}
+
+static void checkWakeups()
+{
+	checkBegin( "local channel wakeup" );
+
+	LocalEventChannel listener( allocBaseEvent, "listenPort=localchan_test" );
+	s_send = LocalEventChannel::connect( allocBaseEvent, 
+				"server=localhost serverPort=localchan_test", "send" );
+	CHECK( NULL != s_send );
+	if ( NULL == s_send ) {
+		return;
+	}
+	EventChannel* recv = listener.accept();
+	CHECK( NULL != recv );
+
+	EpollChannelSelect sel;
+	ChannelSelect::Data data;
+	sel.addChannel( recv, &data );
+
+	pthread_t threads[NUM_SENDERS];
+	for ( int i = 0; i < NUM_SENDERS; i++ ) {
+		pthread_create( &threads[i], NULL, sendAll, NULL );
+	}
+
+	// one getEvent() per wakeup, as the router takes them
+	s_hung = "getEvent() blocked after a wakeup";
+	signal( SIGALRM, hung );
+	alarm( 60 );
+	uint64_t sum = 0;
+	unsigned num = 0;
+	unsigned empty = 0;
+	bool ok = true;
+	while ( num < NUM_SENDERS * NUM_ROUNDS * BURST ) {
+		ok = ok && &data == sel.wait();
+		if ( ! recv->pending() ) {
+			++empty;
+		}
+		Event* ev = recv->getEvent();
+		if ( NULL == ev ) {
+			ok = false;
+			break;
+		}
+		sum += static_cast<CommReqEvent*>( ev )->grpIndex;
+		__atomic_store_n( &s_taken, ++num, __ATOMIC_RELEASE );
+		delete ev;
+	}
+	alarm( 0 );
+
+	for ( int i = 0; i < NUM_SENDERS; i++ ) {
+		pthread_join( threads[i], NULL );
+	}
+	CHECK( ok );
+	CHECK( 0 == empty );
+	CHECK( NUM_SENDERS * NUM_ROUNDS * BURST == num );
+	CHECK( (uint64_t) NUM_SENDERS * BURST * NUM_ROUNDS * ( NUM_ROUNDS - 1 ) / 2 
+															== sum );
+	CHECK( ! recv->pending() );
+
+	// the sender going away is the last thing the receiver sees
+	sel.delChannel( recv );
+	delete s_send;
+	CHECK( NULL == recv->getEvent() );
+	delete recv;
+}
+
+#define NUM_CONNECTS 3
+
+// daemon threads starting together connect before the listener's owner
+// gets to accept any of them
+static void checkAccepts()
+{
+	checkBegin( "local channel accept" );
+
+	LocalEventChannel listener( allocBaseEvent, "listenPort=localchan_accept" );
+	EventChannel* send[ NUM_CONNECTS ];
+	for ( int i = 0; i < NUM_CONNECTS; i++ ) {
+		send[i] = LocalEventChannel::connect( allocBaseEvent, 
+				"server=localhost serverPort=localchan_accept", "send" );
+	}
+
+	EpollChannelSelect sel;
+	ChannelSelect::Data data;
+	sel.addChannel( &listener, &data );
+
+	// one accept() per wakeup, as the router takes them
+	s_hung = "queued connection did not wake the select up";
+	signal( SIGALRM, hung );
+	alarm( 10 );
+	bool ok = true;
+	EventChannel* recv[ NUM_CONNECTS ];
+	for ( int i = 0; i < NUM_CONNECTS; i++ ) {
+		ok = ok && &data == sel.wait();
+		recv[i] = listener.accept();
+		ok = ok && NULL != recv[i];
+	}
+	alarm( 0 );
+	CHECK( ok );
+	CHECK( ! listener.pending() );
+
+	sel.delChannel( &listener );
+	for ( int i = 0; i < NUM_CONNECTS; i++ ) {
+		delete send[i];
+		delete recv[i];
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	checkWakeups();
+	checkAccepts();
+
+	return checkResults( "local channel" );
+}
@@ -0,0 +1,195 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Object name ranges: patterns expand to the names they stand for, and
+ * names compressed to patterns expand back to the same names in the same
+ * order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "objRange.h"
+#include "check.h"
+
+static std::vector<std::string> expand( const std::string& pattern )
+{
+	std::vector<std::string> names;
+	ObjRange range( pattern );
+	std::string name;
+	while ( range.next( name ) ) {
+		names.push_back( name );
+	}
+	return names;
+}
+
+static std::vector<std::string> expand( const std::vector<std::string>& patterns )
+{
+	std::vector<std::string> names;
+	for ( size_t i = 0; i < patterns.size(); i++ ) {
+		std::vector<std::string> tmp = expand( patterns[i] );
+		names.insert( names.end(), tmp.begin(), tmp.end() );
+	}
+	return names;
+}
+
+static bool roundTrip( const std::vector<std::string>& names, 
+										size_t* numPatterns = NULL )
+{
+	std::vector<std::string> patterns;
+	if ( ! compressObjNames( names, patterns ) ) {
+		return false;
+	}
+	if ( numPatterns ) {
+		*numPatterns = patterns.size();
+	}
+	size_t size = 0;
+	for ( size_t i = 0; i < patterns.size(); i++ ) {
+		size += ObjRange( patterns[i] ).size();
+	}
+	return size == names.size() && expand( patterns ) == names;
+}
+
+static void checkExpand()
+{
+	checkBegin( "range expansion" );
+
+	std::vector<std::string> names = expand( "plat.cab[0-1].node[0-2]" );
+	CHECK( 6 == names.size() );
+	CHECK( "plat.cab0.node0" == names[0] );
+	CHECK( "plat.cab0.node2" == names[2] );
+	CHECK( "plat.cab1.node0" == names[3] );
+	CHECK( 6 == ObjRange( "plat.cab[0-1].node[0-2]" ).size() );
+
+	names = expand( "n[0-2,8,10-11]" );
+	CHECK( 6 == names.size() );
+	CHECK( "n8" == names[3] && "n11" == names[5] );
+
+	names = expand( "n[08-11]" );
+	CHECK( 4 == names.size() );
+	CHECK( "n08" == names[0] && "n09" == names[1] && "n11" == names[3] );
+
+	// a reversed range counts up
+	names = expand( "n[3-1]" );
+	CHECK( 3 == names.size() && "n1" == names[0] );
+
+	// not patterns, each is the one name
+	names = expand( "plat.node[a]" );
+	CHECK( 1 == names.size() && "plat.node[a]" == names[0] );
+	names = expand( "plat.node[1" );
+	CHECK( 1 == names.size() && "plat.node[1" == names[0] );
+	names = expand( "plat" );
+	CHECK( 1 == names.size() && "plat" == names[0] );
+
+	ObjRange range( "n[0-1]" );
+	std::string name;
+	while ( range.next( name ) );
+	range.rewind();
+	bool more = range.next( name );
+	CHECK( more && "n0" == name );
+}
+
+static void checkCompress()
+{
+	checkBegin( "name compression" );
+
+	std::vector<std::string> names = expand( "plat.cab[0-3].board[0-7].node[0-3]" );
+	std::vector<std::string> patterns;
+	CHECK( compressObjNames( names, patterns ) );
+	CHECK( 1 == patterns.size() );
+	CHECK( "plat.cab[0-3].board[0-7].node[0-3]" == patterns[0] );
+
+	// a hole splits the pattern, the order of the names is kept
+	names = expand( "plat.board[0-1].node[0-3]" );
+	names.erase( names.begin() + 5 );
+	size_t num;
+	CHECK( roundTrip( names, &num ) );
+	CHECK( num > 1 );
+
+	// out of order names stay in their order
+	names.clear();
+	names.push_back( "plat.node3" );
+	names.push_back( "plat.node1" );
+	names.push_back( "plat.node2" );
+	CHECK( roundTrip( names, &num ) );
+	CHECK( 2 == num );
+
+	// padding is part of the name, n08 and n10 do not share a field
+	names = expand( "n[08-12]" );
+	names.push_back( "n13" );
+	CHECK( compressObjNames( names, patterns ) );
+	CHECK( 2 == patterns.size() );
+	CHECK( "n[08-09]" == patterns[0] && "n[10-13]" == patterns[1] );
+	CHECK( roundTrip( names ) );
+
+	// numbers too long for a field stay text
+	names.clear();
+	names.push_back( "n12345678901" );
+	names.push_back( "n12345678902" );
+	CHECK( roundTrip( names, &num ) );
+	CHECK( 2 == num );
+
+	names.clear();
+	CHECK( roundTrip( names, &num ) && 0 == num );
+
+	names.push_back( "plat.node[0]" );
+	CHECK( ! compressObjNames( names, patterns ) );
+
+	// random subsets of a machine, in order
+	srand( 1 );
+	bool ok = true;
+	std::vector<std::string> all = expand( "plat.cab[0-2].board[0-3].node[0-7]" );
+	for ( int i = 0; i < 200 && ok; i++ ) {
+		names.clear();
+		int keep = rand() % 100;
+		for ( size_t j = 0; j < all.size(); j++ ) {
+			if ( rand() % 100 < keep ) {
+				names.push_back( all[j] );
+			}
+		}
+		ok = roundTrip( names );
+	}
+	CHECK( ok );
+}
+
+static void checkHandles()
+{
+	checkBegin( "handle compression" );
+
+	std::vector<ObjHandle> handles;
+	std::vector<ObjHandle> ranges;
+	handles.push_back( 3 );
+	handles.push_back( 4 );
+	handles.push_back( 5 );
+	handles.push_back( 9 );
+	handles.push_back( 2 );
+	handles.push_back( 3 );
+	compressHandles( handles, ranges );
+	CHECK( 6 == ranges.size() );
+	CHECK( 3 == ranges[0] && 3 == ranges[1] );
+	CHECK( 9 == ranges[2] && 1 == ranges[3] );
+	CHECK( 2 == ranges[4] && 2 == ranges[5] );
+
+	handles.clear();
+	compressHandles( handles, ranges );
+	CHECK( ranges.empty() );
+}
+
+int main( int argc, char* argv[] )
+{
+	checkExpand();
+	checkCompress();
+	checkHandles();
+
+	return checkResults( "object range" );
+}
@@ -0,0 +1,60 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Stand-in for the part of the piapi interface the PowerInsight plugin
+ * uses, so piapidev_test can build the plugin without the library.  The
+ * client side in piapidev_test.c talks to a fake agent over TCP.
+ */
+
+#ifndef PIAPI_H
+#define PIAPI_H
+
+typedef unsigned int piapi_port_t;
+
+typedef enum {
+    PIAPI_MODE_NATIVE,
+    PIAPI_MODE_PROXY,
+    PIAPI_MODE_AGENT
+} piapi_mode_t;
+
+typedef struct {
+    float volts;
+    float amps;
+    float watts;
+} piapi_reading_t;
+
+typedef struct {
+    void *cntx;
+    piapi_port_t port;
+    unsigned int number;
+    unsigned int total;
+    unsigned int time_sec;
+    unsigned int time_usec;
+    piapi_reading_t raw;
+    piapi_reading_t avg;
+    piapi_reading_t min;
+    piapi_reading_t max;
+    double time_total;
+    double energy;
+} piapi_sample_t;
+
+typedef void (*piapi_callback_t)( piapi_sample_t *sample );
+
+int piapi_init( void **cntx, piapi_mode_t mode, piapi_callback_t callback,
+    unsigned int saddr, unsigned short sport, unsigned int counter_freq );
+int piapi_destroy( void **cntx );
+int piapi_collect( void *cntx, piapi_port_t port, unsigned int samples,
+    unsigned int frequency );
+int piapi_halt( void *cntx, piapi_port_t port );
+
+#endif
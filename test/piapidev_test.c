@@ -0,0 +1,313 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Runs the PowerInsight plugin against a fake piapi agent on a local TCP
+ * port.  The piapi client side below stands in for the library: it sends
+ * collect and halt requests to the agent and hands each sample it gets
+ * back to the plugin's callback, tagged with its context like piapi does.
+ * Each agent connection streams its own values, so two devices in the
+ * same process show whether samples reach the right one.
+ */
+
+#include "pwrdev.h"
+#include "piapi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "check.h"
+
+plugin_dev_t *getDev( void );
+
+#define AGENT_PERIOD_US 100000
+#define AGENT_SILENT    9 /* a port the agent never streams */
+
+enum { REQ_COLLECT = 1, REQ_HALT };
+
+typedef struct {
+    unsigned int op;
+    piapi_port_t port;
+} agent_req_t;
+
+typedef struct {
+    piapi_port_t port;
+    unsigned int number;
+    unsigned int time_sec;
+    unsigned int time_usec;
+    float watts;
+} agent_sample_t;
+
+/* client side of the stand-in library */
+
+typedef struct {
+    int fd;
+    piapi_callback_t callback;
+    pthread_t thread;
+} piapi_cntx_t;
+
+static int full_io( int fd, void *buf, size_t len, int out )
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while( done < len ) {
+        n = out ? write( fd, (char *)buf + done, len - done ) :
+                  read( fd, (char *)buf + done, len - done );
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n <= 0 )
+            return -1;
+        done += n;
+    }
+
+    return 0;
+}
+
+static void *piapi_thread( void *arg )
+{
+    piapi_cntx_t *cntx = (piapi_cntx_t *)arg;
+    agent_sample_t in;
+    piapi_sample_t sample;
+
+    while( full_io( cntx->fd, &in, sizeof(in), 0 ) == 0 ) {
+        memset( &sample, 0, sizeof(sample) );
+        sample.cntx = cntx;
+        sample.port = in.port;
+        sample.number = in.number;
+        sample.time_sec = in.time_sec;
+        sample.time_usec = in.time_usec;
+        sample.raw.watts = in.watts;
+        sample.raw.volts = 12.0;
+        sample.energy = in.number;
+        cntx->callback( &sample );
+    }
+
+    return 0x0;
+}
+
+int piapi_init( void **cntx, piapi_mode_t mode, piapi_callback_t callback,
+    unsigned int saddr, unsigned short sport, unsigned int counter_freq )
+{
+    struct sockaddr_in addr;
+    piapi_cntx_t *c = malloc( sizeof(piapi_cntx_t) );
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( saddr );
+    addr.sin_port = htons( sport );
+
+    c->callback = callback;
+    if( (c->fd = socket( AF_INET, SOCK_STREAM, 0 )) < 0 ||
+        connect( c->fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 ) {
+        free( c );
+        return -1;
+    }
+    pthread_create( &c->thread, 0x0, piapi_thread, c );
+
+    *cntx = c;
+    return 0;
+}
+
+int piapi_destroy( void **cntx )
+{
+    piapi_cntx_t *c = (piapi_cntx_t *)*cntx;
+
+    shutdown( c->fd, SHUT_RDWR );
+    pthread_join( c->thread, 0x0 );
+    close( c->fd );
+    free( c );
+    *cntx = 0x0;
+
+    return 0;
+}
+
+static int piapi_request( void *cntx, unsigned int op, piapi_port_t port )
+{
+    agent_req_t req = { op, port };
+
+    return full_io( ((piapi_cntx_t *)cntx)->fd, &req, sizeof(req), 1 );
+}
+
+int piapi_collect( void *cntx, piapi_port_t port, unsigned int samples,
+    unsigned int frequency )
+{
+    return piapi_request( cntx, REQ_COLLECT, port );
+}
+
+int piapi_halt( void *cntx, piapi_port_t port )
+{
+    return piapi_request( cntx, REQ_HALT, port );
+}
+
+/* the fake agent, one thread per connection */
+
+static int agent_listen;
+
+/* connections are numbered in the order the devices were initialized */
+typedef struct {
+    int fd;
+    int id;
+} agent_conn_t;
+
+static void *agent_conn( void *arg )
+{
+    int fd = ((agent_conn_t *)arg)->fd, id = ((agent_conn_t *)arg)->id;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    unsigned int collect[16] = { 0 }, number = 0;
+    agent_sample_t out;
+    agent_req_t req;
+    struct timeval tv;
+    piapi_port_t p;
+
+    while( 1 ) {
+        if( poll( &pfd, 1, AGENT_PERIOD_US / 1000 ) > 0 ) {
+            if( full_io( fd, &req, sizeof(req), 0 ) < 0 )
+                break;
+            if( req.port < 16 )
+                collect[req.port] = req.op == REQ_COLLECT;
+            continue;
+        }
+
+        gettimeofday( &tv, 0x0 );
+        number++;
+        for( p = 0; p < 16; p++ ) {
+            if( !collect[p] || p == AGENT_SILENT )
+                continue;
+            out.port = p;
+            out.number = number;
+            out.time_sec = tv.tv_sec;
+            out.time_usec = tv.tv_usec;
+            out.watts = id * 100 + p;
+            if( full_io( fd, &out, sizeof(out), 1 ) < 0 )
+                break;
+        }
+    }
+
+    close( fd );
+    free( arg );
+    return 0x0;
+}
+
+static void *agent_accept( void *arg )
+{
+    agent_conn_t *conn;
+    pthread_t thread;
+    int fd, id = 0;
+
+    while( (fd = accept( agent_listen, 0x0, 0x0 )) >= 0 ) {
+        conn = malloc( sizeof(agent_conn_t) );
+        conn->fd = fd;
+        conn->id = ++id;
+        pthread_create( &thread, 0x0, agent_conn, conn );
+        pthread_detach( thread );
+    }
+
+    return 0x0;
+}
+
+static int agent_start( void )
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    pthread_t thread;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    if( (agent_listen = socket( AF_INET, SOCK_STREAM, 0 )) < 0 ||
+        bind( agent_listen, (struct sockaddr *)&addr, sizeof(addr) ) < 0 ||
+        listen( agent_listen, 4 ) < 0 ||
+        getsockname( agent_listen, (struct sockaddr *)&addr, &len ) < 0 )
+        return -1;
+
+    pthread_create( &thread, 0x0, agent_accept, 0x0 );
+    pthread_detach( thread );
+
+    return ntohs( addr.sin_port );
+}
+
+int main( int argc, char* argv[] )
+{
+    plugin_devops_t *dev1, *dev2;
+    pwr_fd_t fd1, fd2, fd3;
+    char init[64], open1[] = "3", open2[] = "3", open3[] = "9";
+    double value, values[32];
+    PWR_Time ts;
+    unsigned int n;
+    int port, rc, i, sorted;
+
+    if( (port = agent_start()) < 0 ) {
+        return checkSkip( "PowerInsight device", "no socket" );
+    }
+
+    checkBegin( "PowerInsight device" );
+
+    sprintf( init, "127.0.0.1:%d:10", port );
+    dev1 = getDev()->init( init );
+    CHECK( dev1 != 0x0 );
+    sprintf( init, "127.0.0.1:%d:10", port );
+    dev2 = getDev()->init( init );
+    CHECK( dev2 != 0x0 );
+    if( dev1 == 0x0 || dev2 == 0x0 )
+        return 1;
+
+    /* the first read waits for the sample streamed after the open */
+    fd1 = dev1->open( dev1, open1 );
+    rc = dev1->read( fd1, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 103.0 );
+
+    fd2 = dev2->open( dev2, open2 );
+    rc = dev2->read( fd2, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 203.0 );
+
+    rc = dev1->read( fd1, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 103.0 );
+
+    rc = dev1->read( fd1, PWR_ATTR_VOLTAGE, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 12.0 );
+
+    /* energy counts samples, so resampled values never decrease */
+    usleep( 10 * AGENT_PERIOD_US );
+    n = 32;
+    rc = dev1->get_samples( fd1, PWR_ATTR_ENERGY, &ts, 0.05, &n, values );
+    for( sorted = 1, i = 1; i < n; i++ )
+        sorted &= values[i-1] <= values[i];
+    CHECK( rc == 0 && n > 8 && n < 32 && sorted );
+
+    /* a port that never streams fails after a couple of periods */
+    fd3 = dev1->open( dev1, open3 );
+    CHECK( dev1->read( fd3, PWR_ATTR_POWER, &value, sizeof(double), &ts ) < 0 );
+
+    dev1->close( fd3 );
+    dev1->close( fd1 );
+    dev2->close( fd2 );
+    getDev()->final( dev1 );
+
+    /* the remaining device keeps getting its own samples */
+    fd2 = dev2->open( dev2, open2 );
+    rc = dev2->read( fd2, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 203.0 );
+    dev2->close( fd2 );
+    getDev()->final( dev2 );
+
+    return checkResults( "PowerInsight device" );
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Drives the powercap plugin over a synthetic powercap tree standing in
+ * for /sys/class/powercap: zones opened by directory and by name, energy
+ * across a wrap of the counter, power kept until its window is long
+ * enough, and power limits.
+ */
+
+#include "pwrdev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "check.h"
+
+#define WINDOW 10000000ULL /* ns, POWERCAP_POWER_INTERVAL */
+#define RANGE  2000000ULL
+
+plugin_dev_t *getDev( void );
+
+static char root[64];
+
+static void zone_file( const char *file, unsigned long long value, const char *str )
+{
+    char path[256];
+    FILE *fp;
+
+    sprintf( path, "%s/intel-rapl:0/%s", root, file );
+    if( (fp = fopen( path, "w" )) == 0x0 ) {
+        failures++;
+        return;
+    }
+    if( str )
+        fprintf( fp, "%s\n", str );
+    else
+        fprintf( fp, "%llu\n", value );
+    fclose( fp );
+}
+
+static const char *files[] = { "name", "energy_uj", "max_energy_range_uj",
+    "constraint_0_name", "constraint_0_power_limit_uw",
+    "constraint_0_max_power_uw", "constraint_0_min_power_uw" };
+
+static void zone_remove( void )
+{
+    char path[256];
+    unsigned int i;
+
+    for( i = 0; i < sizeof(files)/sizeof(files[0]); i++ ) {
+        sprintf( path, "%s/intel-rapl:0/%s", root, files[i] );
+        unlink( path );
+    }
+    sprintf( path, "%s/intel-rapl:0", root );
+    rmdir( path );
+    rmdir( root );
+}
+
+/* the power window as the plugin keeps it, any read may close it */
+static PWR_Time start;
+static unsigned long long added;
+static double power;
+
+static void window( PWR_Time ts )
+{
+    if( ts - start < WINDOW )
+        return;
+
+    power = (double)added / ((double)(ts - start) / 1000.0);
+    start = ts;
+    added = 0;
+}
+
+int main( int argc, char* argv[] )
+{
+    PWR_AttrName attrs[] = { PWR_ATTR_ENERGY, PWR_ATTR_POWER };
+    plugin_devops_t *dev;
+    pwr_fd_t fd, byname;
+    char path[256];
+    double value, values[2];
+    PWR_Time ts, tss[2];
+    int status[2], rc;
+
+    strcpy( root, "/tmp/powercapXXXXXX" );
+    sprintf( path, "%s/intel-rapl:0", mkdtemp( root ) );
+    if( mkdir( path, 0700 ) < 0 )
+        return checkSkip( "powercap device", "no temporary directory" );
+
+    zone_file( "name", 0, "package-0" );
+    zone_file( "max_energy_range_uj", RANGE, 0x0 );
+    zone_file( "energy_uj", 1000000, 0x0 );
+    zone_file( "constraint_0_name", 0, "long_term" );
+    zone_file( "constraint_0_power_limit_uw", 50000000, 0x0 );
+    zone_file( "constraint_0_max_power_uw", 100000000, 0x0 );
+    zone_file( "constraint_0_min_power_uw", 10000000, 0x0 );
+
+    checkBegin( "powercap device" );
+
+    dev = getDev()->init( root );
+    CHECK( dev != 0x0 );
+    fd = dev->open( dev, "intel-rapl:0" );
+    byname = dev->open( dev, "package-0" );
+    CHECK( fd != 0x0 && byname != 0x0 );
+    CHECK( dev->open( dev, "dram" ) == 0x0 );
+    if( fd == 0x0 || byname == 0x0 ) {
+        zone_remove();
+        return checkResults( "powercap device" );
+    }
+
+    /* a cold power read waits out the window opened with the zone */
+    rc = dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 0.0 );
+    start = ts;
+    rc = dev->read( fd, PWR_ATTR_ENERGY, &value, sizeof(double), &ts );
+    window( ts );
+    CHECK( rc == 0 && value == 1.0 );
+
+    /* energy moves at once, power only once its window is long enough */
+    zone_file( "energy_uj", 1500000, 0x0 );
+    added += 500000;
+    rc = dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    window( ts );
+    CHECK( rc == 0 && value == power );
+    rc = dev->read( fd, PWR_ATTR_ENERGY, &value, sizeof(double), &ts );
+    window( ts );
+    CHECK( rc == 0 && value == 1.5 );
+
+    /* the counter wraps at max_energy_range_uj */
+    zone_file( "energy_uj", 1900000, 0x0 );
+    added += 400000;
+    rc = dev->read( fd, PWR_ATTR_ENERGY, &value, sizeof(double), &ts );
+    window( ts );
+    CHECK( rc == 0 && value == 1.9 );
+    zone_file( "energy_uj", 100000, 0x0 );
+    added += 200000;
+    usleep( WINDOW / 1000 );
+
+    rc = dev->readv( fd, 2, attrs, values, tss, status );
+    window( tss[1] );
+    CHECK( rc == 0 && status[0] == 0 && status[1] == 0 );
+    CHECK( values[0] == 2.1 && tss[0] == tss[1] );
+    CHECK( values[1] == power && power > 0.0 );
+
+    /* each descriptor has its own accumulator, this one sees one wrap */
+    rc = dev->read( byname, PWR_ATTR_ENERGY, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 2.1 );
+
+    rc = dev->read( fd, PWR_ATTR_POWER_LIMIT_MAX, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 50.0 );
+    rc = dev->read( fd, PWR_ATTR_POWER_LIMIT_MIN, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 10.0 );
+    value = 60.0;
+    CHECK( dev->write( fd, PWR_ATTR_POWER_LIMIT_MAX, &value, sizeof(double) ) == 0 );
+    rc = dev->read( fd, PWR_ATTR_POWER_LIMIT_MAX, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 60.0 );
+    value = 200.0;
+    CHECK( dev->write( fd, PWR_ATTR_POWER_LIMIT_MAX, &value, sizeof(double) ) < 0 );
+
+    dev->close( byname );
+    dev->close( fd );
+    getDev()->final( dev );
+    zone_remove();
+
+    return checkResults( "powercap device" );
+}
@@ -0,0 +1,220 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Route tables: a text route file loads into a table, the table saved as
+ * an image maps back with the same routes, and an image that would send
+ * find() outside the mapping or around the slots forever is refused.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "router.h"
+#include "check.h"
+
+using namespace PWR_Router;
+
+// the image layout of routeTable.h
+struct Header {
+	char		magic[8];
+	uint64_t	numSlots;
+	uint64_t	numEntries;
+};
+
+struct Slot {
+	uint64_t	hash;
+	AppID		app;
+	uint32_t	name;
+	uint32_t	length;
+};
+
+static std::string tmpName( const char* suffix )
+{
+	char name[64];
+	snprintf( name, sizeof( name ), "/tmp/routetable_test.%d.%s", 
+												(int) getpid(), suffix );
+	return name;
+}
+
+static bool writeFile( const std::string& file, const void* data, 
+												size_t length )
+{
+	FILE* fp = fopen( file.c_str(), "w" );
+	if ( NULL == fp ) {
+		return false;
+	}
+	bool ok = length == fwrite( data, 1, length, fp );
+	return 0 == fclose( fp ) && ok;
+}
+
+static std::vector<char> readFile( const std::string& file )
+{
+	std::vector<char> data;
+	FILE* fp = fopen( file.c_str(), "r" );
+	if ( NULL == fp ) {
+		return data;
+	}
+	char buf[4096];
+	size_t num;
+	while ( ( num = fread( buf, 1, sizeof( buf ), fp ) ) ) {
+		data.insert( data.end(), buf, buf + num );
+	}
+	fclose( fp );
+	return data;
+}
+
+static bool loadImage( const std::vector<char>& image )
+{
+	std::string file = tmpName( "bad" );
+	RouteTable table;
+	bool ok = writeFile( file, &image[0], image.size() ) && 
+											table.load( file );
+	unlink( file.c_str() );
+	return ok;
+}
+
+static bool sameRoutes( RouteTable& table )
+{
+	return 4 == table.size() && 
+		APP_ID( 0, 0 ) == table.find( "plat.cab0.board0.node0" ) &&
+		APP_ID( 0, 1 ) == table.find( "plat.cab0.board0.node1" ) &&
+		APP_ID( 1, 7 ) == table.find( "plat.cab0.board0" ) &&
+		APP_ID( 2, 3 ) == table.find( "plat" ) &&
+		NO_ROUTE == table.find( "plat.cab0" ) &&
+		NO_ROUTE == table.find( "" );
+}
+
+static void checkRoundTrip( const std::string& text, 
+										const std::string& image )
+{
+	checkBegin( "route table round trip" );
+
+	const char* routes = 
+		"plat.cab0.board0.node0:0:0\n"
+		"plat.cab0.board0.node1:0:1\r\n"
+		"\n"
+		"plat.cab0.board0:0:2\n"
+		"plat:2:3\n"
+		"plat.cab0.board0:1:7";
+
+	RouteTable empty;
+	CHECK( 0 == empty.size() );
+	CHECK( NO_ROUTE == empty.find( "plat" ) );
+	CHECK( ! empty.save( image ) );
+	CHECK( ! empty.load( tmpName( "missing" ) ) );
+
+	CHECK( writeFile( text, routes, strlen( routes ) ) );
+
+	RouteTable table;
+	CHECK( table.load( text ) );
+	CHECK( sameRoutes( table ) );
+	CHECK( table.save( image ) );
+
+	RouteTable mapped;
+	CHECK( mapped.load( image ) );
+	CHECK( sameRoutes( mapped ) );
+
+	// a mapped table saves the image it mapped
+	std::string copy = tmpName( "copy" );
+	CHECK( mapped.save( copy ) );
+	CHECK( readFile( image ) == readFile( copy ) );
+	unlink( copy.c_str() );
+
+	// loading again replaces the routes
+	const char* one = "node:4:5\n";
+	CHECK( writeFile( text, one, strlen( one ) ) );
+	CHECK( mapped.load( text ) );
+	CHECK( 1 == mapped.size() );
+	CHECK( APP_ID( 4, 5 ) == mapped.find( "node" ) );
+	CHECK( NO_ROUTE == mapped.find( "plat" ) );
+
+	const char* bad = "plat:0\n";
+	CHECK( writeFile( text, bad, strlen( bad ) ) );
+	CHECK( ! table.load( text ) );
+}
+
+static void checkBadImage( const std::string& file )
+{
+	checkBegin( "route table image" );
+
+	std::vector<char> good = readFile( file );
+	CHECK( good.size() > sizeof( Header ) );
+	CHECK( loadImage( good ) );
+
+	Header hdr;
+	memcpy( &hdr, &good[0], sizeof( hdr ) );
+	size_t slotsOff = sizeof( Header );
+	size_t namesOff = slotsOff + hdr.numSlots * sizeof( Slot );
+	size_t used = 0;
+	for ( uint64_t i = 0; i < hdr.numSlots; i++ ) {
+		Slot* slot = (Slot*) &good[ slotsOff + i * sizeof( Slot ) ];
+		if ( NO_ROUTE != slot->app ) {
+			used = slotsOff + i * sizeof( Slot );
+		}
+	}
+
+	std::vector<char> image;
+
+	image.assign( good.begin(), good.begin() + namesOff - 1 );
+	CHECK( ! loadImage( image ) );
+
+	image = good;
+	( (Header*) &image[0] )->numSlots = hdr.numSlots + 1;
+	CHECK( ! loadImage( image ) );
+
+	image = good;
+	( (Header*) &image[0] )->numSlots = (uint64_t) 1 << 62;
+	CHECK( ! loadImage( image ) );
+
+	image = good;
+	( (Header*) &image[0] )->numEntries = hdr.numEntries + 1;
+	CHECK( ! loadImage( image ) );
+
+	image = good;
+	( (Slot*) &image[ used ] )->name = good.size() - namesOff;
+	CHECK( ! loadImage( image ) );
+
+	image = good;
+	( (Slot*) &image[ used ] )->name = 0;
+	( (Slot*) &image[ used ] )->length = 0xffffffff;
+	CHECK( ! loadImage( image ) );
+
+	// every slot used, a missing name would be probed for forever
+	image = good;
+	for ( uint64_t i = 0; i < hdr.numSlots; i++ ) {
+		Slot* slot = (Slot*) &image[ slotsOff + i * sizeof( Slot ) ];
+		if ( NO_ROUTE == slot->app ) {
+			slot->app = APP_ID( 9, 9 );
+			slot->name = 0;
+			slot->length = 0;
+		}
+	}
+	( (Header*) &image[0] )->numEntries = hdr.numSlots;
+	CHECK( ! loadImage( image ) );
+}
+
+int main( int argc, char* argv[] )
+{
+	std::string text = tmpName( "txt" );
+	std::string image = tmpName( "bin" );
+
+	checkRoundTrip( text, image );
+	checkBadImage( image );
+
+	unlink( text.c_str() );
+	unlink( image.c_str() );
+
+	return checkResults( "route table" );
+}
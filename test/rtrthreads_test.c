@@ -0,0 +1,208 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * End to end through a router running two threads: a router, a server
+ * daemon for a board and its two nodes, and this process as the client.
+ * The servers and the client are spread over the router's shards, so
+ * requests, responses and the events released after them cross shards.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <pwr.h>
+#include "check.h"
+
+#define GETS 200
+
+static const char *config =
+    "<?xml version=\"1.0\"?>\n"
+    "<System>\n"
+    "<Plugins>\n"
+    "    <plugin name=\"Dummy\" lib=\"" PLUGIN_DIR "/libdummy_dev\"/>\n"
+    "</Plugins>\n"
+    "<Devices>\n"
+    "    <device name=\"Dummy-node\" plugin=\"Dummy\" initString=\"node\"/>\n"
+    "</Devices>\n"
+    "<Objects>\n"
+    "<obj name=\"plat\" type=\"Platform\">\n"
+    "    <children> <child name=\"cab0\"/> </children>\n"
+    "</obj>\n"
+    "<obj name=\"plat.cab0\" type=\"Cabinet\">\n"
+    "    <attributes>\n"
+    "        <attr name=\"POWER\" op=\"SUM\"> <src type=\"child\" name=\"board0\"/> </attr>\n"
+    "    </attributes>\n"
+    "    <children> <child name=\"board0\"/> </children>\n"
+    "</obj>\n"
+    "<obj name=\"plat.cab0.board0\" type=\"Board\" location=\"plat.cab0.board0-daemon\">\n"
+    "    <attributes>\n"
+    "        <attr name=\"POWER\" op=\"SUM\">\n"
+    "            <src type=\"child\" name=\"node0\"/> <src type=\"child\" name=\"node1\"/>\n"
+    "        </attr>\n"
+    "    </attributes>\n"
+    "    <children> <child name=\"node0\"/> <child name=\"node1\"/> </children>\n"
+    "</obj>\n"
+    "<obj name=\"plat.cab0.board0.node0\" type=\"Node\" location=\"plat.cab0.board0.node0-daemon\">\n"
+    "    <devices> <dev name=\"dev1\" device=\"Dummy-node\" openString=\"node0\"/> </devices>\n"
+    "    <attributes>\n"
+    "        <attr name=\"POWER\" op=\"SUM\"> <src type=\"device\" name=\"dev1\"/> </attr>\n"
+    "    </attributes>\n"
+    "</obj>\n"
+    "<obj name=\"plat.cab0.board0.node1\" type=\"Node\" location=\"plat.cab0.board0.node1-daemon\">\n"
+    "    <devices> <dev name=\"dev1\" device=\"Dummy-node\" openString=\"node1\"/> </devices>\n"
+    "    <attributes>\n"
+    "        <attr name=\"POWER\" op=\"SUM\"> <src type=\"device\" name=\"dev1\"/> </attr>\n"
+    "    </attributes>\n"
+    "</obj>\n"
+    "</Objects>\n"
+    "</System>\n";
+
+static const char *routes =
+    "plat.cab0.board0.node0:0:0\n"
+    "plat.cab0.board0.node1:0:1\n"
+    "plat.cab0.board0:0:2\n";
+
+static char dir[64], configFile[128], routeFile[128];
+
+static int writeFile( const char *path, const char *str )
+{
+    FILE *fp = fopen( path, "w" );
+    if( fp == 0x0 )
+        return -1;
+    fputs( str, fp );
+    fclose( fp );
+    return 0;
+}
+
+/* the daemons go when this process does, even when it is killed */
+static pid_t spawn( char *const argv[] )
+{
+    pid_t pid = fork();
+    if( pid == 0 ) {
+        prctl( PR_SET_PDEATHSIG, SIGKILL );
+        execv( argv[0], argv );
+        _exit( 127 );
+    }
+    return pid;
+}
+
+static void stop( pid_t pid )
+{
+    if( pid <= 0 )
+        return;
+    kill( pid, SIGTERM );
+    waitpid( pid, 0x0, 0 );
+}
+
+int main( int argc, char* argv[] )
+{
+    PWR_Cntxt cntxt;
+    PWR_Obj node0, node1, board0, cab0;
+    PWR_Time ts;
+    double value, board, cab;
+    int port = 20000 + getpid() % 20000, rc, i, good = 0;
+    char clientPort[64], serverPort[64], apiPort[64], routeTable[160];
+    char rtrPort[64], rtrPort0[64], rtrPort1[64];
+    char srvrConfig[160], srvr0Config[160], srvr1Config[160];
+    char portStr[16];
+    pid_t router, server;
+
+    strcpy( dir, "/tmp/rtrthreadsXXXXXX" );
+    if( mkdtemp( dir ) == 0x0 )
+        return checkSkip( "router threads", "no temporary directory" );
+    sprintf( configFile, "%s/config.xml", dir );
+    sprintf( routeFile, "%s/routes.txt", dir );
+    if( writeFile( configFile, config ) || writeFile( routeFile, routes ) ) {
+        rmdir( dir );
+        return checkSkip( "router threads", "no temporary directory" );
+    }
+
+    sprintf( clientPort, "--rtr.clientPort=%d", port );
+    sprintf( serverPort, "--rtr.serverPort=%d", port + 1 );
+    sprintf( routeTable, "--rtr.routeTable=%s", routeFile );
+    {
+        char *args[] = { PWRDAEMON, clientPort, serverPort,
+            "--rtr.routerType=tree", "--rtr.routerId=0", "--rtr.threads=2",
+            routeTable, 0x0 };
+        router = spawn( args );
+    }
+    usleep( 500000 );
+
+    sprintf( rtrPort, "--srvr.rtrPort=%d", port + 1 );
+    sprintf( rtrPort0, "--srvr0.rtrPort=%d", port + 1 );
+    sprintf( rtrPort1, "--srvr1.rtrPort=%d", port + 1 );
+    sprintf( apiPort, "--srvr.pwrApiServerPort=%d", port );
+    sprintf( srvrConfig, "--srvr.pwrApiConfig=%s", configFile );
+    sprintf( srvr0Config, "--srvr0.pwrApiConfig=%s", configFile );
+    sprintf( srvr1Config, "--srvr1.pwrApiConfig=%s", configFile );
+    {
+        char *args[] = { PWRDAEMON,
+            "--srvr.name=board0", "--srvr.rtrHost=127.0.0.1", rtrPort,
+            srvrConfig, "--srvr.pwrApiRoot=plat.cab0.board0",
+            "--srvr.pwrApiServer=127.0.0.1", apiPort,
+            "--srvr0.name=node0", "--srvr0.rtrHost=127.0.0.1", rtrPort0,
+            srvr0Config, "--srvr0.pwrApiRoot=plat.cab0.board0.node0",
+            "--srvr1.name=node1", "--srvr1.rtrHost=127.0.0.1", rtrPort1,
+            srvr1Config, "--srvr1.pwrApiRoot=plat.cab0.board0.node1", 0x0 };
+        server = spawn( args );
+    }
+    sleep( 1 );
+
+    checkBegin( "router threads" );
+
+    sprintf( portStr, "%d", port );
+    setenv( "POWERAPI_ROOT", "plat.cab0", 1 );
+    setenv( "POWERAPI_CONFIG", configFile, 1 );
+    setenv( "POWERAPI_SERVER", "127.0.0.1", 1 );
+    setenv( "POWERAPI_SERVER_PORT", portStr, 1 );
+
+    /* a hung daemon fails the check instead of make check */
+    alarm( 60 );
+
+    rc = PWR_CntxtInit( PWR_CNTXT_DEFAULT, PWR_ROLE_APP, "App", &cntxt );
+    CHECK( rc == PWR_RET_SUCCESS );
+    if( rc == PWR_RET_SUCCESS ) {
+        PWR_CntxtGetEntryPoint( cntxt, &cab0 );
+        PWR_CntxtGetObjByName( cntxt, "plat.cab0.board0", &board0 );
+        PWR_CntxtGetObjByName( cntxt, "plat.cab0.board0.node0", &node0 );
+        PWR_CntxtGetObjByName( cntxt, "plat.cab0.board0.node1", &node1 );
+
+        value = 3.0;
+        CHECK( PWR_ObjAttrSetValue( node0, PWR_ATTR_POWER, &value ) == PWR_RET_SUCCESS );
+        value = 7.0;
+        CHECK( PWR_ObjAttrSetValue( node1, PWR_ATTR_POWER, &value ) == PWR_RET_SUCCESS );
+
+        for( i = 0; i < GETS; i++ ) {
+            board = cab = 0.0;
+            if( PWR_ObjAttrGetValue( board0, PWR_ATTR_POWER, &board, &ts ) == PWR_RET_SUCCESS &&
+                PWR_ObjAttrGetValue( cab0, PWR_ATTR_POWER, &cab, &ts ) == PWR_RET_SUCCESS &&
+                board == 10.0 && cab == 10.0 )
+                good++;
+        }
+        CHECK( good == GETS );
+
+        PWR_CntxtDestroy( cntxt );
+    }
+
+    stop( server );
+    stop( router );
+    unlink( configFile );
+    unlink( routeFile );
+    rmdir( dir );
+
+    return checkResults( "router threads" );
+}
@@ -0,0 +1,137 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Throughput of a ChannelSelect draining many TcpEventChannels.  One
+ * thread sends events over socketpairs to channels picked at random while
+ * the main thread waits on the select and reads whatever it hands out.
+ * With active given, only that many of the connections get events and
+ * the rest sit idle.
+ *
+ * usage: select_bench TCP|EPOLL|EPOLL_ET connections events [active]
+ *
+ * Not part of make check, build it with make select_bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "tcpEventChannel.h"
+#include "events.h"
+
+struct ChanData : public ChannelSelect::Data {
+	EventChannel* chan;
+};
+
+struct Sender {
+	std::vector<EventChannel*> chans;
+	long events;
+	int active;
+};
+
+static void* sendAll( void* arg )
+{
+	Sender* s = static_cast<Sender*>( arg );
+	CommReqEvent ev;
+	ev.attrName.push_back( PWR_ATTR_ENERGY );
+
+	unsigned int seed = 1;
+	for ( long i = 0; i < s->events; i++ ) {
+		seed = seed * 1103515245 + 12345;
+		s->chans[ ( seed >> 8 ) % s->active ]->sendEvent( &ev );
+	}
+	return NULL;
+}
+
+int main( int argc, char* argv[] )
+{
+	if ( argc != 4 && argc != 5 ) {
+		fprintf( stderr, "usage: %s TCP|EPOLL|EPOLL_ET connections events "
+						"[active]\n", argv[0] );
+		return 1;
+	}
+	int num = atoi( argv[2] );
+	long events = atol( argv[3] );
+	int active = 5 == argc ? atoi( argv[4] ) : num;
+
+	ChannelSelect* sel = getChannelSelect( argv[1] );
+	if ( ! sel || num <= 0 || active <= 0 || active > num ) {
+		fprintf( stderr, "bad select type or connection count\n" );
+		return 1;
+	}
+
+	Sender s;
+	s.events = events;
+	s.active = active;
+	std::vector<ChanData*> data( num );
+	for ( int i = 0; i < num; i++ ) {
+		int fds[2];
+		if ( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) ) {
+			perror( "socketpair" );
+			return 1;
+		}
+		s.chans.push_back( new TcpEventChannel( allocBaseEvent, fds[0], "tx" ) );
+		data[i] = new ChanData;
+		data[i]->chan = new TcpEventChannel( allocBaseEvent, fds[1], "rx" );
+		sel->addChannel( data[i]->chan, data[i] );
+	}
+
+	struct timeval start, end;
+	gettimeofday( &start, NULL );
+
+	pthread_t thread;
+	pthread_create( &thread, NULL, sendAll, &s );
+
+	long got = 0;
+	long wakeups = 0;
+	std::vector<ChannelSelect::Data*> ready;
+	while ( got < events ) {
+		ready.clear();
+		sel->wait( ready );
+		++wakeups;
+		for ( unsigned int i = 0; i < ready.size(); i++ ) {
+			EventChannel* chan = static_cast<ChanData*>( ready[i] )->chan;
+			do {
+				delete chan->getEvent();
+				++got;
+			} while ( chan->pending() );
+		}
+	}
+
+	gettimeofday( &end, NULL );
+	// what the waiting thread burnt, sleeping in the select is not counted
+	struct rusage usage;
+	getrusage( RUSAGE_THREAD, &usage );
+	pthread_join( thread, NULL );
+
+	double usecs = ( end.tv_sec - start.tv_sec ) * 1e6 + 
+						( end.tv_usec - start.tv_usec );
+	double cpu = ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) * 1e6 + 
+						usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	printf( "%s connections=%d active=%d events=%ld wakeups=%ld "
+				"%.0f events/s %.1f cpu us/wakeup\n", argv[1], num, active, 
+				events, wakeups, events / usecs * 1e6, cpu / wakeups );
+
+	for ( int i = 0; i < num; i++ ) {
+		sel->delChannel( data[i]->chan );
+		delete data[i]->chan;
+		delete data[i];
+		delete s.chans[i];
+	}
+	delete sel;
+	return 0;
+}
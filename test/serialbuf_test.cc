@@ -0,0 +1,259 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Round trips through SerialBuf in each encoding, the original one read
+ * from bytes as peers that predate versions write them: varint
+ * boundaries, zigzag coded signed values, strings and vectors, and whole
+ * events decoded with allocBaseEvent().
+ */
+
+#include <stdio.h>
+#include <limits>
+
+#include "events.h"
+#include "check.h"
+
+// encodes one value on its own and returns its size if it decodes back
+template<typename T> static size_t roundTrip( unsigned int version, T v )
+{
+	SerialBuf buf;
+	buf.version = version;
+	buf << v;
+
+	T out;
+	buf >> out;
+	return out == v && 0 == buf.remaining() ? buf.length() : 0;
+}
+
+static void checkVarints()
+{
+	const uint64_t umax = std::numeric_limits<uint64_t>::max();
+	const int64_t smin = std::numeric_limits<int64_t>::min();
+	const int64_t smax = std::numeric_limits<int64_t>::max();
+
+	checkBegin( "varint" );
+	CHECK( 1 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, 0 ) );
+	CHECK( 1 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, 127 ) );
+	CHECK( 2 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, 128 ) );
+	CHECK( 2 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, 16383 ) );
+	CHECK( 3 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, 16384 ) );
+	CHECK( 10 == roundTrip<uint64_t>( PROTO_VERSION_COMPACT, umax ) );
+	CHECK( 5 == roundTrip<uint32_t>( PROTO_VERSION_COMPACT, 0xffffffff ) );
+
+	checkBegin( "zigzag" );
+	CHECK( 1 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, 0 ) );
+	CHECK( 1 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, -1 ) );
+	CHECK( 1 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, 63 ) );
+	CHECK( 1 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, -64 ) );
+	CHECK( 2 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, 64 ) );
+	CHECK( 2 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, -65 ) );
+	CHECK( 10 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, smin ) );
+	CHECK( 10 == roundTrip<int64_t>( PROTO_VERSION_COMPACT, smax ) );
+	CHECK( 1 == roundTrip<int>( PROTO_VERSION_COMPACT, -1 ) );
+	CHECK( 1 == roundTrip<CommEvent::OpType>( PROTO_VERSION_COMPACT, 
+												CommEvent::Stop ) );
+
+	checkBegin( "fixed width" );
+	CHECK( 8 == roundTrip<uint64_t>( PROTO_VERSION_FIXED, 1 ) );
+	CHECK( 4 == roundTrip<int>( PROTO_VERSION_FIXED, -1 ) );
+	CHECK( 1 == roundTrip<char>( PROTO_VERSION_COMPACT, 'x' ) );
+	CHECK( 8 == roundTrip<double>( PROTO_VERSION_COMPACT, -0.125 ) );
+}
+
+static void checkContainers()
+{
+	checkBegin( "string and vector" );
+	for ( unsigned int version = PROTO_VERSION_FIXED; 
+							version <= PROTO_VERSION; version++ ) {
+		SerialBuf buf;
+		buf.version = version;
+
+		std::string str( "plat.cab0.board0.node0" ), empty;
+		std::vector<double> dbl( 3, 1.5 );
+		std::vector<int> ints;
+		std::vector< std::vector<uint64_t> > nested( 2 );
+		std::vector<std::string> strs( 2, "x" );
+
+		ints.push_back( -300 );
+		ints.push_back( 5 );
+		nested[1].push_back( 1ULL << 40 );
+
+		buf << str << empty << dbl << ints << nested << strs;
+
+		std::string str2, empty2( "junk" );
+		std::vector<double> dbl2;
+		std::vector<int> ints2;
+		std::vector< std::vector<uint64_t> > nested2;
+		std::vector<std::string> strs2;
+
+		buf >> str2 >> empty2 >> dbl2 >> ints2 >> nested2 >> strs2;
+
+		CHECK( str == str2 && empty2.empty() );
+		CHECK( dbl == dbl2 && ints == ints2 );
+		CHECK( nested == nested2 && strs == strs2 );
+		CHECK( 0 == buf.remaining() );
+	}
+}
+
+static void checkEvents()
+{
+	checkBegin( "event" );
+	for ( unsigned int version = PROTO_VERSION_FIXED; 
+							version <= PROTO_VERSION; version++ ) {
+		CommReqEvent req;
+		req.commID = 0x1234567890ULL;
+		req.op = CommEvent::Get;
+		req.grpIndex = 7;
+		req.attrName.push_back( PWR_ATTR_POWER );
+		req.attrName.push_back( PWR_ATTR_ENERGY );
+		req.valueOp.push_back( VOP_FP_ADD );
+		req.valueOp.push_back( VOP_FP_AVG );
+
+		SerialBuf buf;
+		buf.version = version;
+		req.serialize_out( buf );
+
+		CommReqEvent* req2 = 
+				static_cast<CommReqEvent*>( allocBaseEvent( CommReq, buf ) );
+		CHECK( req2->commID == req.commID && req2->op == req.op );
+		CHECK( req2->attrName == req.attrName );
+		CHECK( req2->valueOp == req.valueOp && req2->grpIndex == 7 );
+		delete req2;
+
+		CommRespEvent resp;
+		resp.commID = 1;
+		resp.grpIndex = 0;
+		resp.value.resize( 1, std::vector<uint64_t>( 2, 0xfedcba9876543210ULL ) );
+		resp.timeStamp.resize( 1, std::vector<PWR_Time>( 2, 1500000000ULL ) );
+		resp.errObj.push_back( "plat.cab0" );
+		resp.errAttr.push_back( PWR_ATTR_FREQ );
+		resp.errValue.push_back( PWR_RET_INVALID );
+		resp.errHandle.push_back( NO_HANDLE );
+
+		buf.clear();
+		resp.serialize_out( buf );
+
+		CommRespEvent* resp2 = 
+				static_cast<CommRespEvent*>( allocBaseEvent( CommResp, buf ) );
+		CHECK( resp2->value == resp.value );
+		CHECK( resp2->timeStamp == resp.timeStamp );
+		CHECK( resp2->errObj == resp.errObj && resp2->errAttr == resp.errAttr );
+		CHECK( resp2->errValue == resp.errValue );
+		CHECK( resp2->errHandle == resp.errHandle );
+		delete resp2;
+	}
+
+	// a sender predating the trailing version field reads as fixed width
+	Event old( ServerConnect );
+	std::string name( "node0" );
+	SerialBuf buf;
+	old.serialize_out( buf );
+	buf << name;
+
+	ServerConnectEvent* conn = 
+		static_cast<ServerConnectEvent*>( allocBaseEvent( ServerConnect, buf ) );
+	CHECK( conn->name == name && conn->version == PROTO_VERSION_FIXED );
+	delete conn;
+}
+
+template<typename T> static void put( SerialBuf& buf, T v )
+{
+	buf.out( &v, sizeof(v) );
+}
+
+static void putString( SerialBuf& buf, const std::string& str )
+{
+	buf.out( str.data(), str.length() );
+	put<uint64_t>( buf, str.length() );
+}
+
+static void checkOriginal()
+{
+	checkBegin( "original encoding" );
+
+	// a response as a peer that predates versions writes it, each length
+	// after what it counts
+	SerialBuf buf;
+	put<uint64_t>( buf, 0x55 );
+	put<uint32_t>( buf, CommResp );
+	put<int32_t>( buf, PWR_RET_SUCCESS );
+	put<uint64_t>( buf, 1 );
+	put<CommEvent::OpType>( buf, CommEvent::Get );
+	put<PWR_Time>( buf, 100 );
+	put<PWR_Time>( buf, 200 );
+	put<uint64_t>( buf, 2 );
+	put<uint64_t>( buf, 1 );
+	put<uint64_t>( buf, 0xfedcba9876543210ULL );
+	put<uint64_t>( buf, 7 );
+	put<uint64_t>( buf, 2 );
+	put<uint64_t>( buf, 1 );
+	put<uint64_t>( buf, 3 );
+	put<int>( buf, PWR_RET_INVALID );
+	put<int>( buf, PWR_RET_FAILURE );
+	put<uint64_t>( buf, 2 );
+	put<PWR_AttrName>( buf, PWR_ATTR_FREQ );
+	put<PWR_AttrName>( buf, PWR_ATTR_POWER );
+	put<uint64_t>( buf, 2 );
+	putString( buf, "plat.cab0" );
+	putString( buf, "node1" );
+	put<uint64_t>( buf, 2 );
+
+	buf.version = PROTO_VERSION_NONE;
+	CommRespEvent* resp = 
+				static_cast<CommRespEvent*>( allocBaseEvent( CommResp, buf ) );
+	CHECK( 0 == buf.remaining() );
+	CHECK( 0x55 == resp->id && CommResp == resp->type );
+	CHECK( 1 == resp->commID && CommEvent::Get == resp->op );
+	CHECK( 1 == resp->timeStamp.size() && 2 == resp->timeStamp[0].size() );
+	CHECK( 100 == resp->timeStamp[0][0] && 200 == resp->timeStamp[0][1] );
+	CHECK( 1 == resp->value.size() && 2 == resp->value[0].size() );
+	CHECK( 0xfedcba9876543210ULL == resp->value[0][0] && 
+										7 == resp->value[0][1] );
+	CHECK( 3 == resp->grpIndex );
+	CHECK( 2 == resp->errValue.size() && PWR_RET_FAILURE == resp->errValue[1] );
+	CHECK( 2 == resp->errAttr.size() && PWR_ATTR_FREQ == resp->errAttr[0] );
+	CHECK( 2 == resp->errObj.size() && "plat.cab0" == resp->errObj[0] &&
+										"node1" == resp->errObj[1] );
+	CHECK( resp->errHandle.empty() && resp->count.empty() && 
+										resp->valueObj.empty() );
+
+	// and written back the same, without the fields added since
+	resp->errHandle.resize( 2, NO_HANDLE );
+	SerialBuf out;
+	out.version = PROTO_VERSION_NONE;
+	resp->serialize_out( out );
+	CHECK( out.buf == buf.buf );
+	delete resp;
+
+	// such a peer reads only the original encoding
+	Event old( ServerConnect );
+	buf.clear();
+	buf.version = PROTO_VERSION_FIXED;
+	old.serialize_out( buf );
+	putString( buf, "node0" );
+	buf.version = PROTO_VERSION_NONE;
+	ServerConnectEvent* conn = 
+		static_cast<ServerConnectEvent*>( allocBaseEvent( ServerConnect, buf ) );
+	CHECK( "node0" == conn->name && PROTO_VERSION_NONE == conn->version );
+	delete conn;
+}
+
+int main( int argc, char* argv[] )
+{
+	checkVarints();
+	checkContainers();
+	checkEvents();
+	checkOriginal();
+
+	return checkResults( "SerialBuf" );
+}
@@ -0,0 +1,131 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * ShmEventChannel framing: events larger than the ring go as pieces and
+ * arrive whole in both directions, with smaller events around them still
+ * framed right.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "shmEventChannel.h"
+#include "events.h"
+#include "check.h"
+
+#define NUM_SAMPLES	300000
+
+struct Send {
+	EventChannel* chan;
+	bool ok;
+};
+
+static void makeSamples( CommGetSamplesRespEvent& ev, uint32_t num )
+{
+	ev.commID = 7;
+	ev.startTime = 12345;
+	ev.count = num;
+	ev.data.resize( num );
+	for ( uint32_t i = 0; i < num; i++ ) {
+		ev.data[i] = i * 0x9e3779b97f4a7c15ULL;
+	}
+}
+
+static bool sameSamples( Event* ev, uint32_t num )
+{
+	if ( NULL == ev || CommGetSamplesResp != ev->type ) {
+		return false;
+	}
+	CommGetSamplesRespEvent expect;
+	makeSamples( expect, num );
+	CommGetSamplesRespEvent* got = static_cast<CommGetSamplesRespEvent*>( ev );
+	return expect.count == got->count && expect.startTime == got->startTime &&
+			expect.data == got->data;
+}
+
+// small, large, small, the large one does not fit the ring
+static void* sendAll( void* arg )
+{
+	Send* send = static_cast<Send*>( arg );
+	CommGetSamplesRespEvent small, large;
+	makeSamples( small, 3 );
+	makeSamples( large, NUM_SAMPLES );
+	send->ok = send->chan->sendEvent( &small ) && 
+				send->chan->sendEvent( &large ) &&
+				send->chan->sendEvent( &small );
+	return NULL;
+}
+
+static bool transfer( EventChannel* from, EventChannel* to )
+{
+	Send send = { from, false };
+	pthread_t thread;
+	pthread_create( &thread, NULL, sendAll, &send );
+
+	Event* ev[3];
+	for ( int i = 0; i < 3; i++ ) {
+		ev[i] = to->getEvent();
+	}
+	pthread_join( thread, NULL );
+
+	bool ok = send.ok && sameSamples( ev[0], 3 ) && 
+				sameSamples( ev[1], NUM_SAMPLES ) && sameSamples( ev[2], 3 );
+	for ( int i = 0; i < 3; i++ ) {
+		delete ev[i];
+	}
+	return ok;
+}
+
+static void hung( int )
+{
+	printf( "\tlarge event never arrived: FAILURE\n" );
+	_exit( 1 );
+}
+
+static void checkLarge()
+{
+	checkBegin( "large event" );
+
+	ShmEventChannel listener( allocBaseEvent, "listenPort=shmchan_test" );
+	ShmEventChannel* client = ShmEventChannel::connect( allocBaseEvent, 
+				"server=localhost serverPort=shmchan_test", "client" );
+	CHECK( NULL != client );
+	if ( NULL == client ) {
+		return;
+	}
+	EventChannel* server = listener.accept();
+	CHECK( NULL != server );
+	if ( NULL == server ) {
+		return;
+	}
+
+	signal( SIGALRM, hung );
+	alarm( 60 );
+	CHECK( transfer( server, client ) );
+	CHECK( transfer( client, server ) );
+	alarm( 0 );
+
+	// the client going away is the last thing the server sees
+	delete client;
+	CHECK( NULL == server->getEvent() );
+	delete server;
+}
+
+int main( int argc, char* argv[] )
+{
+	checkLarge();
+
+	return checkResults( "SHM framing" );
+}
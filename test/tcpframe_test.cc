@@ -0,0 +1,354 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * TcpEventChannel framing over socket pairs: the frame header of each
+ * encoding version, frames arriving a byte at a time or several in one
+ * read, peers that predate versions answered in the original encoding
+ * and newer peers refused, large queued sends
+ * whose send is cut short by signals, and sends to a peer that is gone.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "tcpEventChannel.h"
+#include "events.h"
+#include "check.h"
+
+static void makeReq( CommReqEvent& req, uint64_t grpIndex )
+{
+	req.commID = 42;
+	req.op = CommEvent::Get;
+	req.grpIndex = grpIndex;
+	req.attrName.push_back( PWR_ATTR_POWER );
+	req.valueOp.push_back( VOP_FP_ADD );
+}
+
+// the bytes a channel puts on the wire for one event
+static std::vector<unsigned char> frame( unsigned int version, uint64_t grpIndex )
+{
+	int fds[2];
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+
+	TcpEventChannel chan( allocBaseEvent, fds[0], "send" );
+	chan.setVersion( version );
+
+	CommReqEvent req;
+	makeReq( req, grpIndex );
+	chan.sendEvent( &req );
+	shutdown( fds[0], SHUT_WR );
+
+	std::vector<unsigned char> bytes;
+	unsigned char tmp[256];
+	ssize_t n;
+	while ( ( n = read( fds[1], tmp, sizeof(tmp) ) ) > 0 ) {
+		bytes.insert( bytes.end(), tmp, tmp + n );
+	}
+	close( fds[1] );
+	return bytes;
+}
+
+static void checkHeaders()
+{
+	checkBegin( "frame header" );
+
+	std::vector<unsigned char> fixed = frame( PROTO_VERSION_FIXED, 1 );
+	uint32_t word;
+	uint64_t length;
+	memcpy( &word, &fixed[0], sizeof(word) );
+	memcpy( &length, &fixed[4], sizeof(length) );
+	CHECK( word == FRAME_WORD( CommReq, PROTO_VERSION_FIXED ) );
+	CHECK( length == fixed.size() - 12 );
+
+	std::vector<unsigned char> compact = frame( PROTO_VERSION_COMPACT, 1 );
+	uint32_t length32;
+	memcpy( &word, &compact[0], sizeof(word) );
+	memcpy( &length32, &compact[4], sizeof(length32) );
+	CHECK( word == FRAME_WORD( CommReq, PROTO_VERSION_COMPACT ) );
+	CHECK( length32 == compact.size() - 8 );
+	CHECK( compact.size() < fixed.size() );
+}
+
+struct Dribble {
+	int fd;
+	std::vector<unsigned char> bytes;
+};
+
+static void* dribble( void* arg )
+{
+	Dribble* d = static_cast<Dribble*>( arg );
+	for ( size_t i = 0; i < d->bytes.size(); i++ ) {
+		if ( write( d->fd, &d->bytes[i], 1 ) != 1 ) {
+			break;
+		}
+		usleep( 100 );
+	}
+	return NULL;
+}
+
+static void checkPartialReads()
+{
+	checkBegin( "partial read" );
+
+	int fds[2];
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+	TcpEventChannel chan( allocBaseEvent, fds[1], "recv" );
+
+	// one frame a byte at a time
+	Dribble d;
+	d.fd = fds[0];
+	d.bytes = frame( PROTO_VERSION_FIXED, 1 );
+	pthread_t thread;
+	pthread_create( &thread, NULL, dribble, &d );
+
+	Event* ev = chan.getEvent();
+	pthread_join( thread, NULL );
+	CHECK( ev && CommReq == ev->type );
+	CHECK( ev && 1 == static_cast<CommReqEvent*>(ev)->grpIndex );
+	CHECK( ! chan.pending() );
+	delete ev;
+
+	// a fixed and a compact frame in one write, the second is buffered
+	std::vector<unsigned char> two = frame( PROTO_VERSION_FIXED, 2 );
+	std::vector<unsigned char> compact = frame( PROTO_VERSION_COMPACT, 3 );
+	two.insert( two.end(), compact.begin(), compact.end() );
+	ssize_t n = write( fds[0], &two[0], two.size() );
+	CHECK( (ssize_t) two.size() == n );
+
+	ev = chan.getEvent();
+	CHECK( ev && 2 == static_cast<CommReqEvent*>(ev)->grpIndex );
+	CHECK( chan.pending() );
+	delete ev;
+	ev = chan.getEvent();
+	CHECK( ev && 3 == static_cast<CommReqEvent*>(ev)->grpIndex );
+	delete ev;
+
+	// the peer reads what it sends
+	CHECK( PROTO_VERSION_COMPACT == chan.getVersion() );
+
+	close( fds[0] );
+
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+	TcpEventChannel chan2( allocBaseEvent, fds[1], "recv2" );
+	std::vector<unsigned char> newer = frame( PROTO_VERSION_COMPACT, 5 );
+	newer[3] = PROTO_VERSION + 1;
+	n = write( fds[0], &newer[0], newer.size() );
+	CHECK( (ssize_t) newer.size() == n );
+	ev = chan2.getEvent();
+	CHECK( NULL == ev );
+	close( fds[0] );
+}
+
+// a peer that predates versions, its header is the bare type and a size_t
+// length, its events are in the original encoding
+static void checkOriginal()
+{
+	checkBegin( "original encoding" );
+
+	int fds[2];
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+	TcpEventChannel chan( allocBaseEvent, fds[1], "recv" );
+	chan.setVersion( PROTO_VERSION_COMPACT );
+
+	CommReqEvent req;
+	makeReq( req, 4 );
+	SerialBuf buf;
+	buf.version = PROTO_VERSION_NONE;
+	uint32_t word = CommReq;
+	size_t length = 0;
+	buf.out( &word, sizeof(word) );
+	buf.out( &length, sizeof(length) );
+	req.serialize_out( buf );
+	length = buf.length() - sizeof(word) - sizeof(length);
+	memcpy( &buf.buf[ sizeof(word) ], &length, sizeof(length) );
+	ssize_t n = write( fds[0], buf.addr(), buf.length() );
+	CHECK( (ssize_t) buf.length() == n );
+
+	Event* ev = chan.getEvent();
+	CHECK( ev && CommReq == ev->type );
+	CHECK( ev && 4 == static_cast<CommReqEvent*>(ev)->grpIndex );
+	CHECK( ev && req.attrName == static_cast<CommReqEvent*>(ev)->attrName );
+	delete ev;
+
+	// the answer is in the same encoding, whatever was set before
+	CHECK( PROTO_VERSION_NONE == chan.getVersion() );
+	CommRespEvent resp;
+	resp.commID = 42;
+	resp.grpIndex = 4;
+	resp.errValue.push_back( PWR_RET_INVALID );
+	resp.errAttr.push_back( PWR_ATTR_POWER );
+	resp.errObj.push_back( "plat.node0" );
+	resp.errHandle.push_back( NO_HANDLE );
+	CHECK( chan.sendEvent( &resp ) );
+
+	unsigned char tmp[256];
+	n = read( fds[0], tmp, sizeof(tmp) );
+	CHECK( n > (ssize_t) ( sizeof(word) + sizeof(length) ) );
+	if ( n > (ssize_t) ( sizeof(word) + sizeof(length) ) ) {
+		memcpy( &word, tmp, sizeof(word) );
+		memcpy( &length, tmp + sizeof(word), sizeof(length) );
+		CHECK( CommResp == word );
+		CHECK( length + sizeof(word) + sizeof(length) == (size_t) n );
+
+		SerialBuf in;
+		in.version = PROTO_VERSION_NONE;
+		in.out( tmp + sizeof(word) + sizeof(length), length );
+		CommRespEvent back( in );
+		CHECK( 0 == in.remaining() );
+		CHECK( 42 == back.commID && 4 == back.grpIndex );
+		CHECK( resp.errObj == back.errObj && resp.errValue == back.errValue );
+	}
+	close( fds[0] );
+}
+
+#define NUM_BIG 4
+#define BIG_LEN ( 256 * 1024 )
+
+struct Receiver {
+	TcpEventChannel* chan;
+	int good;
+};
+
+static void* receive( void* arg )
+{
+	Receiver* r = static_cast<Receiver*>( arg );
+
+	// the signals are for the sender
+	sigset_t set;
+	sigemptyset( &set );
+	sigaddset( &set, SIGALRM );
+	pthread_sigmask( SIG_BLOCK, &set, NULL );
+
+	for ( int i = 0; i < NUM_BIG; i++ ) {
+		usleep( 20000 );
+		Event* ev = r->chan->getEvent();
+		if ( ! ev ) {
+			break;
+		}
+		CommRespEvent* resp = static_cast<CommRespEvent*>( ev );
+		bool ok = resp->grpIndex == (uint64_t) i &&
+							1 == resp->value.size() &&
+							BIG_LEN == resp->value[0].size();
+		for ( size_t j = 0; ok && j < BIG_LEN; j++ ) {
+			ok = resp->value[0][j] == j * NUM_BIG + i;
+		}
+		r->good += ok;
+		delete ev;
+	}
+	return NULL;
+}
+
+static volatile int alarms;
+
+static void onAlarm( int )
+{
+	alarms++;
+}
+
+static void checkPartialWrites()
+{
+	checkBegin( "partial write" );
+
+	int fds[2];
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+	int size = 16 * 1024;
+	setsockopt( fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size) );
+
+	TcpEventChannel send( allocBaseEvent, fds[0], "send" );
+	TcpEventChannel recv( allocBaseEvent, fds[1], "recv" );
+	send.setVersion( PROTO_VERSION_COMPACT );
+
+	Receiver r;
+	r.chan = &recv;
+	r.good = 0;
+	pthread_t thread;
+	pthread_create( &thread, NULL, receive, &r );
+
+	// no SA_RESTART, so a signal cuts a blocked sendmsg short
+	struct sigaction sa;
+	memset( &sa, 0, sizeof(sa) );
+	sa.sa_handler = onAlarm;
+	sigaction( SIGALRM, &sa, NULL );
+	struct itimerval it = { { 0, 500 }, { 0, 500 } };
+	setitimer( ITIMER_REAL, &it, NULL );
+
+	// queued, so the events go out together in one sendmsg
+	send.setOutputQueue( true );
+	bool ok = true;
+	std::vector<CommRespEvent> resp( NUM_BIG );
+	for ( int i = 0; i < NUM_BIG; i++ ) {
+		resp[i].commID = 1;
+		resp[i].grpIndex = i;
+		resp[i].value.resize( 1 );
+		resp[i].timeStamp.resize( 1 );
+		for ( size_t j = 0; j < BIG_LEN; j++ ) {
+			resp[i].value[0].push_back( j * NUM_BIG + i );
+		}
+		ok = send.sendEvent( &resp[i] ) && ok;
+	}
+	CHECK( ok );
+	ok = send.flush();
+	CHECK( ok );
+
+	pthread_join( thread, NULL );
+
+	memset( &it, 0, sizeof(it) );
+	setitimer( ITIMER_REAL, &it, NULL );
+
+	CHECK( NUM_BIG == r.good );
+	CHECK( alarms > 0 );
+}
+
+static void checkBrokenPeer()
+{
+	checkBegin( "broken peer" );
+
+	int fds[2];
+	socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+	TcpEventChannel chan( allocBaseEvent, fds[0], "send" );
+	chan.setOutputQueue( true );
+	close( fds[1] );
+
+	// no SIGPIPE, the flush fails and the channel reads as closed
+	CommReqEvent req;
+	makeReq( req, 1 );
+	bool ok = chan.sendEvent( &req );
+	CHECK( ok );
+	ok = chan.flush();
+	CHECK( ! ok );
+	Event* ev = chan.getEvent();
+	CHECK( NULL == ev );
+
+	TcpChannelSelect sel;
+	ChannelSelect::Data data;
+	sel.addChannel( &chan, &data );
+	chan.sendEvent( &req );
+	CHECK( &data == sel.wait() );
+	sel.delChannel( &chan );
+}
+
+int main( int argc, char* argv[] )
+{
+	checkHeaders();
+	checkPartialReads();
+	checkOriginal();
+	checkPartialWrites();
+	checkBrokenPeer();
+
+	return checkResults( "TCP framing" );
+}
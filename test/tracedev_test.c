@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Drives the trace plugin over the same trace written as CSV and as a
+ * binary file.  Playback is held still with scale=0 so offset alone picks
+ * the position: rows are found between their timestamps, before the first
+ * and after the last, with and without loop.  A binary header whose sizes
+ * wrap or run past the file is refused.
+ */
+
+#include "pwrdev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "check.h"
+
+plugin_dev_t *getDev( void );
+
+/* same layout as the plugin's pwr_trace_hdr_t */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t ncols;
+    uint64_t nrows;
+} trace_hdr_t;
+
+#define NAME_LEN 64
+#define NROWS    3
+
+static const char *names[] = { "node0.POWER", "node0.ENERGY" };
+static const double rows[NROWS][3] = {
+    {  0.0, 100.0,    0.0 },
+    { 10.0, 200.0, 1000.0 },
+    { 20.0, 300.0, 3000.0 },
+};
+
+static char dir[64], csvFile[128], binFile[128], badFile[128];
+
+/* the last row has no newline, the plugin must still parse it */
+static int write_csv( void )
+{
+    FILE *fp = fopen( csvFile, "w" );
+    int i;
+
+    if( fp == 0x0 )
+        return -1;
+    fprintf( fp, "time,%s,%s\n", names[0], names[1] );
+    for( i = 0; i < NROWS; i++ )
+        fprintf( fp, "%g,%g,%g%s", rows[i][0], rows[i][1], rows[i][2],
+            i < NROWS - 1 ? "\n" : "" );
+    return fclose( fp );
+}
+
+/* a header claiming nrows, and only the rows given after it */
+static int write_bin( const char *file, uint64_t nrows, int nwritten )
+{
+    FILE *fp = fopen( file, "w" );
+    trace_hdr_t hdr;
+    char name[NAME_LEN];
+    int i;
+
+    if( fp == 0x0 )
+        return -1;
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, "PWRTRACE", 8 );
+    hdr.version = 1;
+    hdr.ncols = 2;
+    hdr.nrows = nrows;
+    fwrite( &hdr, sizeof(hdr), 1, fp );
+    for( i = 0; i < 2; i++ ) {
+        memset( name, 0, sizeof(name) );
+        strcpy( name, names[i] );
+        fwrite( name, sizeof(name), 1, fp );
+    }
+    fwrite( rows, sizeof(rows[0]), nwritten, fp );
+    return fclose( fp );
+}
+
+static plugin_devops_t *init( const char *file, const char *opts )
+{
+    char initstr[256];
+
+    /* the plugin tokenizes the string in place */
+    snprintf( initstr, sizeof(initstr), "%s%s", file, opts );
+    return getDev()->init( initstr );
+}
+
+/* a value at a fixed position, NaN when the trace does not load */
+static double value_at( const char *file, const char *opts, PWR_AttrName attr )
+{
+    plugin_devops_t *dev = init( file, opts );
+    pwr_fd_t fd;
+    double value = NAN;
+    PWR_Time ts;
+
+    if( dev == 0x0 )
+        return value;
+    if( (fd = dev->open( dev, "node0" )) != 0x0 ) {
+        if( dev->read( fd, attr, &value, sizeof(double), &ts ) != 0 )
+            value = NAN;
+        dev->close( fd );
+    }
+    getDev()->final( dev );
+    return value;
+}
+
+static void check_trace( const char *file )
+{
+    PWR_AttrName attrs[] = { PWR_ATTR_POWER, PWR_ATTR_ENERGY, PWR_ATTR_TEMP };
+    plugin_devops_t *dev;
+    pwr_fd_t fd;
+    double values[3], samples[4];
+    PWR_Time ts[3], start;
+    unsigned int n;
+    int status[3];
+
+    /* a position between rows holds the row at or before it */
+    CHECK( value_at( file, ":scale=0", PWR_ATTR_POWER ) == 100.0 );
+    CHECK( value_at( file, ":scale=0:offset=5", PWR_ATTR_POWER ) == 100.0 );
+    CHECK( value_at( file, ":scale=0:offset=10", PWR_ATTR_POWER ) == 200.0 );
+    CHECK( value_at( file, ":scale=0:offset=15", PWR_ATTR_ENERGY ) == 1000.0 );
+    CHECK( value_at( file, ":scale=0:offset=-5", PWR_ATTR_POWER ) == 100.0 );
+
+    /* past the end the last row holds, unless the trace loops */
+    CHECK( value_at( file, ":scale=0:offset=25", PWR_ATTR_POWER ) == 300.0 );
+    CHECK( value_at( file, ":scale=0:offset=25:loop", PWR_ATTR_POWER ) == 100.0 );
+    CHECK( value_at( file, ":scale=0:offset=35:loop", PWR_ATTR_POWER ) == 200.0 );
+
+    /* playback runs at scale times the wall clock */
+    CHECK( value_at( file, "", PWR_ATTR_POWER ) == 100.0 );
+    dev = init( file, ":scale=2000" );
+    CHECK( dev != 0x0 );
+    if( dev == 0x0 )
+        return;
+    fd = dev->open( dev, "node0" );
+    CHECK( fd != 0x0 );
+    CHECK( dev->open( dev, "node1" ) == 0x0 );
+    if( fd == 0x0 ) {
+        getDev()->final( dev );
+        return;
+    }
+    usleep( 20000 );
+
+    /* a readv reads one row, an attr without a column fails alone */
+    CHECK( dev->readv( fd, 3, attrs, values, ts, status ) == 0 );
+    CHECK( status[0] == 0 && status[1] == 0 && status[2] != 0 );
+    CHECK( values[0] == 300.0 && values[1] == 3000.0 && ts[0] == ts[1] );
+
+    /* samples 5 trace seconds apart, ending at the playback position */
+    n = 4;
+    CHECK( dev->get_samples( fd, PWR_ATTR_POWER, &start, 0.0025, &n, samples ) == 0 );
+    CHECK( n == 4 && samples[3] == 300.0 );
+
+    dev->close( fd );
+    getDev()->final( dev );
+}
+
+int main( int argc, char* argv[] )
+{
+    strcpy( dir, "/tmp/tracedevXXXXXX" );
+    if( mkdtemp( dir ) == 0x0 )
+        return checkSkip( "trace device", "no temporary directory" );
+    sprintf( csvFile, "%s/trace.csv", dir );
+    sprintf( binFile, "%s/trace.bin", dir );
+    sprintf( badFile, "%s/bad.bin", dir );
+    if( write_csv() || write_bin( binFile, NROWS, NROWS ) ) {
+        unlink( csvFile );
+        unlink( binFile );
+        rmdir( dir );
+        return checkSkip( "trace device", "no temporary directory" );
+    }
+
+    checkBegin( "CSV trace" );
+    check_trace( csvFile );
+
+    checkBegin( "binary trace" );
+    check_trace( binFile );
+
+    /* nrows * (ncols + 1) * sizeof(double) is 2^61 * 3 * 8, which wraps to 0 */
+    checkBegin( "corrupt binary trace" );
+    CHECK( write_bin( badFile, 1ULL << 61, 0 ) == 0 );
+    CHECK( init( badFile, "" ) == 0x0 );
+    CHECK( write_bin( badFile, NROWS + 1, NROWS ) == 0 );
+    CHECK( init( badFile, "" ) == 0x0 );
+
+    unlink( csvFile );
+    unlink( binFile );
+    unlink( badFile );
+    rmdir( dir );
+
+    return checkResults( "trace device" );
+}
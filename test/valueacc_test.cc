@@ -0,0 +1,152 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Router value reductions: each ValueOp reduces a group's values, and
+ * partial reductions folded together give what reducing all the values
+ * at once gives, and a minimum or maximum keeps the object it came from.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "valueAcc.h"
+#include "check.h"
+
+using namespace PWR_Router;
+
+static uint64_t bits( double value )
+{
+	uint64_t tmp;
+	memcpy( &tmp, &value, sizeof( tmp ) );
+	return tmp;
+}
+
+static double value( ValueAcc& acc, ValueOp op )
+{
+	uint64_t tmp = acc.value( op );
+	double value;
+	memcpy( &value, &tmp, sizeof( value ) );
+	return value;
+}
+
+// 3, 7 and 5 read from objects 0, 1 and 2 at times 10, 30 and 20
+static double reduce( ValueOp op, ObjHandle* obj = NULL )
+{
+	ValueAcc acc;
+	acc.fold( op, bits( 3 ), 1, 0, 10 );
+	acc.fold( op, bits( 7 ), 1, 1, 30 );
+	acc.fold( op, bits( 5 ), 1, 2, 20 );
+	if ( obj ) {
+		*obj = acc.obj;
+	}
+	return value( acc, op );
+}
+
+static void checkOps()
+{
+	checkBegin( "value op" );
+
+	CHECK( 15 == reduce( VOP_FP_ADD ) );
+	CHECK( 15 == reduce( VOP_INT_ADD ) );
+	CHECK( 5 == reduce( VOP_FP_AVG ) );
+	CHECK( 5 == reduce( VOP_INT_AVG ) );
+	CHECK( 3 == reduce( VOP_FP_MIN ) );
+	CHECK( 3 == reduce( VOP_INT_MIN ) );
+	CHECK( 7 == reduce( VOP_FP_MAX ) );
+	CHECK( 7 == reduce( VOP_INT_MAX ) );
+	CHECK( 5 == reduce( VOP_NONE ) );
+
+	// values are doubles whatever the attribute's type
+	ValueAcc avg;
+	avg.fold( VOP_INT_AVG, bits( 1.5 ), 1, NO_HANDLE, 10 );
+	avg.fold( VOP_INT_AVG, bits( 2 ), 1, NO_HANDLE, 10 );
+	CHECK( 1.75 == value( avg, VOP_INT_AVG ) );
+
+	ValueAcc acc;
+	acc.fold( VOP_FP_MIN, bits( -2.5 ), 1, NO_HANDLE, 10 );
+	acc.fold( VOP_FP_MIN, bits( 1.5 ), 1, NO_HANDLE, 30 );
+	CHECK( -2.5 == value( acc, VOP_FP_MIN ) );
+	CHECK( 2 == acc.count );
+	CHECK( 30 == acc.timeStamp );
+
+	ValueAcc empty;
+	CHECK( 0 == value( empty, VOP_FP_AVG ) );
+	CHECK( 0 == empty.count );
+}
+
+static void checkPartial()
+{
+	checkBegin( "partial reduction" );
+
+	// two routers reduce 3, 7 and 2, the third folds in their replies
+	ValueAcc left, right, all;
+	left.fold( VOP_FP_AVG, bits( 3 ), 1, NO_HANDLE, 10 );
+	left.fold( VOP_FP_AVG, bits( 7 ), 1, NO_HANDLE, 20 );
+	right.fold( VOP_FP_AVG, bits( 2 ), 1, NO_HANDLE, 15 );
+
+	all.fold( VOP_FP_AVG, left.value( VOP_FP_AVG ), left.count, 
+										left.obj, left.timeStamp );
+	all.fold( VOP_FP_AVG, right.value( VOP_FP_AVG ), right.count, 
+										right.obj, right.timeStamp );
+	CHECK( 4 == value( all, VOP_FP_AVG ) );
+	CHECK( 3 == all.count );
+	CHECK( 20 == all.timeStamp );
+
+	ValueAcc sum;
+	sum.fold( VOP_INT_ADD, bits( 10 ), 2, NO_HANDLE, 10 );
+	sum.fold( VOP_INT_ADD, bits( 2.5 ), 1, NO_HANDLE, 10 );
+	CHECK( 12.5 == value( sum, VOP_INT_ADD ) );
+
+	ValueAcc max;
+	max.fold( VOP_FP_MAX, bits( 7 ), 2, 4, 10 );
+	max.fold( VOP_FP_MAX, bits( 9 ), 3, 6, 10 );
+	CHECK( 9 == value( max, VOP_FP_MAX ) );
+	CHECK( 5 == max.count );
+	CHECK( 6 == max.obj );
+}
+
+static void checkObj()
+{
+	checkBegin( "value object" );
+
+	ObjHandle obj;
+	reduce( VOP_FP_MIN, &obj );
+	CHECK( 0 == obj );
+	reduce( VOP_INT_MAX, &obj );
+	CHECK( 1 == obj );
+
+	// a sum or an average is no one object's value
+	reduce( VOP_FP_AVG, &obj );
+	CHECK( NO_HANDLE == obj );
+	reduce( VOP_INT_ADD, &obj );
+	CHECK( NO_HANDLE == obj );
+	reduce( VOP_NONE, &obj );
+	CHECK( 2 == obj );
+
+	// a tie keeps the first, a server that names no object names none
+	ValueAcc tie;
+	tie.fold( VOP_FP_MAX, bits( 4 ), 1, 8, 10 );
+	tie.fold( VOP_FP_MAX, bits( 4 ), 1, 9, 10 );
+	CHECK( 8 == tie.obj );
+	tie.fold( VOP_FP_MAX, bits( 5 ), 1, NO_HANDLE, 10 );
+	CHECK( NO_HANDLE == tie.obj );
+}
+
+int main( int argc, char* argv[] )
+{
+	checkOps();
+	checkPartial();
+	checkObj();
+
+	return checkResults( "value reduction" );
+}
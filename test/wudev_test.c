@@ -0,0 +1,153 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+/*
+ * Drives the Wattsup plugin through a pseudo terminal standing in for the
+ * meter's serial port: the logging command sent at init, records parsed by
+ * the reader thread, resampled history, and reads failing once the meter
+ * goes quiet or the line is lost.
+ */
+
+#define _GNU_SOURCE
+
+#include "pwrdev.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include "check.h"
+
+plugin_dev_t *getDev( void );
+
+static int meter;
+
+static void meter_send( double watts, double volts, double amps, double wh )
+{
+    char rec[128];
+
+    sprintf( rec, "#d,-,18,%d,%d,%d,%d;\r\n", (int)(watts * 10 + 0.5),
+        (int)(volts * 10 + 0.5), (int)(amps * 1000 + 0.5), (int)(wh * 10 + 0.5) );
+    if( write( meter, rec, strlen( rec ) ) != strlen( rec ) )
+        failures++;
+}
+
+/* the first record arrives after the first read already waits for it */
+static void *meter_late( void *arg )
+{
+    usleep( 200000 );
+    meter_send( 12.5, 120.0, 0.104, 0.1 );
+    return 0x0;
+}
+
+static int meter_command( char *buf, int len )
+{
+    struct pollfd pfd = { .fd = meter, .events = POLLIN };
+    int n = 0, rc;
+
+    while( n < len - 1 && poll( &pfd, 1, 1000 ) > 0 ) {
+        if( (rc = read( meter, buf + n, len - 1 - n )) <= 0 )
+            break;
+        n += rc;
+        if( buf[n-1] == ';' )
+            break;
+    }
+    buf[n] = '\0';
+
+    return n;
+}
+
+int main( int argc, char* argv[] )
+{
+    PWR_AttrName attrs[] = { PWR_ATTR_POWER, PWR_ATTR_VOLTAGE,
+        PWR_ATTR_CURRENT, PWR_ATTR_ENERGY };
+    plugin_devops_t *dev;
+    pwr_fd_t fd;
+    pthread_t thread;
+    char init[128], cmd[64];
+    double value, values[8];
+    PWR_Time ts, tss[4];
+    int status[4], i, rc;
+    unsigned int n;
+
+    if( (meter = posix_openpt( O_RDWR | O_NOCTTY )) < 0 ||
+        grantpt( meter ) < 0 || unlockpt( meter ) < 0 ) {
+        return checkSkip( "Wattsup device", "no pty" );
+    }
+
+    checkBegin( "Wattsup device" );
+
+    /* failed inits give up the meter and everything they allocated */
+    sprintf( init, "%s:1234:1", ptsname( meter ) );
+    CHECK( getDev()->init( init ) == 0x0 );
+    sprintf( init, "/nonexistent/tty:115200:1" );
+    CHECK( getDev()->init( init ) == 0x0 );
+
+    sprintf( init, "%s:115200:1", ptsname( meter ) );
+    dev = getDev()->init( init );
+    CHECK( dev != 0x0 );
+    if( dev == 0x0 )
+        return 1;
+
+    meter_command( cmd, sizeof(cmd) );
+    CHECK( strcmp( cmd, "#L,W,3,E,0,1;" ) == 0 );
+
+    fd = dev->open( dev, "" );
+    CHECK( fd != 0x0 );
+
+    pthread_create( &thread, 0x0, meter_late, 0x0 );
+    rc = dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    pthread_join( thread, 0x0 );
+    CHECK( rc == 0 && value == 12.5 );
+
+    rc = dev->readv( fd, 4, attrs, values, tss, status );
+    CHECK( rc == 0 && status[0] == 0 && status[3] == 0 );
+    CHECK( values[1] == 120.0 && values[2] == 0.104 && values[3] == 360.0 );
+
+    /* four records 300 ms apart, resampled every 250 ms */
+    for( i = 2; i <= 4; i++ ) {
+        usleep( 300000 );
+        meter_send( 12.5 * i, 120.0, 0.104, 0.1 );
+    }
+    usleep( 100000 );
+
+    n = 5;
+    rc = dev->get_samples( fd, PWR_ATTR_POWER, &ts, 0.25, &n, values );
+    CHECK( rc == 0 && n == 4 );
+    CHECK( values[0] == 12.5 && values[1] == 25.0 &&
+        values[2] == 37.5 && values[3] == 50.0 );
+
+    n = 2;
+    CHECK( dev->get_samples( fd, PWR_ATTR_FREQ, &ts, 0.25, &n, values ) < 0 );
+
+    /* nothing for longer than two intervals plus a second */
+    sleep( 4 );
+    CHECK( dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts ) < 0 );
+
+    meter_send( 10.0, 120.0, 0.104, 0.1 );
+    usleep( 200000 );
+    rc = dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts );
+    CHECK( rc == 0 && value == 10.0 );
+
+    /* hanging up the line stops the reader thread */
+    close( meter );
+    usleep( 300000 );
+    CHECK( dev->read( fd, PWR_ATTR_POWER, &value, sizeof(double), &ts ) < 0 );
+
+    dev->close( fd );
+    getDev()->final( dev );
+
+    return checkResults( "Wattsup device" );
+}
@@ -31,6 +31,19 @@ static const char* _eventNames[] = {
 };
 #endif
 
+void PWR_Router::reportEventPools()
+{
+	DBG4("PWR_Router","CommReq %" PRIu64 "/%" PRIu64 " CommResp %" PRIu64 
+		"/%" PRIu64 " Router2Router %" PRIu64 "/%" PRIu64 
+		" allocated/reused\n",
+		EventPool<RtrCommReqEvent>::allocs(), 
+		EventPool<RtrCommReqEvent>::reuses(),
+		EventPool<RtrCommRespEvent>::allocs(), 
+		EventPool<RtrCommRespEvent>::reuses(),
+		EventPool<RtrRouterEvent>::allocs(), 
+		EventPool<RtrRouterEvent>::reuses() );
+}
+
 Event* PWR_Router::allocRtrEvent( unsigned int type, SerialBuf& buf )
 {
 	DBG4("PWR_Router","`%s`\n",_eventNames[type]); 
@@ -39,7 +52,7 @@ Event* PWR_Router::allocRtrEvent( unsigned int type, SerialBuf& buf )
 	  default:
 		assert(0);
 	  case Router2Router:
-		return new RtrRouterEvent( buf );
+		return EventPool<RtrRouterEvent>::get( buf );
 	}
 	return NULL;
 }
@@ -54,7 +67,7 @@ Event* PWR_Router::allocClientEvent( unsigned int type, SerialBuf& buf )
 	  case CommCreate:
 		return new RtrCommCreateEvent( buf );
 	  case CommReq:
-		return new RtrCommReqEvent( buf );
+		return EventPool<RtrCommReqEvent>::get( buf );
 	  case CommLogReq:
 		return new RtrCommLogReqEvent( buf );
 	  case CommGetSamplesReq:
@@ -71,9 +84,9 @@ Event* PWR_Router::allocServerEvent( unsigned int type, SerialBuf& buf )
 	  default:
 		assert(0);	
 	  case Router2Router:
-		return new RtrRouterEvent( buf );
+		return EventPool<RtrRouterEvent>::get( buf );
 	  case CommResp:
-		return new RtrCommRespEvent( buf );
+		return EventPool<RtrCommRespEvent>::get( buf );
 	  case CommLogResp:
 		return new RtrCommLogRespEvent( buf );
 	  case CommGetSamplesResp:
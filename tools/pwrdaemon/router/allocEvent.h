@@ -21,6 +21,10 @@ Event* allocClientEvent( unsigned int, SerialBuf& buf );
 Event* allocServerEvent( unsigned int, SerialBuf& buf );
 Event* allocRtrEvent( unsigned int, SerialBuf& buf );
 
+// with debugging on, what the calling thread's event pools allocated and
+// what they reused
+void reportEventPools();
+
 }
 
 #endif
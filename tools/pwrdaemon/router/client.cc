@@ -18,27 +18,70 @@ Router::Client::Client( Router& rtr ) :m_rtr(rtr) {
 }
 Router::Client::~Client() {
 	DBGX("\n");
-    std::map<CommID,CommCreateEvent* >::iterator iter;
+    std::map<CommID,Comm >::iterator iter;
     for ( iter = m_commMap.begin(); iter != m_commMap.end(); ++iter ) {
 
-   		CommCreateEvent* ev = iter->second;
-        for ( unsigned int i = 0; i < ev->members[0].size(); i++ ) {
-            DBGX("%s\n", ev->members[0][i].c_str() );
+   		Comm& comm = iter->second;
+		if ( comm.created ) {
             CommDestroyEvent* d_ev = new CommDestroyEvent;
-            d_ev->commID = ev->commID;
-            m_rtr.sendEvent( ev->members[0][i].c_str(), d_ev );
+            d_ev->commID = iter->first;
+			for ( size_t i = 0; i < comm.dests.size(); i++ ) {
+            	m_rtr.sendEvent( comm.dests[i].app, d_ev );
+			}
             delete d_ev;
         }
 
-        delete ev;
+        delete comm.ev;
    }
 }
 
 void Router::Client::addComm( CommID id, CommCreateEvent* ev ) {
 	assert( m_commMap.find( id ) == m_commMap.end() );
-    m_commMap[id] = ev;
+    m_commMap.insert( std::make_pair( id, Comm( ev ) ) );
 }
 
-std::vector< std::vector< ObjID > >& Router::Client::getCommList( CommID id ) {
-	return  m_commMap[id]->members;
+// the servers hear about a communicator when its first request is routed,
+// on the same path as the request so they see the create first
+Router::Client::Comm& Router::Client::getComm( CommID id ) {
+	std::map<CommID,Comm >::iterator iter = m_commMap.find( id );
+	assert( iter != m_commMap.end() );
+	Comm& comm = iter->second;
+	if ( ! comm.created ) {
+		createComm( comm );
+	}
+	return comm;
+}
+
+void Router::Client::createComm( Comm& comm ) {
+	DBGX("id=%"PRIx64"\n",comm.ev->commID);
+
+	CommMembers members( *comm.ev );
+	size_t grp;
+	ObjID name;
+	ObjHandle handle;
+
+	comm.numGroups = members.numGroups();
+	comm.created = true;
+
+	CommCreateEvent* ev = new CommCreateEvent();
+	ev->commID = comm.ev->commID;
+	ev->members.resize( 1 );
+
+	while ( members.next( grp, name, handle ) ) {
+		Dest dest = { m_rtr.findDestApp( name ), grp };
+		DBGX("%s\n", name.c_str() );
+		if ( NO_ROUTE == dest.app ) {
+			printf("Could not route %s, drop member\n",name.c_str());
+			continue;
+		}
+		comm.dests.push_back( dest );
+
+		ev->members[0].assign( 1, name );
+		ev->handles.clear();
+		if ( NO_HANDLE != handle ) {
+			ev->handles.push_back( std::vector<ObjHandle>( 1, handle ) );
+		}
+		m_rtr.sendEvent( dest.app, ev );
+	}
+	delete ev;
 }
@@ -19,29 +19,11 @@
 using namespace PWR_Router;
 
 bool RtrCommCreateEvent::process( EventGenerator* _rtr, EventChannel* ec ) {
-	Router& rtr = *static_cast<Router*>(_rtr);
-	Router::Client* client = rtr.getClient( ec );
-	DBGX("id=%"PRIx64"\n",commID);
+	Router::Client* client = static_cast<Router*>(_rtr)->getClient( ec );
+	DBGX("id=%"PRIx64" version=%u\n",commID,version);
 
+	ec->setVersion( version );
 	client->addComm( commID, this );
 
-	// for each object in a group
-   	for ( unsigned int j = 0; j < members.size(); j++ ) {
-		// for each source of this object 
-   		for ( unsigned int i = 0; i < members[j].size(); i++ ) {
-       		DBGX("%s\n", members[j][i].c_str() );
-		
-			CommCreateEvent* ev = new CommCreateEvent();
-			ev->commID = commID;
-
-			std::vector< ObjID > tmp;
-
-			tmp.push_back( members[j][i] );
-			ev->members.push_back( tmp );
-			rtr.sendEvent( members[j][i], ev );
-			delete ev;
-		}	
-	}
-
 	return false;
 }
@@ -30,15 +30,14 @@ class RtrCommGetSamplesReqEvent: public  CommGetSamplesReqEvent {
 		Router& rtr = *static_cast<Router*>(_rtr);
 		Router::Client& client = *rtr.getClient( ec );
 
-		std::vector<std::vector< ObjID > >& commList= 
-                client.getCommList( commID );
+		Router::Client::Comm& comm = client.getComm( commID );
 
        // don't support more that one object at this time
-        assert( 1 == commList.size() );
-        assert( 1 == commList[0].size() );
+        assert( 1 == comm.numGroups );
 
     	CommReqInfo* info = new CommReqInfo;
     	info->src = ec;
+    	info->shard = rtr.shardId();
     	info->ev = this;
 
         info->resp = new CommGetSamplesRespEvent;
@@ -48,11 +47,8 @@ class RtrCommGetSamplesReqEvent: public  CommGetSamplesReqEvent {
     	DBGX("commID=%"PRIx64" eventId=%"PRIx64" new eventId=%p\n",
                                 commID, id, info );
 
-        for ( unsigned int i=0; i <  commList.size(); i++ ) {
-
-            for ( unsigned int j=0; j <  commList[i].size(); j++ ) {
-                rtr.sendEvent( commList[i][j], this );
-            }
+        for ( size_t i = 0; i < comm.dests.size(); i++ ) {
+            rtr.sendEvent( comm.dests[i].app, this );
         }
 		return false;
 	}
@@ -0,0 +1,84 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include "commMembers.h"
+
+using namespace PWR_Router;
+
+CommMembers::CommMembers( CommCreateEvent& ev ) : m_ev( ev ), m_grp( 0 ),
+	m_pos( 0 ), m_count( 0 ), m_handle( 0 ), m_offset( 0 )
+{
+}
+
+size_t CommMembers::numGroups()
+{
+	if ( m_ev.ranges.empty() ) {
+		return m_ev.members.size();
+	} else if ( ! m_ev.splitRanges ) {
+		return m_ev.ranges.size();
+	}
+
+	size_t num = 0;
+	for ( unsigned i = 0; i < m_ev.ranges[0].size(); i++ ) {
+		num += ObjRange( m_ev.ranges[0][i] ).size();
+	}
+	return num;
+}
+
+bool CommMembers::next( size_t& grp, ObjID& name, ObjHandle& handle )
+{
+	if ( m_ev.ranges.empty() ) {
+		while ( m_grp < m_ev.members.size() && 
+							m_pos == m_ev.members[m_grp].size() ) {
+			++m_grp;
+			m_pos = 0;
+		}
+		if ( m_grp == m_ev.members.size() ) {
+			return false;
+		}
+		grp = m_grp;
+		name = m_ev.members[m_grp][m_pos];
+		handle = m_ev.handles.size() == m_ev.members.size() ? 
+								m_ev.handles[m_grp][m_pos] : NO_HANDLE;
+		++m_pos;
+		return true;
+	}
+
+	while ( ! m_range.next( name ) ) {
+		while ( m_grp < m_ev.ranges.size() && 
+							m_pos == m_ev.ranges[m_grp].size() ) {
+			++m_grp;
+			m_pos = 0;
+		}
+		if ( m_grp == m_ev.ranges.size() ) {
+			return false;
+		}
+		m_range.assign( m_ev.ranges[m_grp][m_pos++] );
+	}
+	grp = m_ev.splitRanges ? m_count : m_grp;
+	++m_count;
+	handle = nextHandle();
+	return true;
+}
+
+ObjHandle CommMembers::nextHandle()
+{
+	while ( m_handle + 1 < m_ev.handleRanges.size() && 
+						m_offset == m_ev.handleRanges[m_handle + 1] ) {
+		m_handle += 2;
+		m_offset = 0;
+	}
+	if ( m_handle + 1 >= m_ev.handleRanges.size() ) {
+		return NO_HANDLE;
+	}
+	return m_ev.handleRanges[m_handle] + m_offset++;
+}
@@ -0,0 +1,45 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _RTR_COMM_MEMBERS_H
+#define _RTR_COMM_MEMBERS_H
+
+#include <events.h>
+#include <objRange.h>
+
+namespace PWR_Router {
+
+// Walks the members of a communicator, expanding its ranges as it goes so
+// that keeping a communicator costs what the client sent.
+
+class CommMembers {
+  public:
+	CommMembers( CommCreateEvent& ev );
+
+	size_t numGroups();
+	bool next( size_t& grp, ObjID& name, ObjHandle& handle );
+
+  private:
+	ObjHandle nextHandle();
+
+	CommCreateEvent&	m_ev;
+	size_t				m_grp;
+	size_t				m_pos;
+	size_t				m_count;
+	ObjRange			m_range;
+	size_t				m_handle;
+	ObjHandle			m_offset;
+};
+
+}
+
+#endif
@@ -26,25 +26,28 @@ class RtrCommReqEvent: public  CommReqEvent {
   public:
    	RtrCommReqEvent( SerialBuf& buf ) : CommReqEvent( buf ) {}  
 
+	void release() { EventPool<RtrCommReqEvent>::put( this ); }
+
 	bool process(EventGenerator* _rtr, EventChannel* ec) {
 		Router& rtr = *static_cast<Router*>(_rtr);
 		Router::Client& client = *rtr.getClient( ec );
 
-    	std::vector< std::vector< ObjID > >& commList = 
-				client.getCommList( commID );
+		Router::Client::Comm& comm = client.getComm( commID );
+		size_t numGroups = comm.numGroups;
 
-    	CommReqInfo* info = new CommReqInfo;
+    	CommReqInfo* info = rtr.getCommReqInfo();
+    	CommRespEvent* resp = static_cast<CommRespEvent*>(info->resp);
 
     	DBGX("commID=%"PRIx64" eventId=%"PRIx64" new eventId=%p\n", 
 													commID, id, info );
 
     	info->src = ec;
+    	info->shard = rtr.shardId();
     	info->ev = this;
-		info->grpInfo.resize( commList.size() );
-		info->respQ.resize( commList.size() );
-		info->pending = commList.size();
-        info->resp = new CommRespEvent;
-        info->resp->id = id;
+		info->grpInfo.assign( numGroups, 0 );
+		info->acc.resize( numGroups );
+		info->pending = numGroups;
+        resp->id = id;
 
     	id = (EventId) info;
 
@@ -56,19 +59,22 @@ class RtrCommReqEvent: public  CommReqEvent {
 				DBGX("valueOp=%d\n",valueOp[i]);	
 			}
 
-        	static_cast<CommRespEvent*>(info->resp)->
-                            timeStamp.resize( commList.size() );
-        	static_cast<CommRespEvent*>(info->resp)->
-                            value.resize( commList.size() );
-   		}
-
-    	for ( unsigned int i=0; i <  commList.size(); i++ ) {
-			info->grpInfo[i] = commList[i].size();
-
-			grpIndex = i;
-    		for ( unsigned int j=0; j <  commList[i].size(); j++ ) {
-				rtr.sendEvent( commList[i][j], this );
-			}
+			// every group's values are overwritten when it completes
+        	resp->timeStamp.resize( numGroups );
+        	resp->value.resize( numGroups );
+        	resp->count.resize( numGroups );
+        	resp->valueObj.resize( numGroups );
+   		} else {
+        	resp->timeStamp.clear();
+        	resp->value.clear();
+        	resp->count.clear();
+        	resp->valueObj.clear();
+		}
+
+		for ( size_t i = 0; i < comm.dests.size(); i++ ) {
+			++info->grpInfo[ comm.dests[i].grp ];
+			grpIndex = comm.dests[i].grp;
+			rtr.sendEvent( comm.dests[i].app, this );
     	}
 		return false;
 	}
@@ -22,85 +22,86 @@
 
 namespace PWR_Router {
 
-static inline void fpAdd( void* inout, void* in )
-{
-	*(double*)inout += *(double*)in;
-}
-
 class RtrCommRespEvent: public  CommRespEvent {
   public:
    	RtrCommRespEvent( SerialBuf& buf ) : CommRespEvent( buf ){ }  
 
+	void release() { EventPool<RtrCommRespEvent>::put( this ); }
+
 	bool process( EventGenerator* _rtr, EventChannel* ) {
+		Router& rtr = *static_cast<Router*>(_rtr);
 
 		DBGX("id=%p status=%"PRIi32" grpIndex=%" PRIu64 "\n",
 								(void*)id, status, grpIndex );
 
         CommReqInfo* info = (CommReqInfo*) id;
-
-		info->respQ[grpIndex].push_back( this );
-
-		if ( info->respQ[grpIndex].size() == info->grpInfo[grpIndex] ) {
-
-            CommRespEvent* resp = static_cast<CommRespEvent*>(info->resp);
-			if ( Get == info->ev->op ) {
-				DBGX("index %"PRIu64" is ready, num attrs %zu\n",
-										grpIndex, info->valueOp.size() );
-				resp->timeStamp[grpIndex].resize( info->valueOp.size() );
-				resp->value[grpIndex].resize( info->valueOp.size() );
-
-				for ( unsigned i = 0; i < info->valueOp.size(); i++ ) { 
-					resp->value[grpIndex][i] = 0;
-				}
-
-				for ( unsigned j = 0; j < info->respQ[grpIndex].size(); j++ ) {
-					for ( unsigned i = 0; i < info->valueOp.size(); i++ ) { 
-						DBGX( "op=%d \n", info->valueOp[i] );			
-						assert( FP_ADD == info->valueOp[i] );
-
-						fpAdd( &resp->value[grpIndex][i], 
-									&info->respQ[grpIndex][j]->value[0][i] );
-
-						resp->timeStamp[grpIndex][i] = 
-									info->respQ[grpIndex][j]->timeStamp[0][i];
-					}
-				} 
+        CommRespEvent* resp = static_cast<CommRespEvent*>(info->resp);
+
+		// fold this response in and let it go, only the reduction so far
+		// is kept
+		if ( Get == info->ev->op ) {
+			size_t num = info->valueOp.size();
+			std::vector<ValueAcc>& acc = info->acc[grpIndex];
+			acc.resize( num );
+
+			for ( unsigned i = 0; i < num; i++ ) { 
+				DBGX( "op=%d \n", info->valueOp[i] );			
+				acc[i].fold( info->valueOp[i], value[0][i],
+						count.empty() ? 1 : count[0][i],
+						valueObj.empty() ? NO_HANDLE : valueObj[0][i],
+						timeStamp[0][i] );
 			}
-			for ( unsigned j = 0; j < info->respQ[grpIndex].size(); j++ ) {
-				resp->errValue.insert( resp->errValue.end(), 
-							info->respQ[grpIndex][j]->errValue.begin(), 
-							info->respQ[grpIndex][j]->errValue.end() );
-				resp->errAttr.insert( resp->errAttr.end(), 
-							info->respQ[grpIndex][j]->errAttr.begin(), 
-							info->respQ[grpIndex][j]->errAttr.end() );
-				resp->errObj.insert( resp->errObj.end(), 
-							info->respQ[grpIndex][j]->errObj.begin(), 
-							info->respQ[grpIndex][j]->errObj.end() );
-
-				if ( j < info->respQ[grpIndex].size() - 1 ) {
-					delete info->respQ[grpIndex][ j ];
-				}
+		}
+
+		resp->errValue.insert( resp->errValue.end(), 
+							errValue.begin(), errValue.end() );
+		resp->errAttr.insert( resp->errAttr.end(), 
+							errAttr.begin(), errAttr.end() );
+		resp->errObj.insert( resp->errObj.end(), 
+							errObj.begin(), errObj.end() );
+
+		// a server without handles sends none, keep them aligned
+		errHandle.resize( errValue.size(), NO_HANDLE );
+		resp->errHandle.insert( resp->errHandle.end(), 
+							errHandle.begin(), errHandle.end() );
+
+		if ( --info->grpInfo[grpIndex] ) {
+			return true;
+		}
+
+		if ( Get == info->ev->op ) {
+			DBGX("index %"PRIu64" is ready, num attrs %zu\n",
+										grpIndex, info->valueOp.size() );
+			size_t num = info->valueOp.size();
+			std::vector<ValueAcc>& acc = info->acc[grpIndex];
+
+			resp->value[grpIndex].resize( num );
+			resp->timeStamp[grpIndex].resize( num );
+			resp->count[grpIndex].resize( num );
+			resp->valueObj[grpIndex].resize( num );
+			for ( unsigned i = 0; i < num; i++ ) { 
+				resp->value[grpIndex][i] = acc[i].value( info->valueOp[i] );
+				resp->timeStamp[grpIndex][i] = acc[i].timeStamp;
+				resp->count[grpIndex][i] = acc[i].count;
+				resp->valueObj[grpIndex][i] = acc[i].obj;
 			}
-			// quiet valgrind
-			resp->grpIndex = 0;
-			resp->commID = 0;
-
-			DBGX("pending %zu\n",info->pending);
-			--info->pending;
-
-			if ( 0 == info->pending ) {
-				DBGX("done send the response\n");
-        		info->src->sendEvent( info->resp );
-				delete info->resp;
-				delete info->ev;
-				delete info;
-			} 
-
-			return true; 
-
-		} else {
-			return false;
+			acc.clear();
+		}
+		// quiet valgrind
+		resp->grpIndex = 0;
+		resp->commID = 0;
+
+		DBGX("pending %zu\n",info->pending);
+		--info->pending;
+
+		if ( 0 == info->pending ) {
+			DBGX("done send the response\n");
+       		info->src->sendEvent( info->resp );
+			info->ev->release();
+			rtr.putCommReqInfo( info );
 		} 
+
+		return true; 
 	}
 };
 
@@ -0,0 +1,293 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include "pwr_config.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <debug.h>
+#include "routeTable.h"
+#include "router.h"
+
+using namespace PWR_Router;
+
+static const char s_magic[8] = { 'P','W','R','R','T','B','L','1' };
+
+RouteTable::RouteTable() : m_map( NULL ), m_mapLength( 0 ), m_header( NULL ),
+	m_slots( NULL ), m_names( NULL ), m_mask( 0 )
+{
+}
+
+RouteTable::~RouteTable()
+{
+	unmap();
+}
+
+void RouteTable::unmap()
+{
+	if ( m_map ) {
+		munmap( m_map, m_mapLength );
+		m_map = NULL;
+		m_mapLength = 0;
+	}
+}
+
+// FNV-1a
+uint64_t RouteTable::hash( const char* name, size_t length )
+{
+	uint64_t h = 14695981039346656037ULL;
+	for ( size_t i = 0; i < length; i++ ) {
+		h ^= (unsigned char) name[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+bool RouteTable::load( const std::string& file )
+{
+	DBGX("%s\n",file.c_str());
+
+	int fd = open( file.c_str(), O_RDONLY );
+	if ( -1 == fd ) {
+		return false;
+	}
+
+	struct stat st;
+	if ( -1 == fstat( fd, &st ) ) {
+		close( fd );
+		return false;
+	}
+
+	size_t length = st.st_size;
+	void* map = NULL;
+	if ( length ) {
+		map = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+	}
+	close( fd );
+	if ( MAP_FAILED == map ) {
+		return false;
+	}
+
+	unmap();
+	m_image.clear();
+	m_header = NULL;
+
+	const Header* hdr = (const Header*) map;
+	if ( length >= sizeof(Header) && 
+				0 == memcmp( hdr->magic, s_magic, sizeof(s_magic) ) ) {
+		if ( ! valid( hdr, length ) ) {
+			printf("bad route table image `%s`\n", file.c_str() );
+			munmap( map, length );
+			return false;
+		}
+		m_map = map;
+		m_mapLength = length;
+		attach( map, length );
+		DBGX("mapped %"PRIu64" routes\n", hdr->numEntries );
+		return true;
+	}
+
+	bool ok = parse( (const char*) map, length );
+	if ( map ) {
+		munmap( map, length );
+	}
+	return ok;
+}
+
+// A mapped image is used as it is, so check everything find() relies on:
+// the slots fit, every name lies inside the names, and at least one slot
+// is empty so a probe for a missing name ends.
+bool RouteTable::valid( const Header* hdr, size_t length )
+{
+	uint64_t numSlots = hdr->numSlots;
+	if ( 0 == numSlots || ( numSlots & ( numSlots - 1 ) ) ||
+			numSlots > ( length - sizeof(Header) ) / sizeof(Slot) ) {
+		return false;
+	}
+
+	const Slot* slots = (const Slot*) ( hdr + 1 );
+	uint64_t nameBytes = length - sizeof(Header) - numSlots * sizeof(Slot);
+	uint64_t used = 0;
+	for ( uint64_t i = 0; i < numSlots; i++ ) {
+		if ( NO_ROUTE == slots[i].app ) {
+			continue;
+		}
+		if ( (uint64_t) slots[i].name + slots[i].length > nameBytes ) {
+			return false;
+		}
+		++used;
+	}
+	return used < numSlots && used == hdr->numEntries;
+}
+
+bool RouteTable::save( const std::string& file )
+{
+	if ( ! m_header ) {
+		return false;
+	}
+	size_t length = m_map ? m_mapLength : m_image.size();
+
+	FILE* fp = fopen( file.c_str(), "w" );
+	if ( NULL == fp ) {
+		return false;
+	}
+	bool ok = length == fwrite( m_header, 1, length, fp );
+	return 0 == fclose( fp ) && ok;
+}
+
+static bool parseID( const char* pos, const char* end, int& id )
+{
+	bool neg = pos < end && '-' == *pos;
+	if ( neg ) {
+		++pos;
+	}
+	if ( pos == end ) {
+		return false;
+	}
+	long val = 0;
+	for ( ; pos < end; ++pos ) {
+		if ( *pos < '0' || *pos > '9' ) {
+			return false;
+		}
+		val = val * 10 + ( *pos - '0' );
+	}
+	id = neg ? -val : val;
+	return true;
+}
+
+bool RouteTable::parse( const char* text, size_t length )
+{
+	struct Line {
+		const char* name;
+		size_t 		length;
+		AppID		app;
+	};
+	std::vector<Line> lines;
+	size_t nameBytes = 0;
+
+	const char* end = text + length;
+	while ( text < end ) {
+		const char* eol = (const char*) memchr( text, '\n', end - text );
+		if ( NULL == eol ) {
+			eol = end;
+		}
+		const char* last = eol;
+		if ( last > text && '\r' == last[-1] ) {
+			--last;
+		}
+
+		if ( last > text ) {
+			const char* pos1 = (const char*) memchr( text, ':', last - text );
+			const char* pos2 = last;
+			while ( pos2 > text && ':' != pos2[-1] ) {
+				--pos2;
+			}
+			int rtrID, srvrID;
+			if ( NULL == pos1 || pos1 + 1 >= pos2 ||
+					! parseID( pos1 + 1, pos2 - 1, rtrID ) ||
+					! parseID( pos2, last, srvrID ) ) {
+				printf("bad route `%.*s`\n", (int) ( last - text ), text );
+				return false;
+			}
+			Line line = { text, (size_t) ( pos1 - text ), 
+									APP_ID( rtrID, srvrID ) };
+			DBGX("%.*s %d %d\n", (int) line.length, line.name,
+													rtrID, srvrID );
+			lines.push_back( line );
+			nameBytes += line.length;
+		}
+		text = eol + 1;
+	}
+
+	uint64_t numSlots = 1;
+	while ( numSlots < 2 * lines.size() ) {
+		numSlots <<= 1;
+	}
+
+	size_t slotsOff = sizeof(Header);
+	size_t namesOff = slotsOff + numSlots * sizeof(Slot);
+	m_image.assign( namesOff + nameBytes, 0 );
+
+	Header* hdr = (Header*) &m_image[0];
+	memcpy( hdr->magic, s_magic, sizeof(s_magic) );
+	hdr->numSlots = numSlots;
+	hdr->numEntries = 0;
+
+	Slot* slots = (Slot*) &m_image[slotsOff];
+	for ( uint64_t i = 0; i < numSlots; i++ ) {
+		slots[i].app = NO_ROUTE;
+	}
+
+	char* names = (char*) &m_image[namesOff];
+	size_t name = 0;
+	for ( size_t i = 0; i < lines.size(); i++ ) {
+		uint64_t h = hash( lines[i].name, lines[i].length );
+		uint64_t slot = h & ( numSlots - 1 );
+
+		// a later line for the same name wins, as it did with the map
+		while ( NO_ROUTE != slots[slot].app && 
+				! ( slots[slot].hash == h && 
+					slots[slot].length == lines[i].length &&
+					0 == memcmp( names + slots[slot].name, lines[i].name,
+											lines[i].length ) ) ) {
+			slot = ( slot + 1 ) & ( numSlots - 1 );
+		}
+		if ( NO_ROUTE == slots[slot].app ) {
+			memcpy( names + name, lines[i].name, lines[i].length );
+			slots[slot].hash = h;
+			slots[slot].name = name;
+			slots[slot].length = lines[i].length;
+			name += lines[i].length;
+			++hdr->numEntries;
+		}
+		slots[slot].app = lines[i].app;
+	}
+	m_image.resize( namesOff + name );
+
+	attach( &m_image[0], m_image.size() );
+	return true;
+}
+
+void RouteTable::attach( const void* image, size_t length )
+{
+	m_header = (const Header*) image;
+	m_slots = (const Slot*) ( m_header + 1 );
+	m_names = (const char*) ( m_slots + m_header->numSlots );
+	m_mask = m_header->numSlots - 1;
+}
+
+AppID RouteTable::find( const std::string& name ) const
+{
+	if ( ! m_header ) {
+		return NO_ROUTE;
+	}
+	uint64_t h = hash( name.data(), name.length() );
+	for ( uint64_t slot = h & m_mask; NO_ROUTE != m_slots[slot].app; 
+										slot = ( slot + 1 ) & m_mask ) {
+		const Slot& s = m_slots[slot];
+		if ( s.hash == h && s.length == name.length() && 
+				0 == memcmp( m_names + s.name, name.data(), s.length ) ) {
+			return s.app;
+		}
+	}
+	return NO_ROUTE;
+}
+
+size_t RouteTable::size() const
+{
+	return m_header ? m_header->numEntries : 0;
+}
@@ -0,0 +1,75 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _RTR_ROUTE_TABLE_H
+#define _RTR_ROUTE_TABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "routerEvent.h"
+
+#define NO_ROUTE ((AppID)-1)
+
+namespace PWR_Router {
+
+// Object name to AppID, kept as an open addressed hash table laid out as
+// one flat image: a header, a power of two number of slots probed
+// linearly, and the names.  The text route file, one `name:rtr:srvr` per
+// line, is hashed into the image when it is loaded.  A table saved with
+// save() is the image itself and is mapped as it is.
+
+class RouteTable {
+  public:
+	RouteTable();
+	~RouteTable();
+
+	bool load( const std::string& file );
+	bool save( const std::string& file );
+
+	AppID find( const std::string& name ) const;
+	size_t size() const;
+
+  private:
+	struct Header {
+		char		magic[8];
+		uint64_t	numSlots;
+		uint64_t	numEntries;
+	};
+
+	struct Slot {
+		uint64_t	hash;
+		AppID		app;
+		uint32_t	name;
+		uint32_t	length;
+	};
+
+	static uint64_t hash( const char* name, size_t length );
+	static bool valid( const Header*, size_t length );
+
+	bool parse( const char* text, size_t length );
+	void attach( const void* image, size_t length );
+	void unmap();
+
+	std::vector<unsigned char>	m_image;
+	void*			m_map;
+	size_t			m_mapLength;
+
+	const Header*	m_header;
+	const Slot*		m_slots;
+	const char*		m_names;
+	uint64_t		m_mask;
+};
+
+}
+
+#endif
@@ -15,7 +15,6 @@
 #include <inttypes.h>
 #include <sys/utsname.h>
 #include <string>
-#include <fstream>
 #include <debug.h>
 #include <stdlib.h>
 #include "router.h"
@@ -24,6 +23,7 @@
 #include "routerCore.h"
 #include "torusCore.h"
 #include "treeCore.h"
+#include "shard.h"
 
 using namespace PWR_Router;
 
@@ -32,18 +32,21 @@ static void initArgs( int argc, char* argv[], Args* );
 Router::Router( int argc, char* argv[] ) :
     m_client( this, &Router::addClientChan, &Router::delClientChan ),
     m_server( this, &Router::addServerChan, &Router::delServerChan ),
-    m_router( this, &Router::addRouterChan, &Router::delRouterChan ),
-    m_chanSelect(NULL)
+    m_router( this, &Router::addRouterChan, &Router::delRouterChan )
 {
     if ( NULL != getenv( "POWERAPI_DEBUG" ) ) {
         _DbgFlags = atoi( getenv( "POWERAPI_DEBUG" ) );
     }
 	initArgs( argc, argv, &m_args );
 
-	m_chanSelect = getChannelSelect( "TCP" );
-
 	Args& args= m_args;
 
+	for ( unsigned i = 0; i < args.threads; i++ ) {
+		m_shards.push_back( new Shard( *this, i ) );
+	}
+	// the channels set up here are shard 0's, it runs on this thread
+	m_shards[0]->makeCurrent();
+
     struct utsname buf;
     int rc = uname( &buf );
     assert( 0 == rc );
@@ -56,15 +59,36 @@ Router::Router( int argc, char* argv[] ) :
     	EventChannel* clientChan =
                 getEventChannel( "TCP", allocClientEvent, 
 						"listenPort=" + args.clientPort, "client-listen" );
-    	m_chanSelect->addChannel( clientChan,
+    	chanSelect().addChannel( clientChan,
 				new AcceptData<EventData>(clientChan, &m_client ) );
+
+		// clients in this process, e.g. the logger, connect in-process
+    	EventChannel* localChan =
+                getEventChannel( "LOCAL", allocClientEvent, 
+						"listenPort=" + args.clientPort, "client-local" );
+    	chanSelect().addChannel( localChan,
+				new AcceptData<EventData>(localChan, &m_client ) );
+
+		// and application processes on this node through shared memory
+    	EventChannel* shmChan =
+                getEventChannel( "SHM", allocClientEvent,
+						"listenPort=" + args.clientPort, "client-shm" );
+    	chanSelect().addChannel( shmChan,
+				new AcceptData<EventData>(shmChan, &m_client ) );
 	}
 	if ( ! args.serverPort.empty()  )  {
     	EventChannel* serverChan =
                 getEventChannel( "TCP", allocServerEvent, 
 						"listenPort=" + args.serverPort, "server-listen" );
-    	m_chanSelect->addChannel( serverChan,
+    	chanSelect().addChannel( serverChan,
 				new AcceptData<EventData>(serverChan, &m_server ) );
+
+		// as do the servers pwrdaemon runs next to the router
+    	EventChannel* localChan =
+                getEventChannel( "LOCAL", allocServerEvent, 
+						"listenPort=" + args.serverPort, "server-local" );
+    	chanSelect().addChannel( localChan,
+				new AcceptData<EventData>(localChan, &m_server ) );
 	}
 
     std::string XPOS_server;
@@ -81,59 +105,182 @@ Router::Router( int argc, char* argv[] ) :
 
 void Router::initRouteTable( std::string file )
 {		
-	std::ifstream fs;
 	DBGX("%s\n",file.c_str());
-	fs.open( file.c_str(), std::ifstream::in  );
-	if ( fs.fail() ) {
+	if ( ! m_routeTable.load( file ) ) {
 		printf("can't read route file `%s`\n", file.c_str());	
 		assert(0);
 	}
+	DBGX("%zu routes\n", m_routeTable.size() );
 
-	std::string tmpStr;	
-	while( ! std::getline( fs, tmpStr, '\n' ).eof() ) {
-		size_t pos1 = tmpStr.find_first_of(":");
-		size_t pos2 = tmpStr.find_last_of(":");
-
-		
-		RouterID rtrID = atoi( tmpStr.substr(pos1+1, pos2-1).c_str() );
-		ServerID srvrID = atoi( tmpStr.substr(pos2+1).c_str() );
-		DBGX("%s %d %d\n",tmpStr.substr(0,pos1).c_str(), rtrID, srvrID );
-
-		m_routeTable[ tmpStr.substr( 0, pos1)  ] = APP_ID( rtrID, srvrID );  
+	// hashed once here, the saved table is mapped as it is next time 
+	if ( ! m_args.saveRouteTable.empty() && 
+				! m_routeTable.save( m_args.saveRouteTable ) ) {
+		printf("can't write route file `%s`\n", 
+							m_args.saveRouteTable.c_str());	
 	}
 }
 
 int Router::work()
 {
-	SelectData* data;
+	for ( unsigned i = 1; i < m_shards.size(); i++ ) {
+		m_shards[i]->start();
+	}
+	return m_shards[0]->work();
+}
+
+ChannelSelect& Router::chanSelect()
+{
+	return Shard::current().chanSelect();
+}
 
-    while ( ( data = static_cast<SelectData*>( m_chanSelect->wait() ) ) ) {
-        if ( data->process( m_chanSelect, this ) ) {
-            delete data;
-        }
-    }
-	return 0;
+unsigned Router::shardId()
+{
+	return Shard::current().id();
 }
 
+CommReqInfo* Router::getCommReqInfo()
+{
+	return Shard::current().getCommReqInfo();
+}
+
+void Router::putCommReqInfo( CommReqInfo* info )
+{
+	Shard::current().putCommReqInfo( info );
+}
+
+// a channel accepted by this shard goes to the next one round robin
+void Router::addChannel( EventChannel* chan, SelectData* data, ChanBase* base )
+{
+	Shard& shard = Shard::current();
+	unsigned to = shard.nextShard( m_shards.size() );
+
+	DBGX("shard %u\n",to);
+	if ( to == shard.id() ) {
+		shard.chanSelect().addChannel( chan, data );
+		base->add( chan );
+	} else {
+		Shard::Work work = { Shard::Work::AddChannel, chan, data, base };
+		shard.post( to, work );
+	}
+}
+
+void Router::addClientChan( EventChannel* ec ) {
+	DBGX("ec=%p\n",ec);
+	ec->setOutputQueue( true );
+	Shard::current().m_clientMap[ec] = new Client(*this);
+}			
+
+void Router::delClientChan( EventChannel* ec ) {
+	DBGX("ec=%p\n",ec);
+	Shard& shard = Shard::current();
+	delete shard.m_clientMap[ec];
+	shard.m_clientMap.erase(ec);
+	reportEventPools();
+}			
+
+void Router::addServerChan( EventChannel* ec ) {
+	DBGX("ec=%p\n",ec);
+	ec->setOutputQueue( true );
+	Shard::current().m_serverMap[ec] = new Server(*this);
+}			
+
+void Router::delServerChan( EventChannel* ec ) {
+	DBGX("ec=%p\n",ec);
+	Shard& shard = Shard::current();
+	delete shard.m_serverMap[ec];
+	shard.m_serverMap.erase(ec);
+}			
+
+Router::Client* Router::getClient( EventChannel* ec ) {
+	Shard& shard = Shard::current();
+	assert ( shard.m_clientMap.find(ec) != shard.m_clientMap.end() );
+	return shard.m_clientMap[ec];
+}
+
+// the other shards are told which one has the server, they send it what
+// they have been holding for it
+ServerID Router::addServer( std::string name, EventChannel* ec ) {
+	AppID id = findRoute( name );
+
+	DBGX("rootObj=`%s` rtrId=%d serverId=%d\n",
+		name.c_str(), RTR_ID(id), SERVER_ID(id)  );
+
+	assert( NO_ROUTE != id );
+
+	Shard& shard = Shard::current();
+	shard.m_localMap[ SERVER_ID(id) ] = ec;
+	shard.m_serverMap[ ec ]->initName(name);
+	shard.m_serverShard[ SERVER_ID(id) ] = shard.id();
+
+	Shard::Work work = { Shard::Work::ServerUp };
+	work.server = SERVER_ID(id);
+	work.shard = shard.id();
+	for ( unsigned i = 0; i < m_shards.size(); i++ ) {
+		if ( i != shard.id() ) {
+			shard.post( i, work );
+		}
+	}
+	return SERVER_ID(id);
+}
+
+void Router::delServer( std::string name ) {
+	DBGX("%s\n",name.c_str());
+	//assert( m_localMap.find(name) != m_localMap.end() );
+	Shard::current().m_localMap.erase( 0 );
+}
 
 void Router::sendEvent( ObjID destObj, Event* ev ) {
 	AppID destID = findDestApp( destObj );
 	DBGX("dest=`%s` AppID=%" PRIx64 "\n", destObj.c_str(), destID );
-	if ( (unsigned) -1 == destID ) {
+	if ( NO_ROUTE == destID ) {
 		printf("Could not route %s, drop event\n",destObj.c_str());
 		return;
 	}
 	sendEvent( destID, ev ); 	
 }
 
+// Sends from the shard the destination's channel is on, events for other
+// shards go to them as RouterEvents.  The event stays the caller's.
 void Router::sendEvent( AppID dest, Event* ev ) {
 
+	Shard& shard = Shard::current();
 	ServerID srvrID = SERVER_ID( dest );
 	RouterID rtrID  = RTR_ID( dest );
 	EventChannel* ec = NULL; 
-	Event* rev = NULL;
 
 	DBGX("rtr=%d srvr=%d\n",rtrID, srvrID );
+
+	if ( ev->type == Router2Router && 
+				rtrID == m_args.rtrId && (unsigned) -1 == srvrID ) {
+		RouterEvent* rev = static_cast<RouterEvent*>(ev);
+		Event* pev = rev->getPayload( allocServerEvent );
+		unsigned owner = ((CommReqInfo*) pev->id)->shard;
+
+		DBGX("call process on shard %u\n",owner);
+		if ( owner == shard.id() ) {
+			if ( pev->process( this ) ) {
+				pev->release();
+			}
+		} else {
+			Shard::Work work = { Shard::Work::Process };
+			work.ev = pev;
+			work.shard = shard.id();
+			shard.post( owner, work );
+		}
+		return;
+	} 
+
+	unsigned owner = rtrID == m_args.rtrId ? shard.serverShard( srvrID ) : 0;
+	AppID src = APP_ID( m_args.rtrId, -1 );
+
+	if ( owner != shard.id() ) {
+		Shard::Work work = { Shard::Work::Send };
+		work.ev = newRouterEvent( src, dest, ev );
+		work.shard = shard.id();
+		shard.post( owner, work );
+		return;
+	}
+
 	if ( rtrID == m_args.rtrId ) {
 		DBGX("local channel\n");
 		ec = findServerChan( srvrID ); 
@@ -143,41 +290,42 @@ void Router::sendEvent( AppID dest, Event* ev ) {
 		assert(ec);
 	}
 
-	if ( ev->type == Router2Router ) {
-		RouterEvent* rev = static_cast<RouterEvent*>(ev);
+	if ( ! ec ) {
+		shard.m_pendingEvents[srvrID].push_back( 
+								newRouterEvent( src, dest, ev ) );
+		DBGX("add pending %d\n",srvrID);
+	} else if ( ev->type == Router2Router ) {
 		DBGX("is RouterEvent\n");
-
-		if ( rtrID == m_args.rtrId && (unsigned) -1 == srvrID ) {
-			Event* pev = rev->getPayload( allocServerEvent );
-			DBGX("call process\n");
-			if ( pev->process( this ) ) {
-				delete pev;
-			}
-			return;
-		} 
-
+		ec->sendEvent( ev );
 	} else {
-		DBGX("rtrId %d\n",m_args.rtrId);
-		AppID src = APP_ID( m_args.rtrId, -1 );
 		DBGX("create RouterEvent src=%#"PRIx64" dest=%#"PRIx64"\n",src,dest);
-		rev = new RouterEvent( src, dest, ev );
-		ev = rev;
+		shard.m_sendEvent.src = src;
+		shard.m_sendEvent.dest = dest;
+		shard.m_sendEvent.initPayload( ev, ec->getVersion() );
+		ec->sendEvent( &shard.m_sendEvent );
 	}
+}
 
-	if ( ! ec ) {
-		m_pendingEvents[srvrID].push_back( ev );
-		DBGX("add pending %d\n",srvrID);
-	} else {
-		ec->sendEvent( ev );
-		if ( rev ) {
-			delete rev;
-		}
+// a copy of a RouterEvent, or ev wrapped in one, to keep, from the
+// shard's pool and released to it
+RouterEvent* Router::newRouterEvent( AppID src, AppID dest, Event* ev ) {
+	RouterEvent* rev = Shard::current().getRouterEvent();
+	if ( ev->type == Router2Router ) {
+		*rev = *static_cast<RouterEvent*>(ev);
+		return rev;
 	}
+	rev->id = 0;
+	rev->status = 0;
+	rev->src = src;
+	rev->dest = dest;
+	rev->initPayload( ev, PROTO_VERSION );
+	return rev;
 }
 
 void Router::doPending( ServerID id )
 {
-	if ( m_pendingEvents.find( id ) == m_pendingEvents.end() ) {
+	Shard& shard = Shard::current();
+	if ( shard.m_pendingEvents.find( id ) == shard.m_pendingEvents.end() ) {
 		return;
 	}
 
@@ -185,12 +333,14 @@ void Router::doPending( ServerID id )
 	assert(ec);
 
 	DBGX("have pending for server %d\n",id);
-	while ( ! m_pendingEvents[id].empty() ) {
+	std::deque<Event*>& pending = shard.m_pendingEvents[id];
+	while ( ! pending.empty() ) {
 		DBGX("sent pending %d\n",id);
-		ec->sendEvent( m_pendingEvents[id].front() );	
-		m_pendingEvents[id].pop_front();
+		ec->sendEvent( pending.front() );	
+		pending.front()->release();
+		pending.pop_front();
 	}
-	m_pendingEvents.erase(id);
+	shard.m_pendingEvents.erase(id);
 }
 
 AppID Router::findDestApp( ObjID id ) {
@@ -207,7 +357,7 @@ EventChannel* Router::findServerChan( ServerID id ) {
 	if ( (unsigned) -1 == id  ) {
 		return NULL;
 	} else {
-		return m_localMap[id];
+		return Shard::current().m_localMap[id];
 	}
 }
 
@@ -223,7 +373,8 @@ static void initArgs( int argc, char* argv[], Args* args )
 {
     int opt = 0;
     int long_index = 0;
-    enum { CLNT_PORT, SRVR_PORT, RTR_TYPE, RTR_INFO, RTR_ID, PWRAPI_CONFIG, RTR_TABLE };
+    enum { CLNT_PORT, SRVR_PORT, RTR_TYPE, RTR_INFO, RTR_ID, PWRAPI_CONFIG, RTR_TABLE,
+			RTR_SAVE_TABLE, RTR_THREADS };
     static struct option long_options[] = {
         {"clientPort"           , required_argument, NULL, CLNT_PORT },
         {"serverPort"           , required_argument, NULL, SRVR_PORT },
@@ -231,6 +382,8 @@ static void initArgs( int argc, char* argv[], Args* args )
         {"routerInfo"           , required_argument, NULL, RTR_INFO },
         {"routerId"             , required_argument, NULL, RTR_ID },
         {"routeTable"           , required_argument, NULL, RTR_TABLE },
+        {"saveRouteTable"       , required_argument, NULL, RTR_SAVE_TABLE },
+        {"threads"              , required_argument, NULL, RTR_THREADS },
         {0,0,0,0}
     };
 
@@ -250,6 +403,12 @@ static void initArgs( int argc, char* argv[], Args* args )
           case RTR_TABLE:
             args->routeTable = optarg;
             break;
+          case RTR_SAVE_TABLE:
+            args->saveRouteTable = optarg;
+            break;
+          case RTR_THREADS:
+            args->threads = atoi(optarg);
+            break;
           case RTR_TYPE:
 			assert( ! args->coreArgs ); 
 			if ( 0 == strcmp( optarg, "torus" ) ) {
@@ -277,7 +436,7 @@ static void initArgs( int argc, char* argv[], Args* args )
     }
 
     if ( (RouterID) -1 == args->rtrId 
-		|| args->routeTable.empty() ) {
+		|| args->routeTable.empty() || 0 == args->threads ) {
         print_usage();
         exit(-1);
     }
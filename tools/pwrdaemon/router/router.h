@@ -25,6 +25,9 @@
 #include <tcpEventChannel.h>
 #include "routerEvent.h"
 #include "commCreateEvent.h"
+#include "commMembers.h"
+#include "routeTable.h"
+#include "valueAcc.h"
 #include "routerCore.h"
 #include "impTypes.h"
 
@@ -39,11 +42,15 @@ class Config;
 
 namespace PWR_Router {
 
+class Shard;
+struct CommReqInfo;
 
 struct Args {
-    Args( ) : rtrId(-1), coreArgs(NULL) { }
+    Args( ) : rtrId(-1), threads(1), coreArgs(NULL) { }
     RouterID   	rtrId;
+	unsigned	threads;
 	std::string routeTable;
+	std::string saveRouteTable;
     std::string	serverPort;
     std::string clientPort;
 
@@ -77,11 +84,29 @@ class Router : public EventGenerator {
 	  public:
 		Client( Router& rtr );
 		~Client();
+		struct Dest {
+			AppID	app;
+			size_t	grp;
+		};
+
+		// the members are routed once, when the servers are told about
+		// the communicator, requests go to the AppIDs kept here
+		struct Comm {
+			Comm( CommCreateEvent* _ev ) : ev( _ev ), numGroups( 0 ),
+				created( false ) {}
+			CommCreateEvent*	ev;
+			size_t				numGroups;
+			std::vector<Dest>	dests;
+			bool				created;
+		};
+
 		void addComm( CommID id, CommCreateEvent* ev );
-		std::vector< std::vector< ObjID > >& getCommList( CommID id );
+		Comm& getComm( CommID id );
 
 	  private:	  
-		std::map<CommID,CommCreateEvent* > m_commMap;
+		void createComm( Comm& );
+
+		std::map<CommID,Comm > m_commMap;
 		Router& 		m_rtr;
 	};
 
@@ -105,29 +130,9 @@ class Router : public EventGenerator {
 
 	Router( int, char* [] );
 
-	ServerID addServer( std::string name, EventChannel* ec ) {
-		AppID id = findRoute( name );
-
-		DBGX("rootObj=`%s` rtrId=%d serverId=%d\n",
-			name.c_str(), RTR_ID(id), SERVER_ID(id)  );
-
-		assert( (unsigned) -1 != id );
-
-		m_localMap[ SERVER_ID(id) ] = ec;
-		m_serverMap[ ec ]->initName(name);
-		return SERVER_ID(id);
-	}
-
-	void delServer( std::string name ) {
-		DBGX("%s\n",name.c_str());
-		//assert( m_localMap.find(name) != m_localMap.end() );
-		m_localMap.erase( 0 );
-	}
-
-	Client* getClient( EventChannel* ec ) {
-		assert ( m_clientMap.find(ec) != m_clientMap.end() );
-		return m_clientMap[ec];
-	}
+	ServerID addServer( std::string name, EventChannel* ec );
+	void delServer( std::string name );
+	Client* getClient( EventChannel* ec );
 
 	void sendEvent( AppID, Event* );
 	void sendEvent( ObjID, Event* );
@@ -140,45 +145,33 @@ class Router : public EventGenerator {
 	Chan m_server;
 	Chan m_router;
 
-	ChannelSelect& chanSelect() { return *m_chanSelect; }
+	// of the shard the calling thread runs
+	ChannelSelect& chanSelect();
+	unsigned shardId();
+	CommReqInfo* getCommReqInfo();
+	void putCommReqInfo( CommReqInfo* );
+
+	Shard& getShard( unsigned id ) { return *m_shards[id]; }
+	void addChannel( EventChannel*, SelectData*, ChanBase* );
 
 	void doPending( ServerID );
 
   private:
 
+	RouterEvent* newRouterEvent( AppID src, AppID dest, Event* );
 	EventChannel* findRtrChan( RouterID );
 	EventChannel* findServerChan( ServerID );
 
 	AppID findRoute( ObjID id ) {
-		AppID retval = -1;
-		if ( m_routeTable.find(id) != m_routeTable.end() ) {
-			retval = m_routeTable[id];
-		}
+		AppID retval = m_routeTable.find( id );
 		DBGX("name=`%s` AppID=%"PRIx64"\n", id.c_str(), retval  )
     	return retval;
 	}
 
-	void addClientChan( EventChannel* ec) {
-		DBGX("ec=%p\n",ec);
-		m_clientMap[ec] = new Client(*this);
-	}			
-
-	void delClientChan( EventChannel* ec ) {
-		DBGX("ec=%p\n",ec);
-		delete m_clientMap[ec];
-		m_clientMap.erase(ec);
-	}			
-
-	void addServerChan( EventChannel* ec) {
-		DBGX("ec=%p\n",ec);
-		m_serverMap[ec] = new Server(*this);
-	}			
-
-	void delServerChan( EventChannel* ec ) {
-		DBGX("ec=%p\n",ec);
-		delete m_serverMap[ec];
-		m_serverMap.erase(ec);
-	}			
+	void addClientChan( EventChannel* ec);
+	void delClientChan( EventChannel* ec );
+	void addServerChan( EventChannel* ec);
+	void delServerChan( EventChannel* ec );
 
 	void addRouterChan( EventChannel* ec) {
 		DBGX("\n");
@@ -191,26 +184,24 @@ class Router : public EventGenerator {
 
 
   private:
-	ChannelSelect* 			 		m_chanSelect;
-
-	std::map<EventChannel*,Server*>	m_serverMap;
-	std::map<EventChannel*,Client*>	m_clientMap;
-
-	std::map<ServerID,EventChannel*> m_localMap;
+	std::vector<Shard*>				m_shards;
 	RouterCore* 					m_routerCore;
-	std::map< std::string, AppID >  m_routeTable;
-	std::map< AppID, std::deque< Event*> > 	m_pendingEvents;
+	RouteTable						m_routeTable;
 };
 
 struct CommReqInfo {
    	EventChannel*   src;
     CommEvent*      ev;
+	// the shard src is on, the responses are handed to it
+	unsigned		shard;
+	// per group the responses still due, and the reduction of the ones
+	// in so far which goes once the group is complete
 	std::vector<size_t>	grpInfo;
+	std::vector< std::vector< ValueAcc > >	acc;
 
 	size_t			pending;
 
 	std::vector<ValueOp>		valueOp;
-	std::vector< std::vector< CommRespEvent* > > 	respQ; 
 	CommEvent* resp;
 };
 
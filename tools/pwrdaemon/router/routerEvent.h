@@ -13,6 +13,7 @@
 #define _ROUTER_EVENT_H
 
 #include <event.h>
+#include <events.h>
 
 typedef uint64_t AppID;
 
@@ -31,12 +32,18 @@ struct RouterEvent : public Event {
         serialize_in(buf);
     }
 
-	void initPayload( Event* ev ) {
+    RouterEvent( ) : Event( Router2Router ) {}
+
+	// encoded in the version of the channel it is about to go out on
+	void initPayload( Event* ev, unsigned int version = PROTO_VERSION_FIXED ) {
+		payload.clear();
+		payload.version = version;
 		ev->serialize_out( payload );
 		eventType = (EventType) ev->type;
 	}
 
 	Event* getPayload( AllocFuncPtr alloc ) {
+		payload.rewind();
 		return alloc( eventType, payload ); 
 	}
 
@@ -50,15 +57,35 @@ struct RouterEvent : public Event {
         buf << dest;
         buf << src;
 		buf << eventType;
-		buf << payload.buf;
+		if ( payload.version == buf.version ) {
+			buf << payload.buf;
+		} else {
+			// the payload is in the encoding of the hop it arrived on
+			SerialBuf tmp;
+			tmp.version = buf.version;
+			payload.rewind();
+			Event* ev = allocBaseEvent( eventType, payload );
+			ev->serialize_out( tmp );
+			delete ev;
+			buf << tmp.buf;
+		}
     }
 
     virtual void serialize_in( SerialBuf& buf ) {
-		buf >> payload.buf;
-		buf >> eventType;
-        buf >> src;
-        buf >> dest;
-        Event::serialize_in(buf);
+		if ( buf.backward() ) {
+			buf >> payload.buf;
+			buf >> eventType;
+			buf >> src;
+			buf >> dest;
+			Event::serialize_in(buf);
+		} else {
+			Event::serialize_in(buf);
+			buf >> dest;
+			buf >> src;
+			buf >> eventType;
+			buf >> payload.buf;
+		}
+		payload.version = buf.version;
     }
 };
 
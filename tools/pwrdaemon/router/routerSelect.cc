@@ -16,32 +16,40 @@
 
 using namespace PWR_Router;
 
+void SelectData::addChannel( Router* rtr, EventChannel* chan, SelectData* data,
+												ChanBase* base ) {
+	rtr->addChannel( chan, data, base );
+}
+
+// every event already buffered on the channel is handled per wakeup
 bool EventData::process( ChannelSelect* sel, Router* rtr ) {
-    Event* event = m_chan->getEvent();
-    if ( NULL == event ) {
-        DBGX("channel closed\n");
-        sel->delChannel( m_chan );
-        m_rtrChan->del( m_chan );
-        delete m_chan;
-		return true;
-    } else {
+	do {
+    	Event* event = m_chan->getEvent();
+    	if ( NULL == event ) {
+        	DBGX("channel closed\n");
+        	sel->delChannel( m_chan );
+        	m_rtrChan->del( m_chan );
+        	delete m_chan;
+			return true;
+    	}
         if ( event->process( static_cast<EventGenerator*>(rtr), m_chan ) ) {
-			delete event;
+			event->release();
 		}
-		return false;
-    }
+	} while ( m_chan->pending() );
+	return false;
 }
 
 bool RouterData::process( ChannelSelect* sel, Router* rtr ) {
-    Event* event = m_chan->getEvent();
-    if ( NULL == event ) {
-        DBGX("channel closed\n");
-		m_chan->close();
-		return false;
-    } else {
+	do {
+    	Event* event = m_chan->getEvent();
+    	if ( NULL == event ) {
+        	DBGX("channel closed\n");
+			m_chan->close();
+			return false;
+    	}
         if ( event->process( static_cast<EventGenerator*>(rtr), m_chan ) ) {
-			delete event;
+			event->release();
 		}
-		return false;
-    }
+	} while ( m_chan->pending() );
+	return false;
 }
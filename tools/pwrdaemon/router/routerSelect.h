@@ -33,6 +33,9 @@ class SelectData : public ChannelSelect::Data {
 	virtual bool process( ChannelSelect*, Router* ) = 0;
 
   protected:
+	// on the router's shards, see Router::addChannel()
+	static void addChannel( Router*, EventChannel*, SelectData*, ChanBase* );
+
 	EventChannel* m_chan;
 	ChanBase*	  m_rtrChan;
 };
@@ -46,8 +49,11 @@ class AcceptData : public SelectData {
 
     bool process( ChannelSelect* sel, Router* rtr ) {
         EventChannel* newChan = m_chan->accept();
-        sel->addChannel( newChan, new T( newChan, m_rtrChan ) );
-		m_rtrChan->add( newChan );
+		// the listener refused the connection
+		if ( NULL == newChan ) {
+			return false;
+		}
+        addChannel( rtr, newChan, new T( newChan, m_rtrChan ), m_rtrChan );
         return false;
     }
 };
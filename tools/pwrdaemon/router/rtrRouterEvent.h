@@ -23,6 +23,8 @@ class RtrRouterEvent: public  RouterEvent {
   public:
     RtrRouterEvent( SerialBuf& buf ) : RouterEvent( buf ) {}
 
+	void release() { EventPool<RtrRouterEvent>::put( this ); }
+
     bool process( EventGenerator* _rtr, EventChannel* ec ) {
         Router& rtr = *static_cast<Router*>(_rtr);
 		DBGX("dest=%"PRIx64"\n",dest);
@@ -26,6 +26,7 @@ class RtrServerConnectEvent: public  ServerConnectEvent {
 	bool process( EventGenerator* _rtr, EventChannel* ec ) {
         Router& rtr = *static_cast<Router*>(_rtr);
 		ServerID id = rtr.addServer( name, ec );
+		ec->setVersion( version );
 
 		rtr.doPending( id );
 //        Router::Server& server = *rtr.getServer( ec );
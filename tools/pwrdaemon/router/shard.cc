@@ -0,0 +1,349 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <debug.h>
+#include "shard.h"
+#include "routerSelect.h"
+
+using namespace PWR_Router;
+
+__thread Shard* Shard::s_current;
+
+// shard is the one that allocated the node, the inbox's first dummy has
+// none and is deleted
+struct Shard::Node {
+	Node() : next(NULL), shard(-1) {}
+	Node*				next;
+	unsigned			shard;
+	std::vector<Work>	work;
+};
+
+// a RouterEvent kept for a send, release() is only called on the shard
+// that allocated it
+struct KeptRouterEvent : public RouterEvent {
+	void release() { Shard::current().putRouterEvent( this ); }
+};
+
+// Multi-producer single-consumer queue, producers swap themselves in at
+// the head and the consumer follows next pointers from a dummy node at
+// the tail.  The eventfd only wakes the consumer up, it takes everything
+// that is linked in by then.
+class Shard::Inbox : public EventChannel {
+  public:
+	Inbox( std::string name ) : EventChannel( NULL, name ) {
+		m_head = m_tail = new Node;
+		m_fd = eventfd( 0, EFD_NONBLOCK );
+		assert( m_fd >= 0 );
+	}
+	~Inbox() {
+		while ( m_tail ) {
+			Node* next = m_tail->next;
+			delete m_tail;
+			m_tail = next;
+		}
+		::close( m_fd );
+	}
+
+	void push( Node* node ) {
+		node->next = NULL;
+		Node* prev = __atomic_exchange_n( &m_head, node, __ATOMIC_ACQ_REL );
+		__atomic_store_n( &prev->next, node, __ATOMIC_RELEASE );
+
+		uint64_t one = 1;
+		ssize_t nbytes;
+		do {
+			nbytes = write( m_fd, &one, sizeof(one) );
+		} while ( nbytes < 0 && EINTR == errno );
+		assert( nbytes == sizeof(one) );
+	}
+
+	// NULL once the consumer has caught up with what is linked in, a 
+	// producer that has swapped the head but not linked it yet writes the
+	// eventfd after it does.  The node returned is the dummy from then on,
+	// the one that was is done with.
+	Node* pop( Node*& done ) {
+		Node* next = __atomic_load_n( &m_tail->next, __ATOMIC_ACQUIRE );
+		if ( NULL == next ) {
+			return NULL;
+		}
+		done = m_tail;
+		m_tail = next;
+		return next;
+	}
+
+	void clear() {
+		uint64_t cnt;
+		while ( read( m_fd, &cnt, sizeof(cnt) ) < 0 && EINTR == errno );
+	}
+
+	Event* getEvent( bool blocking = true ) { assert(0); return NULL; }
+	bool sendEvent( Event* ) { assert(0); return false; }
+	int getFd() { return m_fd; }
+	bool pending() {
+		return NULL != __atomic_load_n( &m_tail->next, __ATOMIC_ACQUIRE );
+	}
+
+  private:
+	Node*	m_head;
+	Node*	m_tail;
+	int		m_fd;
+};
+
+class Shard::InboxData : public SelectData {
+  public:
+	InboxData( Shard& shard ) : SelectData( shard.m_inbox, NULL ), 
+		m_shard( shard ) {}
+
+	bool process( ChannelSelect*, Router* ) {
+		m_shard.drain();
+		return false;
+	}
+  private:
+	Shard&	m_shard;
+};
+
+Shard::Shard( Router& rtr, unsigned id ) : m_rtr( rtr ), m_id( id ), 
+	m_nextShard( id ), m_chanSelect( NULL ), m_inbox( NULL ), m_thread( 0 ),
+	m_returned( NULL )
+{
+	DBGX("id=%u\n",id);
+	m_chanSelect = getChannelSelect( "EPOLL" );
+	m_inbox = new Inbox( "shard-inbox" );
+	m_chanSelect->addChannel( m_inbox, new InboxData( *this ) );
+	m_outbox.resize( rtr.m_args.threads );
+}
+
+Shard::~Shard()
+{
+	m_chanSelect->delChannel( m_inbox );
+	delete m_chanSelect;
+	delete m_inbox;
+
+	while ( m_returned ) {
+		Node* next = m_returned->next;
+		delete m_returned;
+		m_returned = next;
+	}
+	for ( unsigned i = 0; i < m_freeNodes.size(); i++ ) {
+		delete m_freeNodes[i];
+	}
+	for ( unsigned i = 0; i < m_freeRouterEvents.size(); i++ ) {
+		delete m_freeRouterEvents[i];
+	}
+	for ( unsigned i = 0; i < m_freeCommReqInfos.size(); i++ ) {
+		delete m_freeCommReqInfos[i]->resp;
+		delete m_freeCommReqInfos[i];
+	}
+}
+
+void* Shard::thread( void* arg )
+{
+	return (void*) (unsigned long) static_cast<Shard*>(arg)->work();
+}
+
+void Shard::start()
+{
+	int rc = pthread_create( &m_thread, NULL, thread, this );
+	assert( 0 == rc );
+}
+
+int Shard::work()
+{
+	makeCurrent();
+
+	std::vector<ChannelSelect::Data*> ready;
+
+	while ( 1 ) {
+		ready.clear();
+		m_chanSelect->wait( ready );
+
+		for ( unsigned int i = 0; i < ready.size(); i++ ) {
+			SelectData* data = static_cast<SelectData*>( ready[i] );
+        	if ( data->process( m_chanSelect, &m_rtr ) ) {
+            	delete data;
+        	}
+		}
+		flush();
+    }
+	return 0;
+}
+
+void Shard::post( unsigned shard, const Work& work )
+{
+	DBGX("shard %u -> %u type %d\n", m_id, shard, work.type );
+	m_outbox[shard].push_back( work );
+}
+
+void Shard::release( unsigned shard, Event* ev )
+{
+	if ( shard == m_id ) {
+		ev->release();
+	} else {
+		Work work = { Work::Release };
+		work.ev = ev;
+		post( shard, work );
+	}
+}
+
+RouterEvent* Shard::getRouterEvent()
+{
+	if ( m_freeRouterEvents.empty() ) {
+		return new KeptRouterEvent;
+	}
+	RouterEvent* ev = m_freeRouterEvents.back();
+	m_freeRouterEvents.pop_back();
+	return ev;
+}
+
+void Shard::putRouterEvent( RouterEvent* ev )
+{
+	if ( m_freeRouterEvents.size() == EVENT_POOL_LEN ) {
+		delete ev;
+	} else {
+		m_freeRouterEvents.push_back( ev );
+	}
+}
+
+// the vectors of the info and its response keep their capacity
+CommReqInfo* Shard::getCommReqInfo()
+{
+	if ( m_freeCommReqInfos.empty() ) {
+		CommReqInfo* info = new CommReqInfo;
+		info->resp = new CommRespEvent;
+		return info;
+	}
+	CommReqInfo* info = m_freeCommReqInfos.back();
+	m_freeCommReqInfos.pop_back();
+
+	CommRespEvent* resp = static_cast<CommRespEvent*>( info->resp );
+	resp->errValue.clear();
+	resp->errAttr.clear();
+	resp->errObj.clear();
+	resp->errHandle.clear();
+	return info;
+}
+
+void Shard::putCommReqInfo( CommReqInfo* info )
+{
+	if ( m_freeCommReqInfos.size() == EVENT_POOL_LEN ) {
+		delete info->resp;
+		delete info;
+	} else {
+		m_freeCommReqInfos.push_back( info );
+	}
+}
+
+// a node of this shard's, the ones other shards gave back are taken all
+// at once when there are no others
+Shard::Node* Shard::getNode()
+{
+	if ( m_freeNodes.empty() ) {
+		Node* node = __atomic_exchange_n( &m_returned, NULL, __ATOMIC_ACQUIRE );
+		for ( ; node; node = node->next ) {
+			m_freeNodes.push_back( node );
+		}
+	}
+	if ( m_freeNodes.empty() ) {
+		Node* node = new Node;
+		node->shard = m_id;
+		return node;
+	}
+	Node* node = m_freeNodes.back();
+	m_freeNodes.pop_back();
+	return node;
+}
+
+// back to the shard that allocated it, the vector keeps its capacity
+void Shard::putNode( Node* node )
+{
+	if ( node->shard >= m_outbox.size() ) {
+		delete node;
+		return;
+	}
+	Shard& owner = m_rtr.getShard( node->shard );
+	node->next = __atomic_load_n( &owner.m_returned, __ATOMIC_RELAXED );
+	while ( ! __atomic_compare_exchange_n( &owner.m_returned, &node->next, 
+				node, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
+}
+
+void Shard::flush()
+{
+	for ( unsigned i = 0; i < m_outbox.size(); i++ ) {
+		if ( m_outbox[i].empty() ) {
+			continue;
+		}
+		// the outbox gets the node's emptied vector
+		Node* node = getNode();
+		node->work.swap( m_outbox[i] );
+		m_rtr.getShard( i ).m_inbox->push( node );
+	}
+}
+
+void Shard::drain()
+{
+	m_inbox->clear();
+
+	Node* node;
+	Node* done;
+	while ( ( node = m_inbox->pop( done ) ) ) {
+		putNode( done );
+		for ( unsigned i = 0; i < node->work.size(); i++ ) {
+			run( node->work[i] );
+		}
+		node->work.clear();
+	}
+}
+
+void Shard::run( Work& work )
+{
+	switch ( work.type ) {
+	  case Work::AddChannel:
+		m_chanSelect->addChannel( work.chan, work.data );
+		work.base->add( work.chan );
+		break;
+
+	  case Work::ServerUp:
+		DBGX("server %u is on shard %u\n", work.server, work.shard );
+		m_serverShard[ work.server ] = work.shard;
+		if ( m_pendingEvents.find( work.server ) != m_pendingEvents.end() ) {
+			std::deque<Event*>& pending = m_pendingEvents[ work.server ];
+			Work send = { Work::Send };
+			send.shard = m_id;
+			for ( unsigned i = 0; i < pending.size(); i++ ) {
+				send.ev = pending[i];
+				post( work.shard, send );
+			}
+			m_pendingEvents.erase( work.server );
+		}
+		break;
+
+	  case Work::Send: {
+		RouterEvent* ev = static_cast<RouterEvent*>( work.ev );
+		m_rtr.sendEvent( ev->dest, ev );
+		release( work.shard, ev );
+		break;
+	  }
+
+	  case Work::Process:
+		if ( work.ev->process( &m_rtr, NULL ) ) {
+			release( work.shard, work.ev );
+		}
+		break;
+
+	  case Work::Release:
+		work.ev->release();
+		break;
+	}
+}
@@ -0,0 +1,135 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _RTR_SHARD_H
+#define _RTR_SHARD_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include "router.h"
+
+namespace PWR_Router {
+
+// One of the router's event loops, on a thread of its own.  A channel
+// belongs to the shard whose ChannelSelect it is on and only that shard's
+// thread reads from it, sends on it, or touches what the router keeps for
+// it.  Listening channels are on shard 0, which deals the channels it
+// accepts out round robin, and so are the links to other routers.
+//
+// Shards hand each other Work through a lock-free multi-producer queue 
+// per shard, the same kind LocalEventChannel uses, with an eventfd that
+// the shard's ChannelSelect waits on.  Work posted while a batch of ready
+// channels is handled is queued per destination and goes out as one node
+// once the batch is done.
+//
+// Event pools are per thread, so an event another shard is done with is
+// handed back to the shard that allocated it, in the next node that goes
+// there.  The nodes and the RouterEvents kept for other shards are pooled
+// the same way.
+
+class Shard {
+  public:
+	struct Work {
+		enum Type { 
+			AddChannel, 	// chan, data and base, accepted by another shard
+			ServerUp,		// server is now on shard
+			Send,			// ev, a RouterEvent of shard to send
+			Process,		// ev, a response to a request of this shard,
+							// decoded by shard
+			Release 		// ev, allocated by this shard and done with
+		} type;
+		EventChannel*	chan;
+		SelectData*		data;
+		ChanBase*		base;
+		ServerID		server;
+		unsigned		shard;
+		Event*			ev;
+	};
+
+	Shard( Router&, unsigned id );
+	~Shard();
+
+	static Shard& current() { return *s_current; } 
+
+	unsigned id() { return m_id; }
+	ChannelSelect& chanSelect() { return *m_chanSelect; }
+
+	void post( unsigned shard, const Work& );
+
+	// ev, allocated by shard, is done with
+	void release( unsigned shard, Event* ev );
+
+	// copies of RouterEvents, to keep until they are sent
+	RouterEvent* getRouterEvent();
+	void putRouterEvent( RouterEvent* );
+
+	// the CommReqInfo of a read or write of a client of this shard, with
+	// a CommRespEvent for its response that has no errors in it
+	CommReqInfo* getCommReqInfo();
+	void putCommReqInfo( CommReqInfo* );
+	void makeCurrent() { s_current = this; }
+	void start();
+	int work();
+
+	// channels this shard accepted are spread from here
+	unsigned nextShard( unsigned num ) { return m_nextShard++ % num; }
+
+	// shard the server is on, this one until it has connected somewhere
+	unsigned serverShard( ServerID id ) {
+		std::map<ServerID,unsigned>::iterator iter = m_serverShard.find(id);
+		return iter == m_serverShard.end() ? m_id : iter->second;
+	}
+
+	std::map<EventChannel*,Router::Server*>	m_serverMap;
+	std::map<EventChannel*,Router::Client*>	m_clientMap;
+	std::map<ServerID,EventChannel*> 		m_localMap;
+	std::map<ServerID,unsigned>				m_serverShard;
+	std::map< ServerID, std::deque< Event*> > 	m_pendingEvents;
+
+	// wraps events sent right away, its payload buffer is reused
+	RouterEvent						m_sendEvent;
+
+  private:
+	struct Node;
+	class Inbox;
+	class InboxData;
+
+	static void* thread( void* );
+	Node* getNode();
+	void putNode( Node* );
+	void flush();
+	void drain();
+	void run( Work& );
+
+	static __thread Shard*	s_current;
+
+	Router&			m_rtr;
+	unsigned		m_id;
+	unsigned		m_nextShard;
+	ChannelSelect*	m_chanSelect;
+	Inbox*			m_inbox;
+	pthread_t		m_thread;
+	std::vector< std::vector<Work> >	m_outbox;
+
+	// nodes of this shard's that other shards are done with come back
+	// on m_returned, a stack they push on and only this shard takes all of
+	Node*				m_returned;
+	std::vector<Node*>	m_freeNodes;
+	std::vector<RouterEvent*>	m_freeRouterEvents;
+	std::vector<CommReqInfo*>	m_freeCommReqInfos;
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/* 
+ * Copyright 2014-2016 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000, there is a non-exclusive license for use of this work 
+ * by or on behalf of the U.S. Government. Export of this program may require
+ * a license from the United States Government.
+ *
+ * This file is part of the Power API Prototype software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+*/
+
+
+#ifndef _RTR_VALUE_ACC_H
+#define _RTR_VALUE_ACC_H
+
+#include <string.h>
+#include <algorithm>
+#include <pwrtypes.h>
+#include <impTypes.h>
+
+namespace PWR_Router {
+
+// The running reduction of one attribute over the members of a group.
+// Averages are kept as a sum and the number of values in it, so partial
+// reductions combine into what reducing all the values at once gives.
+// Values travel as the bits of a double whatever the attribute's type,
+// the client reduces them as doubles too, so an INT_ op reduces like its
+// FP_ one.  A value that is one object's, a minimum, a maximum or one
+// that is not reduced, keeps the client's handle of the object it came
+// from.  A router above folds that in like any server's, so the object
+// that wins at the top of a tree is the one the client gets.
+
+struct ValueAcc {
+	ValueAcc() : acc( 0 ), count( 0 ), obj( NO_HANDLE ), timeStamp( 0 ) { }
+
+	void fold( ValueOp op, uint64_t bits, uint64_t num, ObjHandle from,
+											PWR_Time ts ) {
+		double in;
+		memcpy( &in, &bits, sizeof( in ) );
+		bool first = 0 == count;
+
+		switch ( op ) {
+		  case VOP_FP_AVG:
+		  case VOP_INT_AVG:
+			in *= num;
+			// fall through
+		  case VOP_FP_ADD:
+		  case VOP_INT_ADD:
+			acc += in;
+			break;
+		  case VOP_FP_MIN:
+		  case VOP_INT_MIN:
+			if ( first || in < acc ) { acc = in; obj = from; }
+			break;
+		  case VOP_FP_MAX:
+		  case VOP_INT_MAX:
+			if ( first || in > acc ) { acc = in; obj = from; }
+			break;
+		  default:
+			acc = in;
+			obj = from;
+			break;
+		}
+		count += num;
+		timeStamp = std::max( timeStamp, ts );
+	}
+
+	uint64_t value( ValueOp op ) {
+		double out = acc;
+		uint64_t bits;
+		if ( ( VOP_FP_AVG == op || VOP_INT_AVG == op ) && count ) {
+			out /= count;
+		}
+		memcpy( &bits, &out, sizeof( bits ) );
+		return bits;
+	}
+
+	double		acc;
+	uint64_t	count;
+	ObjHandle	obj;
+	PWR_Time	timeStamp;
+};
+
+}
+
+#endif
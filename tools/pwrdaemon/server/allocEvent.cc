@@ -28,7 +28,7 @@ Event* PWR_Server::allocRtrEvent( unsigned int type, SerialBuf& buf )
 	  default:
 		assert(0);	
 	  case Router2Router:
-		return new SrvrRouterEvent( buf );
+		return EventPool<SrvrRouterEvent>::get( buf );
 	}
 	return NULL;
 }
@@ -45,7 +45,7 @@ Event* PWR_Server::allocReqEvent( unsigned int type, SerialBuf& buf )
       case CommDestroy:
         return new SrvrCommDestroyEvent( buf );
       case CommReq:
-        return new SrvrCommReqEvent( buf );
+        return EventPool<SrvrCommReqEvent>::get( buf );
       case CommLogReq:
         return new SrvrCommLogReqEvent( buf );
       case CommGetSamplesReq:
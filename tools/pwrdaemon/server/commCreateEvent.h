@@ -25,12 +25,19 @@ class SrvrCommCreateEvent: public  CommCreateEvent {
 
     	CommInfo& cInfo = info.m_commMap[commID];
     	cInfo.objects.resize( members.size() );
+		cInfo.handle = NO_HANDLE;
     	assert( 1 == members[0].size() );
 
     	for ( unsigned int i = 0; i < members[0].size(); i++ ) {
         	std::string& name = members[0][i];
         	DBGX("get object %s\n", name.c_str());
-        	PWR_CntxtGetObjByName(info.m_ctx, name.c_str(), &(cInfo.objects[i]) );
+			if ( 1 == handles.size() && i < handles[0].size() ) { 
+				cInfo.handle = handles[0][i];
+				cInfo.objects[i] = info.getObjByHandle( cInfo.handle, name );
+			} else {
+        		PWR_CntxtGetObjByName(info.m_ctx, name.c_str(), 
+										&(cInfo.objects[i]) );
+			}
         	assert( cInfo.objects[i] );
    		}	
 		return true;
@@ -76,9 +76,8 @@ static void logReqFini( void* _data )
     while ( PWR_RET_EMPTY != PWR_StatusPopError( status, &error ) ) {
         data->m_respEvent.errValue.push_back( error.error ) ;
         data->m_respEvent.errAttr.push_back( error.name ) ;
-        char name[100];
-        PWR_ObjGetName( error.obj, name, 100 );
-        data->m_respEvent.errObj.push_back( name );
+        data->m_info->addErrObj( data->commID, error.obj, 
+        				data->m_respEvent.errObj, data->m_respEvent.errHandle );
     }
 
 	PWR_StatusDestroy( data->m_status );
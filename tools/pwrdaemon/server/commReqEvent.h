@@ -26,10 +26,24 @@ class SrvrCommReqEvent: public  CommReqEvent {
 		}
 	}
 
+	// the response is not decoded, clear what the last request left in it
+	void release() {
+		if ( m_req ) {
+			PWR_ReqDestroy( m_req );
+			m_req = NULL;
+		}
+		m_respEvent.errValue.clear();
+		m_respEvent.errAttr.clear();
+		m_respEvent.errObj.clear();
+		m_respEvent.errHandle.clear();
+		EventPool<SrvrCommReqEvent>::put( this );
+	}
+
 	bool process( EventGenerator* gen, EventChannel* ) {
 		m_info = static_cast<Server*>(gen);
 
-    	PWR_Obj obj = m_info->m_commMap[commID].objects[0];
+		CommInfo& cInfo = m_info->m_commMap[commID];
+    	PWR_Obj obj = cInfo.objects[0];
 
 		DBGX("commID=%"PRIx64" grpIndex=%"PRIu64"\n",commID, grpIndex);
 		char name[100];
@@ -45,6 +59,16 @@ class SrvrCommReqEvent: public  CommReqEvent {
 			m_respEvent.timeStamp.resize(1);
 			m_respEvent.value[0].resize(attrName.size());
 			m_respEvent.timeStamp[0].resize(attrName.size());
+			// the router weighs and identifies this object's values
+			m_respEvent.count.assign( 1, 
+						std::vector<uint64_t>( attrName.size(), 1 ) );
+			m_respEvent.valueObj.assign( 1, 
+						std::vector<ObjHandle>( attrName.size(), cInfo.handle ) );
+		} else {
+			m_respEvent.value.clear();
+			m_respEvent.timeStamp.clear();
+			m_respEvent.count.clear();
+			m_respEvent.valueObj.clear();
 		}
 
 		m_respEvent.op = op;
@@ -92,9 +116,8 @@ static void requestFini( void* _data )
 	while ( PWR_RET_EMPTY != PWR_StatusPopError( status, &error ) ) {
     	data->m_respEvent.errValue.push_back( error.error ) ;
     	data->m_respEvent.errAttr.push_back( error.name ) ;
-		char name[100];
-		PWR_ObjGetName( error.obj, name, 100 );	
-    	data->m_respEvent.errObj.push_back( name ); 
+		data->m_info->addErrObj( data->commID, error.obj, 
+						data->m_respEvent.errObj, data->m_respEvent.errHandle );
 	} 
 
 	PWR_StatusDestroy( data->m_status );
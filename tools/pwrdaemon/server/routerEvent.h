@@ -23,6 +23,8 @@ class SrvrRouterEvent: public RouterEvent {
 		DBGX("\n");
 	}  
 
+	void release() { EventPool<SrvrRouterEvent>::put( this ); }
+
 	bool process( EventGenerator* gen, EventChannel* ec ) {
 
         Server* info = static_cast<Server*>(gen);
@@ -33,7 +35,7 @@ class SrvrRouterEvent: public RouterEvent {
        	info->initFini( ev, this, ec );
 
         if ( ev->process( gen ) ) {
-            delete ev;
+            ev->release();
 			info->freeFini( ev );
 			return true;
         } else {
@@ -42,11 +42,17 @@ Server::Server( int argc, char* argv[] )
     EventChannel* rtrChan = getEventChannel( "TCP", allocRtrEvent, 
 			"server=" + m_args.host + " serverPort=" + m_args.port, "router" );
 
+	// responses queue up and go out together once per loop iteration
+	rtrChan->setOutputQueue( true );
+
 	m_chanSelect = getChannelSelect("TCP");
 	assert( m_chanSelect );
 	if ( ctxChan ) {
     	m_chanSelect->addChannel( ctxChan, new CntxtData( ctxChan ) ); 
 	}
+	// device reads complete on this channel instead of blocking the loop
+	EventChannel* devChan = PWR_CntxtGetDevEventChannel( m_ctx );
+    m_chanSelect->addChannel( devChan, new DevData( devChan ) ); 
     m_chanSelect->addChannel( rtrChan, new RouterData( rtrChan ) );
     
 	ServerConnectEvent* ev = new ServerConnectEvent;	
@@ -95,16 +101,68 @@ void Server::fini( Event* key, Event* payload )
 	EventChannel* ec = static_cast<EventChannel*>(m_finiMap[key].second);
 
 	DBGX("src=%" PRIx64 " dest=%" PRIx64"\n",re->dest,re->src);
-    RouterEvent* ev = new RouterEvent( re->dest, re->src, payload );
-    ec->sendEvent( ev );
+	m_sendEvent.src = re->dest;
+	m_sendEvent.dest = re->src;
+	m_sendEvent.initPayload( payload, ec->getVersion() );
+    ec->sendEvent( &m_sendEvent );
 
-	delete ev;
-	delete re;
-	delete key;
+	re->release();
+	key->release();
 	m_finiMap.erase(key);
 }
 
+// A client's handle is the object's index in its configuration.  It is
+// looked up in ours, which bounds it, and only used if ours has the object
+// the client named there, otherwise the handle is cleared and the object
+// is found by name.
+PWR_Obj Server::getObjByHandle( ObjHandle& handle, const std::string& name )
+{
+	PWR_Obj obj = NULL;
+	if ( handle < m_objByHandle.size() ) {
+		obj = m_objByHandle[handle];
+	}
+	if ( NULL == obj ) {
+		PWR_CntxtGetObjByHandle( m_ctx, handle, &obj );
+		if ( obj ) {
+			if ( handle >= m_objByHandle.size() ) {
+				m_objByHandle.resize( handle + 1, NULL );
+			}
+			m_objByHandle[handle] = obj;
+		}
+	}
+
+	if ( obj ) {
+		char objName[256];
+		PWR_ObjGetName( obj, objName, sizeof(objName) );
+		if ( name == objName ) {
+			return obj;
+		}
+		DBGX("handle %u is `%s`, not `%s`\n", handle, objName, name.c_str());
+	}
 
+	handle = NO_HANDLE;
+	PWR_CntxtGetObjByName( m_ctx, name.c_str(), &obj );
+	return obj;
+}
+
+// report an error's object by handle if its communicator was created with
+// one, the client only knows handles of its own configuration
+void Server::addErrObj( CommID commID, PWR_Obj obj, std::vector<ObjID>& errObj,
+									std::vector<ObjHandle>& errHandle )
+{
+	std::map<CommID,CommInfo>::iterator iter = m_commMap.find( commID );
+	if ( iter != m_commMap.end() && NO_HANDLE != iter->second.handle &&
+									obj == iter->second.objects[0] ) {
+		errObj.push_back( "" );
+		errHandle.push_back( iter->second.handle );
+	} else {
+		char name[100];
+		PWR_ObjGetName( obj, name, 100 );
+		errObj.push_back( name );
+		errHandle.push_back( NO_HANDLE );
+	}
+}
+ 
 #include <getopt.h>
 static void print_usage() {
     printf("Server::%s()\n",__func__);
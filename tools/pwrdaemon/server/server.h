@@ -8,13 +8,17 @@
 #include <eventChannel.h>
 #include <events.h>
 #include "debug.h"
+#include "../router/routerEvent.h"
 
 class EventChannel;
 
 namespace PWR_Server { 
 
+// handle is the client's handle of the object, NO_HANDLE if the client
+// did not give one or it does not name the same object here
 struct CommInfo {
 	std::vector<PWR_Obj> objects;
+	ObjHandle handle;
 };
 
 struct Args {
@@ -41,10 +45,21 @@ class Server : public EventGenerator {
 	void initFini( Event* key, Event*, EventChannel* );
 	void freeFini( Event* key );
 
+	PWR_Obj getObjByHandle( ObjHandle&, const std::string& name );
+	void addErrObj( CommID, PWR_Obj, std::vector<ObjID>&, 
+										std::vector<ObjHandle>& );
+
   private:
 	ChannelSelect*  m_chanSelect;
 	Args			m_args;
 	std::map<Event*, std::pair<Event*,EventChannel*> > m_finiMap;
+
+	// objects communicators were created with, by their index in our
+	// configuration, looked up once
+	std::vector<PWR_Obj>			m_objByHandle;
+
+	// wraps every response, its payload buffer is reused
+	RouterEvent		m_sendEvent;
 };
 
 class SelectData : public ChannelSelect::Data {
@@ -64,15 +79,17 @@ class RouterData : public SelectData {
         SelectData( chan )
     { }
     bool process( Server* gen ) {
-        Event* event = m_chan->getEvent();
-		if ( NULL == event ) {
-			return true;
-		} else { 
+		// drain everything the last read brought in
+		do {
+        	Event* event = m_chan->getEvent();
+			if ( NULL == event ) {
+				return true;
+			}
         	if ( event->process( gen, m_chan ) ) { 
-				delete event;	
+				event->release();
 			}	
-			return false;
-		}
+		} while ( m_chan->pending() );
+		return false;
     }
 };
 
@@ -91,6 +108,21 @@ class CntxtData : public SelectData {
     }
 };
 
+class DevData : public SelectData {
+  public:
+    DevData(  EventChannel* chan ) :
+        SelectData( chan )
+    { }
+
+    bool process( Server* gen ) {
+        if ( PWR_RET_SUCCESS == PWR_CntxtMakeDevProgress( gen->m_ctx ) ) {
+        	return false;
+		} else {
+        	return true;
+		}
+    }
+};
+
 }
 
 #endif